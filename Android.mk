@@ -43,8 +43,12 @@ srcs +=	adbg/src/adbg_case.c \
 	adbg/src/adbg_run.c \
 	adbg/src/security_utils_hex.c \
 	aes_perf.c \
+	arith_perf.c \
 	benchmark_1000.c \
 	benchmark_2000.c \
+	crypto_common.c \
+	crypto_perf.c \
+	perf_output.c \
 	regression_4000.c \
 	regression_4100.c \
 	regression_5000.c \
@@ -0,0 +1,602 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Copyright (c) 2026, Linaro Limited
+ */
+
+/*
+ * Native microbenchmark for the crypt TA reference crypto.
+ *
+ * ta/crypt/aes_impl.c and ta/crypt/sha2_impl.c are built for the host
+ * (x86-64 or AArch64 Linux) and timed directly, so changes to those
+ * kernels can be measured without an OP-TEE round trip. Results are
+ * reported in cycles/byte for each buffer size. When built with
+ * OPENSSL_FOUND the outputs are also cross-checked against, and timed
+ * next to, the OpenSSL EVP equivalents.
+ */
+
+#include <linux/perf_event.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+#ifdef OPENSSL_FOUND
+#include <openssl/evp.h>
+#endif
+
+#include <aes_impl.h>
+#include <sha2_impl.h>
+
+#define ARRAY_SIZE(x)		(sizeof(x) / sizeof((x)[0]))
+
+#define AES_KEY_BITS		256
+#define AES_BLK			16
+#define MAX_SIZES		32
+#define DEF_BYTES		(4 * 1024 * 1024)
+#define DEF_REPEAT		5
+
+enum op_kind { OP_ENCRYPT, OP_DECRYPT, OP_DIGEST };
+
+struct bench_op {
+	const char *algo;
+	const char *impl;
+	enum op_kind kind;
+	/* OpenSSL name of the equivalent cipher or digest */
+	const char *ossl_name;
+	void (*run)(const uint8_t *in, uint8_t *out, size_t len);
+};
+
+static unsigned long rk_enc[RKLENGTH(AES_KEY_BITS)];
+static unsigned long rk_dec[RKLENGTH(AES_KEY_BITS)];
+static struct rijndael_bs_key bs_key;
+static uint8_t aes_key[AES_KEY_BITS / 8];
+
+static void aes_enc_ref(const uint8_t *in, uint8_t *out, size_t len)
+{
+	size_t n = 0;
+
+	for (n = 0; n < len; n += AES_BLK)
+		rijndaelEncrypt(rk_enc, NROUNDS(AES_KEY_BITS), in + n, out + n);
+}
+
+static void aes_dec_ref(const uint8_t *in, uint8_t *out, size_t len)
+{
+	size_t n = 0;
+
+	for (n = 0; n < len; n += AES_BLK)
+		rijndaelDecrypt(rk_dec, NROUNDS(AES_KEY_BITS), in + n, out + n);
+}
+
+static void aes_enc_mb(const uint8_t *in, uint8_t *out, size_t len)
+{
+	rijndaelEncryptBlocks(rk_enc, NROUNDS(AES_KEY_BITS), in, out,
+			      len / AES_BLK);
+}
+
+static void aes_dec_mb(const uint8_t *in, uint8_t *out, size_t len)
+{
+	rijndaelDecryptBlocks(rk_dec, NROUNDS(AES_KEY_BITS), in, out,
+			      len / AES_BLK);
+}
+
+static void aes_enc_bs(const uint8_t *in, uint8_t *out, size_t len)
+{
+	rijndaelEncryptBitsliced(&bs_key, in, out, len / AES_BLK);
+}
+
+static void aes_dec_bs(const uint8_t *in, uint8_t *out, size_t len)
+{
+	rijndaelDecryptBitsliced(&bs_key, in, out, len / AES_BLK);
+}
+
+static void sha256_ref(const uint8_t *in, uint8_t *out, size_t len)
+{
+	sha256(in, len, out);
+}
+
+static void sha256_window(const uint8_t *in, uint8_t *out, size_t len)
+{
+	sha256_fast(in, len, out);
+}
+
+static void sha384_ref(const uint8_t *in, uint8_t *out, size_t len)
+{
+	sha384(in, len, out);
+}
+
+static void sha512_ref(const uint8_t *in, uint8_t *out, size_t len)
+{
+	sha512(in, len, out);
+}
+
+static const struct bench_op ops[] = {
+	{ "aes256-ecb-enc", "reference", OP_ENCRYPT, "aes-256-ecb",
+	  aes_enc_ref },
+	{ "aes256-ecb-enc", "multiblock", OP_ENCRYPT, "aes-256-ecb",
+	  aes_enc_mb },
+	{ "aes256-ecb-enc", "bitsliced", OP_ENCRYPT, "aes-256-ecb",
+	  aes_enc_bs },
+	{ "aes256-ecb-dec", "reference", OP_DECRYPT, "aes-256-ecb",
+	  aes_dec_ref },
+	{ "aes256-ecb-dec", "multiblock", OP_DECRYPT, "aes-256-ecb",
+	  aes_dec_mb },
+	{ "aes256-ecb-dec", "bitsliced", OP_DECRYPT, "aes-256-ecb",
+	  aes_dec_bs },
+	{ "sha256", "reference", OP_DIGEST, "sha256", sha256_ref },
+	{ "sha256", "fast", OP_DIGEST, "sha256", sha256_window },
+	{ "sha384", "reference", OP_DIGEST, "sha384", sha384_ref },
+	{ "sha512", "reference", OP_DIGEST, "sha512", sha512_ref },
+};
+
+static size_t op_out_size(const struct bench_op *op, size_t len)
+{
+	if (op->kind != OP_DIGEST)
+		return len;
+	if (!strcmp(op->algo, "sha384"))
+		return SHA384_DIGEST_SIZE;
+	if (!strcmp(op->algo, "sha512"))
+		return SHA512_DIGEST_SIZE;
+	return SHA256_DIGEST_SIZE;
+}
+
+static bool op_accepts(const struct bench_op *op, size_t len)
+{
+	return op->kind == OP_DIGEST || (len && !(len % AES_BLK));
+}
+
+/*
+ * Cycle counter: the PMU cycle counter through perf_event_open() when
+ * available, the TSC on x86-64 otherwise. With -f, or when neither is
+ * usable, cycles are derived from CLOCK_MONOTONIC.
+ */
+enum clk_src { CLK_PERF, CLK_TSC, CLK_NSEC };
+
+static enum clk_src clk_src = CLK_NSEC;
+static int perf_fd = -1;
+static double clk_mhz;
+
+static const char *clk_name(void)
+{
+	switch (clk_src) {
+	case CLK_PERF:
+		return "perf cpu-cycles";
+	case CLK_TSC:
+		return "tsc";
+	default:
+		return clk_mhz > 0 ? "clock_gettime x MHz" : "none";
+	}
+}
+
+static void clk_init(void)
+{
+	struct perf_event_attr attr;
+
+	if (clk_mhz > 0)
+		return;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.size = sizeof(attr);
+	attr.config = PERF_COUNT_HW_CPU_CYCLES;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	perf_fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+	if (perf_fd >= 0) {
+		clk_src = CLK_PERF;
+		return;
+	}
+#if defined(__x86_64__)
+	clk_src = CLK_TSC;
+#endif
+}
+
+static uint64_t clk_cycles(void)
+{
+	uint64_t v = 0;
+
+	switch (clk_src) {
+	case CLK_PERF:
+		if (read(perf_fd, &v, sizeof(v)) != sizeof(v))
+			return 0;
+		return v;
+#if defined(__x86_64__)
+	case CLK_TSC:
+		return __rdtsc();
+#endif
+	default:
+		return 0;
+	}
+}
+
+static uint64_t clk_nsec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+#ifdef OPENSSL_FOUND
+static EVP_CIPHER_CTX *ossl_cctx;
+static EVP_MD_CTX *ossl_mdctx;
+static const EVP_MD *ossl_md;
+
+static int ossl_prepare(const struct bench_op *op)
+{
+	const EVP_CIPHER *cipher = NULL;
+
+	if (op->kind == OP_DIGEST) {
+		ossl_md = EVP_get_digestbyname(op->ossl_name);
+		return ossl_md ? 0 : -1;
+	}
+
+	cipher = EVP_get_cipherbyname(op->ossl_name);
+	if (!cipher || !EVP_CipherInit_ex(ossl_cctx, cipher, NULL, aes_key,
+					  NULL, op->kind == OP_ENCRYPT))
+		return -1;
+	EVP_CIPHER_CTX_set_padding(ossl_cctx, 0);
+	return 0;
+}
+
+static void ossl_run(const struct bench_op *op, const uint8_t *in,
+		     uint8_t *out, size_t len)
+{
+	unsigned int mdlen = 0;
+	int outl = 0;
+
+	if (op->kind == OP_DIGEST) {
+		EVP_DigestInit_ex(ossl_mdctx, ossl_md, NULL);
+		EVP_DigestUpdate(ossl_mdctx, in, len);
+		EVP_DigestFinal_ex(ossl_mdctx, out, &mdlen);
+	} else {
+		EVP_CipherUpdate(ossl_cctx, out, &outl, in, len);
+	}
+}
+#endif
+
+struct bench_res {
+	double cpb;
+	double nspb;
+};
+
+/*
+ * Runs @op (or its OpenSSL equivalent) over about @bytes of input in
+ * @len sized calls, @repeat times, and keeps the fastest pass.
+ */
+static void bench_one(const struct bench_op *op, bool ossl, const uint8_t *in,
+		      uint8_t *out, size_t len, size_t bytes,
+		      unsigned int repeat, struct bench_res *res)
+{
+	size_t loops = bytes / len ? bytes / len : 1;
+	double best_c = 0;
+	double best_ns = 0;
+	unsigned int r = 0;
+	size_t n = 0;
+
+	/* Warm up caches and branch predictors */
+	for (n = 0; n < loops / 16 + 1; n++) {
+#ifdef OPENSSL_FOUND
+		if (ossl)
+			ossl_run(op, in, out, len);
+		else
+#endif
+			op->run(in, out, len);
+	}
+
+	for (r = 0; r < repeat; r++) {
+		uint64_t c0 = clk_cycles();
+		uint64_t t0 = clk_nsec();
+		double c = 0;
+		double ns = 0;
+
+		for (n = 0; n < loops; n++) {
+#ifdef OPENSSL_FOUND
+			if (ossl)
+				ossl_run(op, in, out, len);
+			else
+#endif
+				op->run(in, out, len);
+		}
+
+		ns = (double)(clk_nsec() - t0) / (loops * len);
+		c = (double)(clk_cycles() - c0) / (loops * len);
+		if (clk_src == CLK_NSEC)
+			c = ns * clk_mhz / 1000;
+		if (!r || ns < best_ns)
+			best_ns = ns;
+		if (!r || c < best_c)
+			best_c = c;
+	}
+
+	(void)ossl;
+	res->cpb = best_c;
+	res->nspb = best_ns;
+}
+
+static void fill_random(uint8_t *buf, size_t len)
+{
+	size_t n = 0;
+
+	for (n = 0; n < len; n++)
+		buf[n] = rand();
+}
+
+static void print_res(const struct bench_op *op, const char *impl, size_t len,
+		      const struct bench_res *res, const struct bench_res *base)
+{
+	printf("%-16s %-10s %7zu", op->algo, impl, len);
+	if (clk_src != CLK_NSEC || clk_mhz > 0)
+		printf(" %10.2f", res->cpb);
+	else
+		printf(" %10s", "-");
+	printf(" %9.3f %9.1f", res->nspb, 1e9 / res->nspb / (1024 * 1024));
+	if (base)
+		printf(" %8.2fx", res->nspb / base->nspb);
+	printf("\n");
+}
+
+/*
+ * Checks @op against the OpenSSL equivalent, or against the reference
+ * implementation of the same algorithm when OpenSSL is not available.
+ * Decryption is also checked to invert encryption.
+ */
+static int check_one(const struct bench_op *op, uint8_t *in, uint8_t *out,
+		     uint8_t *exp, size_t len)
+{
+	size_t olen = op_out_size(op, len);
+
+	fill_random(in, len);
+	op->run(in, out, len);
+
+#ifdef OPENSSL_FOUND
+	if (ossl_prepare(op)) {
+		fprintf(stderr, "%s: no OpenSSL %s\n", op->algo,
+			op->ossl_name);
+		return -1;
+	}
+	ossl_run(op, in, exp, len);
+#else
+	if (op->kind == OP_DIGEST) {
+		size_t i = 0;
+
+		for (i = 0; i < ARRAY_SIZE(ops); i++) {
+			if (!strcmp(ops[i].algo, op->algo)) {
+				ops[i].run(in, exp, len);
+				break;
+			}
+		}
+	} else if (op->kind == OP_ENCRYPT) {
+		aes_enc_ref(in, exp, len);
+	} else {
+		aes_dec_ref(in, exp, len);
+	}
+#endif
+	if (memcmp(out, exp, olen)) {
+		fprintf(stderr, "%s %s: mismatch at %zu bytes\n", op->algo,
+			op->impl, len);
+		return -1;
+	}
+
+	if (op->kind == OP_DECRYPT) {
+		aes_enc_ref(out, exp, len);
+		if (memcmp(in, exp, len)) {
+			fprintf(stderr, "%s %s: no round trip at %zu bytes\n",
+				op->algo, op->impl, len);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static int check_all(const char *filter, uint8_t *in, uint8_t *out,
+		     uint8_t *exp)
+{
+	static const size_t lens[] = {
+		0, 1, 16, 55, 56, 63, 64, 65, 80, 111, 112, 127, 128, 129,
+		240, 1000, 4096, 4097,
+	};
+	size_t i = 0;
+	size_t j = 0;
+	int res = 0;
+
+	for (i = 0; i < ARRAY_SIZE(ops); i++) {
+		if (filter && !strstr(ops[i].algo, filter) &&
+		    strcmp(ops[i].impl, filter))
+			continue;
+		for (j = 0; j < ARRAY_SIZE(lens); j++)
+			if (op_accepts(&ops[i], lens[j]) &&
+			    check_one(&ops[i], in, out, exp, lens[j]))
+				res = -1;
+	}
+	return res;
+}
+
+static int parse_sizes(char *arg, size_t *sizes, size_t *count)
+{
+	char *tok = NULL;
+	char *end = NULL;
+	unsigned long v = 0;
+
+	*count = 0;
+	for (tok = strtok(arg, ","); tok; tok = strtok(NULL, ",")) {
+		v = strtoul(tok, &end, 0);
+		if (!v || *end || *count == MAX_SIZES)
+			return -1;
+		sizes[(*count)++] = v;
+	}
+	return *count ? 0 : -1;
+}
+
+static void usage(const char *progname)
+{
+	fprintf(stderr, "Usage: %s [-h] [-c] [-a ALGO] [-s SIZES] [-b BYTES] [-r N] [-f MHZ]\n",
+		progname);
+	fprintf(stderr, "  -h        Print this help and exit\n");
+	fprintf(stderr, "  -c        Only cross-check the implementations\n");
+	fprintf(stderr, "  -a ALGO   Only run algorithms or implementations matching ALGO\n");
+	fprintf(stderr, "  -s SIZES  Comma separated buffer sizes [16,64,256,1024,8192,65536]\n");
+	fprintf(stderr, "  -b BYTES  Bytes processed per pass [%d]\n", DEF_BYTES);
+	fprintf(stderr, "  -r N      Passes per measurement, fastest is kept [%d]\n",
+		DEF_REPEAT);
+	fprintf(stderr, "  -f MHZ    Derive cycles from elapsed time at this CPU frequency\n");
+}
+
+int main(int argc, char *argv[])
+{
+	size_t sizes[MAX_SIZES] = { 16, 64, 256, 1024, 8192, 65536 };
+	size_t nsizes = 6;
+	size_t bytes = DEF_BYTES;
+	unsigned int repeat = DEF_REPEAT;
+	const char *filter = NULL;
+	const char *last_algo = NULL;
+	bool check_only = false;
+	size_t max_len = 4097;
+	uint8_t *in = NULL;
+	uint8_t *out = NULL;
+	uint8_t *exp = NULL;
+	size_t i = 0;
+	size_t j = 0;
+	int ret = EXIT_FAILURE;
+	int opt = 0;
+
+	while ((opt = getopt(argc, argv, "hca:s:b:r:f:")) != -1) {
+		switch (opt) {
+		case 'c':
+			check_only = true;
+			break;
+		case 'a':
+			filter = optarg;
+			break;
+		case 's':
+			if (parse_sizes(optarg, sizes, &nsizes)) {
+				fprintf(stderr, "Invalid size list\n");
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'b':
+			bytes = strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			repeat = strtoul(optarg, NULL, 0);
+			break;
+		case 'f':
+			clk_mhz = strtod(optarg, NULL);
+			break;
+		case 'h':
+			usage(argv[0]);
+			return EXIT_SUCCESS;
+		default:
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (!bytes || !repeat) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	for (i = 0; i < nsizes; i++)
+		if (sizes[i] > max_len)
+			max_len = sizes[i];
+	in = malloc(max_len);
+	out = malloc(max_len);
+	exp = malloc(max_len);
+	if (!in || !out || !exp) {
+		fprintf(stderr, "Out of memory\n");
+		goto out;
+	}
+
+	srand(1);
+	fill_random(aes_key, sizeof(aes_key));
+	rijndaelSetupEncrypt(rk_enc, aes_key, AES_KEY_BITS);
+	rijndaelSetupDecrypt(rk_dec, aes_key, AES_KEY_BITS);
+	rijndaelSetupBitsliced(&bs_key, aes_key, AES_KEY_BITS);
+#ifdef OPENSSL_FOUND
+	ossl_cctx = EVP_CIPHER_CTX_new();
+	ossl_mdctx = EVP_MD_CTX_new();
+	if (!ossl_cctx || !ossl_mdctx) {
+		fprintf(stderr, "Out of memory\n");
+		goto out;
+	}
+#endif
+
+	if (check_all(filter, in, out, exp))
+		goto out;
+#ifdef OPENSSL_FOUND
+	printf("Cross-check against OpenSSL: OK\n");
+#else
+	printf("Cross-check against reference: OK\n");
+#endif
+	if (check_only) {
+		ret = EXIT_SUCCESS;
+		goto out;
+	}
+
+	clk_init();
+	printf("Cycle counter: %s\n", clk_name());
+	printf("%-16s %-10s %7s %10s %9s %9s%s\n", "algorithm", "impl", "size",
+	       "cycles/B", "ns/B", "MiB/s",
+#ifdef OPENSSL_FOUND
+	       "  x openssl"
+#else
+	       ""
+#endif
+	       );
+
+	fill_random(in, max_len);
+	for (i = 0; i < ARRAY_SIZE(ops); i++) {
+		const struct bench_op *op = ops + i;
+		bool first = false;
+
+		if (filter && !strstr(op->algo, filter) &&
+		    strcmp(op->impl, filter))
+			continue;
+		/* One block per algorithm, with the OpenSSL rows printed once */
+		first = !last_algo || strcmp(last_algo, op->algo);
+		if (first && last_algo)
+			printf("\n");
+		last_algo = op->algo;
+
+		for (j = 0; j < nsizes; j++) {
+			struct bench_res res = { };
+			struct bench_res *base = NULL;
+#ifdef OPENSSL_FOUND
+			struct bench_res ossl_res = { };
+#endif
+
+			if (!op_accepts(op, sizes[j]))
+				continue;
+#ifdef OPENSSL_FOUND
+			if (ossl_prepare(op))
+				goto out;
+			bench_one(op, true, in, out, sizes[j], bytes, repeat,
+				  &ossl_res);
+			if (first)
+				print_res(op, "openssl", sizes[j], &ossl_res,
+					  NULL);
+			base = &ossl_res;
+#endif
+			bench_one(op, false, in, out, sizes[j], bytes, repeat,
+				  &res);
+			print_res(op, op->impl, sizes[j], &res, base);
+		}
+	}
+	ret = EXIT_SUCCESS;
+out:
+#ifdef OPENSSL_FOUND
+	EVP_CIPHER_CTX_free(ossl_cctx);
+	EVP_MD_CTX_free(ossl_mdctx);
+#endif
+	if (perf_fd >= 0)
+		close(perf_fd);
+	free(in);
+	free(out);
+	free(exp);
+	return ret;
+}
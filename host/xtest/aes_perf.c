@@ -27,6 +27,7 @@
 
 #include <fcntl.h>
 #include <math.h>
+#include <pthread.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -43,6 +44,7 @@
 #include <unistd.h>
 
 #include "crypto_common.h"
+#include "xtest_helpers.h"
 
 #ifdef CFG_SECURE_DATA_PATH
 #include "sdp_basic.h"
@@ -95,6 +97,50 @@ static const char *buf_type_str(int buf_type)
 /* Are we running a SDP test: default to NO (is_sdp_test == 0) */
 static int is_sdp_test;
 
+/* Scaling test up to num_threads concurrent sessions (0: single session) */
+static unsigned int num_threads;
+
+/* Print the full latency histogram (--hist) */
+static int dump_hist;
+
+/* Buffer size sweep (-s START:END:xFACTOR), sweep.factor == 0 when unused */
+static struct size_sweep sweep;
+
+/*
+ * Key agility: number of keys in the TA key pool (--key-pool P), rekey
+ * before every N-th invoke (--rekey-invokes N) or every N bytes inside the
+ * TA (--rekey-bytes N). All 0 when unused.
+ */
+static unsigned int key_pool;
+static unsigned int rekey_invokes;
+static unsigned int rekey_bytes;
+
+/* Skip the invocation baseline measurement (--no-baseline) */
+static int no_baseline;
+
+/* Buffers in flight in pipelined mode (--pipeline K), 0 when unused */
+static unsigned int pipeline_depth;
+
+/* Records of size bytes processed per invoke (--batch N), 0 when unused */
+static unsigned int batch;
+
+/*
+ * Per-message GCM (--aead-msg): each unit is a message with its own AAD
+ * (--aad N bytes) and tag. CCM is always processed this way. Decrypting
+ * such messages needs their tags, computed by the TA before each
+ * measurement (need_tags).
+ */
+static int aead_msg;
+static int aad_len = -1;
+static int need_tags;
+
+/* Run parameters, common to all the result records of a test */
+static struct perf_record params;
+static struct lat_hist hist;
+
+/* Secure-side time returned by the TA */
+static struct ta_time ta_time;
+
 /*
  * TEE client stuff
  */
@@ -111,76 +157,22 @@ static TEEC_SharedMemory in_shm = {
 static TEEC_SharedMemory out_shm = {
 	.flags = TEEC_MEM_INPUT | TEEC_MEM_OUTPUT
 };
-
-static void errx(const char *msg, TEEC_Result res, uint32_t *orig)
-{
-	fprintf(stderr, "%s: 0x%08x", msg, res);
-	if (orig)
-		fprintf(stderr, " (orig=%d)", (int)*orig);
-	fprintf(stderr, "\n");
-	exit (1);
-}
-
-static void check_res(TEEC_Result res, const char *errmsg, uint32_t *orig)
-{
-	if (res != TEEC_SUCCESS)
-		errx(errmsg, res, orig);
-}
-
-static void open_ta(void)
-{
-	TEEC_Result res;
-	TEEC_UUID uuid = TA_AES_PERF_UUID;
-	uint32_t err_origin;
-
-	res = TEEC_InitializeContext(NULL, &ctx);
-	check_res(res, "TEEC_InitializeContext", NULL);
-
-	res = TEEC_OpenSession(&ctx, &sess, &uuid, TEEC_LOGIN_PUBLIC, NULL,
-			       NULL, &err_origin);
-	check_res(res, "TEEC_OpenSession", &err_origin);
-}
-
-/*
- * Statistics
- *
- * We want to compute min, max, mean and standard deviation of processing time
- */
-
-struct statistics {
-	int n;
-	double m;
-	double M2;
-	double min;
-	double max;
-	int initialized;
+/* Segment descriptor table for TA_AES_PERF_CMD_PROCESS_BATCH */
+static TEEC_SharedMemory desc_shm = {
+	.flags = TEEC_MEM_INPUT
 };
 
-/* Take new sample into account (Knuth/Welford algorithm) */
-static void update_stats(struct statistics *s, uint64_t t)
+static const TEEC_UUID ta_uuid = TA_AES_PERF_UUID;
+
+static void open_session(TEEC_Session *s)
 {
-	double x = (double)t;
-	double delta = x - s->m;
-
-	s->n++;
-	s->m += delta/s->n;
-	s->M2 += delta*(x - s->m);
-	if (!s->initialized) {
-		s->min = s->max = x;
-		s->initialized = 1;
-	} else {
-		if (s->min > x)
-			s->min = x;
-		if (s->max < x)
-			s->max = x;
-	}
+	crypto_open_session(&ctx, s, &ta_uuid);
 }
 
-static double stddev(struct statistics *s)
+static void close_ta(void)
 {
-	if (s->n < 2)
-		return NAN;
-	return sqrt(s->M2/s->n);
+	TEEC_CloseSession(&sess);
+	TEEC_FinalizeContext(&ctx);
 }
 
 static const char *mode_str(uint32_t mode)
@@ -196,6 +188,12 @@ static const char *mode_str(uint32_t mode)
 		return "XTS";
 	case TA_AES_GCM:
 		return "GCM";
+	case TA_AES_CCM:
+		return "CCM";
+	case TA_AES_CTS:
+		return "CTS";
+	case TA_AES_CMAC:
+		return "CMAC";
 	default:
 		return "???";
 	}
@@ -208,9 +206,13 @@ static void usage(const char *progname, int keysize, int mode, size_t size,
 		  size_t unit, int warmup, unsigned int l, unsigned int n)
 {
 	fprintf(stderr, "Usage: %s [-h]\n", progname);
-	fprintf(stderr, "Usage: %s [-d] [-i] [-k SIZE]", progname);
-	fprintf(stderr, " [-l LOOP] [-m MODE] [-n LOOP] [-r|--no-inited] [-s SIZE]");
-	fprintf(stderr, " [-v [-v]] [-w SEC]");
+	fprintf(stderr, "Usage: %s [--aad N] [--aead-msg] [--batch N] [-d]",
+		progname);
+	fprintf(stderr, " [--format FMT] [-i] [-k SIZE] [--key-pool P]");
+	fprintf(stderr, " [--rekey-bytes N] [--rekey-invokes N] [--hist]");
+	fprintf(stderr, " [-l LOOP] [-m MODE] [-n LOOP] [--no-baseline]");
+	fprintf(stderr, " [--output FILE] [--pipeline K] [-r|--no-inited]");
+	fprintf(stderr, " [-s SIZE] [-t|--threads N] [-v [-v]] [-w SEC]");
 #ifdef CFG_SECURE_DATA_PATH
 	fprintf(stderr, " [--sdp [-Id|-Ir|-IR] [-Od|-Or|-OR] [--ion-heap ID]]");
 #endif
@@ -218,16 +220,41 @@ static void usage(const char *progname, int keysize, int mode, size_t size,
 	fprintf(stderr, "AES performance testing tool for OP-TEE\n");
 	fprintf(stderr, "\n");
 	fprintf(stderr, "Options:\n");
-	fprintf(stderr, "  -d            Test AES decryption instead of encryption\n");
+	fprintf(stderr, "  --aad N       AAD bytes per message with --aead-msg or CCM (max %u) [16]\n", TA_AES_PERF_MAX_AAD);
+	fprintf(stderr, "  --aead-msg    GCM: process each unit as a complete message (init, AAD,\n");
+	fprintf(stderr, "                final with tag computation or check) instead of a stream\n");
+	fprintf(stderr, "  --batch N     Process N independent SIZE-byte records, each with its own\n");
+	fprintf(stderr, "                IV, per TA invocation (descriptor table in shared memory)\n");
+	fprintf(stderr, "  -d            Test AES decryption instead of encryption (not with CMAC)\n");
+	fprintf(stderr, "  --format FMT  Result format: text, json (one object per line) or csv [text]\n");
 	fprintf(stderr, "  -h|--help     Print this help and exit\n");
+	fprintf(stderr, "  --hist        Print the full latency histogram\n");
 	fprintf(stderr, "  -i|--in-place Use same buffer for input and output (decrypt in place)\n");
 	fprintf(stderr, "  -k SIZE       Key size in bits: 128, 192 or 256 [%u]\n", keysize);
+	fprintf(stderr, "  --key-pool P  Key agility: create a pool of P keys (max %u) in the TA and\n", TA_AES_PERF_MAX_KEYS);
+	fprintf(stderr, "                time the key setup (TEE_SetOperationKey + init) alone\n");
 	fprintf(stderr, "  -l LOOP       Inner loop iterations [%u]\n", l);
-	fprintf(stderr, "  -m MODE       AES mode: ECB, CBC, CTR, XTS, GCM [%s]\n", mode_str(mode));
+	fprintf(stderr, "  -m MODE       AES mode: ECB, CBC, CTR, XTS, GCM, CCM, CTS, CMAC [%s]\n", mode_str(mode));
 	fprintf(stderr, "  -n LOOP       Outer test loop iterations [%u]\n", n);
+	fprintf(stderr, "  --no-baseline Do not measure the invocation baseline (null and value-only\n");
+	fprintf(stderr, "                commands) nor report crypto-only time\n");
 	fprintf(stderr, "  --not-inited  Do not initialize input buffer content.\n");
+	fprintf(stderr, "  --output FILE Write json/csv results to FILE instead of stdout\n");
+	fprintf(stderr, "  --pipeline K  Pipelined mode: K buffers in flight, a producer thread\n");
+	fprintf(stderr, "                refills the next input buffers while the TA processes\n");
+	fprintf(stderr, "                the current one; reports end-to-end and invoke MiB/s\n");
+	fprintf(stderr, "  --rekey-bytes N    Switch to the next pool key every N bytes, in the TA\n");
+	fprintf(stderr, "                     (sets -u N unless -u is given)\n");
+	fprintf(stderr, "  --rekey-invokes N  Switch to the next pool key before every N-th invoke,\n");
+	fprintf(stderr, "                     the rekey invoke is included in the measured time\n");
 	fprintf(stderr, "  -r|--random   Get input data from /dev/urandom (default: all zeros)\n");
-	fprintf(stderr, "  -s SIZE       Test buffer size in bytes [%zu]\n", size);
+	fprintf(stderr, "  -s SIZE       Test buffer size in bytes, K/M suffixes allowed [%zu]\n", size);
+	fprintf(stderr, "  -s START:END[:xF]  Size sweep: test START, START*F, ... up to END\n");
+	fprintf(stderr, "                bytes (F defaults to 2) with a single session and key,\n");
+	fprintf(stderr, "                print one row per size and the fixed per-invoke cost\n");
+	fprintf(stderr, "  -t|--threads N  Scaling test: run 1..N threads, one session and\n");
+	fprintf(stderr, "                  buffer pair per thread, and report per-thread and\n");
+	fprintf(stderr, "                  aggregate throughput for each thread count\n");
 	fprintf(stderr, "  -u UNIT       Divide buffer in UNIT-byte increments (+ remainder)\n");
 	fprintf(stderr, "                (0 to ignore) [%zu]\n", unit);
 	fprintf(stderr, "  -v            Be verbose (use twice for greater effect)\n");
@@ -253,7 +280,7 @@ static void register_shm(TEEC_SharedMemory *shm, int fd)
 {
 	TEEC_Result res = TEEC_RegisterSharedMemoryFileDescriptor(&ctx, shm, fd);
 
-	check_res(res, "TEEC_RegisterSharedMemoryFileDescriptor", NULL);
+	crypto_check_res(res, "TEEC_RegisterSharedMemoryFileDescriptor", NULL);
 }
 #endif
 
@@ -264,7 +291,7 @@ static void allocate_shm(TEEC_SharedMemory *shm, size_t sz)
 	shm->buffer = NULL;
 	shm->size = sz;
 	res = TEEC_AllocateSharedMemory(&ctx, shm);
-	check_res(res, "TEEC_AllocateSharedMemory", NULL);
+	crypto_check_res(res, "TEEC_AllocateSharedMemory", NULL);
 }
 
 /* initial test buffer allocation (eventual registering to TEEC) */
@@ -327,49 +354,7 @@ static void free_shm(int in_place)
 #endif /* CFG_SECURE_DATA_PATH */
 }
 
-static ssize_t read_random(void *in, size_t rsize)
-{
-	static int rnd;
-	ssize_t s;
-
-	if (!rnd) {
-		rnd = open("/dev/urandom", O_RDONLY);
-		if (rnd < 0) {
-			perror("open");
-			return 1;
-		}
-	}
-	s = read(rnd, in, rsize);
-	if (s < 0) {
-		perror("read");
-		return 1;
-	}
-	if ((size_t)s != rsize) {
-		printf("read: requested %zu bytes, got %zd\n", rsize, s);
-	}
-
-	return 0;
-}
-
-static void get_current_time(struct timespec *ts)
-{
-	if (clock_gettime(CLOCK_MONOTONIC, ts) < 0) {
-		perror("clock_gettime");
-		exit(1);
-	}
-}
-
-static uint64_t timespec_to_ns(struct timespec *ts)
-{
-	return ((uint64_t)ts->tv_sec * 1000000000) + ts->tv_nsec;
-}
-
-static uint64_t timespec_diff_ns(struct timespec *start, struct timespec *end)
-{
-	return timespec_to_ns(end) - timespec_to_ns(start);
-}
-
-static void prepare_key(int decrypt, int keysize, int mode)
+static void prepare_key(TEEC_Session *s, int decrypt, int keysize, int mode)
 {
 	TEEC_Result res;
 	uint32_t ret_origin;
@@ -382,32 +367,36 @@ static void prepare_key(int decrypt, int keysize, int mode)
 	op.params[0].value.a = decrypt;
 	op.params[0].value.b = keysize;
 	op.params[1].value.a = mode;
-	res = TEEC_InvokeCommand(&sess, cmd, &op,
+	if (aad_len > 0 || aead_msg) {
+		op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT,
+						 TEEC_VALUE_INPUT,
+						 TEEC_VALUE_INPUT, TEEC_NONE);
+		op.params[2].value.a = aad_len;
+		if (aead_msg)
+			op.params[2].value.b = TA_AES_PERF_FLAG_AE_PER_MESSAGE;
+	}
+	res = TEEC_InvokeCommand(s, cmd, &op,
 				 &ret_origin);
-	check_res(res, "TEEC_InvokeCommand", &ret_origin);
+	crypto_check_res(res, "TEEC_InvokeCommand", &ret_origin);
 }
 
-static void do_warmup(int warmup)
+/* Have the TA compute the tags of the @unit-byte messages of the input */
+static void prepare_tags(size_t size, size_t unit)
 {
-	struct timespec t0, t;
-	int i;
-
-	get_current_time(&t0);
-	do {
-		for (i = 0; i < 100000; i++)
-			;
-		get_current_time(&t);
-	} while (timespec_diff_ns(&t0, &t) < (uint64_t)warmup * 1000000000);
-}
-
-static const char *yesno(int v)
-{
-	return (v ? "yes" : "no");
-}
+	TEEC_Result res;
+	uint32_t ret_origin;
+	TEEC_Operation op;
 
-static double mb_per_sec(size_t size, double usec)
-{
-	return (1000000000/usec)*((double)size/(1024*1024));
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_PARTIAL_INPUT,
+					 TEEC_VALUE_INPUT, TEEC_NONE,
+					 TEEC_NONE);
+	op.params[0].memref.parent = &in_shm;
+	op.params[0].memref.size = size;
+	op.params[1].value.a = unit;
+	res = TEEC_InvokeCommand(&sess, TA_AES_PERF_CMD_PREPARE_TAGS, &op,
+				 &ret_origin);
+	crypto_check_res(res, "TEEC_InvokeCommand", &ret_origin);
 }
 
 static void feed_input(void *in, size_t size, int random)
@@ -443,6 +432,637 @@ static void run_feed_input(void *in, size_t size, int random)
 }
 
 
+/*
+ * Scaling test
+ *
+ * Each thread owns a session and a pair of shared memory buffers, so that
+ * the threads only contend inside the TEE. All threads are released at
+ * once by a barrier after setup; the aggregate throughput is computed from
+ * the wall-clock time between the first thread starting its loop and the
+ * last one finishing.
+ */
+
+struct thread_test_args {
+	int mode;
+	int keysize;
+	int decrypt;
+	size_t size;
+	size_t unit;
+	unsigned int n;
+	unsigned int l;
+	int input_data_init;
+	int in_place;
+	pthread_barrier_t barrier;
+};
+
+struct thread_ctx {
+	pthread_t thr;
+	unsigned int id;
+	struct thread_test_args *args;
+	TEEC_Session sess;
+	TEEC_SharedMemory in_shm;
+	TEEC_SharedMemory out_shm;
+	struct statistics stats;
+	struct lat_hist hist;
+	struct timespec start;
+	struct timespec end;
+};
+
+static void *test_thread(void *arg)
+{
+	struct thread_ctx *t = arg;
+	struct thread_test_args *a = t->args;
+	TEEC_Operation op;
+	unsigned int n;
+
+	open_session(&t->sess);
+	prepare_key(&t->sess, a->decrypt, a->keysize, a->mode);
+
+	t->in_shm.flags = TEEC_MEM_INPUT | TEEC_MEM_OUTPUT;
+	allocate_shm(&t->in_shm, a->size);
+	if (!a->in_place) {
+		t->out_shm.flags = TEEC_MEM_INPUT | TEEC_MEM_OUTPUT;
+		allocate_shm(&t->out_shm, a->size);
+	}
+	if (a->input_data_init == CRYPTO_USE_ZEROS)
+		feed_input(t->in_shm.buffer, a->size, 0);
+
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_PARTIAL_INOUT,
+					 TEEC_MEMREF_PARTIAL_INOUT,
+					 TEEC_VALUE_INPUT, TEEC_NONE);
+	op.params[0].memref.parent = &t->in_shm;
+	op.params[0].memref.size = a->size;
+	op.params[1].memref.parent = a->in_place ? &t->in_shm : &t->out_shm;
+	op.params[1].memref.size = a->size;
+	op.params[2].value.a = a->l;
+	op.params[2].value.b = a->unit;
+
+	xtest_barrier_wait(&a->barrier);
+
+	get_current_time(&t->start);
+	for (n = 0; n < a->n; n++) {
+		TEEC_Result res;
+		uint32_t ret_origin;
+		struct timespec t0, t1;
+
+		if (a->input_data_init == CRYPTO_USE_RANDOM)
+			feed_input(t->in_shm.buffer, a->size, 1);
+
+		get_current_time(&t0);
+		res = TEEC_InvokeCommand(&t->sess, TA_AES_PERF_CMD_PROCESS,
+					 &op, &ret_origin);
+		crypto_check_res(res, "TEEC_InvokeCommand", &ret_origin);
+		get_current_time(&t1);
+
+		update_stats(&t->stats, timespec_diff_ns(&t0, &t1));
+		lat_hist_record(&t->hist, timespec_diff_ns(&t0, &t1));
+	}
+	get_current_time(&t->end);
+
+	TEEC_ReleaseSharedMemory(&t->in_shm);
+	if (!a->in_place)
+		TEEC_ReleaseSharedMemory(&t->out_shm);
+	TEEC_CloseSession(&t->sess);
+
+	return NULL;
+}
+
+/*
+ * Run the test with nthr concurrent threads, return aggregate MiB/s. The
+ * latency histograms of all threads are merged into @h, the statistics of
+ * each thread are returned in @thr_stats.
+ */
+static double run_threads(struct thread_test_args *args, unsigned int nthr,
+			  struct lat_hist *h, struct statistics *thr_stats)
+{
+	struct thread_ctx *t;
+	struct timespec *first;
+	struct timespec *last;
+	uint64_t wall_ns;
+	double agg;
+	unsigned int i;
+	int e;
+
+	t = calloc(nthr, sizeof(*t));
+	if (!t) {
+		perror("calloc");
+		exit(1);
+	}
+
+	xtest_barrier_init(&args->barrier, nthr);
+	for (i = 0; i < nthr; i++) {
+		t[i].id = i;
+		t[i].args = args;
+		e = pthread_create(&t[i].thr, NULL, test_thread, &t[i]);
+		if (e) {
+			fprintf(stderr, "pthread_create: %s\n", strerror(e));
+			exit(1);
+		}
+	}
+	for (i = 0; i < nthr; i++) {
+		e = pthread_join(t[i].thr, NULL);
+		if (e) {
+			fprintf(stderr, "pthread_join: %s\n", strerror(e));
+			exit(1);
+		}
+	}
+	xtest_barrier_destroy(&args->barrier);
+
+	first = &t[0].start;
+	last = &t[0].end;
+	for (i = 0; i < nthr; i++) {
+		if (timespec_to_ns(&t[i].start) < timespec_to_ns(first))
+			first = &t[i].start;
+		if (timespec_to_ns(&t[i].end) > timespec_to_ns(last))
+			last = &t[i].end;
+		lat_hist_merge(h, &t[i].hist);
+		thr_stats[i] = t[i].stats;
+	}
+	wall_ns = timespec_diff_ns(first, last);
+	agg = mb_per_sec((size_t)nthr * args->n * args->size,
+			 (double)wall_ns);
+
+	free(t);
+	return agg;
+}
+
+static void run_scaling_test(int mode, int keysize, int decrypt, size_t size,
+			     size_t unit, unsigned int n, unsigned int l,
+			     int input_data_init, int in_place, int verbosity)
+{
+	struct thread_test_args args = {
+		.mode = mode,
+		.keysize = keysize,
+		.decrypt = decrypt,
+		.size = size,
+		.unit = unit,
+		.n = n,
+		.l = l,
+		.input_data_init = input_data_init,
+		.in_place = in_place,
+	};
+	struct statistics *thr_stats;
+	struct perf_record r;
+	double base = 0;
+	double agg;
+	unsigned int i;
+	unsigned int j;
+
+	thr_stats = calloc(num_threads, sizeof(*thr_stats));
+	if (!thr_stats) {
+		perror("calloc");
+		exit(1);
+	}
+
+	if (perf_output_text())
+		printf("threads  aggregate(MiB/s)  speedup  efficiency  p50(us)  p99(us)\n");
+	for (i = 1; i <= num_threads; i++) {
+		lat_hist_init(&hist);
+		agg = run_threads(&args, i, &hist, thr_stats);
+		if (i == 1)
+			base = agg;
+		if (!perf_output_text()) {
+			r = params;
+			perf_record_uint(&r, "size", size);
+			perf_record_uint(&r, "threads", i);
+			perf_record_double(&r, "mib_per_s", agg);
+			perf_record_double(&r, "speedup", agg / base);
+			perf_record_double(&r, "efficiency",
+					   agg / (base * i));
+			perf_record_double(&r, "p50_us",
+				lat_hist_percentile(&hist, 50) / 1000);
+			perf_record_double(&r, "p99_us",
+				lat_hist_percentile(&hist, 99) / 1000);
+			perf_record_emit(&r);
+			continue;
+		}
+		printf("%7u  %16g  %7.2f  %9.1f%%  %7g  %7g\n", i, agg,
+		       agg / base, 100 * agg / (base * i),
+		       lat_hist_percentile(&hist, 50) / 1000,
+		       lat_hist_percentile(&hist, 99) / 1000);
+		for (j = 0; j < i; j++) {
+			printf("  thread %u: %gMiB/s", j,
+			       mb_per_sec(size, thr_stats[j].m));
+			if (verbosity >= 1)
+				printf(" mean=%gus stddev=%gus",
+				       thr_stats[j].m / 1000,
+				       stddev(&thr_stats[j]) / 1000);
+			printf("\n");
+		}
+		if (dump_hist)
+			lat_hist_dump(&hist);
+	}
+	free(thr_stats);
+}
+
+/* Bytes processed per invoke for @size-byte records */
+static size_t batch_bytes(size_t size)
+{
+	return batch ? size * batch : size;
+}
+
+/* One independent @size-byte message per descriptor, each with its own IV */
+static void fill_batch_desc(size_t size)
+{
+	struct ta_aes_perf_batch_desc *d = desc_shm.buffer;
+	unsigned int i;
+
+	memset(d, 0, batch * sizeof(*d));
+	for (i = 0; i < batch; i++) {
+		d[i].offset = i * size;
+		d[i].len = size;
+		d[i].flags = TA_AES_PERF_BATCH_IV;
+		memcpy(d[i].iv, &i, sizeof(i));
+	}
+}
+
+/* Derive a pool of @nkeys keys from the current one in the TA */
+static void prepare_key_pool(TEEC_Session *s, unsigned int nkeys)
+{
+	TEEC_Result res;
+	uint32_t ret_origin;
+	TEEC_Operation op;
+
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT, TEEC_NONE,
+					 TEEC_NONE, TEEC_NONE);
+	op.params[0].value.a = nkeys;
+	res = TEEC_InvokeCommand(s, TA_AES_PERF_CMD_PREPARE_KEY_POOL, &op,
+				 &ret_origin);
+	crypto_check_res(res, "TEEC_InvokeCommand", &ret_origin);
+}
+
+/* Switch to the next key of the pool @count times */
+static void rekey(TEEC_Session *s, uint32_t count, uint32_t *elapsed_us)
+{
+	TEEC_Result res;
+	uint32_t ret_origin;
+	TEEC_Operation op;
+
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT, TEEC_VALUE_OUTPUT,
+					 TEEC_NONE, TEEC_NONE);
+	op.params[0].value.a = count;
+	res = TEEC_InvokeCommand(s, TA_AES_PERF_CMD_REKEY, &op, &ret_origin);
+	crypto_check_res(res, "TEEC_InvokeCommand", &ret_origin);
+	if (elapsed_us)
+		*elapsed_us = op.params[1].value.a;
+}
+
+#define KEY_SETUP_BULK_COUNT	1000
+
+/*
+ * Time the key setup alone (TEE_SetOperationKey() and cipher init): once in
+ * bulk inside the TA, and as n single rekey invocations timed from here.
+ */
+static void measure_key_setup(unsigned int n)
+{
+	struct statistics st;
+	struct timespec t0, t1;
+	uint32_t elapsed_us = 0;
+	double bulk_us;
+	unsigned int i;
+
+	rekey(&sess, KEY_SETUP_BULK_COUNT, &elapsed_us);
+	bulk_us = (double)elapsed_us / KEY_SETUP_BULK_COUNT;
+
+	memset(&st, 0, sizeof(st));
+	for (i = 0; i < n; i++) {
+		get_current_time(&t0);
+		rekey(&sess, 1, NULL);
+		get_current_time(&t1);
+		update_stats(&st, timespec_diff_ns(&t0, &t1));
+	}
+
+	perf_record_double(&params, "key_setup_us", bulk_us);
+	perf_record_double(&params, "rekey_invoke_us", st.m / 1000);
+	if (perf_output_text())
+		printf("key setup: %gus per rekey (in TA, %u keys), rekey invoke: mean=%gus stddev=%gus\n",
+		       bulk_us, key_pool, st.m / 1000, stddev(&st) / 1000);
+}
+
+/*
+ * Run @n timed invocations of @cmd on @size bytes of the test buffers, or on
+ * @batch records of @size bytes
+ */
+static void measure(TEEC_Operation *op, uint32_t cmd, size_t size,
+		    unsigned int n, int input_data_init,
+		    struct statistics *stats, struct lat_hist *h,
+		    int verbosity)
+{
+	TEEC_Result res;
+	unsigned int n0 = n;
+	unsigned int done = 0;
+	uint32_t p3 = TEEC_PARAM_TYPE_GET(op->paramTypes, 3);
+	size_t bytes = batch_bytes(size);
+
+	memset(stats, 0, sizeof(*stats));
+	lat_hist_init(h);
+	ta_time_reset(&ta_time);
+	op->params[0].memref.size = bytes;
+	op->params[1].memref.size = bytes;
+	if (batch)
+		fill_batch_desc(size);
+	if (need_tags && input_data_init != CRYPTO_USE_RANDOM)
+		prepare_tags(bytes, op->params[2].value.b);
+
+	while (n-- > 0) {
+		uint32_t ret_origin;
+		struct timespec t0, t1;
+
+		if (input_data_init == CRYPTO_USE_RANDOM) {
+			run_feed_input(in_shm.buffer, bytes, 1);
+			if (need_tags)
+				prepare_tags(bytes, op->params[2].value.b);
+		}
+
+		get_current_time(&t0);
+
+#ifdef CFG_SECURE_DATA_PATH
+		if (input_buffer == BUFFER_SECURE_REGISTER)
+			register_shm(&in_shm, input_sdp_fd);
+		if (output_buffer == BUFFER_SECURE_REGISTER)
+			register_shm(&out_shm, output_sdp_fd);
+#endif
+
+		if (rekey_invokes && done && !(done % rekey_invokes))
+			rekey(&sess, 1, NULL);
+		if (p3 == TEEC_VALUE_INOUT)
+			op->params[3].value.a = rekey_bytes;
+
+		res = TEEC_InvokeCommand(&sess, cmd,
+					 op, &ret_origin);
+		crypto_check_res(res, "TEEC_InvokeCommand", &ret_origin);
+		done++;
+
+#ifdef CFG_SECURE_DATA_PATH
+		if (input_buffer == BUFFER_SECURE_REGISTER)
+			TEEC_ReleaseSharedMemory(&in_shm);
+		if (output_buffer == BUFFER_SECURE_REGISTER)
+			TEEC_ReleaseSharedMemory(&out_shm);
+#endif
+
+		get_current_time(&t1);
+
+		update_stats(stats, timespec_diff_ns(&t0, &t1));
+		lat_hist_record(h, timespec_diff_ns(&t0, &t1));
+		if (p3 == TEEC_VALUE_OUTPUT || p3 == TEEC_VALUE_INOUT)
+			ta_time_update(&ta_time, &op->params[3].value);
+		if (n0 >= 10 && n % (n0 / 10) == 0)
+			vverbose("#");
+	}
+	vverbose("\n");
+}
+
+static void run_sweep(TEEC_Operation *op, uint32_t cmd, unsigned int n,
+		      int input_data_init, int verbosity)
+{
+	unsigned int count = size_sweep_count(&sweep);
+	struct sweep_row *rows = NULL;
+	struct statistics stats;
+	unsigned int i = 0;
+	size_t sz = 0;
+
+	rows = calloc(count, sizeof(*rows));
+	if (!rows)
+		crypto_errx("calloc", TEEC_ERROR_OUT_OF_MEMORY, NULL);
+
+	for (i = 0; i < count; i++) {
+		sz = size_sweep_get(&sweep, i);
+		verbose("size=%zu bytes\n", sz);
+		measure(op, cmd, sz, n, input_data_init, &stats, &hist,
+			verbosity);
+		sweep_record(rows + i, sz, batch_bytes(sz), &stats, &hist,
+			     &ta_time);
+		if (dump_hist && perf_output_text()) {
+			printf("size=%zu bytes:\n", sz);
+			lat_hist_dump(&hist);
+		}
+	}
+	sweep_print(rows, count, &params);
+	free(rows);
+}
+
+static const char *input_data_str(int input_data_init)
+{
+	switch (input_data_init) {
+	case CRYPTO_USE_ZEROS:
+		return "zeros";
+	case CRYPTO_USE_RANDOM:
+		return "random";
+	case CRYPTO_NOT_INITED:
+		return "not-inited";
+	default:
+		return "?";
+	}
+}
+
+static void record_params(int mode, int keysize, int decrypt, size_t unit,
+			  unsigned int n, unsigned int l, int input_data_init,
+			  int in_place, int warmup)
+{
+	perf_record_init(&params, "aes_perf");
+	perf_record_str(&params, "mode", mode_str(mode));
+	perf_record_str(&params, "operation", decrypt ? "decrypt" : "encrypt");
+	perf_record_int(&params, "keysize", keysize);
+	perf_record_uint(&params, "unit", unit);
+	perf_record_uint(&params, "loops", n);
+	perf_record_uint(&params, "inner_loops", l);
+	perf_record_str(&params, "input_data", input_data_str(input_data_init));
+	perf_record_bool(&params, "in_place", in_place);
+	perf_record_int(&params, "warmup_s", warmup);
+	perf_record_uint(&params, "batch", batch);
+	perf_record_bool(&params, "aead_msg", aead_msg);
+	perf_record_uint(&params, "aad", aad_len > 0 ? aad_len : 0);
+	perf_record_uint(&params, "key_pool", key_pool);
+	perf_record_uint(&params, "rekey_invokes", rekey_invokes);
+	perf_record_uint(&params, "rekey_bytes", rekey_bytes);
+	perf_record_bool(&params, "sdp", is_sdp_test);
+	perf_record_str(&params, "input_buffer", buf_type_str(input_buffer));
+	perf_record_str(&params, "output_buffer", buf_type_str(output_buffer));
+}
+
+/*
+ * Pipelined mode: a producer thread refills the input buffers of a ring of
+ * pipeline_depth buffer pairs while the calling thread invokes the TA on the
+ * buffers already filled.
+ */
+struct pipe_slot {
+	TEEC_SharedMemory in;
+	TEEC_SharedMemory out;
+};
+
+struct pipeline {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	struct pipe_slot *slots;
+	unsigned int depth;
+	unsigned int n;
+	unsigned int filled;	/* Buffers produced so far */
+	unsigned int consumed;	/* Buffers processed by the TA so far */
+	size_t size;
+	int input_data_init;
+	uint64_t fill_ns;
+};
+
+static void *pipeline_producer(void *arg)
+{
+	struct pipeline *p = arg;
+	struct timespec t0, t1;
+	unsigned int i;
+
+	for (i = 0; i < p->n; i++) {
+		pthread_mutex_lock(&p->lock);
+		while (i - p->consumed >= p->depth)
+			pthread_cond_wait(&p->cond, &p->lock);
+		pthread_mutex_unlock(&p->lock);
+
+		get_current_time(&t0);
+		if (p->input_data_init != CRYPTO_NOT_INITED)
+			feed_input(p->slots[i % p->depth].in.buffer, p->size,
+				   p->input_data_init == CRYPTO_USE_RANDOM);
+		get_current_time(&t1);
+		p->fill_ns += timespec_diff_ns(&t0, &t1);
+
+		pthread_mutex_lock(&p->lock);
+		p->filled = i + 1;
+		pthread_cond_broadcast(&p->cond);
+		pthread_mutex_unlock(&p->lock);
+	}
+	return NULL;
+}
+
+static void run_pipeline(size_t size, size_t unit, unsigned int n,
+			 unsigned int l, int input_data_init, int in_place,
+			 int verbosity)
+{
+	struct pipeline p = {
+		.lock = PTHREAD_MUTEX_INITIALIZER,
+		.cond = PTHREAD_COND_INITIALIZER,
+		.depth = pipeline_depth,
+		.n = n,
+		.size = size,
+		.input_data_init = input_data_init,
+	};
+	struct statistics stats;
+	struct timespec start, end;
+	struct pipe_slot *slot;
+	struct perf_record r;
+	TEEC_Operation op;
+	pthread_t producer;
+	uint32_t ret_origin;
+	TEEC_Result res;
+	uint64_t invoke_ns = 0;
+	uint64_t wall_ns;
+	double e2e, raw;
+	unsigned int i;
+
+	p.slots = calloc(p.depth, sizeof(*p.slots));
+	if (!p.slots)
+		crypto_errx("calloc", TEEC_ERROR_OUT_OF_MEMORY, NULL);
+	for (i = 0; i < p.depth; i++) {
+		p.slots[i].in.flags = TEEC_MEM_INPUT | TEEC_MEM_OUTPUT;
+		allocate_shm(&p.slots[i].in, size);
+		if (!in_place) {
+			p.slots[i].out.flags = TEEC_MEM_INPUT | TEEC_MEM_OUTPUT;
+			allocate_shm(&p.slots[i].out, size);
+		}
+	}
+
+	memset(&stats, 0, sizeof(stats));
+	lat_hist_init(&hist);
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_PARTIAL_INOUT,
+					 TEEC_MEMREF_PARTIAL_INOUT,
+					 TEEC_VALUE_INPUT, TEEC_NONE);
+	op.params[0].memref.size = size;
+	op.params[1].memref.size = size;
+	op.params[2].value.a = l;
+	op.params[2].value.b = unit;
+
+	get_current_time(&start);
+	if (pthread_create(&producer, NULL, pipeline_producer, &p))
+		crypto_errx("pthread_create", TEEC_ERROR_GENERIC, NULL);
+
+	for (i = 0; i < n; i++) {
+		struct timespec t0, t1;
+
+		pthread_mutex_lock(&p.lock);
+		while (p.filled <= i)
+			pthread_cond_wait(&p.cond, &p.lock);
+		pthread_mutex_unlock(&p.lock);
+
+		slot = p.slots + i % p.depth;
+		op.params[0].memref.parent = &slot->in;
+		op.params[1].memref.parent = in_place ? &slot->in : &slot->out;
+
+		get_current_time(&t0);
+		res = TEEC_InvokeCommand(&sess, TA_AES_PERF_CMD_PROCESS, &op,
+					 &ret_origin);
+		crypto_check_res(res, "TEEC_InvokeCommand", &ret_origin);
+		get_current_time(&t1);
+
+		update_stats(&stats, timespec_diff_ns(&t0, &t1));
+		lat_hist_record(&hist, timespec_diff_ns(&t0, &t1));
+		invoke_ns += timespec_diff_ns(&t0, &t1);
+
+		pthread_mutex_lock(&p.lock);
+		p.consumed = i + 1;
+		pthread_cond_broadcast(&p.cond);
+		pthread_mutex_unlock(&p.lock);
+	}
+	get_current_time(&end);
+	pthread_join(producer, NULL);
+
+	wall_ns = timespec_diff_ns(&start, &end);
+	e2e = mb_per_sec((size_t)n * size, (double)wall_ns);
+	raw = mb_per_sec(size, stats.m);
+
+	if (!perf_output_text()) {
+		struct lat_summary sum;
+
+		r = params;
+		lat_hist_summary(&hist, &sum);
+		perf_record_uint(&r, "size", size);
+		perf_record_uint(&r, "pipeline", p.depth);
+		perf_record_stats(&r, size, &stats, &sum);
+		perf_record_double(&r, "e2e_mib_per_s", e2e);
+		perf_record_double(&r, "fill_us", (double)p.fill_ns / n / 1000);
+		perf_record_emit(&r);
+	} else {
+		printf("pipeline depth=%u: end-to-end %gMiB/s, invoke %gMiB/s (TA busy %.1f%%)\n",
+		       p.depth, e2e, raw, 100.0 * invoke_ns / wall_ns);
+		printf("mean invoke=%gus stddev=%gus, mean refill=%gus (serial estimate %gMiB/s)\n",
+		       stats.m / 1000, stddev(&stats) / 1000,
+		       (double)p.fill_ns / n / 1000,
+		       mb_per_sec(size, stats.m + (double)p.fill_ns / n));
+		lat_hist_print_percentiles(&hist);
+		if (dump_hist)
+			lat_hist_dump(&hist);
+	}
+	vverbose("wall time %gs\n", (double)wall_ns / 1000000000);
+
+	for (i = 0; i < p.depth; i++) {
+		TEEC_ReleaseSharedMemory(&p.slots[i].in);
+		if (!in_place)
+			TEEC_ReleaseSharedMemory(&p.slots[i].out);
+	}
+	free(p.slots);
+}
+
+static void emit_result(size_t size, struct statistics *stats)
+{
+	struct perf_record r = params;
+	struct lat_summary sum;
+
+	lat_hist_summary(&hist, &sum);
+	perf_record_uint(&r, "size", size);
+	perf_record_stats(&r, batch_bytes(size), stats, &sum);
+	perf_record_ta_time(&r, &ta_time, stats);
+	perf_record_emit(&r);
+}
+
 void aes_perf_run_test(int mode, int keysize, int decrypt, size_t size, size_t unit,
 				unsigned int n, unsigned int l, int input_data_init,
 				int in_place, int warmup, int verbosity)
@@ -450,7 +1070,7 @@ void aes_perf_run_test(int mode, int keysize, int decrypt, size_t size, size_t u
 	struct statistics stats;
 	struct timespec ts;
 	TEEC_Operation op;
-	int n0 = n;
+	TEEC_Result res;
 	double sd;
 	uint32_t cmd = is_sdp_test ? TA_AES_PERF_CMD_PROCESS_SDP :
 				     TA_AES_PERF_CMD_PROCESS;
@@ -475,20 +1095,54 @@ void aes_perf_run_test(int mode, int keysize, int decrypt, size_t size, size_t u
 	vverbose("input test buffer:  %s\n", buf_type_str(input_buffer));
 	vverbose("output test buffer: %s\n", buf_type_str(output_buffer));
 
-	open_ta();
-	prepare_key(decrypt, keysize, mode);
+	record_params(mode, keysize, decrypt, unit, n, l, input_data_init,
+		      in_place, warmup);
+
+	if (num_threads) {
+		res = TEEC_InitializeContext(NULL, &ctx);
+		crypto_check_res(res, "TEEC_InitializeContext", NULL);
+
+		verbose("Starting scaling test: %s, %scrypt, keysize=%u bits, ",
+			mode_str(mode), (decrypt ? "de" : "en"), keysize);
+		verbose("size=%zu bytes, threads=1..%u, loops=%u\n", size,
+			num_threads, n);
+		if (warmup)
+			do_warmup(warmup);
+		run_scaling_test(mode, keysize, decrypt, size, unit, n, l,
+				 input_data_init, in_place, verbosity);
+		TEEC_FinalizeContext(&ctx);
+		return;
+	}
 
-	memset(&stats, 0, sizeof(stats));
+	crypto_open_ta(&ctx, &sess, &ta_uuid);
+	prepare_key(&sess, decrypt, keysize, mode);
+	need_tags = decrypt && (mode == TA_AES_CCM || aead_msg);
+
+	if (pipeline_depth) {
+		verbose("Starting pipelined test: %s, %scrypt, keysize=%u bits, ",
+			mode_str(mode), (decrypt ? "de" : "en"), keysize);
+		verbose("size=%zu bytes, depth=%u, loops=%u\n", size,
+			pipeline_depth, n);
+		if (warmup)
+			do_warmup(warmup);
+		run_pipeline(size, unit, n, l, input_data_init, in_place,
+			     verbosity);
+		close_ta();
+		return;
+	}
 
-	alloc_buffers(size, in_place, verbosity);
+	alloc_buffers(batch_bytes(size), in_place, verbosity);
 	if (input_data_init == CRYPTO_USE_ZEROS)
-		run_feed_input(in_shm.buffer, size, 0);
+		run_feed_input(in_shm.buffer, batch_bytes(size), 0);
 
 	memset(&op, 0, sizeof(op));
-	/* Using INOUT to handle the case in_place == 1 */
+	/*
+	 * Using INOUT to handle the case in_place == 1. The TA returns the
+	 * time spent processing in value[3].
+	 */
 	op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_PARTIAL_INOUT,
 					 TEEC_MEMREF_PARTIAL_INOUT,
-					 TEEC_VALUE_INPUT, TEEC_NONE);
+					 TEEC_VALUE_INPUT, TEEC_VALUE_OUTPUT);
 	op.params[0].memref.parent = &in_shm;
 	op.params[0].memref.size = size;
 	op.params[1].memref.parent = in_place ? &in_shm : &out_shm;
@@ -496,60 +1150,89 @@ void aes_perf_run_test(int mode, int keysize, int decrypt, size_t size, size_t u
 	op.params[2].value.a = l;
 	op.params[2].value.b = unit;
 
-	verbose("Starting test: %s, %scrypt, keysize=%u bits, size=%zu bytes, ",
-		mode_str(mode), (decrypt ? "de" : "en"), keysize, size);
+	if (batch) {
+		cmd = TA_AES_PERF_CMD_PROCESS_BATCH;
+		allocate_shm(&desc_shm,
+			     batch * sizeof(struct ta_aes_perf_batch_desc));
+		op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_PARTIAL_INOUT,
+						 TEEC_MEMREF_PARTIAL_INOUT,
+						 TEEC_MEMREF_PARTIAL_INPUT,
+						 TEEC_VALUE_INPUT);
+		op.params[2].memref.parent = &desc_shm;
+		op.params[2].memref.size = desc_shm.size;
+		op.params[3].value.a = l;
+	}
+
+	verbose("Starting test: %s, %scrypt, keysize=%u bits, ",
+		mode_str(mode), (decrypt ? "de" : "en"), keysize);
+	if (sweep.factor)
+		verbose("size=%zu..%zu bytes (x%u), ", sweep.start, sweep.end,
+			sweep.factor);
+	else
+		verbose("size=%zu bytes, ", size);
+	if (batch)
+		verbose("batch=%u, ", batch);
 	verbose("random=%s, ", yesno(input_data_init == CRYPTO_USE_RANDOM));
 	verbose("in place=%s, ", yesno(in_place));
 	verbose("inner loops=%u, loops=%u, warm-up=%u s, ", l, n, warmup);
+	if (aad_len > 0)
+		verbose("aad=%d, ", aad_len);
 	verbose("unit=%zu\n", unit);
 
+	if (rekey_bytes)
+		op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_PARTIAL_INOUT,
+						 TEEC_MEMREF_PARTIAL_INOUT,
+						 TEEC_VALUE_INPUT,
+						 TEEC_VALUE_INOUT);
+
 	if (warmup)
 		do_warmup(warmup);
 
-	while (n-- > 0) {
-		TEEC_Result res;
-		uint32_t ret_origin;
-		struct timespec t0, t1;
-
-		if (input_data_init == CRYPTO_USE_RANDOM)
-			run_feed_input(in_shm.buffer, size, 1);
-
-		get_current_time(&t0);
-
-#ifdef CFG_SECURE_DATA_PATH
-		if (input_buffer == BUFFER_SECURE_REGISTER)
-			register_shm(&in_shm, input_sdp_fd);
-		if (output_buffer == BUFFER_SECURE_REGISTER)
-			register_shm(&out_shm, output_sdp_fd);
-#endif
-
-		res = TEEC_InvokeCommand(&sess, cmd,
-					 &op, &ret_origin);
-		check_res(res, "TEEC_InvokeCommand", &ret_origin);
+	if (key_pool) {
+		prepare_key_pool(&sess, key_pool);
+		measure_key_setup(n);
+	}
 
-#ifdef CFG_SECURE_DATA_PATH
-		if (input_buffer == BUFFER_SECURE_REGISTER)
-			TEEC_ReleaseSharedMemory(&in_shm);
-		if (output_buffer == BUFFER_SECURE_REGISTER)
-			TEEC_ReleaseSharedMemory(&out_shm);
-#endif
+	invoke_baseline.valid = 0;
+	if (!no_baseline) {
+		res = measure_invoke_baseline(&sess, TA_AES_PERF_CMD_NULL,
+					      TA_AES_PERF_CMD_VALUE, n);
+		crypto_check_res(res, "invocation baseline", NULL);
+	}
 
-		get_current_time(&t1);
+	if (sweep.factor) {
+		run_sweep(&op, cmd, n, input_data_init, verbosity);
+		goto out;
+	}
 
-		update_stats(&stats, timespec_diff_ns(&t0, &t1));
-		if (n % (n0 / 10) == 0)
-			vverbose("#");
+	measure(&op, cmd, size, n, input_data_init, &stats, &hist,
+		verbosity);
+	if (!perf_output_text()) {
+		emit_result(size, &stats);
+		goto out;
 	}
-	vverbose("\n");
 	sd = stddev(&stats);
 	printf("min=%gus max=%gus mean=%gus stddev=%gus (cv %g%%) (%gMiB/s)\n",
 	       stats.min / 1000, stats.max / 1000, stats.m / 1000,
-	       sd / 1000, 100 * sd / stats.m, mb_per_sec(size, stats.m));
+	       sd / 1000, 100 * sd / stats.m,
+	       mb_per_sec(batch_bytes(size), stats.m));
+	lat_hist_print_percentiles(&hist);
+	if (batch)
+		printf("batch of %u x %zu bytes: %gus per record\n", batch,
+		       size, stats.m / batch / 1000);
+	print_invoke_baseline(batch_bytes(size), &stats);
+	print_ta_time(&ta_time, &stats);
 	verbose("2-sigma interval: %g..%gus (%g..%gMiB/s)\n",
 		(stats.m - 2 * sd) / 1000, (stats.m + 2 * sd) / 1000,
-		mb_per_sec(size, stats.m + 2 * sd),
-		mb_per_sec(size, stats.m - 2 * sd));
+		mb_per_sec(batch_bytes(size), stats.m + 2 * sd),
+		mb_per_sec(batch_bytes(size), stats.m - 2 * sd));
+	if (dump_hist)
+		lat_hist_dump(&hist);
+out:
+	if (batch)
+		TEEC_ReleaseSharedMemory(&desc_shm);
 	free_shm(in_place);
+	close_ta();
 }
 
 #define NEXT_ARG(i) \
@@ -593,8 +1276,38 @@ int aes_perf_runner_cmd_parser(int argc, char *argv[])
 		}
 	}
 	for (i = 1; i < argc; i++) {
-		if (!strcmp(argv[i], "-d")) {
+		if (!strcmp(argv[i], "--aad")) {
+			NEXT_ARG(i);
+			aad_len = atoi(argv[i]);
+			if (aad_len < 0 || aad_len > TA_AES_PERF_MAX_AAD) {
+				fprintf(stderr, "%s: invalid AAD size\n",
+					argv[0]);
+				USAGE();
+				return 1;
+			}
+		} else if (!strcmp(argv[i], "--aead-msg")) {
+			aead_msg = 1;
+		} else if (!strcmp(argv[i], "--batch")) {
+			NEXT_ARG(i);
+			batch = atoi(argv[i]);
+			if (!batch) {
+				fprintf(stderr, "%s: invalid batch size\n",
+					argv[0]);
+				USAGE();
+				return 1;
+			}
+		} else if (!strcmp(argv[i], "-d")) {
 			decrypt = 1;
+		} else if (!strcmp(argv[i], "--format")) {
+			NEXT_ARG(i);
+			if (perf_output_set_format(argv[i])) {
+				fprintf(stderr, "%s: invalid format\n",
+					argv[0]);
+				USAGE();
+				return 1;
+			}
+		} else if (!strcmp(argv[i], "--hist")) {
+			dump_hist = 1;
 		} else if (!strcmp(argv[i], "--in-place") ||
 			   !strcmp(argv[i], "-i")) {
 			in_place = 1;
@@ -623,6 +1336,12 @@ int aes_perf_runner_cmd_parser(int argc, char *argv[])
 				mode = TA_AES_XTS;
 			else if (!strcasecmp(argv[i], "GCM"))
 				mode = TA_AES_GCM;
+			else if (!strcasecmp(argv[i], "CCM"))
+				mode = TA_AES_CCM;
+			else if (!strcasecmp(argv[i], "CTS"))
+				mode = TA_AES_CTS;
+			else if (!strcasecmp(argv[i], "CMAC"))
+				mode = TA_AES_CMAC;
 			else {
 				fprintf(stderr, "%s, invalid mode\n",
 					argv[0]);
@@ -632,6 +1351,36 @@ int aes_perf_runner_cmd_parser(int argc, char *argv[])
 		} else if (!strcmp(argv[i], "-n")) {
 			NEXT_ARG(i);
 			n = atoi(argv[i]);
+		} else if (!strcmp(argv[i], "--key-pool")) {
+			NEXT_ARG(i);
+			key_pool = atoi(argv[i]);
+			if (!key_pool || key_pool > TA_AES_PERF_MAX_KEYS) {
+				fprintf(stderr, "%s: invalid key pool size\n",
+					argv[0]);
+				USAGE();
+				return 1;
+			}
+		} else if (!strcmp(argv[i], "--rekey-bytes")) {
+			NEXT_ARG(i);
+			rekey_bytes = atoi(argv[i]);
+		} else if (!strcmp(argv[i], "--rekey-invokes")) {
+			NEXT_ARG(i);
+			rekey_invokes = atoi(argv[i]);
+		} else if (!strcmp(argv[i], "--no-baseline")) {
+			no_baseline = 1;
+		} else if (!strcmp(argv[i], "--output")) {
+			NEXT_ARG(i);
+			if (perf_output_set_file(argv[i]))
+				return 1;
+		} else if (!strcmp(argv[i], "--pipeline")) {
+			NEXT_ARG(i);
+			pipeline_depth = atoi(argv[i]);
+			if (!pipeline_depth) {
+				fprintf(stderr, "%s: invalid pipeline depth\n",
+					argv[0]);
+				USAGE();
+				return 1;
+			}
 		} else if (!strcmp(argv[i], "--random") ||
 			   !strcmp(argv[i], "-r")) {
 			if (input_data_init == CRYPTO_NOT_INITED) {
@@ -649,7 +1398,20 @@ int aes_perf_runner_cmd_parser(int argc, char *argv[])
 			input_data_init = CRYPTO_NOT_INITED;
 		} else if (!strcmp(argv[i], "-s")) {
 			NEXT_ARG(i);
-			size = atoi(argv[i]);
+			if (strchr(argv[i], ':')) {
+				if (parse_size_sweep(argv[i], &sweep)) {
+					fprintf(stderr, "%s: invalid size sweep\n",
+						argv[0]);
+					USAGE();
+					return 1;
+				}
+				size = size_sweep_get(&sweep,
+					size_sweep_count(&sweep) - 1);
+			} else if (parse_size(argv[i], &size)) {
+				fprintf(stderr, "%s: invalid size\n", argv[0]);
+				USAGE();
+				return 1;
+			}
 #ifdef CFG_SECURE_DATA_PATH
 		} else if (!strcmp(argv[i], "--sdp")) {
 			is_sdp_test = 1;
@@ -669,6 +1431,10 @@ int aes_perf_runner_cmd_parser(int argc, char *argv[])
 			NEXT_ARG(i);
 			ion_heap = atoi(argv[i]);
 #endif
+		} else if (!strcmp(argv[i], "--threads") ||
+			   !strcmp(argv[i], "-t")) {
+			NEXT_ARG(i);
+			num_threads = atoi(argv[i]);
 		} else if (!strcmp(argv[i], "-u")) {
 			NEXT_ARG(i);
 			unit = atoi(argv[i]);
@@ -686,12 +1452,97 @@ int aes_perf_runner_cmd_parser(int argc, char *argv[])
 		}
 	}
 
-	if (size & (16 - 1)) {
+	if ((size & (16 - 1)) || (sweep.factor && (sweep.start & (16 - 1)))) {
 		fprintf(stderr, "invalid buffer size argument, must be a multiple of 16\n\n");
 		USAGE();
 		return 1;
 	}
 
+	if (num_threads && is_sdp_test) {
+		fprintf(stderr, "--threads is not supported with --sdp\n\n");
+		USAGE();
+		return 1;
+	}
+
+	if (batch && (is_sdp_test || num_threads || unit)) {
+		fprintf(stderr, "--batch is not supported with --sdp, --threads or -u\n\n");
+		USAGE();
+		return 1;
+	}
+
+	if (batch && (uint64_t)size * batch > UINT32_MAX) {
+		fprintf(stderr, "--batch: total buffer size is too large\n\n");
+		USAGE();
+		return 1;
+	}
+
+	if (pipeline_depth &&
+	    (is_sdp_test || num_threads || batch || sweep.factor)) {
+		fprintf(stderr, "--pipeline is not supported with --sdp, --threads, --batch or a size sweep\n\n");
+		USAGE();
+		return 1;
+	}
+
+	if ((rekey_bytes || rekey_invokes) && !key_pool)
+		key_pool = 2;
+
+	if (key_pool && (num_threads || batch || pipeline_depth)) {
+		fprintf(stderr, "key agility options are not supported with --threads, --batch or --pipeline\n\n");
+		USAGE();
+		return 1;
+	}
+
+	/* Rekey on exact N-byte boundaries: process N-byte units */
+	if (rekey_bytes) {
+		if (rekey_bytes & (16 - 1)) {
+			fprintf(stderr, "--rekey-bytes must be a multiple of 16\n\n");
+			USAGE();
+			return 1;
+		}
+		if (unit && rekey_bytes % unit) {
+			fprintf(stderr, "--rekey-bytes must be a multiple of the unit size (-u)\n\n");
+			USAGE();
+			return 1;
+		}
+		if (!unit)
+			unit = rekey_bytes;
+	}
+
+	if (num_threads && sweep.factor) {
+		fprintf(stderr, "--threads is not supported with a size sweep\n\n");
+		USAGE();
+		return 1;
+	}
+
+	if (aead_msg && mode != TA_AES_GCM) {
+		fprintf(stderr, "--aead-msg only applies to GCM\n\n");
+		USAGE();
+		return 1;
+	}
+
+	if (mode == TA_AES_CCM || aead_msg) {
+		if (aad_len < 0)
+			aad_len = 16;
+	} else if (aad_len > 0) {
+		fprintf(stderr, "--aad needs CCM or GCM with --aead-msg\n\n");
+		USAGE();
+		return 1;
+	}
+
+	if (decrypt && mode == TA_AES_CMAC) {
+		fprintf(stderr, "CMAC has no decryption, -d is not supported\n\n");
+		USAGE();
+		return 1;
+	}
+
+	/* Tags are computed on the input buffer, before each measurement */
+	if (decrypt && (mode == TA_AES_CCM || aead_msg) &&
+	    (in_place || is_sdp_test || num_threads || batch ||
+	     pipeline_depth || rekey_bytes || rekey_invokes)) {
+		fprintf(stderr, "AEAD message decryption is not supported with -i, --sdp, --threads, --batch,\n--pipeline or rekeying\n\n");
+		USAGE();
+		return 1;
+	}
 
 	aes_perf_run_test(mode, keysize, decrypt, size, unit, n, l,
 			  input_data_init, in_place, warmup, verbosity);
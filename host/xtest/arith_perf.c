@@ -0,0 +1,583 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Copyright (c) 2026, Linaro Limited
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tee_client_api.h>
+#include <time.h>
+
+#include "crypto_common.h"
+#include "ta_crypt.h"
+#include "xtest_helpers.h"
+#include "xtest_test.h"
+
+#include <util.h>
+
+/*
+ * Big integer arithmetic performance
+ *
+ * Each timed invocation is one TEE_BigInt*() call of the TEE Internal Core
+ * API, through the arith commands of the crypt TA. A TEE_BigIntCmpS32()
+ * invocation, whose TA-side cost is negligible, is timed first and
+ * subtracted from the other results ("net" column), so that what remains is
+ * the arithmetic itself rather than the world switch.
+ *
+ * A modular exponentiation is then timed twice: as one
+ * TA_CRYPT_CMD_ARITH_PROGRAM invocation and as one invocation per
+ * operation. Both run the same squarings and multiplications for the
+ * same exponent, so the difference is what the world switches cost an
+ * algorithm built on the arith commands.
+ */
+
+/* GP minimum, TEE_BigIntIsProbablePrime() treats lower values as 80 */
+#define ARITH_PRIME_CONFIDENCE	80
+
+/* Iterations of the slow operations are divided by this */
+#define ARITH_SLOW_DIV		10
+
+/* Exponent size of the modexp comparison */
+#define ARITH_EXP_BITS		64
+
+static TEEC_Context ctx;
+static TEEC_Session sess;
+
+struct arith_op {
+	const char *name;
+	uint32_t cmd;
+	uint32_t param_types;
+	uint32_t v[3][2];	/* value.a and value.b of params[0..2] */
+	bool slow;
+};
+
+enum arith_op_id {
+	OP_INVOKE,
+	OP_MUL,
+	OP_SQR,
+	OP_DIV,
+	OP_MOD,
+	OP_MULMOD,
+	OP_SQRMOD,
+	OP_INVMOD,
+	OP_IS_PRIME_COMPOSITE,
+	OP_IS_PRIME,
+	OP_TO_FMM,
+	OP_COMPUTE_FMM,
+	OP_COUNT,
+};
+
+/* Handles of the operands and results */
+struct arith_vars {
+	uint32_t a;		/* bits - 1 bits, a < n */
+	uint32_t b;		/* bits - 1 bits, b < n */
+	uint32_t n;		/* Odd modulus of bits bits */
+	uint32_t wide;		/* 2 * bits bits dividend */
+	uint32_t inv;		/* Relatively prime to n */
+	uint32_t prime;		/* Mersenne prime */
+	uint32_t dest;		/* 2 * bits bits result */
+	uint32_t q;
+	uint32_t r;
+	uint32_t fmm_ctx;
+	uint32_t fa;
+	uint32_t fb;
+	uint32_t fdest;
+	uint32_t acc;
+	uint8_t exp[ARITH_EXP_BITS / 8];	/* Exponent, big endian */
+};
+
+/* Mersenne prime exponents, 2^p - 1 is the is_prime operand */
+static const uint32_t mersenne_exp[] = {
+	127, 521, 607, 1279, 2203, 2281, 3217, 4253,
+};
+
+static void arith_invoke(uint32_t cmd, TEEC_Operation *op, const char *what)
+{
+	TEEC_Result res;
+	uint32_t ret_origin;
+
+	res = TEEC_InvokeCommand(&sess, cmd, op, &ret_origin);
+	crypto_check_res(res, what, &ret_origin);
+}
+
+static uint32_t new_handle(uint32_t cmd, uint32_t bits, uint32_t hmod)
+{
+	TEEC_Operation op;
+
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT, TEEC_VALUE_OUTPUT,
+					 TEEC_NONE, TEEC_NONE);
+	op.params[0].value.a = bits;
+	op.params[0].value.b = hmod;
+	arith_invoke(cmd, &op, "allocate arith handle");
+	return op.params[1].value.a;
+}
+
+static uint32_t new_var(uint32_t bits)
+{
+	return new_handle(TA_CRYPT_CMD_ARITH_NEW_VAR, bits, 0);
+}
+
+static void free_handle(uint32_t h)
+{
+	TEEC_Operation op;
+
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT, TEEC_NONE,
+					 TEEC_NONE, TEEC_NONE);
+	op.params[0].value.a = h;
+	arith_invoke(TA_CRYPT_CMD_ARITH_FREE_HANDLE, &op, "free handle");
+}
+
+/* Set @h to the @bits bits value in @buf, most significant bit set */
+static void set_value(uint32_t h, uint8_t *buf, uint32_t bits)
+{
+	size_t len = (bits + 7) / 8;
+	TEEC_Operation op;
+
+	buf[0] &= 0xff >> (len * 8 - bits);
+	buf[0] |= 0x80 >> (len * 8 - bits);
+
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT,
+					 TEEC_MEMREF_TEMP_INPUT, TEEC_NONE,
+					 TEEC_NONE);
+	op.params[0].value.a = h;
+	op.params[1].tmpref.buffer = buf;
+	op.params[1].tmpref.size = len;
+	arith_invoke(TA_CRYPT_CMD_ARITH_FROM_OCTET_STRING, &op, "set value");
+}
+
+static void set_random(uint32_t h, uint32_t bits, bool odd)
+{
+	uint8_t buf[2 * 4096 / 8];
+
+	read_random(buf, (bits + 7) / 8);
+	if (odd)
+		buf[(bits + 7) / 8 - 1] |= 1;
+	set_value(h, buf, bits);
+}
+
+static bool is_rel_prime(uint32_t h1, uint32_t h2)
+{
+	TEEC_Operation op;
+
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT, TEEC_VALUE_OUTPUT,
+					 TEEC_NONE, TEEC_NONE);
+	op.params[0].value.a = h1;
+	op.params[0].value.b = h2;
+	arith_invoke(TA_CRYPT_CMD_ARITH_IS_RELATIVE_PRIME, &op,
+		     "relative prime");
+	return op.params[1].value.a;
+}
+
+static void to_fmm(struct arith_vars *v, uint32_t src, uint32_t dest)
+{
+	TEEC_Operation op;
+
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT, TEEC_VALUE_INPUT,
+					 TEEC_NONE, TEEC_NONE);
+	op.params[0].value.a = src;
+	op.params[0].value.b = v->n;
+	op.params[1].value.a = v->fmm_ctx;
+	op.params[1].value.b = dest;
+	arith_invoke(TA_CRYPT_CMD_ARITH_TO_FMM, &op, "convert to FMM");
+}
+
+/* The Mersenne prime closest to @bits bits */
+static uint32_t mersenne_bits(uint32_t bits)
+{
+	uint32_t best = mersenne_exp[0];
+	size_t n;
+
+	for (n = 1; n < ARRAY_SIZE(mersenne_exp); n++)
+		if (abs((int)mersenne_exp[n] - (int)bits) <
+		    abs((int)best - (int)bits))
+			best = mersenne_exp[n];
+	return best;
+}
+
+static void alloc_vars(struct arith_vars *v, uint32_t bits)
+{
+	uint8_t buf[(4253 + 7) / 8];
+	uint32_t pbits = mersenne_bits(bits);
+
+	v->a = new_var(bits);
+	v->b = new_var(bits);
+	v->n = new_var(bits);
+	v->wide = new_var(2 * bits);
+	v->inv = new_var(bits);
+	v->prime = new_var(pbits);
+	v->dest = new_var(2 * bits);
+	v->q = new_var(2 * bits);
+	v->r = new_var(bits);
+
+	set_random(v->a, bits - 1, false);
+	set_random(v->b, bits - 1, false);
+	set_random(v->n, bits, true);
+	set_random(v->wide, 2 * bits, false);
+	do {
+		set_random(v->inv, bits - 1, false);
+	} while (!is_rel_prime(v->inv, v->n));
+	memset(buf, 0xff, sizeof(buf));
+	set_value(v->prime, buf, pbits);
+
+	v->fmm_ctx = new_handle(TA_CRYPT_CMD_ARITH_NEW_FMM_CTX, bits, v->n);
+	v->fa = new_handle(TA_CRYPT_CMD_ARITH_NEW_FMM_VAR, bits, 0);
+	v->fb = new_handle(TA_CRYPT_CMD_ARITH_NEW_FMM_VAR, bits, 0);
+	v->fdest = new_handle(TA_CRYPT_CMD_ARITH_NEW_FMM_VAR, bits, 0);
+	to_fmm(v, v->a, v->fa);
+	to_fmm(v, v->b, v->fb);
+
+	v->acc = new_var(bits);
+	read_random(v->exp, sizeof(v->exp));
+	set_random(v->acc, bits - 1, false);
+}
+
+static void free_vars(struct arith_vars *v)
+{
+	free_handle(v->acc);
+	free_handle(v->fdest);
+	free_handle(v->fb);
+	free_handle(v->fa);
+	free_handle(v->fmm_ctx);
+	free_handle(v->r);
+	free_handle(v->q);
+	free_handle(v->dest);
+	free_handle(v->prime);
+	free_handle(v->inv);
+	free_handle(v->wide);
+	free_handle(v->n);
+	free_handle(v->b);
+	free_handle(v->a);
+}
+
+#define IN	TEEC_VALUE_INPUT
+#define OUT	TEEC_VALUE_OUTPUT
+#define PT2(t0, t1)	TEEC_PARAM_TYPES(t0, t1, TEEC_NONE, TEEC_NONE)
+#define PT3(t0, t1, t2)	TEEC_PARAM_TYPES(t0, t1, t2, TEEC_NONE)
+
+static void init_ops(struct arith_op *ops, struct arith_vars *v,
+		     uint32_t pbits)
+{
+	static char prime_name[16];
+
+	snprintf(prime_name, sizeof(prime_name), "is_prime(M%u)", pbits);
+
+	ops[OP_INVOKE] = (struct arith_op){ "invoke (cmp_s32)",
+		TA_CRYPT_CMD_ARITH_CMP_S32, PT2(IN, OUT), { { v->a, 0 } } };
+	ops[OP_MUL] = (struct arith_op){ "mul",
+		TA_CRYPT_CMD_ARITH_MUL, PT2(IN, IN),
+		{ { v->a, v->b }, { v->dest } } };
+	ops[OP_SQR] = (struct arith_op){ "sqr",
+		TA_CRYPT_CMD_ARITH_SQR, PT2(IN, TEEC_NONE),
+		{ { v->a, v->dest } } };
+	ops[OP_DIV] = (struct arith_op){ "div (2n/n bits)",
+		TA_CRYPT_CMD_ARITH_DIV, PT2(IN, IN),
+		{ { v->wide, v->n }, { v->q, v->r } } };
+	ops[OP_MOD] = (struct arith_op){ "mod (2n/n bits)",
+		TA_CRYPT_CMD_ARITH_MOD, PT2(IN, IN),
+		{ { v->wide, v->n }, { v->r } } };
+	ops[OP_MULMOD] = (struct arith_op){ "mulmod",
+		TA_CRYPT_CMD_ARITH_MULMOD, PT2(IN, IN),
+		{ { v->a, v->b }, { v->n, v->r } } };
+	ops[OP_SQRMOD] = (struct arith_op){ "sqrmod",
+		TA_CRYPT_CMD_ARITH_SQRMOD, PT2(IN, IN),
+		{ { v->a, v->n }, { v->r } } };
+	ops[OP_INVMOD] = (struct arith_op){ "invmod",
+		TA_CRYPT_CMD_ARITH_INVMOD, PT2(IN, IN),
+		{ { v->inv, v->n }, { v->r } } };
+	ops[OP_IS_PRIME_COMPOSITE] = (struct arith_op){ "is_prime(random)",
+		TA_CRYPT_CMD_ARITH_IS_PRIME, PT2(IN, OUT),
+		{ { v->n, ARITH_PRIME_CONFIDENCE } } };
+	ops[OP_IS_PRIME] = (struct arith_op){ prime_name,
+		TA_CRYPT_CMD_ARITH_IS_PRIME, PT2(IN, OUT),
+		{ { v->prime, ARITH_PRIME_CONFIDENCE } }, .slow = true };
+	ops[OP_TO_FMM] = (struct arith_op){ "to_fmm",
+		TA_CRYPT_CMD_ARITH_TO_FMM, PT2(IN, IN),
+		{ { v->a, v->n }, { v->fmm_ctx, v->fdest } } };
+	ops[OP_COMPUTE_FMM] = (struct arith_op){ "compute_fmm",
+		TA_CRYPT_CMD_ARITH_COMPUTE_FMM, PT3(IN, IN, IN),
+		{ { v->fa, v->fb }, { v->n, v->fmm_ctx }, { v->fdest } } };
+}
+
+static void measure_op(const struct arith_op *ao, unsigned int n,
+		       struct statistics *stats, struct lat_hist *h)
+{
+	struct timespec t0, t1;
+	TEEC_Operation op;
+	TEEC_Result res;
+	uint32_t ret_origin;
+	size_t i;
+
+	memset(stats, 0, sizeof(*stats));
+	lat_hist_init(h);
+
+	while (n-- > 0) {
+		memset(&op, 0, sizeof(op));
+		op.paramTypes = ao->param_types;
+		for (i = 0; i < 3; i++) {
+			op.params[i].value.a = ao->v[i][0];
+			op.params[i].value.b = ao->v[i][1];
+		}
+		get_current_time(&t0);
+		res = TEEC_InvokeCommand(&sess, ao->cmd, &op, &ret_origin);
+		crypto_check_res(res, ao->name, &ret_origin);
+		get_current_time(&t1);
+		update_stats(stats, timespec_diff_ns(&t0, &t1));
+		lat_hist_record(h, timespec_diff_ns(&t0, &t1));
+	}
+}
+
+static bool modexp_bit(struct arith_vars *v, int bit)
+{
+	return (v->exp[(ARITH_EXP_BITS - 1 - bit) / 8] >> (bit % 8)) & 1;
+}
+
+/* The square-and-multiply steps for the exponent of @v, unrolled */
+static uint32_t modexp_program(struct arith_vars *v, uint32_t *prog)
+{
+	static const uint32_t sqr[] = {
+		TA_CRYPT_ARITH_INSN(TA_CRYPT_ARITH_OP_SQRMOD, 2, 2, 1, 0),
+	};
+	static const uint32_t mul[] = {
+		TA_CRYPT_ARITH_INSN(TA_CRYPT_ARITH_OP_MULMOD, 2, 2, 0, 1),
+	};
+	uint32_t n = 0;
+	int bit;
+
+	/* Registers: 0 base, 1 modulus, 2 acc */
+	for (bit = ARITH_EXP_BITS - 1; bit >= 0; bit--) {
+		memcpy(prog + n, sqr, sizeof(sqr));
+		n += ARRAY_SIZE(sqr);
+		if (modexp_bit(v, bit)) {
+			memcpy(prog + n, mul, sizeof(mul));
+			n += ARRAY_SIZE(mul);
+		}
+	}
+	return n;
+}
+
+static void invoke_modop(uint32_t cmd, uint32_t a0, uint32_t b0,
+			 uint32_t a1, uint32_t b1)
+{
+	TEEC_Operation op;
+
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = PT2(IN, IN);
+	op.params[0].value.a = a0;
+	op.params[0].value.b = b0;
+	op.params[1].value.a = a1;
+	op.params[1].value.b = b1;
+	arith_invoke(cmd, &op, "modexp step");
+}
+
+/*
+ * Left-to-right square-and-multiply, either as a program or with one
+ * invocation per operation. The exponent is known on the host, so both
+ * only multiply for the bits which are set.
+ */
+static void measure_modexp(struct arith_vars *v, bool program,
+			   unsigned int n, struct statistics *stats,
+			   struct lat_hist *h)
+{
+	static uint32_t prog[ARITH_EXP_BITS * 4];
+	uint32_t regs[] = { v->a, v->n, v->acc };
+	uint32_t prog_words = modexp_program(v, prog);
+	struct timespec t0, t1;
+	TEEC_Operation op;
+	int bit;
+
+	memset(stats, 0, sizeof(*stats));
+	lat_hist_init(h);
+
+	while (n-- > 0) {
+		get_current_time(&t0);
+		if (program) {
+			memset(&op, 0, sizeof(op));
+			op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_TEMP_INPUT,
+							 TEEC_MEMREF_TEMP_INPUT,
+							 TEEC_VALUE_OUTPUT,
+							 TEEC_NONE);
+			op.params[0].tmpref.buffer = prog;
+			op.params[0].tmpref.size = prog_words * sizeof(*prog);
+			op.params[1].tmpref.buffer = regs;
+			op.params[1].tmpref.size = sizeof(regs);
+			arith_invoke(TA_CRYPT_CMD_ARITH_PROGRAM, &op,
+				     "modexp program");
+		} else {
+			for (bit = ARITH_EXP_BITS - 1; bit >= 0; bit--) {
+				invoke_modop(TA_CRYPT_CMD_ARITH_SQRMOD, v->acc,
+					     v->n, v->acc, 0);
+				if (modexp_bit(v, bit))
+					invoke_modop(TA_CRYPT_CMD_ARITH_MULMOD,
+						     v->acc, v->a, v->n,
+						     v->acc);
+			}
+		}
+		get_current_time(&t1);
+		update_stats(stats, timespec_diff_ns(&t0, &t1));
+		lat_hist_record(h, timespec_diff_ns(&t0, &t1));
+	}
+}
+
+/* Invocations of the host driven modexp */
+static unsigned int modexp_invokes(struct arith_vars *v)
+{
+	unsigned int count = ARITH_EXP_BITS;
+	size_t i;
+
+	for (i = 0; i < sizeof(v->exp); i++)
+		count += __builtin_popcount(v->exp[i]);
+	return count;
+}
+
+/* One table row, or one record in json/csv format */
+static void print_op(const char *name, uint32_t bits,
+		     struct statistics *stats, struct lat_hist *h,
+		     double net)
+{
+	struct perf_record r;
+	struct lat_summary sum;
+
+	lat_hist_summary(h, &sum);
+	if (perf_output_text()) {
+		printf("%-20s %12.2f %12.2f %12.2f %12.2f\n", name,
+		       stats->m / 1000, net / 1000, sum.p50 / 1000,
+		       sum.p99 / 1000);
+		return;
+	}
+	perf_record_init(&r, "arith_perf");
+	perf_record_str(&r, "op", name);
+	perf_record_uint(&r, "bits", bits);
+	perf_record_stats(&r, 0, stats, &sum);
+	perf_record_double(&r, "net_us", net / 1000);
+	perf_record_emit(&r);
+}
+
+/*
+ * Time each operation @n times on @bits bits operands (2 * @bits for the
+ * dividend of div and mod), then compare TEE_BigIntMulMod() with
+ * TEE_BigIntComputeFMM() and a modexp in one or many invocations.
+ */
+void arith_perf_run_test(uint32_t bits, unsigned int n, int warmup,
+			 int verbosity)
+{
+	struct arith_op ops[OP_COUNT];
+	double mean[OP_COUNT];
+	struct statistics stats;
+	struct arith_vars v;
+	struct lat_hist h;
+	double base = 0;
+	double net = 0;
+	double gain = 0;
+	double prog_mean = 0;
+	size_t i;
+
+	if (bits < 8 || bits > 4096) {
+		fprintf(stderr, "arith_perf: unsupported size: %u bits\n",
+			bits);
+		return;
+	}
+
+	crypto_open_ta(&ctx, &sess, &crypt_user_ta_uuid);
+	alloc_vars(&v, bits);
+	init_ops(ops, &v, mersenne_bits(bits));
+
+	verbose("Starting test: %u-bit operands, loops=%u, warm-up=%u s\n",
+		bits, n, warmup);
+	if (warmup)
+		do_warmup(warmup);
+
+	if (perf_output_text()) {
+		printf("Big integer arithmetic, %u-bit operands:\n", bits);
+		printf("%-20s %12s %12s %12s %12s\n", "operation", "mean(us)",
+		       "net(us)", "p50(us)", "p99(us)");
+	}
+	for (i = 0; i < OP_COUNT; i++) {
+		measure_op(ops + i, ops[i].slow ? (n + ARITH_SLOW_DIV - 1) /
+			   ARITH_SLOW_DIV : n, &stats, &h);
+		mean[i] = stats.m;
+		if (i == OP_INVOKE)
+			base = stats.m;
+		print_op(ops[i].name, bits, &stats, &h, stats.m - base);
+	}
+
+	measure_modexp(&v, true, n, &stats, &h);
+	prog_mean = stats.m;
+	print_op("modexp (program)", bits, &stats, &h, stats.m - base);
+	measure_modexp(&v, false, n, &stats, &h);
+	print_op("modexp (invokes)", bits, &stats, &h,
+		 stats.m - base * modexp_invokes(&v));
+
+	if (perf_output_text()) {
+		printf("modexp, %u-bit exponent: one invocation %gus, %u invocations %gus (%.2fx)\n",
+		       ARITH_EXP_BITS, prog_mean / 1000, modexp_invokes(&v),
+		       stats.m / 1000, stats.m / prog_mean);
+		net = mean[OP_COMPUTE_FMM] - base;
+		gain = (mean[OP_MULMOD] - base) - net;
+		printf("FMM: compute_fmm %gus vs mulmod %gus net", net / 1000,
+		       (mean[OP_MULMOD] - base) / 1000);
+		if (gain > 0 && net > 0)
+			printf(" (%.2fx), to_fmm amortized after %.0f multiplications\n",
+			       (mean[OP_MULMOD] - base) / net,
+			       (mean[OP_TO_FMM] - base) / gain);
+		else
+			printf(", no gain\n");
+	}
+
+	free_vars(&v);
+	TEEC_CloseSession(&sess);
+	TEEC_FinalizeContext(&ctx);
+}
+
+/*
+ * Time @rounds rounds of allocation, lookup, reallocation of every other
+ * one and release of @count handles in the TA handle database, per handle
+ */
+void arith_perf_handle_test(uint32_t count, uint32_t rounds)
+{
+	static const char * const phase[] = {
+		"alloc", "lookup", "free+realloc", "free"
+	};
+	double ns_per[ARRAY_SIZE(phase)];
+	struct perf_record r;
+	TEEC_Operation op;
+	size_t i;
+
+	crypto_open_ta(&ctx, &sess, &crypt_user_ta_uuid);
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT, TEEC_VALUE_OUTPUT,
+					 TEEC_VALUE_OUTPUT, TEEC_NONE);
+	op.params[0].value.a = count;
+	op.params[0].value.b = rounds;
+	arith_invoke(TA_CRYPT_CMD_ARITH_HANDLE_BENCH, &op, "handle bench");
+	TEEC_CloseSession(&sess);
+	TEEC_FinalizeContext(&ctx);
+
+	/* Every other handle is freed and reallocated */
+	ns_per[0] = op.params[1].value.a * 1e6 / count / rounds;
+	ns_per[1] = op.params[1].value.b * 1e6 / count / rounds;
+	ns_per[2] = op.params[2].value.a * 1e6 / ((count + 1) / 2) / rounds;
+	ns_per[3] = op.params[2].value.b * 1e6 / count / rounds;
+
+	if (perf_output_text()) {
+		printf("%u handles x %u rounds, ns per handle:", count, rounds);
+		for (i = 0; i < ARRAY_SIZE(phase); i++)
+			printf(" %s %.1f", phase[i], ns_per[i]);
+		printf("\n");
+		return;
+	}
+	perf_record_init(&r, "arith_perf");
+	perf_record_str(&r, "op", "handles");
+	perf_record_uint(&r, "count", count);
+	perf_record_uint(&r, "rounds", rounds);
+	for (i = 0; i < ARRAY_SIZE(phase); i++)
+		perf_record_double(&r, phase[i], ns_per[i]);
+	perf_record_emit(&r);
+}
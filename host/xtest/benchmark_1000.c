@@ -15,6 +15,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "perf_output.h"
 #include "xtest_test.h"
 #include "xtest_helpers.h"
 
@@ -97,6 +98,40 @@ static TEEC_Result run_chunk_access_test(enum storage_benchmark_cmd cmd,
 	return res;
 }
 
+static const char *cmd_str(enum storage_benchmark_cmd cmd)
+{
+	switch (cmd) {
+	case TA_STORAGE_BENCHMARK_CMD_TEST_READ:
+		return "read";
+	case TA_STORAGE_BENCHMARK_CMD_TEST_WRITE:
+		return "write";
+	case TA_STORAGE_BENCHMARK_CMD_TEST_REWRITE:
+		return "rewrite";
+	default:
+		return "?";
+	}
+}
+
+static void emit_test_result(const char *id, enum storage_benchmark_cmd cmd,
+			     uint32_t chunk_size, struct test_record records[],
+			     size_t size)
+{
+	struct perf_record r;
+	size_t i;
+
+	perf_output_set_case(id);
+	for (i = 0; i < size; i++) {
+		perf_record_init(&r, "storage_benchmark");
+		perf_record_str(&r, "operation", cmd_str(cmd));
+		perf_record_uint(&r, "chunk_size", chunk_size);
+		perf_record_uint(&r, "size", records[i].data_size);
+		perf_record_double(&r, "time_s", records[i].spent_time);
+		perf_record_double(&r, "kib_per_s", records[i].speed_in_kb);
+		perf_record_emit(&r);
+	}
+	perf_output_set_case(NULL);
+}
+
 static void show_test_result(struct test_record records[], size_t size)
 {
 	size_t i;
@@ -115,7 +150,8 @@ static void show_test_result(struct test_record records[], size_t size)
 
 }
 
-static void chunk_test(ADBG_Case_t *c, enum storage_benchmark_cmd cmd)
+static void chunk_test(ADBG_Case_t *c, const char *id,
+		       enum storage_benchmark_cmd cmd)
 {
 	uint32_t chunk_size = DEFAULT_CHUNK_SIZE;
 	struct test_record records[ARRAY_SIZE(data_size_table) - 1];
@@ -127,22 +163,26 @@ static void chunk_test(ADBG_Case_t *c, enum storage_benchmark_cmd cmd)
 				chunk_size, &records[i]));
 	}
 
-	show_test_result(records, ARRAY_SIZE(records));
+	if (perf_output_text())
+		show_test_result(records, ARRAY_SIZE(records));
+	else
+		emit_test_result(id, cmd, chunk_size, records,
+				 ARRAY_SIZE(records));
 }
 
 static void xtest_tee_benchmark_1001(ADBG_Case_t *c)
 {
-	chunk_test(c, TA_STORAGE_BENCHMARK_CMD_TEST_WRITE);
+	chunk_test(c, "benchmark_1001", TA_STORAGE_BENCHMARK_CMD_TEST_WRITE);
 }
 
 static void xtest_tee_benchmark_1002(ADBG_Case_t *c)
 {
-	chunk_test(c, TA_STORAGE_BENCHMARK_CMD_TEST_READ);
+	chunk_test(c, "benchmark_1002", TA_STORAGE_BENCHMARK_CMD_TEST_READ);
 }
 
 static void xtest_tee_benchmark_1003(ADBG_Case_t *c)
 {
-	chunk_test(c, TA_STORAGE_BENCHMARK_CMD_TEST_REWRITE);
+	chunk_test(c, "benchmark_1003", TA_STORAGE_BENCHMARK_CMD_TEST_REWRITE);
 }
 
 ADBG_CASE_DEFINE(benchmark, 1001, xtest_tee_benchmark_1001,
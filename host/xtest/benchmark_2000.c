@@ -19,15 +19,83 @@
 #include "xtest_helpers.h"
 
 #include <crypto_common.h>
+#include <perf_output.h>
+#include <ta_crypt.h>
 #include <util.h>
 
 /* SHA bechmarks */
 static void xtest_tee_benchmark_2001(ADBG_Case_t *Case_p);
 static void xtest_tee_benchmark_2002(ADBG_Case_t *Case_p);
+static void xtest_tee_benchmark_2003(ADBG_Case_t *Case_p);
+static void xtest_tee_benchmark_2004(ADBG_Case_t *Case_p);
 
 /* AES benchmarks */
 static void xtest_tee_benchmark_2011(ADBG_Case_t *Case_p);
 static void xtest_tee_benchmark_2012(ADBG_Case_t *Case_p);
+static void xtest_tee_benchmark_2013(ADBG_Case_t *Case_p);
+static void xtest_tee_benchmark_2014(ADBG_Case_t *Case_p);
+
+/* Asymmetric benchmarks */
+static void xtest_tee_benchmark_2021(ADBG_Case_t *Case_p);
+static void xtest_tee_benchmark_2022(ADBG_Case_t *Case_p);
+static void xtest_tee_benchmark_2023(ADBG_Case_t *Case_p);
+static void xtest_tee_benchmark_2024(ADBG_Case_t *Case_p);
+static void xtest_tee_benchmark_2025(ADBG_Case_t *Case_p);
+static void xtest_tee_benchmark_2031(ADBG_Case_t *Case_p);
+static void xtest_tee_benchmark_2041(ADBG_Case_t *Case_p);
+static void xtest_tee_benchmark_2042(ADBG_Case_t *Case_p);
+
+/*
+ * Time @n invocations of @cmd of the crypt TA with the parameters in @op,
+ * which processes @size bytes, and report them as @test/@impl.
+ */
+static int crypt_ta_bench(ADBG_Case_t *c, TEEC_Session *s, uint32_t cmd,
+			  TEEC_Operation *op, const char *test,
+			  const char *impl, size_t size, unsigned int n)
+{
+	struct statistics stats = { };
+	struct lat_summary sum = { };
+	struct perf_record r = { };
+	struct timespec t0 = { };
+	struct timespec t1 = { };
+	struct lat_hist *h = malloc(sizeof(*h));
+	uint32_t ret_orig = 0;
+	uint64_t ns = 0;
+	unsigned int i = 0;
+	int rc = -1;
+
+	if (!ADBG_EXPECT_NOT_NULL(c, h))
+		return -1;
+	lat_hist_init(h);
+
+	for (i = 0; i < n; i++) {
+		get_current_time(&t0);
+		if (!ADBG_EXPECT_TEEC_SUCCESS(c,
+			TEEC_InvokeCommand(s, cmd, op, &ret_orig)))
+			goto out;
+		get_current_time(&t1);
+		ns = timespec_diff_ns(&t0, &t1);
+		update_stats(&stats, ns);
+		lat_hist_record(h, ns);
+	}
+
+	lat_hist_summary(h, &sum);
+	if (perf_output_text()) {
+		printf("%-10s %-10s %6zu bytes: %10.3f us %8.2f MiB/s\n",
+		       test, impl, size, stats.m / 1000,
+		       mb_per_sec(size, stats.m));
+	} else {
+		perf_record_init(&r, test);
+		perf_record_str(&r, "impl", impl);
+		perf_record_uint(&r, "size", size);
+		perf_record_stats(&r, size, &stats, &sum);
+		perf_record_emit(&r);
+	}
+	rc = 0;
+out:
+	free(h);
+	return rc;
+}
 
 /* ----------------------------------------------------------------------- */
 /* -------------------------- SHA Benchmarks ----------------------------- */
@@ -41,10 +109,11 @@ static void xtest_tee_benchmark_2001(ADBG_Case_t *c)
 	size_t size = 1024;	/* Buffer size */
 	int offset = 0;          /* Buffer offset wrt. alloc'ed address */
 
+	perf_output_set_case("benchmark_2001");
 	sha_perf_run_test(algo, size, CRYPTO_DEF_COUNT,
 				CRYPTO_DEF_LOOPS, CRYPTO_USE_RANDOM, offset,
 				CRYPTO_DEF_WARMUP, CRYPTO_DEF_VERBOSITY);
-
+	perf_output_set_case(NULL);
 }
 
 static void xtest_tee_benchmark_2002(ADBG_Case_t *c)
@@ -55,16 +124,111 @@ static void xtest_tee_benchmark_2002(ADBG_Case_t *c)
 	size_t size = 4096;	/* Buffer size */
 	int offset = 0;          /* Buffer offset wrt. alloc'ed address */
 
+	perf_output_set_case("benchmark_2002");
 	sha_perf_run_test(algo, size, CRYPTO_DEF_COUNT,
 				CRYPTO_DEF_LOOPS, CRYPTO_USE_RANDOM, offset,
 				CRYPTO_DEF_WARMUP, CRYPTO_DEF_VERBOSITY);
+	perf_output_set_case(NULL);
+}
+
+static void xtest_tee_benchmark_2003(ADBG_Case_t *c)
+{
+	UNUSED(c);
+
+	int algo = TA_SHA_HMAC_SHA256;	/* Algorithm */
+	size_t size = 256;	/* Buffer size: a small record */
+	int offset = 0;          /* Buffer offset wrt. alloc'ed address */
 
+	perf_output_set_case("benchmark_2003");
+	sha_perf_run_test(algo, size, CRYPTO_DEF_COUNT,
+				CRYPTO_DEF_LOOPS, CRYPTO_USE_RANDOM, offset,
+				CRYPTO_DEF_WARMUP, CRYPTO_DEF_VERBOSITY);
+	perf_output_set_case(NULL);
+}
+
+static const struct {
+	const char *name;
+	uint32_t cmd;
+	size_t digest_size;
+} sw_sha[] = {
+	{ "sha256", TA_CRYPT_CMD_SHA256, 32 },
+	{ "sha256-fast", TA_CRYPT_CMD_SHA256_FAST, 32 },
+	{ "sha384", TA_CRYPT_CMD_SHA384, 48 },
+	{ "sha512", TA_CRYPT_CMD_SHA512, 64 },
+};
+
+/*
+ * Software SHA-2 of the crypt TA next to the TEE core's TEE_ALG_SHA256
+ * (sha_perf TA) on the same buffer sizes.
+ */
+static void xtest_tee_benchmark_2004(ADBG_Case_t *c)
+{
+	static const size_t sizes[] = { 64, 1024, 16384 };
+	TEEC_Operation op = TEEC_OPERATION_INITIALIZER;
+	TEEC_Session session = { };
+	uint8_t digest[64] = { };
+	uint32_t ret_orig = 0;
+	uint8_t *buf = NULL;
+	size_t i = 0;
+	size_t j = 0;
+
+	if (!ADBG_EXPECT_TEEC_SUCCESS(c, xtest_teec_open_session(
+					      &session, &crypt_user_ta_uuid,
+					      NULL, &ret_orig)))
+		return;
+	buf = calloc(1, sizes[ARRAY_SIZE(sizes) - 1]);
+	if (!ADBG_EXPECT_NOT_NULL(c, buf))
+		goto out;
+
+	/* Which transform is behind TA_CRYPT_CMD_SHA256_FAST */
+	op.params[0].tmpref.buffer = buf;
+	op.params[0].tmpref.size = 0;
+	op.params[1].tmpref.buffer = digest;
+	op.params[1].tmpref.size = sizeof(digest);
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_TEMP_INPUT,
+					 TEEC_MEMREF_TEMP_OUTPUT,
+					 TEEC_VALUE_OUTPUT, TEEC_NONE);
+	if (!ADBG_EXPECT_TEEC_SUCCESS(c,
+		TEEC_InvokeCommand(&session, TA_CRYPT_CMD_SHA256_FAST, &op,
+				   &ret_orig)))
+		goto out;
+	Do_ADBG_Log("sha256-fast: %s",
+		    op.params[2].value.a == TA_CRYPT_SHA256_IMPL_CE ?
+		    "ARMv8 Crypto Extension" : "16-word schedule window");
+
+	perf_output_set_case("benchmark_2004");
+	for (i = 0; i < ARRAY_SIZE(sizes); i++) {
+		for (j = 0; j < ARRAY_SIZE(sw_sha); j++) {
+			op.params[0].tmpref.size = sizes[i];
+			op.params[1].tmpref.size = sw_sha[j].digest_size;
+			op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_TEMP_INPUT,
+							 TEEC_MEMREF_TEMP_OUTPUT,
+							 TEEC_NONE, TEEC_NONE);
+			if (crypt_ta_bench(c, &session, sw_sha[j].cmd, &op,
+					   "crypt_sha", sw_sha[j].name,
+					   sizes[i], CRYPTO_DEF_COUNT / 10))
+				goto out_case;
+		}
+		sha_perf_run_test(TA_SHA_SHA256, sizes[i],
+				  CRYPTO_DEF_COUNT / 10, CRYPTO_DEF_LOOPS,
+				  CRYPTO_USE_RANDOM, 0, 0,
+				  CRYPTO_DEF_VERBOSITY);
+	}
+out_case:
+	perf_output_set_case(NULL);
+out:
+	free(buf);
+	TEEC_CloseSession(&session);
 }
 
 ADBG_CASE_DEFINE(benchmark, 2001, xtest_tee_benchmark_2001,
 		"TEE SHA Performance test (TA_SHA_SHA1)");
 ADBG_CASE_DEFINE(benchmark, 2002, xtest_tee_benchmark_2002,
 		"TEE SHA Performance test (TA_SHA_SHA226)");
+ADBG_CASE_DEFINE(benchmark, 2003, xtest_tee_benchmark_2003,
+		"TEE SHA Performance test (TA_SHA_HMAC_SHA256)");
+ADBG_CASE_DEFINE(benchmark, 2004, xtest_tee_benchmark_2004,
+		"Crypt TA software SHA-2 vs TEE core SHA-256");
 
 
 /* ----------------------------------------------------------------------- */
@@ -80,9 +244,11 @@ static void xtest_tee_benchmark_2011(ADBG_Case_t *c)
 	int keysize = AES_128;
 	size_t size = 1024;	/* Buffer size */
 
+	perf_output_set_case("benchmark_2011");
 	aes_perf_run_test(mode, keysize, decrypt, size, CRYPTO_DEF_UNIT_SIZE,
 		CRYPTO_DEF_COUNT, CRYPTO_DEF_LOOPS, CRYPTO_USE_RANDOM,
 		AES_PERF_INPLACE, CRYPTO_DEF_WARMUP, CRYPTO_DEF_VERBOSITY);
+	perf_output_set_case(NULL);
 }
 
 static void xtest_tee_benchmark_2012(ADBG_Case_t *c)
@@ -94,12 +260,360 @@ static void xtest_tee_benchmark_2012(ADBG_Case_t *c)
 	int keysize = AES_256;
 	size_t size = 1024;	/* Buffer size */
 
+	perf_output_set_case("benchmark_2012");
 	aes_perf_run_test(mode, keysize, decrypt, size, CRYPTO_DEF_UNIT_SIZE,
 		CRYPTO_DEF_COUNT, CRYPTO_DEF_LOOPS, CRYPTO_USE_RANDOM,
 		AES_PERF_INPLACE, CRYPTO_DEF_WARMUP, CRYPTO_DEF_VERBOSITY);
+	perf_output_set_case(NULL);
+}
+
+static const char *aes_path_name(uint32_t path)
+{
+	switch (path) {
+	case TA_CRYPT_AES_PATH_REFERENCE:
+		return "reference";
+	case TA_CRYPT_AES_PATH_MULTIBLOCK:
+		return "multiblock";
+	case TA_CRYPT_AES_PATH_BITSLICED:
+		return "bitsliced";
+	default:
+		return "?";
+	}
+}
+
+/*
+ * Software AES-256 ECB of the crypt TA, timed per implementation path:
+ * T-table one block at a time, T-tables on interleaved blocks and the
+ * constant-time bitsliced code.
+ */
+static void aes_path_bench(ADBG_Case_t *c, TEEC_Session *s, uint32_t path,
+			   size_t size, unsigned int n)
+{
+	TEEC_Operation op = TEEC_OPERATION_INITIALIZER;
+	uint8_t *buf = calloc(2, size);
+
+	if (!ADBG_EXPECT_NOT_NULL(c, buf))
+		return;
+
+	op.params[0].tmpref.buffer = buf;
+	op.params[0].tmpref.size = size;
+	op.params[1].tmpref.buffer = buf + size;
+	op.params[1].tmpref.size = size;
+	op.params[2].value.a = path;
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_TEMP_INPUT,
+					 TEEC_MEMREF_TEMP_OUTPUT,
+					 TEEC_VALUE_INOUT, TEEC_NONE);
+
+	/* The TA reports the path it actually took */
+	if (!crypt_ta_bench(c, s, TA_CRYPT_CMD_AES256ECB_ENC, &op, "aes_path",
+			    aes_path_name(path), size, n))
+		ADBG_EXPECT(c, path, op.params[2].value.b);
+	free(buf);
+}
+
+static void xtest_tee_benchmark_2013(ADBG_Case_t *c)
+{
+	static const uint32_t paths[] = {
+		TA_CRYPT_AES_PATH_REFERENCE, TA_CRYPT_AES_PATH_MULTIBLOCK,
+		TA_CRYPT_AES_PATH_BITSLICED,
+	};
+	static const size_t sizes[] = { 64, 1024, 16384 };
+	TEEC_Session session = { };
+	uint32_t ret_orig = 0;
+	size_t i = 0;
+	size_t j = 0;
+
+	if (!ADBG_EXPECT_TEEC_SUCCESS(c, xtest_teec_open_session(
+					      &session, &crypt_user_ta_uuid,
+					      NULL, &ret_orig)))
+		return;
+
+	perf_output_set_case("benchmark_2013");
+	for (i = 0; i < ARRAY_SIZE(sizes); i++)
+		for (j = 0; j < ARRAY_SIZE(paths); j++)
+			aes_path_bench(c, &session, paths[j], sizes[i],
+				       CRYPTO_DEF_COUNT / 10);
+	perf_output_set_case(NULL);
+
+	TEEC_CloseSession(&session);
+}
+
+/*
+ * Latency of allocating a SHA-256 operation in the crypt TA, freed right
+ * after, with the operation pool of the session disabled or enabled.
+ */
+static void op_pool_bench(ADBG_Case_t *c, TEEC_Session *s, uint32_t pool,
+			  unsigned int n)
+{
+	TEEC_Operation op = TEEC_OPERATION_INITIALIZER;
+	TEEC_Operation pool_op = TEEC_OPERATION_INITIALIZER;
+	struct statistics stats = { };
+	struct lat_summary sum = { };
+	struct perf_record r = { };
+	struct timespec t0 = { };
+	struct timespec t1 = { };
+	struct lat_hist *h = malloc(sizeof(*h));
+	const char *name = pool == TA_CRYPT_OP_POOL_ENABLE ? "on" : "off";
+	uint32_t ret_orig = 0;
+	uint64_t ns = 0;
+	unsigned int i = 0;
+
+	if (!ADBG_EXPECT_NOT_NULL(c, h))
+		return;
+	lat_hist_init(h);
+
+	pool_op.params[0].value.a = pool;
+	pool_op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT, TEEC_NONE,
+					      TEEC_NONE, TEEC_NONE);
+	if (!ADBG_EXPECT_TEEC_SUCCESS(c, TEEC_InvokeCommand(s,
+			TA_CRYPT_CMD_OPERATION_POOL, &pool_op, &ret_orig)))
+		goto out;
+
+	for (i = 0; i < n; i++) {
+		op.params[0].value.b = TEE_ALG_SHA256;
+		op.params[1].value.a = TEE_MODE_DIGEST;
+		op.params[1].value.b = 0;
+		op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INOUT,
+						 TEEC_VALUE_INPUT, TEEC_NONE,
+						 TEEC_NONE);
+		get_current_time(&t0);
+		if (!ADBG_EXPECT_TEEC_SUCCESS(c, TEEC_InvokeCommand(s,
+				TA_CRYPT_CMD_ALLOCATE_OPERATION, &op,
+				&ret_orig)))
+			goto out;
+		get_current_time(&t1);
+		ns = timespec_diff_ns(&t0, &t1);
+		update_stats(&stats, ns);
+		lat_hist_record(h, ns);
+
+		op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT, TEEC_NONE,
+						 TEEC_NONE, TEEC_NONE);
+		if (!ADBG_EXPECT_TEEC_SUCCESS(c, TEEC_InvokeCommand(s,
+				TA_CRYPT_CMD_FREE_OPERATION, &op, &ret_orig)))
+			goto out;
+	}
+
+	pool_op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_OUTPUT,
+					      TEEC_VALUE_OUTPUT, TEEC_NONE,
+					      TEEC_NONE);
+	if (!ADBG_EXPECT_TEEC_SUCCESS(c, TEEC_InvokeCommand(s,
+			TA_CRYPT_CMD_OPERATION_POOL_STATS, &pool_op,
+			&ret_orig)))
+		goto out;
+
+	lat_hist_summary(h, &sum);
+	if (perf_output_text()) {
+		printf("op_pool    %-4s allocate: %10.3f us, %u hits, %u misses\n",
+		       name, stats.m / 1000, pool_op.params[0].value.a,
+		       pool_op.params[0].value.b);
+	} else {
+		perf_record_init(&r, "op_pool");
+		perf_record_str(&r, "pool", name);
+		perf_record_uint(&r, "hits", pool_op.params[0].value.a);
+		perf_record_uint(&r, "misses", pool_op.params[0].value.b);
+		perf_record_stats(&r, 0, &stats, &sum);
+		perf_record_emit(&r);
+	}
+out:
+	free(h);
+}
+
+static void xtest_tee_benchmark_2014(ADBG_Case_t *c)
+{
+	TEEC_Session session = { };
+	uint32_t ret_orig = 0;
+
+	if (!ADBG_EXPECT_TEEC_SUCCESS(c, xtest_teec_open_session(
+					      &session, &crypt_user_ta_uuid,
+					      NULL, &ret_orig)))
+		return;
+
+	perf_output_set_case("benchmark_2014");
+	op_pool_bench(c, &session, TA_CRYPT_OP_POOL_DISABLE, CRYPTO_DEF_COUNT);
+	op_pool_bench(c, &session, TA_CRYPT_OP_POOL_ENABLE, CRYPTO_DEF_COUNT);
+	perf_output_set_case(NULL);
+
+	TEEC_CloseSession(&session);
 }
 
 ADBG_CASE_DEFINE(benchmark, 2011, xtest_tee_benchmark_2011,
 		"TEE AES Performance test (TA_AES_ECB)");
 ADBG_CASE_DEFINE(benchmark, 2012, xtest_tee_benchmark_2012,
 		"TEE AES Performance test (TA_AES_CBC)");
+ADBG_CASE_DEFINE(benchmark, 2013, xtest_tee_benchmark_2013,
+		"TEE AES-256 ECB software paths of the crypt TA");
+ADBG_CASE_DEFINE(benchmark, 2014, xtest_tee_benchmark_2014,
+		"TEE crypt TA operation allocation with and without pool");
+
+/* ----------------------------------------------------------------------- */
+/* ----------------------- Asymmetric Benchmarks ------------------------- */
+/* ----------------------------------------------------------------------- */
+
+struct asym_bench {
+	const char *algo;	/* TEE_ALG_* name */
+	uint32_t key_size;	/* 0: algorithm default */
+	int decrypt;		/* Decrypt or verify */
+};
+
+static void asym_bench_run(const char *id, const struct asym_bench *b,
+			   size_t count)
+{
+	size_t n;
+
+	perf_output_set_case(id);
+	for (n = 0; n < count; n++)
+		crypto_perf_run_test(b[n].algo, b[n].decrypt, b[n].key_size,
+				     0, CRYPTO_ASYM_COUNT, CRYPTO_USE_RANDOM,
+				     CRYPTO_DEF_WARMUP, CRYPTO_DEF_VERBOSITY);
+	perf_output_set_case(NULL);
+}
+
+#define RSA_BENCH(ks) \
+	{ "RSASSA_PKCS1_V1_5_SHA256", (ks), 0 }, \
+	{ "RSASSA_PKCS1_V1_5_SHA256", (ks), 1 }, \
+	{ "RSASSA_PKCS1_PSS_MGF1_SHA256", (ks), 0 }, \
+	{ "RSASSA_PKCS1_PSS_MGF1_SHA256", (ks), 1 }, \
+	{ "RSAES_PKCS1_V1_5", (ks), 0 }, \
+	{ "RSAES_PKCS1_V1_5", (ks), 1 }, \
+	{ "RSAES_PKCS1_OAEP_MGF1_SHA256", (ks), 0 }, \
+	{ "RSAES_PKCS1_OAEP_MGF1_SHA256", (ks), 1 }
+
+static void xtest_tee_benchmark_2021(ADBG_Case_t *c)
+{
+	static const struct asym_bench b[] = { RSA_BENCH(2048) };
+
+	UNUSED(c);
+	asym_bench_run("benchmark_2021", b, ARRAY_SIZE(b));
+}
+
+static void xtest_tee_benchmark_2022(ADBG_Case_t *c)
+{
+	static const struct asym_bench b[] = { RSA_BENCH(3072) };
+
+	UNUSED(c);
+	asym_bench_run("benchmark_2022", b, ARRAY_SIZE(b));
+}
+
+static void xtest_tee_benchmark_2023(ADBG_Case_t *c)
+{
+	static const struct asym_bench b[] = { RSA_BENCH(4096) };
+
+	UNUSED(c);
+	asym_bench_run("benchmark_2023", b, ARRAY_SIZE(b));
+}
+
+static void xtest_tee_benchmark_2024(ADBG_Case_t *c)
+{
+	static const struct asym_bench b[] = {
+		{ "ECDSA_P256", 0, 0 },
+		{ "ECDSA_P256", 0, 1 },
+		{ "ECDSA_P384", 0, 0 },
+		{ "ECDSA_P384", 0, 1 },
+		{ "ECDSA_P521", 0, 0 },
+		{ "ECDSA_P521", 0, 1 },
+	};
+
+	UNUSED(c);
+	asym_bench_run("benchmark_2024", b, ARRAY_SIZE(b));
+}
+
+static void xtest_tee_benchmark_2025(ADBG_Case_t *c)
+{
+	static const struct asym_bench b[] = {
+		{ "ECDH_P256", 0, 0 },
+		{ "ECDH_P384", 0, 0 },
+		{ "ECDH_P521", 0, 0 },
+		{ "DH_DERIVE_SHARED_SECRET", 2048, 0 },
+	};
+
+	UNUSED(c);
+	asym_bench_run("benchmark_2025", b, ARRAY_SIZE(b));
+}
+
+ADBG_CASE_DEFINE(benchmark, 2021, xtest_tee_benchmark_2021,
+		"TEE RSA-2048 Performance test (sign, verify, encrypt, decrypt)");
+ADBG_CASE_DEFINE(benchmark, 2022, xtest_tee_benchmark_2022,
+		"TEE RSA-3072 Performance test (sign, verify, encrypt, decrypt)");
+ADBG_CASE_DEFINE(benchmark, 2023, xtest_tee_benchmark_2023,
+		"TEE RSA-4096 Performance test (sign, verify, encrypt, decrypt)");
+ADBG_CASE_DEFINE(benchmark, 2024, xtest_tee_benchmark_2024,
+		"TEE ECDSA Performance test (P-256, P-384, P-521)");
+ADBG_CASE_DEFINE(benchmark, 2025, xtest_tee_benchmark_2025,
+		"TEE key agreement Performance test (ECDH, DH-2048)");
+
+/* ----------------------------------------------------------------------- */
+/* ------------------------ Key Generation Benchmarks -------------------- */
+/* ----------------------------------------------------------------------- */
+
+/* Fewer iterations for the slower prime searches */
+static const struct {
+	const char *type;	/* --keygen key type */
+	uint32_t key_size;
+	unsigned int n;
+} keygen_bench[] = {
+	{ "RSA", 1024, 100 },
+	{ "RSA", 2048, 50 },
+	{ "RSA", 3072, 20 },
+	{ "RSA", 4096, 20 },
+	{ "DSA", 1024, 50 },
+	{ "DSA", 2048, 20 },
+	{ "DH", 2048, 50 },
+	{ "P-256", 256, 100 },
+	{ "P-384", 384, 100 },
+	{ "P-521", 521, 100 },
+};
+
+static void xtest_tee_benchmark_2031(ADBG_Case_t *c)
+{
+	size_t n;
+
+	UNUSED(c);
+	perf_output_set_case("benchmark_2031");
+	for (n = 0; n < ARRAY_SIZE(keygen_bench); n++)
+		crypto_perf_keygen(keygen_bench[n].type,
+				   keygen_bench[n].key_size, keygen_bench[n].n,
+				   CRYPTO_DEF_WARMUP, CRYPTO_DEF_VERBOSITY);
+	perf_output_set_case(NULL);
+}
+
+ADBG_CASE_DEFINE(benchmark, 2031, xtest_tee_benchmark_2031,
+		"TEE key generation latency distribution (RSA, DSA, DH, ECC)");
+
+/* ----------------------------------------------------------------------- */
+/* ---------------------- Big Integer Benchmarks ------------------------- */
+/* ----------------------------------------------------------------------- */
+
+static void xtest_tee_benchmark_2041(ADBG_Case_t *c)
+{
+	static const uint32_t bits[] = { 256, 512, 1024, 2048, 3072, 4096 };
+	size_t n;
+
+	UNUSED(c);
+	perf_output_set_case("benchmark_2041");
+	for (n = 0; n < ARRAY_SIZE(bits); n++)
+		arith_perf_run_test(bits[n], CRYPTO_ARITH_COUNT,
+				    CRYPTO_DEF_WARMUP, CRYPTO_DEF_VERBOSITY);
+	perf_output_set_case(NULL);
+}
+
+/*
+ * The crypt TA heap limits the number of live handles, so each size is
+ * repeated up to 1M handles in total: the time per handle must not grow
+ * with the size of the database.
+ */
+static void xtest_tee_benchmark_2042(ADBG_Case_t *c)
+{
+	static const uint32_t count[] = { 16, 64, 256, 512 };
+	size_t n;
+
+	UNUSED(c);
+	perf_output_set_case("benchmark_2042");
+	for (n = 0; n < ARRAY_SIZE(count); n++)
+		arith_perf_handle_test(count[n], 1000000 / count[n]);
+	perf_output_set_case(NULL);
+}
+
+ADBG_CASE_DEFINE(benchmark, 2041, xtest_tee_benchmark_2041,
+		"TEE big integer arithmetic Performance test (256 to 4096 bits)");
+ADBG_CASE_DEFINE(benchmark, 2042, xtest_tee_benchmark_2042,
+		"TEE arith handle allocation scaling test");
@@ -0,0 +1,703 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Copyright (c) 2026, Linaro Limited
+ */
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "crypto_common.h"
+
+/*
+ * Statistics
+ *
+ * We want to compute min, max, mean and standard deviation of processing time
+ */
+
+/* Take new sample into account (Knuth/Welford algorithm) */
+void update_stats(struct statistics *s, uint64_t t)
+{
+	double x = (double)t;
+	double delta = x - s->m;
+
+	s->n++;
+	s->m += delta/s->n;
+	s->M2 += delta*(x - s->m);
+	if (!s->initialized) {
+		s->min = s->max = x;
+		s->initialized = 1;
+	} else {
+		if (s->min > x)
+			s->min = x;
+		if (s->max < x)
+			s->max = x;
+	}
+}
+
+double stddev(struct statistics *s)
+{
+	if (s->n < 2)
+		return NAN;
+	return sqrt(s->M2/s->n);
+}
+
+double mb_per_sec(size_t size, double usec)
+{
+	return (1000000000/usec)*((double)size/(1024*1024));
+}
+
+/*
+ * Timing, input data and warm-up, common to the perf applets
+ */
+
+void get_current_time(struct timespec *ts)
+{
+	if (clock_gettime(CLOCK_MONOTONIC, ts) < 0) {
+		perror("clock_gettime");
+		exit(1);
+	}
+}
+
+uint64_t timespec_to_ns(struct timespec *ts)
+{
+	return ((uint64_t)ts->tv_sec * 1000000000) + ts->tv_nsec;
+}
+
+uint64_t timespec_diff_ns(struct timespec *start, struct timespec *end)
+{
+	return timespec_to_ns(end) - timespec_to_ns(start);
+}
+
+ssize_t read_random(void *in, size_t rsize)
+{
+	static int rnd;
+	ssize_t s;
+
+	if (!rnd) {
+		rnd = open("/dev/urandom", O_RDONLY);
+		if (rnd < 0) {
+			perror("open");
+			return 1;
+		}
+	}
+	s = read(rnd, in, rsize);
+	if (s < 0) {
+		perror("read");
+		return 1;
+	}
+	if ((size_t)s != rsize) {
+		printf("read: requested %zu bytes, got %zd\n", rsize, s);
+	}
+
+	return 0;
+}
+
+/* Busy loop for @warmup seconds to get the CPU out of its idle states */
+void do_warmup(int warmup)
+{
+	struct timespec t0, t;
+	int i;
+
+	get_current_time(&t0);
+	do {
+		for (i = 0; i < 100000; i++)
+			;
+		get_current_time(&t);
+	} while (timespec_diff_ns(&t0, &t) < (uint64_t)warmup * 1000000000);
+}
+
+const char *yesno(int v)
+{
+	return (v ? "yes" : "no");
+}
+
+/*
+ * TEE client helpers, the benchmarks exit on any error
+ */
+
+void crypto_errx(const char *msg, TEEC_Result res, uint32_t *orig)
+{
+	fprintf(stderr, "%s: 0x%08x", msg, res);
+	if (orig)
+		fprintf(stderr, " (orig=%d)", (int)*orig);
+	fprintf(stderr, "\n");
+	exit(1);
+}
+
+void crypto_check_res(TEEC_Result res, const char *errmsg, uint32_t *orig)
+{
+	if (res != TEEC_SUCCESS)
+		crypto_errx(errmsg, res, orig);
+}
+
+void crypto_open_session(TEEC_Context *ctx, TEEC_Session *s,
+			 const TEEC_UUID *uuid)
+{
+	TEEC_Result res;
+	uint32_t err_origin;
+
+	res = TEEC_OpenSession(ctx, s, uuid, TEEC_LOGIN_PUBLIC, NULL, NULL,
+			       &err_origin);
+	crypto_check_res(res, "TEEC_OpenSession", &err_origin);
+}
+
+void crypto_open_ta(TEEC_Context *ctx, TEEC_Session *s, const TEEC_UUID *uuid)
+{
+	TEEC_Result res;
+
+	res = TEEC_InitializeContext(NULL, ctx);
+	crypto_check_res(res, "TEEC_InitializeContext", NULL);
+
+	crypto_open_session(ctx, s, uuid);
+}
+
+/*
+ * Invocation baseline
+ */
+
+struct invoke_baseline invoke_baseline;
+
+static TEEC_Result time_invoke(TEEC_Session *s, uint32_t cmd,
+			       TEEC_Operation *op, unsigned int n,
+			       struct statistics *stats)
+{
+	TEEC_Result res;
+	uint32_t ret_origin;
+	struct timespec t0;
+	struct timespec t1;
+
+	memset(stats, 0, sizeof(*stats));
+	while (n--) {
+		get_current_time(&t0);
+		res = TEEC_InvokeCommand(s, cmd, op, &ret_origin);
+		if (res != TEEC_SUCCESS)
+			return res;
+		get_current_time(&t1);
+		update_stats(stats, timespec_diff_ns(&t0, &t1));
+	}
+	return TEEC_SUCCESS;
+}
+
+TEEC_Result measure_invoke_baseline(TEEC_Session *s, uint32_t null_cmd,
+				    uint32_t value_cmd, unsigned int n)
+{
+	TEEC_Operation op;
+	TEEC_Result res;
+
+	invoke_baseline.valid = 0;
+
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_NONE, TEEC_NONE, TEEC_NONE,
+					 TEEC_NONE);
+	res = time_invoke(s, null_cmd, &op, n, &invoke_baseline.null_stats);
+	if (res != TEEC_SUCCESS)
+		return res;
+
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT, TEEC_VALUE_OUTPUT,
+					 TEEC_NONE, TEEC_NONE);
+	op.params[0].value.a = 1;
+	op.params[0].value.b = 2;
+	res = time_invoke(s, value_cmd, &op, n, &invoke_baseline.value_stats);
+	if (res != TEEC_SUCCESS)
+		return res;
+
+	invoke_baseline.valid = 1;
+	return TEEC_SUCCESS;
+}
+
+/* Mean time of a run with the invocation baseline subtracted, in ns */
+static double crypto_only_ns(struct statistics *stats)
+{
+	return stats->m - invoke_baseline.value_stats.m;
+}
+
+void print_invoke_baseline(size_t bytes, struct statistics *stats)
+{
+	double net = 0;
+
+	if (!invoke_baseline.valid)
+		return;
+
+	printf("invoke baseline: null=%gus (stddev %gus) value=%gus (stddev %gus)\n",
+	       invoke_baseline.null_stats.m / 1000,
+	       stddev(&invoke_baseline.null_stats) / 1000,
+	       invoke_baseline.value_stats.m / 1000,
+	       stddev(&invoke_baseline.value_stats) / 1000);
+	if (!stats)
+		return;
+	net = crypto_only_ns(stats);
+	if (net > 0)
+		printf("crypto only: mean=%gus (%gMiB/s)\n", net / 1000,
+		       mb_per_sec(bytes, net));
+	else
+		printf("crypto only: below invocation noise\n");
+}
+
+/*
+ * Secure-side time
+ */
+
+void ta_time_reset(struct ta_time *t)
+{
+	memset(t, 0, sizeof(*t));
+}
+
+void ta_time_update(struct ta_time *t, const TEEC_Value *v)
+{
+	update_stats(&t->stats, (uint64_t)v->a * 1000);
+	t->resolution_us = v->b;
+}
+
+void print_ta_time(struct ta_time *t, struct statistics *host)
+{
+	double secure = t->stats.m;
+	double transport = host->m - secure;
+
+	if (!t->stats.n)
+		return;
+
+	printf("secure time: mean=%gus (resolution %uus), transport: mean=%gus",
+	       secure / 1000, t->resolution_us, transport / 1000);
+	if (secure > 0)
+		printf(" (transport/secure %g)", transport / secure);
+	printf("\n");
+}
+
+void perf_record_ta_time(struct perf_record *r, struct ta_time *t,
+			 struct statistics *host)
+{
+	if (!t->stats.n)
+		return;
+
+	perf_record_double(r, "secure_mean_us", t->stats.m / 1000);
+	perf_record_uint(r, "secure_resolution_us", t->resolution_us);
+	perf_record_double(r, "transport_mean_us",
+			   (host->m - t->stats.m) / 1000);
+}
+
+/*
+ * Latency histogram
+ *
+ * Values below 2^LAT_HIST_SUB_BITS ns are counted exactly. Above that, each
+ * power of two is split into 2^LAT_HIST_SUB_BITS linear sub-buckets, which
+ * bounds the relative error of any reported value to
+ * 1 / 2^LAT_HIST_SUB_BITS whatever its magnitude (HdrHistogram-like).
+ */
+
+static unsigned int msb64(uint64_t v)
+{
+	return 63 - __builtin_clzll(v);
+}
+
+static size_t bucket_index(uint64_t v)
+{
+	unsigned int shift;
+
+	if (v < LAT_HIST_SUB_COUNT)
+		return v;
+
+	shift = msb64(v) - LAT_HIST_SUB_BITS;
+	if (shift >= LAT_HIST_MAX_SHIFT)
+		return LAT_HIST_NUM_BUCKETS - 1;
+
+	return ((size_t)(shift + 1) << LAT_HIST_SUB_BITS) +
+	       ((v >> shift) & (LAT_HIST_SUB_COUNT - 1));
+}
+
+static uint64_t bucket_low(size_t idx)
+{
+	unsigned int shift;
+
+	if (idx < LAT_HIST_SUB_COUNT)
+		return idx;
+
+	shift = (idx >> LAT_HIST_SUB_BITS) - 1;
+	return (uint64_t)(LAT_HIST_SUB_COUNT |
+			  (idx & (LAT_HIST_SUB_COUNT - 1))) << shift;
+}
+
+static uint64_t bucket_width(size_t idx)
+{
+	if (idx < LAT_HIST_SUB_COUNT)
+		return 1;
+
+	return (uint64_t)1 << ((idx >> LAT_HIST_SUB_BITS) - 1);
+}
+
+void lat_hist_init(struct lat_hist *h)
+{
+	memset(h, 0, sizeof(*h));
+}
+
+void lat_hist_record(struct lat_hist *h, uint64_t ns)
+{
+	if (!h->count || ns < h->min)
+		h->min = ns;
+	if (ns > h->max)
+		h->max = ns;
+	h->count++;
+	h->buckets[bucket_index(ns)]++;
+}
+
+void lat_hist_merge(struct lat_hist *dst, const struct lat_hist *src)
+{
+	size_t n;
+
+	if (!src->count)
+		return;
+
+	if (!dst->count || src->min < dst->min)
+		dst->min = src->min;
+	if (src->max > dst->max)
+		dst->max = src->max;
+	dst->count += src->count;
+	for (n = 0; n < LAT_HIST_NUM_BUCKETS; n++)
+		dst->buckets[n] += src->buckets[n];
+}
+
+/*
+ * Returns the value at percentile p (0..100) in ns. The middle of the
+ * matching bucket is returned, clamped to the observed min/max.
+ */
+double lat_hist_percentile(const struct lat_hist *h, double p)
+{
+	uint64_t rank;
+	uint64_t seen = 0;
+	uint64_t v;
+	size_t n;
+
+	if (!h->count)
+		return 0;
+
+	rank = (uint64_t)(p / 100 * h->count + 0.5);
+	if (rank < 1)
+		rank = 1;
+	if (rank >= h->count)
+		return (double)h->max;
+
+	for (n = 0; n < LAT_HIST_NUM_BUCKETS; n++) {
+		seen += h->buckets[n];
+		if (seen >= rank)
+			break;
+	}
+
+	v = bucket_low(n) + bucket_width(n) / 2;
+	if (v < h->min)
+		v = h->min;
+	if (v > h->max)
+		v = h->max;
+	return (double)v;
+}
+
+void lat_hist_print_percentiles(const struct lat_hist *h)
+{
+	printf("p50=%gus p90=%gus p99=%gus p99.9=%gus max=%gus\n",
+	       lat_hist_percentile(h, 50) / 1000,
+	       lat_hist_percentile(h, 90) / 1000,
+	       lat_hist_percentile(h, 99) / 1000,
+	       lat_hist_percentile(h, 99.9) / 1000,
+	       (double)h->max / 1000);
+}
+
+void lat_hist_summary(const struct lat_hist *h, struct lat_summary *sum)
+{
+	sum->p50 = lat_hist_percentile(h, 50);
+	sum->p90 = lat_hist_percentile(h, 90);
+	sum->p99 = lat_hist_percentile(h, 99);
+	sum->p999 = lat_hist_percentile(h, 99.9);
+}
+
+/* Add the statistics of a run on @size-byte buffers to a result record */
+void perf_record_stats(struct perf_record *r, size_t size,
+		       struct statistics *stats,
+		       const struct lat_summary *sum)
+{
+	perf_record_int(r, "samples", stats->n);
+	perf_record_double(r, "min_us", stats->min / 1000);
+	perf_record_double(r, "max_us", stats->max / 1000);
+	perf_record_double(r, "mean_us", stats->m / 1000);
+	perf_record_double(r, "stddev_us", stddev(stats) / 1000);
+	perf_record_double(r, "p50_us", sum->p50 / 1000);
+	perf_record_double(r, "p90_us", sum->p90 / 1000);
+	perf_record_double(r, "p99_us", sum->p99 / 1000);
+	perf_record_double(r, "p999_us", sum->p999 / 1000);
+	perf_record_double(r, "mib_per_s", mb_per_sec(size, stats->m));
+	if (invoke_baseline.valid) {
+		double net = crypto_only_ns(stats);
+
+		perf_record_double(r, "null_invoke_us",
+				   invoke_baseline.null_stats.m / 1000);
+		perf_record_double(r, "value_invoke_us",
+				   invoke_baseline.value_stats.m / 1000);
+		perf_record_double(r, "crypto_mean_us", net / 1000);
+		if (net > 0)
+			perf_record_double(r, "crypto_mib_per_s",
+					   mb_per_sec(size, net));
+	}
+}
+
+/* Print all non-empty buckets with their cumulative distribution */
+void lat_hist_dump(const struct lat_hist *h)
+{
+	uint64_t seen = 0;
+	uint64_t lo;
+	size_t n;
+
+	printf("%14s %14s %10s %8s\n", "from(us)", "to(us)", "count",
+	       "cumul%");
+	for (n = 0; n < LAT_HIST_NUM_BUCKETS; n++) {
+		if (!h->buckets[n])
+			continue;
+		seen += h->buckets[n];
+		lo = bucket_low(n);
+		printf("%14.3f %14.3f %10llu %8.3f\n", (double)lo / 1000,
+		       (double)(lo + bucket_width(n)) / 1000,
+		       (unsigned long long)h->buckets[n],
+		       100.0 * seen / h->count);
+	}
+}
+
+/*
+ * Parse a buffer size with an optional K, M or G (binary) suffix.
+ * Returns 0 on success, -1 if the string is not a valid size.
+ */
+int parse_size(const char *arg, size_t *size)
+{
+	unsigned long long v;
+	char *end = NULL;
+
+	if (!arg || *arg < '0' || *arg > '9')
+		return -1;
+
+	v = strtoull(arg, &end, 0);
+	switch (*end) {
+	case 'k':
+	case 'K':
+		v <<= 10;
+		end++;
+		break;
+	case 'm':
+	case 'M':
+		v <<= 20;
+		end++;
+		break;
+	case 'g':
+	case 'G':
+		v <<= 30;
+		end++;
+		break;
+	default:
+		break;
+	}
+	if (*end || !v || v > SIZE_MAX)
+		return -1;
+
+	*size = v;
+	return 0;
+}
+
+/*
+ * Parse a size sweep specification "START:END:xFACTOR", for instance
+ * "16:16M:x2". The factor defaults to 2 when omitted ("16:16M").
+ * Returns 0 on success, -1 on syntax error.
+ */
+int parse_size_sweep(const char *arg, struct size_sweep *sw)
+{
+	char buf[64];
+	char *end_s = NULL;
+	char *fac_s = NULL;
+	char *end = NULL;
+	unsigned long f = 2;
+
+	if (strlen(arg) >= sizeof(buf))
+		return -1;
+	strcpy(buf, arg);
+
+	end_s = strchr(buf, ':');
+	if (!end_s)
+		return -1;
+	*end_s++ = '\0';
+	fac_s = strchr(end_s, ':');
+	if (fac_s) {
+		*fac_s++ = '\0';
+		if (*fac_s != 'x' && *fac_s != 'X')
+			return -1;
+		f = strtoul(fac_s + 1, &end, 10);
+		if (*end || f < 2)
+			return -1;
+	}
+
+	if (parse_size(buf, &sw->start) || parse_size(end_s, &sw->end))
+		return -1;
+	if (sw->end < sw->start)
+		return -1;
+	sw->factor = f;
+	return 0;
+}
+
+unsigned int size_sweep_count(const struct size_sweep *sw)
+{
+	unsigned int n = 0;
+	size_t sz = sw->start;
+
+	while (sz <= sw->end) {
+		n++;
+		if (sz > sw->end / sw->factor)
+			break;
+		sz *= sw->factor;
+	}
+	return n;
+}
+
+/* Size of step @idx of the sweep, 0 when past the end */
+size_t size_sweep_get(const struct size_sweep *sw, unsigned int idx)
+{
+	size_t sz = sw->start;
+
+	while (idx--) {
+		if (sz > sw->end / sw->factor)
+			return 0;
+		sz *= sw->factor;
+	}
+	return sz;
+}
+
+void sweep_record(struct sweep_row *row, size_t size, size_t bytes,
+		  struct statistics *stats, const struct lat_hist *h,
+		  const struct ta_time *t)
+{
+	row->secure_ns = (t && t->stats.n) ? t->stats.m : NAN;
+	row->size = size;
+	row->bytes = bytes;
+	row->stats = *stats;
+	lat_hist_summary(h, &row->pct);
+}
+
+/*
+ * Fit mean(size) = fixed + size * per_byte through the sweep results. The
+ * intercept is the fixed per-invocation cost (TEE entry/exit, parameter
+ * marshalling, operation setup), the slope gives the asymptotic throughput.
+ *
+ * Sizes are geometric so an ordinary least squares fit would be dominated by
+ * the largest buffers and leave the intercept meaningless. Each point is
+ * therefore weighted by 1 / mean^2, which minimizes the relative error.
+ */
+static int sweep_fit(const struct sweep_row *rows, unsigned int n,
+		     double *fixed, double *per_byte)
+{
+	double s = 0;
+	double sx = 0;
+	double sy = 0;
+	double sxx = 0;
+	double sxy = 0;
+	double d = 0;
+	unsigned int i = 0;
+
+	if (n < 2)
+		return -1;
+
+	for (i = 0; i < n; i++) {
+		double x = (double)rows[i].bytes;
+		double y = rows[i].stats.m;
+		double w = 1 / (y * y);
+
+		s += w;
+		sx += w * x;
+		sy += w * y;
+		sxx += w * x * x;
+		sxy += w * x * y;
+	}
+	d = s * sxx - sx * sx;
+	if (!(d > 0))
+		return -1;
+
+	*per_byte = (s * sxy - sx * sy) / d;
+	*fixed = (sxx * sy - sx * sxy) / d;
+	return 0;
+}
+
+/* One result record per size, with the fit results repeated in each */
+static void sweep_emit(const struct sweep_row *rows, unsigned int n,
+		       const struct perf_record *params, int have_fit,
+		       double fixed, double per_byte)
+{
+	struct perf_record r;
+	struct statistics st;
+	unsigned int i = 0;
+
+	for (i = 0; i < n; i++) {
+		r = *params;
+		st = rows[i].stats;
+		perf_record_uint(&r, "size", rows[i].size);
+		perf_record_stats(&r, rows[i].bytes, &st, &rows[i].pct);
+		if (!isnan(rows[i].secure_ns)) {
+			perf_record_double(&r, "secure_mean_us",
+					   rows[i].secure_ns / 1000);
+			perf_record_double(&r, "transport_mean_us",
+					   (st.m - rows[i].secure_ns) / 1000);
+		}
+		if (have_fit) {
+			perf_record_double(&r, "fixed_us", fixed / 1000);
+			perf_record_double(&r, "asymptotic_mib_per_s",
+					   mb_per_sec(1, per_byte));
+		}
+		perf_record_emit(&r);
+	}
+}
+
+void sweep_print(const struct sweep_row *rows, unsigned int n,
+		 const struct perf_record *params)
+{
+	double fixed = 0;
+	double per_byte = 0;
+	int have_fit = !sweep_fit(rows, n, &fixed, &per_byte);
+	unsigned int i = 0;
+
+	if (!perf_output_text()) {
+		sweep_emit(rows, n, params, have_fit, fixed, per_byte);
+		return;
+	}
+
+	printf("%10s %10s %10s %10s %10s %10s %10s %7s", "size(B)",
+	       "min(us)", "mean(us)", "p50(us)", "p99(us)", "stddev(us)",
+	       "MiB/s", "fixed%");
+	if (invoke_baseline.valid)
+		printf(" %10s", "crypto(us)");
+	if (!isnan(rows[0].secure_ns))
+		printf(" %10s %12s", "secure(us)", "transport(us)");
+	printf("\n");
+	for (i = 0; i < n; i++) {
+		struct statistics st = rows[i].stats;
+
+		printf("%10zu %10.3f %10.3f %10.3f %10.3f %10.3f %10.2f",
+		       rows[i].size, st.min / 1000, st.m / 1000,
+		       rows[i].pct.p50 / 1000, rows[i].pct.p99 / 1000,
+		       stddev(&st) / 1000, mb_per_sec(rows[i].bytes, st.m));
+		if (have_fit && fixed > 0)
+			printf(" %7.1f", 100 * fixed / st.m);
+		else
+			printf(" %7s", "-");
+		if (invoke_baseline.valid)
+			printf(" %10.3f", crypto_only_ns(&st) / 1000);
+		if (!isnan(rows[i].secure_ns))
+			printf(" %10.3f %12.3f", rows[i].secure_ns / 1000,
+			       (st.m - rows[i].secure_ns) / 1000);
+		printf("\n");
+	}
+
+	print_invoke_baseline(0, NULL);
+	if (!have_fit)
+		return;
+	printf("fixed cost per invoke: %.3f us", fixed / 1000);
+	if (per_byte > 0)
+		printf(", asymptotic throughput: %.2f MiB/s",
+		       mb_per_sec(1, per_byte));
+	printf("\n");
+}
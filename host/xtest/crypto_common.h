@@ -28,6 +28,13 @@
 #ifndef XTEST_CRYPTO_COMMON_H
 #define XTEST_CRYPTO_COMMON_H
 
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <tee_client_api.h>
+#include <time.h>
+
+#include "perf_output.h"
 #include "ta_aes_perf.h"
 #include "ta_sha_perf.h"
 
@@ -44,6 +51,9 @@
 
 #define CRYPTO_DEF_WARMUP 2 /* Start with a 2-second busy loop  */
 #define CRYPTO_DEF_COUNT 5000	/* Default number of measurements */
+#define CRYPTO_ASYM_COUNT 100	/* Same, for public key operations */
+#define CRYPTO_KEYGEN_COUNT 50	/* Same, for key pair generation */
+#define CRYPTO_ARITH_COUNT 200	/* Same, for big integer operations */
 #define CRYPTO_DEF_VERBOSITY 0
 #define CRYPTO_DEF_UNIT_SIZE 0 /* Process whole buffer */
 
@@ -59,6 +69,130 @@
 #define verbose(...)  _verbose(1, __VA_ARGS__)
 #define vverbose(...) _verbose(2, __VA_ARGS__)
 
+struct statistics {
+	int n;
+	double m;
+	double M2;
+	double min;
+	double max;
+	int initialized;
+};
+
+void update_stats(struct statistics *s, uint64_t t);
+double stddev(struct statistics *s);
+double mb_per_sec(size_t size, double usec);
+
+void get_current_time(struct timespec *ts);
+uint64_t timespec_to_ns(struct timespec *ts);
+uint64_t timespec_diff_ns(struct timespec *start, struct timespec *end);
+ssize_t read_random(void *in, size_t rsize);
+void do_warmup(int warmup);
+const char *yesno(int v);
+
+/* Print the error and exit */
+void crypto_errx(const char *msg, TEEC_Result res, uint32_t *orig);
+void crypto_check_res(TEEC_Result res, const char *errmsg, uint32_t *orig);
+void crypto_open_session(TEEC_Context *ctx, TEEC_Session *s,
+			 const TEEC_UUID *uuid);
+void crypto_open_ta(TEEC_Context *ctx, TEEC_Session *s, const TEEC_UUID *uuid);
+
+/*
+ * Cost of the TA invocation path alone, measured with commands that do no
+ * work: NULL (no parameter) and VALUE (one value in, one value out). When
+ * valid, the VALUE mean is subtracted from the results to report the time
+ * spent in the crypto operation itself.
+ */
+struct invoke_baseline {
+	int valid;
+	struct statistics null_stats;
+	struct statistics value_stats;
+};
+
+extern struct invoke_baseline invoke_baseline;
+
+TEEC_Result measure_invoke_baseline(TEEC_Session *s, uint32_t null_cmd,
+				    uint32_t value_cmd, unsigned int n);
+void print_invoke_baseline(size_t bytes, struct statistics *stats);
+
+/*
+ * Secure-side processing time, as returned by the TA in the optional
+ * value[3] output of its PROCESS command (microseconds, coarse resolution).
+ * Individual samples are quantized but their mean over many invocations is
+ * not biased, so only the mean is reported.
+ */
+struct ta_time {
+	struct statistics stats;	/* ns */
+	uint32_t resolution_us;
+};
+
+void ta_time_reset(struct ta_time *t);
+void ta_time_update(struct ta_time *t, const TEEC_Value *v);
+void print_ta_time(struct ta_time *t, struct statistics *host);
+
+/*
+ * Log-bucketed latency histogram, values in nanoseconds. 2^LAT_HIST_SUB_BITS
+ * sub-buckets per power of two (relative error < 1.6%), values up to
+ * 2^(LAT_HIST_MAX_SHIFT + LAT_HIST_SUB_BITS) ns (~73 minutes).
+ */
+#define LAT_HIST_SUB_BITS	6
+#define LAT_HIST_SUB_COUNT	(1 << LAT_HIST_SUB_BITS)
+#define LAT_HIST_MAX_SHIFT	36
+#define LAT_HIST_NUM_BUCKETS	((LAT_HIST_MAX_SHIFT + 1) * LAT_HIST_SUB_COUNT)
+
+struct lat_hist {
+	uint64_t count;
+	uint64_t min;
+	uint64_t max;
+	uint64_t buckets[LAT_HIST_NUM_BUCKETS];
+};
+
+void lat_hist_init(struct lat_hist *h);
+void lat_hist_record(struct lat_hist *h, uint64_t ns);
+void lat_hist_merge(struct lat_hist *dst, const struct lat_hist *src);
+double lat_hist_percentile(const struct lat_hist *h, double p);
+void lat_hist_print_percentiles(const struct lat_hist *h);
+void lat_hist_dump(const struct lat_hist *h);
+
+/* Latency percentiles in ns */
+struct lat_summary {
+	double p50;
+	double p90;
+	double p99;
+	double p999;
+};
+
+void lat_hist_summary(const struct lat_hist *h, struct lat_summary *sum);
+void perf_record_stats(struct perf_record *r, size_t size,
+		       struct statistics *stats,
+		       const struct lat_summary *sum);
+void perf_record_ta_time(struct perf_record *r, struct ta_time *t,
+			 struct statistics *host);
+
+/* Geometric buffer size sweep: start, start * factor, ... up to end */
+struct size_sweep {
+	size_t start;
+	size_t end;
+	unsigned int factor;
+};
+
+int parse_size(const char *arg, size_t *size);
+int parse_size_sweep(const char *arg, struct size_sweep *sw);
+unsigned int size_sweep_count(const struct size_sweep *sw);
+size_t size_sweep_get(const struct size_sweep *sw, unsigned int idx);
+
+struct sweep_row {
+	size_t size;
+	size_t bytes;	/* Processed per invoke, size unless batched */
+	struct statistics stats;
+	struct lat_summary pct;
+	double secure_ns;	/* Mean TA-side time, NAN if not measured */
+};
+
+void sweep_record(struct sweep_row *row, size_t size, size_t bytes,
+		  struct statistics *stats, const struct lat_hist *h,
+		  const struct ta_time *t);
+void sweep_print(const struct sweep_row *rows, unsigned int n,
+		 const struct perf_record *params);
 
 int aes_perf_runner_cmd_parser(int argc, char *argv[]);
 void aes_perf_run_test(int mode, int keysize, int decrypt, size_t size,
@@ -70,6 +204,17 @@ void sha_perf_run_test(int algo, size_t size, unsigned int n,
 				unsigned int l, int random_in, int offset,
 				int warmup, int verbosity);
 
+int crypto_perf_runner_cmd_parser(int argc, char *argv[]);
+void crypto_perf_run_test(const char *algo, int decrypt, uint32_t key_size,
+			  size_t size, unsigned int n, int random_in,
+			  int warmup, int verbosity);
+void crypto_perf_keygen(const char *type, uint32_t key_size, unsigned int n,
+			int warmup, int verbosity);
+
+void arith_perf_run_test(uint32_t bits, unsigned int n, int warmup,
+			 int verbosity);
+void arith_perf_handle_test(uint32_t count, uint32_t rounds);
+
 #ifdef CFG_SECURE_DATA_PATH
 int sdp_basic_runner_cmd_parser(int argc, char *argv[]);
 #endif
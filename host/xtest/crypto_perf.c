@@ -0,0 +1,1346 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Copyright (c) 2026, Linaro Limited
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <tee_client_api.h>
+#include <time.h>
+#include <utee_defines.h>
+
+#include <nist/186-3dsatestvectors.h>
+
+#include "crypto_common.h"
+#include "ta_crypt.h"
+#include "xtest_helpers.h"
+#include "xtest_test.h"
+
+/*
+ * Generic crypto performance tool
+ *
+ * Any algorithm of the TEE Internal Core API can be measured through the
+ * generic operation commands of the crypt TA (TA_CRYPT_CMD_*), each timed
+ * invocation being one TEE Internal API call:
+ * - cipher, MAC and AE: TEE_CipherUpdate(), TEE_MACUpdate() or
+ *   TEE_AEUpdate() on an operation initialized once, that is the streaming
+ *   throughput
+ * - digest: TEE_DigestDoFinal(), one message per invocation
+ * - asymmetric: one TEE_AsymmetricSignDigest(), TEE_AsymmetricVerifyDigest(),
+ *   TEE_AsymmetricEncrypt() or TEE_AsymmetricDecrypt() per invocation, on an
+ *   input sized after the algorithm and key
+ * - key agreement (ECDH, DH): one TEE_DeriveKey() per invocation, with the
+ *   public value of a second key pair as peer key
+ * - key generation (--keygen): one TEE_GenerateKey() per invocation
+ */
+
+struct perf_alg {
+	const char *name;	/* TEE_ALG_ suffix */
+	uint32_t algo;
+	uint32_t key_type;	/* 0: no key */
+	uint32_t key_size;	/* Default key size in bits, DES without parity */
+	uint32_t curve;		/* ECC curve, 0 otherwise */
+	size_t block;		/* Symmetric: input size granularity */
+	size_t iv_len;		/* Symmetric: IV or nonce size */
+	size_t in_len;		/* Signature: digest size, cipher: padding */
+};
+
+#define SYM(a, type, ks, blk, iv) \
+	{ .name = #a, .algo = TEE_ALG_##a, .key_type = TEE_TYPE_##type, \
+	  .key_size = (ks), .block = (blk), .iv_len = (iv) }
+#define DIGEST(a) \
+	{ .name = #a, .algo = TEE_ALG_##a, .block = 1 }
+#define RSA(a, len) \
+	{ .name = #a, .algo = TEE_ALG_##a, \
+	  .key_type = TEE_TYPE_RSA_KEYPAIR, .key_size = 2048, .in_len = (len) }
+#define ECC(a, type, c, ks, len) \
+	{ .name = #a, .algo = TEE_ALG_##a, \
+	  .key_type = TEE_TYPE_##type, .key_size = (ks), \
+	  .curve = TEE_ECC_CURVE_##c, .in_len = (len) }
+
+static const struct perf_alg algs[] = {
+	SYM(AES_ECB_NOPAD, AES, 128, 16, 0),
+	SYM(AES_CBC_NOPAD, AES, 128, 16, 16),
+	SYM(AES_CTR, AES, 128, 1, 16),
+	SYM(AES_CTS, AES, 128, 1, 16),
+	SYM(AES_XTS, AES, 128, 16, 16),
+	SYM(DES_ECB_NOPAD, DES, 56, 8, 0),
+	SYM(DES_CBC_NOPAD, DES, 56, 8, 8),
+	SYM(DES3_ECB_NOPAD, DES3, 168, 8, 0),
+	SYM(DES3_CBC_NOPAD, DES3, 168, 8, 8),
+	SYM(AES_CBC_MAC_NOPAD, AES, 128, 16, 0),
+	SYM(AES_CMAC, AES, 128, 1, 0),
+	SYM(DES3_CBC_MAC_NOPAD, DES3, 168, 8, 0),
+	SYM(HMAC_MD5, HMAC_MD5, 128, 1, 0),
+	SYM(HMAC_SHA1, HMAC_SHA1, 160, 1, 0),
+	SYM(HMAC_SHA224, HMAC_SHA224, 224, 1, 0),
+	SYM(HMAC_SHA256, HMAC_SHA256, 256, 1, 0),
+	SYM(HMAC_SHA384, HMAC_SHA384, 384, 1, 0),
+	SYM(HMAC_SHA512, HMAC_SHA512, 512, 1, 0),
+	SYM(AES_GCM, AES, 128, 1, 12),
+	DIGEST(MD5),
+	DIGEST(SHA1),
+	DIGEST(SHA224),
+	DIGEST(SHA256),
+	DIGEST(SHA384),
+	DIGEST(SHA512),
+#ifdef TEE_ALG_SHA3_224
+	DIGEST(SHA3_224),
+	DIGEST(SHA3_256),
+	DIGEST(SHA3_384),
+	DIGEST(SHA3_512),
+#endif
+	RSA(RSASSA_PKCS1_V1_5_SHA1, 20),
+	RSA(RSASSA_PKCS1_V1_5_SHA256, 32),
+	RSA(RSASSA_PKCS1_V1_5_SHA512, 64),
+	RSA(RSASSA_PKCS1_PSS_MGF1_SHA256, 32),
+	RSA(RSAES_PKCS1_V1_5, 11),
+	RSA(RSAES_PKCS1_OAEP_MGF1_SHA1, 42),
+	RSA(RSAES_PKCS1_OAEP_MGF1_SHA256, 66),
+	RSA(RSA_NOPAD, 0),
+	ECC(ECDSA_P256, ECDSA_KEYPAIR, NIST_P256, 256, 32),
+	ECC(ECDSA_P384, ECDSA_KEYPAIR, NIST_P384, 384, 48),
+	ECC(ECDSA_P521, ECDSA_KEYPAIR, NIST_P521, 521, 64),
+	ECC(ECDH_P256, ECDH_KEYPAIR, NIST_P256, 256, 0),
+	ECC(ECDH_P384, ECDH_KEYPAIR, NIST_P384, 384, 0),
+	ECC(ECDH_P521, ECDH_KEYPAIR, NIST_P521, 521, 0),
+	{ .name = "DH_DERIVE_SHARED_SECRET",
+	  .algo = TEE_ALG_DH_DERIVE_SHARED_SECRET,
+	  .key_type = TEE_TYPE_DH_KEYPAIR, .key_size = 2048 },
+};
+
+/* RFC 3526 2048-bit MODP group (14), used for the DH key pairs */
+static const uint8_t dh_prime[] = {
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xc9, 0x0f, 0xda, 0xa2, 0x21, 0x68, 0xc2, 0x34,
+	0xc4, 0xc6, 0x62, 0x8b, 0x80, 0xdc, 0x1c, 0xd1,
+	0x29, 0x02, 0x4e, 0x08, 0x8a, 0x67, 0xcc, 0x74,
+	0x02, 0x0b, 0xbe, 0xa6, 0x3b, 0x13, 0x9b, 0x22,
+	0x51, 0x4a, 0x08, 0x79, 0x8e, 0x34, 0x04, 0xdd,
+	0xef, 0x95, 0x19, 0xb3, 0xcd, 0x3a, 0x43, 0x1b,
+	0x30, 0x2b, 0x0a, 0x6d, 0xf2, 0x5f, 0x14, 0x37,
+	0x4f, 0xe1, 0x35, 0x6d, 0x6d, 0x51, 0xc2, 0x45,
+	0xe4, 0x85, 0xb5, 0x76, 0x62, 0x5e, 0x7e, 0xc6,
+	0xf4, 0x4c, 0x42, 0xe9, 0xa6, 0x37, 0xed, 0x6b,
+	0x0b, 0xff, 0x5c, 0xb6, 0xf4, 0x06, 0xb7, 0xed,
+	0xee, 0x38, 0x6b, 0xfb, 0x5a, 0x89, 0x9f, 0xa5,
+	0xae, 0x9f, 0x24, 0x11, 0x7c, 0x4b, 0x1f, 0xe6,
+	0x49, 0x28, 0x66, 0x51, 0xec, 0xe4, 0x5b, 0x3d,
+	0xc2, 0x00, 0x7c, 0xb8, 0xa1, 0x63, 0xbf, 0x05,
+	0x98, 0xda, 0x48, 0x36, 0x1c, 0x55, 0xd3, 0x9a,
+	0x69, 0x16, 0x3f, 0xa8, 0xfd, 0x24, 0xcf, 0x5f,
+	0x83, 0x65, 0x5d, 0x23, 0xdc, 0xa3, 0xad, 0x96,
+	0x1c, 0x62, 0xf3, 0x56, 0x20, 0x85, 0x52, 0xbb,
+	0x9e, 0xd5, 0x29, 0x07, 0x70, 0x96, 0x96, 0x6d,
+	0x67, 0x0c, 0x35, 0x4e, 0x4a, 0xbc, 0x98, 0x04,
+	0xf1, 0x74, 0x6c, 0x08, 0xca, 0x18, 0x21, 0x7c,
+	0x32, 0x90, 0x5e, 0x46, 0x2e, 0x36, 0xce, 0x3b,
+	0xe3, 0x9e, 0x77, 0x2c, 0x18, 0x0e, 0x86, 0x03,
+	0x9b, 0x27, 0x83, 0xa2, 0xec, 0x07, 0xa2, 0x8f,
+	0xb5, 0xc5, 0x5d, 0xf0, 0x6f, 0x4c, 0x52, 0xc9,
+	0xde, 0x2b, 0xcb, 0xf6, 0x95, 0x58, 0x17, 0x18,
+	0x39, 0x95, 0x49, 0x7c, 0xea, 0x95, 0x6a, 0xe5,
+	0x15, 0xd2, 0x26, 0x18, 0x98, 0xfa, 0x05, 0x10,
+	0x15, 0x72, 0x8e, 0x5a, 0x8a, 0xac, 0xaa, 0x68,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+};
+static const uint8_t dh_base[] = { 0x02 };
+
+/* DSA domain parameters from the NIST 186-3 vectors (L = 1024/2048) */
+static const struct {
+	uint32_t key_size;
+	const uint8_t *p;
+	const uint8_t *q;
+	size_t q_len;
+	const uint8_t *g;
+} dsa_params[] = {
+	{ 1024, ac_dsa_vect1_prime, ac_dsa_vect1_sub_prime,
+	  sizeof(ac_dsa_vect1_sub_prime), ac_dsa_vect1_base },
+	{ 2048, ac_dsa_vect151_prime, ac_dsa_vect151_sub_prime,
+	  sizeof(ac_dsa_vect151_sub_prime), ac_dsa_vect151_base },
+};
+
+/* Key pair types of --keygen */
+struct perf_keygen {
+	const char *name;
+	uint32_t key_type;
+	uint32_t key_size;	/* Default key size in bits */
+	uint32_t curve;		/* ECC curve, 0 otherwise */
+};
+
+static const struct perf_keygen keygens[] = {
+	{ "RSA", TEE_TYPE_RSA_KEYPAIR, 2048, 0 },
+	{ "DSA", TEE_TYPE_DSA_KEYPAIR, 2048, 0 },
+	{ "DH", TEE_TYPE_DH_KEYPAIR, 2048, 0 },
+	{ "P-192", TEE_TYPE_ECDSA_KEYPAIR, 192, TEE_ECC_CURVE_NIST_P192 },
+	{ "P-224", TEE_TYPE_ECDSA_KEYPAIR, 224, TEE_ECC_CURVE_NIST_P224 },
+	{ "P-256", TEE_TYPE_ECDSA_KEYPAIR, 256, TEE_ECC_CURVE_NIST_P256 },
+	{ "P-384", TEE_TYPE_ECDSA_KEYPAIR, 384, TEE_ECC_CURVE_NIST_P384 },
+	{ "P-521", TEE_TYPE_ECDSA_KEYPAIR, 521, TEE_ECC_CURVE_NIST_P521 },
+};
+
+#define GCM_TAG_LEN	16
+
+/*
+ * TEE client stuff
+ */
+
+static TEEC_Context ctx;
+static TEEC_Session sess;
+static TEEC_SharedMemory in_shm = {
+	.flags = TEEC_MEM_INPUT
+};
+static TEEC_SharedMemory out_shm = {
+	.flags = TEEC_MEM_OUTPUT
+};
+/* Signature checked by the verify operation */
+static TEEC_SharedMemory sig_shm = {
+	.flags = TEEC_MEM_INPUT
+};
+
+/* Crypt TA handles */
+static uint32_t oph;
+static uint32_t key_obj[2];
+/* Key agreement: peer key pair and derived secret */
+static uint32_t peer_obj;
+static uint32_t secret_obj;
+
+/* Key agreement: packed public value of the peer */
+static uint8_t *peer_attrs;
+static size_t peer_attrs_len;
+
+/* Key pair object of --keygen, reset before each TEE_GenerateKey() */
+static uint32_t keygen_obj;
+
+/* Print the full latency histogram (--hist) */
+static int dump_hist;
+static struct lat_hist hist;
+
+/* Buffer size sweep (-s START:END:xFACTOR), sweep.factor == 0 when unused */
+static struct size_sweep sweep;
+
+/* Run parameters, common to all the result records of a test */
+static struct perf_record params;
+
+static void crypt_invoke(uint32_t cmd, TEEC_Operation *op, const char *what)
+{
+	TEEC_Result res;
+	uint32_t ret_origin;
+
+	res = TEEC_InvokeCommand(&sess, cmd, op, &ret_origin);
+	crypto_check_res(res, what, &ret_origin);
+}
+
+static const struct perf_alg *find_alg(const char *name)
+{
+	size_t n;
+
+	if (!strncasecmp(name, "TEE_ALG_", 8))
+		name += 8;
+	for (n = 0; n < sizeof(algs) / sizeof(algs[0]); n++)
+		if (!strcasecmp(name, algs[n].name))
+			return algs + n;
+	return NULL;
+}
+
+static uint32_t alg_class(const struct perf_alg *alg)
+{
+	return TEE_ALG_GET_CLASS(alg->algo);
+}
+
+static int is_asym(const struct perf_alg *alg)
+{
+	return alg_class(alg) == TEE_OPERATION_ASYMMETRIC_CIPHER ||
+	       alg_class(alg) == TEE_OPERATION_ASYMMETRIC_SIGNATURE ||
+	       alg_class(alg) == TEE_OPERATION_KEY_DERIVATION;
+}
+
+static const char *mode_str(const struct perf_alg *alg, int decrypt)
+{
+	switch (alg_class(alg)) {
+	case TEE_OPERATION_CIPHER:
+	case TEE_OPERATION_AE:
+	case TEE_OPERATION_ASYMMETRIC_CIPHER:
+		return decrypt ? "decrypt" : "encrypt";
+	case TEE_OPERATION_MAC:
+		return "mac";
+	case TEE_OPERATION_DIGEST:
+		return "digest";
+	case TEE_OPERATION_ASYMMETRIC_SIGNATURE:
+		return decrypt ? "verify" : "sign";
+	case TEE_OPERATION_KEY_DERIVATION:
+		return "derive";
+	default:
+		return "?";
+	}
+}
+
+static uint32_t op_mode(const struct perf_alg *alg, int decrypt)
+{
+	switch (alg_class(alg)) {
+	case TEE_OPERATION_CIPHER:
+	case TEE_OPERATION_AE:
+	case TEE_OPERATION_ASYMMETRIC_CIPHER:
+		return decrypt ? TEE_MODE_DECRYPT : TEE_MODE_ENCRYPT;
+	case TEE_OPERATION_MAC:
+		return TEE_MODE_MAC;
+	case TEE_OPERATION_DIGEST:
+		return TEE_MODE_DIGEST;
+	case TEE_OPERATION_ASYMMETRIC_SIGNATURE:
+		return decrypt ? TEE_MODE_VERIFY : TEE_MODE_SIGN;
+	case TEE_OPERATION_KEY_DERIVATION:
+		return TEE_MODE_DERIVE;
+	default:
+		return 0;
+	}
+}
+
+/* Input size of an asymmetric operation, fixed by the algorithm and key */
+static size_t asym_in_size(const struct perf_alg *alg, uint32_t key_size)
+{
+	if (alg_class(alg) == TEE_OPERATION_ASYMMETRIC_SIGNATURE)
+		return alg->in_len;
+	if (alg_class(alg) == TEE_OPERATION_KEY_DERIVATION)
+		return 0;
+	return (key_size + 7) / 8 - alg->in_len;
+}
+
+/* Signature, ciphertext or key sized buffer */
+static size_t asym_buf_size(uint32_t key_size)
+{
+	return 2 * ((key_size + 7) / 8) + 64;
+}
+
+static void alloc_shm(TEEC_SharedMemory *shm, size_t sz)
+{
+	TEEC_Result res;
+
+	shm->buffer = NULL;
+	shm->size = sz;
+	res = TEEC_AllocateSharedMemory(&ctx, shm);
+	crypto_check_res(res, "TEEC_AllocateSharedMemory", NULL);
+}
+
+static void free_shm(void)
+{
+	TEEC_ReleaseSharedMemory(&in_shm);
+	TEEC_ReleaseSharedMemory(&out_shm);
+	if (sig_shm.buffer)
+		TEEC_ReleaseSharedMemory(&sig_shm);
+	sig_shm.buffer = NULL;
+}
+
+static uint32_t alloc_object(uint32_t type, uint32_t size)
+{
+	TEEC_Operation op;
+
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT, TEEC_VALUE_OUTPUT,
+					 TEEC_NONE, TEEC_NONE);
+	op.params[0].value.a = type;
+	op.params[0].value.b = size;
+	crypt_invoke(TA_CRYPT_CMD_ALLOCATE_TRANSIENT_OBJECT, &op,
+		     "allocate object");
+	return op.params[1].value.a;
+}
+
+/*
+ * TEE_GenerateKey() parameters of a key pair: curve or domain parameters.
+ * Returns -1 if there are none for this key size.
+ */
+static int keypair_attrs(uint32_t key_type, uint32_t curve,
+			 uint32_t key_size, TEE_Attribute *attrs,
+			 size_t *attr_count)
+{
+	size_t n;
+
+	*attr_count = 0;
+	switch (key_type) {
+	case TEE_TYPE_DH_KEYPAIR:
+		if (key_size != sizeof(dh_prime) * 8)
+			return -1;
+		xtest_add_attr(attr_count, attrs, TEE_ATTR_DH_PRIME,
+			       dh_prime, sizeof(dh_prime));
+		xtest_add_attr(attr_count, attrs, TEE_ATTR_DH_BASE,
+			       dh_base, sizeof(dh_base));
+		return 0;
+	case TEE_TYPE_DSA_KEYPAIR:
+		for (n = 0; n < sizeof(dsa_params) / sizeof(dsa_params[0]);
+		     n++) {
+			if (dsa_params[n].key_size != key_size)
+				continue;
+			xtest_add_attr(attr_count, attrs, TEE_ATTR_DSA_PRIME,
+				       dsa_params[n].p, key_size / 8);
+			xtest_add_attr(attr_count, attrs,
+				       TEE_ATTR_DSA_SUBPRIME, dsa_params[n].q,
+				       dsa_params[n].q_len);
+			xtest_add_attr(attr_count, attrs, TEE_ATTR_DSA_BASE,
+				       dsa_params[n].g, key_size / 8);
+			return 0;
+		}
+		return -1;
+	default:
+		if (curve)
+			xtest_add_attr_value(attr_count, attrs,
+					     TEE_ATTR_ECC_CURVE, curve, 0);
+		return 0;
+	}
+}
+
+/* Random secret value or generated key pair of @key_size bits */
+static uint32_t alloc_key(const struct perf_alg *alg, uint32_t key_size)
+{
+	TEE_Attribute attrs[3];
+	size_t attr_count = 0;
+	uint8_t secret[64];
+	size_t secret_len = (key_size + 7) / 8;
+	uint8_t *buf = NULL;
+	size_t blen = 0;
+	TEEC_Operation op;
+	uint32_t obj;
+	uint32_t cmd;
+
+	obj = alloc_object(alg->key_type, key_size);
+
+	if (is_asym(alg)) {
+		if (keypair_attrs(alg->key_type, alg->curve, key_size, attrs,
+				  &attr_count))
+			crypto_errx("unsupported key size",
+				    TEEC_ERROR_NOT_SUPPORTED, NULL);
+		cmd = TA_CRYPT_CMD_GENERATE_KEY;
+	} else {
+		/* DES key sizes exclude the parity bit of each byte */
+		if (alg->key_type == TEE_TYPE_DES ||
+		    alg->key_type == TEE_TYPE_DES3)
+			secret_len = key_size / 7;
+		if (secret_len > sizeof(secret))
+			crypto_errx("key size too large",
+				    TEEC_ERROR_BAD_PARAMETERS, NULL);
+		read_random(secret, secret_len);
+		xtest_add_attr(&attr_count, attrs, TEE_ATTR_SECRET_VALUE,
+			       secret, secret_len);
+		cmd = TA_CRYPT_CMD_POPULATE_TRANSIENT_OBJECT;
+	}
+	if (pack_attrs(attrs, attr_count, &buf, &blen) != TEE_SUCCESS)
+		crypto_errx("pack_attrs", TEEC_ERROR_OUT_OF_MEMORY, NULL);
+
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT,
+					 TEEC_MEMREF_TEMP_INPUT, TEEC_NONE,
+					 TEEC_NONE);
+	op.params[0].value.a = obj;
+	op.params[0].value.b = key_size;
+	op.params[1].tmpref.buffer = buf;
+	op.params[1].tmpref.size = blen;
+	crypt_invoke(cmd, &op, is_asym(alg) ? "generate key" : "populate key");
+	free(buf);
+
+	return obj;
+}
+
+/* Allocate an operation of @mode and set its key(s) */
+static uint32_t setup_operation(const struct perf_alg *alg, uint32_t mode,
+				uint32_t key_size)
+{
+	TEEC_Result res;
+	uint32_t ret_origin;
+	TEEC_Operation op;
+	uint32_t h;
+
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INOUT, TEEC_VALUE_INPUT,
+					 TEEC_NONE, TEEC_NONE);
+	op.params[0].value.b = alg->algo;
+	op.params[1].value.a = mode;
+	op.params[1].value.b = alg->key_type ? key_size : 0;
+	/* XTS takes two keys, the maximum covers both */
+	if (alg->algo == TEE_ALG_AES_XTS)
+		op.params[1].value.b = 2 * key_size;
+	res = TEEC_InvokeCommand(&sess, TA_CRYPT_CMD_ALLOCATE_OPERATION, &op,
+				 &ret_origin);
+	if (res == TEEC_ERROR_NOT_SUPPORTED) {
+		fprintf(stderr, "TEE_ALG_%s with a %u-bit key is not supported by this TEE\n",
+			alg->name, key_size);
+		exit(1);
+	}
+	crypto_check_res(res, "allocate operation", &ret_origin);
+	h = op.params[0].value.a;
+
+	if (!alg->key_type)
+		return h;
+
+	memset(&op, 0, sizeof(op));
+	op.params[0].value.a = h;
+	op.params[0].value.b = key_obj[0];
+	if (alg->algo == TEE_ALG_AES_XTS) {
+		op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT,
+						 TEEC_VALUE_INPUT, TEEC_NONE,
+						 TEEC_NONE);
+		op.params[1].value.a = key_obj[1];
+		crypt_invoke(TA_CRYPT_CMD_SET_OPERATION_KEY2, &op,
+			     "set operation keys");
+	} else {
+		op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT, TEEC_NONE,
+						 TEEC_NONE, TEEC_NONE);
+		crypt_invoke(TA_CRYPT_CMD_SET_OPERATION_KEY, &op,
+			     "set operation key");
+	}
+	return h;
+}
+
+static void free_operation(uint32_t h)
+{
+	TEEC_Operation op;
+
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT, TEEC_NONE,
+					 TEEC_NONE, TEEC_NONE);
+	op.params[0].value.a = h;
+	crypt_invoke(TA_CRYPT_CMD_FREE_OPERATION, &op, "free operation");
+}
+
+static void free_key(uint32_t obj)
+{
+	TEEC_Operation op;
+
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT, TEEC_NONE,
+					 TEEC_NONE, TEEC_NONE);
+	op.params[0].value.a = obj;
+	crypt_invoke(TA_CRYPT_CMD_FREE_TRANSIENT_OBJECT, &op, "free key");
+}
+
+/* Cipher, MAC and AE operations are initialized once for all the runs */
+static void init_operation(const struct perf_alg *alg)
+{
+	uint8_t iv[16] = { };
+	TEEC_Operation op;
+	uint32_t cmd;
+
+	memset(&op, 0, sizeof(op));
+	op.params[0].value.a = oph;
+	op.params[1].tmpref.buffer = iv;
+	op.params[1].tmpref.size = alg->iv_len;
+
+	switch (alg_class(alg)) {
+	case TEE_OPERATION_CIPHER:
+	case TEE_OPERATION_MAC:
+		cmd = alg_class(alg) == TEE_OPERATION_CIPHER ?
+		      TA_CRYPT_CMD_CIPHER_INIT : TA_CRYPT_CMD_MAC_INIT;
+		if (alg->iv_len)
+			op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT,
+							 TEEC_MEMREF_TEMP_INPUT,
+							 TEEC_NONE, TEEC_NONE);
+		else
+			op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT,
+							 TEEC_NONE, TEEC_NONE,
+							 TEEC_NONE);
+		break;
+	case TEE_OPERATION_AE:
+		/* Unknown AAD and payload lengths, 128-bit tag */
+		op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT,
+						 TEEC_MEMREF_TEMP_INPUT,
+						 TEEC_VALUE_INPUT, TEEC_NONE);
+		op.params[0].value.b = GCM_TAG_LEN;
+		cmd = TA_CRYPT_CMD_AE_INIT;
+		break;
+	default:
+		return;
+	}
+	crypt_invoke(cmd, &op, "init operation");
+}
+
+static size_t get_attr(uint32_t obj, uint32_t id, uint8_t *buf, size_t len)
+{
+	TEEC_Operation op;
+
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT,
+					 TEEC_MEMREF_TEMP_OUTPUT, TEEC_NONE,
+					 TEEC_NONE);
+	op.params[0].value.a = obj;
+	op.params[0].value.b = id;
+	op.params[1].tmpref.buffer = buf;
+	op.params[1].tmpref.size = len;
+	crypt_invoke(TA_CRYPT_CMD_GET_OBJECT_BUFFER_ATTRIBUTE, &op,
+		     "get public value");
+	return op.params[1].tmpref.size;
+}
+
+/* Key agreement with the public value of a second key pair */
+static void prepare_derive(const struct perf_alg *alg, uint32_t key_size,
+			   TEEC_Operation *op, uint32_t *cmd)
+{
+	size_t len = (key_size + 7) / 8;
+	TEE_Attribute attrs[2];
+	size_t attr_count = 0;
+	uint8_t *x = NULL;
+	uint8_t *y = NULL;
+	size_t x_len = 0;
+	size_t y_len = 0;
+
+	x = malloc(len);
+	y = malloc(len);
+	if (!x || !y)
+		crypto_errx("malloc", TEEC_ERROR_OUT_OF_MEMORY, NULL);
+
+	peer_obj = alloc_key(alg, key_size);
+	if (alg->curve) {
+		x_len = get_attr(peer_obj, TEE_ATTR_ECC_PUBLIC_VALUE_X, x, len);
+		y_len = get_attr(peer_obj, TEE_ATTR_ECC_PUBLIC_VALUE_Y, y, len);
+		xtest_add_attr(&attr_count, attrs, TEE_ATTR_ECC_PUBLIC_VALUE_X,
+			       x, x_len);
+		xtest_add_attr(&attr_count, attrs, TEE_ATTR_ECC_PUBLIC_VALUE_Y,
+			       y, y_len);
+	} else {
+		x_len = get_attr(peer_obj, TEE_ATTR_DH_PUBLIC_VALUE, x, len);
+		xtest_add_attr(&attr_count, attrs, TEE_ATTR_DH_PUBLIC_VALUE,
+			       x, x_len);
+	}
+	if (pack_attrs(attrs, attr_count, &peer_attrs,
+		       &peer_attrs_len) != TEE_SUCCESS)
+		crypto_errx("pack_attrs", TEEC_ERROR_OUT_OF_MEMORY, NULL);
+	free(x);
+	free(y);
+
+	/* The shared secret is at most as large as the key */
+	secret_obj = alloc_object(TEE_TYPE_GENERIC_SECRET, len * 8);
+
+	memset(op, 0, sizeof(*op));
+	op->paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT,
+					  TEEC_MEMREF_TEMP_INPUT, TEEC_NONE,
+					  TEEC_NONE);
+	op->params[0].value.a = oph;
+	op->params[0].value.b = secret_obj;
+	op->params[1].tmpref.buffer = peer_attrs;
+	op->params[1].tmpref.size = peer_attrs_len;
+	*cmd = TA_CRYPT_CMD_DERIVE_KEY;
+}
+
+/*
+ * Set up the timed operation @op and its command @cmd. Verify and decrypt
+ * need a valid signature or ciphertext, made here with a second operation.
+ */
+static void prepare_asym(const struct perf_alg *alg, int decrypt,
+			 uint32_t key_size, TEEC_Operation *op, uint32_t *cmd)
+{
+	int sign = alg_class(alg) == TEE_OPERATION_ASYMMETRIC_SIGNATURE;
+	size_t in_size = asym_in_size(alg, key_size);
+	TEEC_Operation prep;
+	uint32_t h;
+
+	/* RSA without padding: keep the input below the modulus */
+	if (alg->algo == TEE_ALG_RSA_NOPAD)
+		((uint8_t *)in_shm.buffer)[0] = 0;
+
+	memset(op, 0, sizeof(*op));
+	op->paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT,
+					  TEEC_MEMREF_TEMP_INPUT,
+					  TEEC_MEMREF_PARTIAL_INPUT,
+					  TEEC_MEMREF_PARTIAL_OUTPUT);
+	op->params[0].value.a = oph;
+	op->params[2].memref.parent = &in_shm;
+	op->params[2].memref.size = in_size;
+	op->params[3].memref.parent = &out_shm;
+	op->params[3].memref.size = out_shm.size;
+	if (sign)
+		*cmd = decrypt ? TA_CRYPT_CMD_ASYMMETRIC_VERIFY_DIGEST :
+				 TA_CRYPT_CMD_ASYMMETRIC_SIGN_DIGEST;
+	else
+		*cmd = decrypt ? TA_CRYPT_CMD_ASYMMETRIC_DECRYPT :
+				 TA_CRYPT_CMD_ASYMMETRIC_ENCRYPT;
+	if (!decrypt)
+		return;
+
+	h = setup_operation(alg, sign ? TEE_MODE_SIGN : TEE_MODE_ENCRYPT,
+			    key_size);
+	prep = *op;
+	prep.params[0].value.a = h;
+	crypt_invoke(sign ? TA_CRYPT_CMD_ASYMMETRIC_SIGN_DIGEST :
+			    TA_CRYPT_CMD_ASYMMETRIC_ENCRYPT, &prep,
+		     sign ? "sign" : "encrypt");
+	free_operation(h);
+
+	if (sign) {
+		alloc_shm(&sig_shm, prep.params[3].memref.size);
+		memcpy(sig_shm.buffer, out_shm.buffer, sig_shm.size);
+		op->paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT,
+						  TEEC_MEMREF_TEMP_INPUT,
+						  TEEC_MEMREF_PARTIAL_INPUT,
+						  TEEC_MEMREF_PARTIAL_INPUT);
+		op->params[3].memref.parent = &sig_shm;
+		op->params[3].memref.size = sig_shm.size;
+	} else {
+		memcpy(in_shm.buffer, out_shm.buffer,
+		       prep.params[3].memref.size);
+		op->params[2].memref.size = prep.params[3].memref.size;
+	}
+}
+
+static void prepare_sym(const struct perf_alg *alg, TEEC_Operation *op,
+			uint32_t *cmd)
+{
+	memset(op, 0, sizeof(*op));
+	op->paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT,
+					  TEEC_MEMREF_PARTIAL_INPUT,
+					  TEEC_MEMREF_PARTIAL_OUTPUT,
+					  TEEC_NONE);
+	op->params[0].value.a = oph;
+	op->params[1].memref.parent = &in_shm;
+	op->params[2].memref.parent = &out_shm;
+
+	switch (alg_class(alg)) {
+	case TEE_OPERATION_CIPHER:
+		*cmd = TA_CRYPT_CMD_CIPHER_UPDATE;
+		break;
+	case TEE_OPERATION_AE:
+		*cmd = TA_CRYPT_CMD_AE_UPDATE;
+		break;
+	case TEE_OPERATION_MAC:
+		op->paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT,
+						  TEEC_MEMREF_PARTIAL_INPUT,
+						  TEEC_NONE, TEEC_NONE);
+		*cmd = TA_CRYPT_CMD_MAC_UPDATE;
+		break;
+	default:
+		*cmd = TA_CRYPT_CMD_DIGEST_DO_FINAL;
+		break;
+	}
+}
+
+static void reset_object(uint32_t obj)
+{
+	TEEC_Operation op;
+
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT, TEEC_NONE,
+					 TEEC_NONE, TEEC_NONE);
+	op.params[0].value.a = obj;
+	crypt_invoke(TA_CRYPT_CMD_RESET_TRANSIENT_OBJECT, &op,
+		     "reset object");
+}
+
+static uint64_t run_test_once(void *in, size_t size, int random_in,
+			      uint32_t cmd, TEEC_Operation *op)
+{
+	struct timespec t0, t1;
+	TEEC_Result res;
+	uint32_t ret_origin;
+
+	if (random_in == CRYPTO_USE_RANDOM)
+		read_random(in, size);
+	/* TEE_DeriveKey() and TEE_GenerateKey() need an uninitialized object */
+	if (secret_obj)
+		reset_object(secret_obj);
+	if (keygen_obj)
+		reset_object(keygen_obj);
+	/* The TA updates the output sizes */
+	if (TEEC_PARAM_TYPE_GET(op->paramTypes, 2) ==
+	    TEEC_MEMREF_PARTIAL_OUTPUT)
+		op->params[2].memref.size = out_shm.size;
+	if (TEEC_PARAM_TYPE_GET(op->paramTypes, 3) ==
+	    TEEC_MEMREF_PARTIAL_OUTPUT)
+		op->params[3].memref.size = out_shm.size;
+
+	get_current_time(&t0);
+	res = TEEC_InvokeCommand(&sess, cmd, op, &ret_origin);
+	crypto_check_res(res, "TEEC_InvokeCommand", &ret_origin);
+	get_current_time(&t1);
+
+	return timespec_diff_ns(&t0, &t1);
+}
+
+/*
+ * Run @n timed invocations of @cmd. Symmetric operations process @size bytes
+ * of the input buffer, asymmetric ones have their input set up beforehand.
+ */
+static void measure(TEEC_Operation *op, uint32_t cmd, size_t size,
+		    unsigned int n, int random_in, struct statistics *stats,
+		    struct lat_hist *h, int verbosity)
+{
+	unsigned int n0 = n;
+	uint64_t t;
+
+	memset(stats, 0, sizeof(*stats));
+	lat_hist_init(h);
+	if (size)
+		op->params[1].memref.size = size;
+
+	while (n-- > 0) {
+		t = run_test_once(in_shm.buffer, size, random_in, cmd, op);
+		update_stats(stats, t);
+		lat_hist_record(h, t);
+		if (n0 >= 10 && n % (n0 / 10) == 0)
+			vverbose("#");
+	}
+	vverbose("\n");
+}
+
+static void run_sweep(TEEC_Operation *op, uint32_t cmd, unsigned int n,
+		      int random_in, int verbosity)
+{
+	unsigned int count = size_sweep_count(&sweep);
+	struct sweep_row *rows = NULL;
+	struct statistics stats;
+	unsigned int i = 0;
+	size_t sz = 0;
+
+	rows = calloc(count, sizeof(*rows));
+	if (!rows)
+		crypto_errx("calloc", TEEC_ERROR_OUT_OF_MEMORY, NULL);
+
+	for (i = 0; i < count; i++) {
+		sz = size_sweep_get(&sweep, i);
+		verbose("size=%zu bytes\n", sz);
+		measure(op, cmd, sz, n, random_in, &stats, &hist, verbosity);
+		sweep_record(rows + i, sz, sz, &stats, &hist, NULL);
+		if (dump_hist && perf_output_text()) {
+			printf("size=%zu bytes:\n", sz);
+			lat_hist_dump(&hist);
+		}
+	}
+	sweep_print(rows, count, &params);
+	free(rows);
+}
+
+static void record_params(const struct perf_alg *alg, int decrypt,
+			  uint32_t key_size, unsigned int n, int random_in,
+			  int warmup)
+{
+	perf_record_init(&params, "crypto_perf");
+	perf_record_str(&params, "algo", alg->name);
+	perf_record_str(&params, "mode", mode_str(alg, decrypt));
+	perf_record_uint(&params, "key_size", alg->key_type ? key_size : 0);
+	perf_record_uint(&params, "loops", n);
+	perf_record_str(&params, "input_data",
+			random_in == CRYPTO_USE_RANDOM ? "random" : "zeros");
+	perf_record_int(&params, "warmup_s", warmup);
+}
+
+static void emit_result(const struct perf_alg *alg, size_t size,
+			struct statistics *stats)
+{
+	struct perf_record r = params;
+	struct lat_summary sum;
+
+	lat_hist_summary(&hist, &sum);
+	perf_record_uint(&r, "size", size);
+	perf_record_stats(&r, size, stats, &sum);
+	if (is_asym(alg))
+		perf_record_double(&r, "ops_per_s", 1000000000.0 / stats->m);
+	perf_record_emit(&r);
+}
+
+static void run_test(const struct perf_alg *alg, int decrypt,
+		     uint32_t key_size, size_t size, unsigned int n,
+		     int random_in, int warmup, int verbosity)
+{
+	struct statistics stats;
+	TEEC_Operation op;
+	uint32_t cmd = 0;
+	size_t buf_size;
+	double sd;
+
+	record_params(alg, decrypt, key_size, n, random_in, warmup);
+
+	crypto_open_ta(&ctx, &sess, &crypt_user_ta_uuid);
+	if (alg->key_type) {
+		key_obj[0] = alloc_key(alg, key_size);
+		if (alg->algo == TEE_ALG_AES_XTS)
+			key_obj[1] = alloc_key(alg, key_size);
+	}
+	oph = setup_operation(alg, op_mode(alg, decrypt), key_size);
+	init_operation(alg);
+
+	if (is_asym(alg)) {
+		size = asym_in_size(alg, key_size);
+		buf_size = asym_buf_size(key_size);
+	} else {
+		/* Room for the blocks a cipher may hold back then release */
+		buf_size = size + 64;
+	}
+	alloc_shm(&in_shm, buf_size);
+	alloc_shm(&out_shm, buf_size);
+	if (random_in == CRYPTO_USE_RANDOM)
+		read_random(in_shm.buffer, in_shm.size);
+	else
+		memset(in_shm.buffer, 0, in_shm.size);
+
+	if (alg_class(alg) == TEE_OPERATION_KEY_DERIVATION) {
+		prepare_derive(alg, key_size, &op, &cmd);
+	} else if (is_asym(alg)) {
+		prepare_asym(alg, decrypt, key_size, &op, &cmd);
+		/* The input must stay a valid digest or ciphertext */
+		random_in = CRYPTO_NOT_INITED;
+	} else {
+		prepare_sym(alg, &op, &cmd);
+	}
+
+	verbose("Starting test: TEE_ALG_%s, %s, ", alg->name,
+		mode_str(alg, decrypt));
+	if (alg->key_type)
+		verbose("key=%u bits, ", key_size);
+	if (sweep.factor)
+		verbose("size=%zu..%zu bytes (x%u), ", sweep.start, sweep.end,
+			sweep.factor);
+	else
+		verbose("size=%zu bytes, ", size);
+	verbose("random=%s, ", yesno(random_in == CRYPTO_USE_RANDOM));
+	verbose("loops=%u, warm-up=%u s\n", n, warmup);
+
+	if (warmup)
+		do_warmup(warmup);
+
+	if (sweep.factor) {
+		run_sweep(&op, cmd, n, random_in, verbosity);
+		goto out;
+	}
+
+	/* Asymmetric operations already have their input memref set up */
+	measure(&op, cmd, is_asym(alg) ? 0 : size, n, random_in, &stats, &hist,
+		verbosity);
+	if (!perf_output_text()) {
+		emit_result(alg, size, &stats);
+		goto out;
+	}
+	sd = stddev(&stats);
+	printf("min=%gus max=%gus mean=%gus stddev=%gus (cv %g%%) ",
+	       stats.min / 1000, stats.max / 1000, stats.m / 1000,
+	       sd / 1000, 100 * sd / stats.m);
+	if (is_asym(alg))
+		printf("(%g ops/s)\n", 1000000000.0 / stats.m);
+	else
+		printf("(%gMiB/s)\n", mb_per_sec(size, stats.m));
+	lat_hist_print_percentiles(&hist);
+	if (dump_hist)
+		lat_hist_dump(&hist);
+out:
+	free_operation(oph);
+	if (alg->key_type)
+		free_key(key_obj[0]);
+	if (alg->algo == TEE_ALG_AES_XTS)
+		free_key(key_obj[1]);
+	if (secret_obj) {
+		free_key(secret_obj);
+		free_key(peer_obj);
+		secret_obj = 0;
+		peer_obj = 0;
+	}
+	free(peer_attrs);
+	peer_attrs = NULL;
+	free_shm();
+	TEEC_CloseSession(&sess);
+	TEEC_FinalizeContext(&ctx);
+}
+
+/* Print why the parameters are not supported and return -1 */
+static int check_params(const struct perf_alg *alg, int decrypt,
+			uint32_t key_size, size_t size)
+{
+	if (decrypt && (alg_class(alg) == TEE_OPERATION_MAC ||
+			alg_class(alg) == TEE_OPERATION_DIGEST ||
+			alg_class(alg) == TEE_OPERATION_KEY_DERIVATION)) {
+		fprintf(stderr, "-d is not supported with MAC, digest and key derivation algorithms\n");
+		return -1;
+	}
+
+	if (is_asym(alg) && sweep.factor) {
+		fprintf(stderr, "A size sweep is not supported with asymmetric algorithms\n");
+		return -1;
+	}
+
+	if (alg_class(alg) == TEE_OPERATION_ASYMMETRIC_CIPHER &&
+	    (key_size + 7) / 8 <= alg->in_len) {
+		fprintf(stderr, "Key size too small for TEE_ALG_%s\n",
+			alg->name);
+		return -1;
+	}
+
+	if (alg->key_type == TEE_TYPE_DH_KEYPAIR &&
+	    key_size != sizeof(dh_prime) * 8) {
+		fprintf(stderr, "TEE_ALG_%s: only %zu-bit keys are supported\n",
+			alg->name, sizeof(dh_prime) * 8);
+		return -1;
+	}
+
+	if (!is_asym(alg) && (!size || size % alg->block)) {
+		fprintf(stderr, "TEE_ALG_%s: size must be a multiple of %zu bytes\n",
+			alg->name, alg->block);
+		return -1;
+	}
+
+	if (sweep.factor && (sweep.start % alg->block)) {
+		fprintf(stderr, "TEE_ALG_%s: sweep sizes must be multiples of %zu bytes\n",
+			alg->name, alg->block);
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * Run one test, @algo being a TEE_ALG_* name and @key_size 0 for the
+ * algorithm default. Asymmetric algorithms ignore @size.
+ */
+void crypto_perf_run_test(const char *algo, int decrypt, uint32_t key_size,
+			  size_t size, unsigned int n, int random_in,
+			  int warmup, int verbosity)
+{
+	const struct perf_alg *alg = find_alg(algo);
+
+	if (!alg) {
+		fprintf(stderr, "crypto_perf: unknown algorithm: %s\n", algo);
+		return;
+	}
+	if (!key_size)
+		key_size = alg->key_size;
+	if (check_params(alg, decrypt, key_size, size))
+		return;
+
+	if (perf_output_text()) {
+		printf("TEE_ALG_%s, %s", alg->name, mode_str(alg, decrypt));
+		if (alg->key_type)
+			printf(", %u-bit key", key_size);
+		printf(":\n");
+	}
+	run_test(alg, decrypt, key_size, size, n, random_in, warmup,
+		 verbosity);
+}
+
+static const struct perf_keygen *find_keygen(const char *name)
+{
+	size_t n;
+
+	for (n = 0; n < sizeof(keygens) / sizeof(keygens[0]); n++)
+		if (!strcasecmp(name, keygens[n].name))
+			return keygens + n;
+	return NULL;
+}
+
+static int check_keygen(const struct perf_keygen *kg, uint32_t key_size)
+{
+	TEE_Attribute attrs[3];
+	size_t attr_count = 0;
+
+	if (kg->curve && key_size != kg->key_size) {
+		fprintf(stderr, "%s: only %u-bit keys are supported\n",
+			kg->name, kg->key_size);
+		return -1;
+	}
+	if (keypair_attrs(kg->key_type, kg->curve, key_size, attrs,
+			  &attr_count)) {
+		fprintf(stderr, "%s: no domain parameters for %u-bit keys\n",
+			kg->name, key_size);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * Key generation time is data dependent (prime search), so the full
+ * distribution is reported along with the worst case.
+ */
+static void run_keygen(const struct perf_keygen *kg, uint32_t key_size,
+		       unsigned int n, int warmup, int verbosity)
+{
+	TEE_Attribute attrs[3];
+	size_t attr_count = 0;
+	struct statistics stats;
+	struct lat_summary sum;
+	struct perf_record r;
+	uint8_t *buf = NULL;
+	size_t blen = 0;
+	TEEC_Operation op;
+	double sd;
+
+	perf_record_init(&params, "crypto_perf");
+	perf_record_str(&params, "keygen", kg->name);
+	perf_record_uint(&params, "key_size", key_size);
+	perf_record_uint(&params, "loops", n);
+	perf_record_int(&params, "warmup_s", warmup);
+
+	crypto_open_ta(&ctx, &sess, &crypt_user_ta_uuid);
+	keygen_obj = alloc_object(kg->key_type, key_size);
+	keypair_attrs(kg->key_type, kg->curve, key_size, attrs, &attr_count);
+	if (pack_attrs(attrs, attr_count, &buf, &blen) != TEE_SUCCESS)
+		crypto_errx("pack_attrs", TEEC_ERROR_OUT_OF_MEMORY, NULL);
+
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT,
+					 TEEC_MEMREF_TEMP_INPUT, TEEC_NONE,
+					 TEEC_NONE);
+	op.params[0].value.a = keygen_obj;
+	op.params[0].value.b = key_size;
+	op.params[1].tmpref.buffer = buf;
+	op.params[1].tmpref.size = blen;
+
+	verbose("Starting test: %s key generation, key=%u bits, ", kg->name,
+		key_size);
+	verbose("loops=%u, warm-up=%u s\n", n, warmup);
+
+	if (warmup)
+		do_warmup(warmup);
+
+	measure(&op, TA_CRYPT_CMD_GENERATE_KEY, 0, n, CRYPTO_NOT_INITED,
+		&stats, &hist, verbosity);
+	lat_hist_summary(&hist, &sum);
+	if (!perf_output_text()) {
+		r = params;
+		perf_record_stats(&r, 0, &stats, &sum);
+		perf_record_double(&r, "worst_to_median", stats.max / sum.p50);
+		perf_record_emit(&r);
+		goto out;
+	}
+	sd = stddev(&stats);
+	printf("min=%gms max=%gms mean=%gms stddev=%gms (cv %g%%)\n",
+	       stats.min / 1000000, stats.max / 1000000, stats.m / 1000000,
+	       sd / 1000000, 100 * sd / stats.m);
+	lat_hist_print_percentiles(&hist);
+	printf("worst case: %gms (%.1fx the median)\n", stats.max / 1000000,
+	       stats.max / sum.p50);
+	lat_hist_dump(&hist);
+out:
+	free(buf);
+	free_key(keygen_obj);
+	keygen_obj = 0;
+	TEEC_CloseSession(&sess);
+	TEEC_FinalizeContext(&ctx);
+}
+
+/*
+ * Measure @n key pair generations, @type being a --keygen name such as
+ * "RSA" or "P-256" and @key_size 0 for the type default.
+ */
+void crypto_perf_keygen(const char *type, uint32_t key_size, unsigned int n,
+			int warmup, int verbosity)
+{
+	const struct perf_keygen *kg = find_keygen(type);
+
+	if (!kg) {
+		fprintf(stderr, "crypto_perf: unknown key type: %s\n", type);
+		return;
+	}
+	if (!key_size)
+		key_size = kg->key_size;
+	if (check_keygen(kg, key_size))
+		return;
+
+	if (perf_output_text())
+		printf("%s key generation, %u-bit key:\n", kg->name, key_size);
+	run_keygen(kg, key_size, n, warmup, verbosity);
+}
+
+static void list_algs(void)
+{
+	size_t n;
+
+	for (n = 0; n < sizeof(algs) / sizeof(algs[0]); n++) {
+		printf("%-32s %-8s", algs[n].name, mode_str(algs + n, 0));
+		if (algs[n].key_type)
+			printf(" key=%u bits", algs[n].key_size);
+		printf("\n");
+	}
+	printf("\nKey types (--keygen):\n");
+	for (n = 0; n < sizeof(keygens) / sizeof(keygens[0]); n++)
+		printf("%-32s key=%u bits\n", keygens[n].name,
+		       keygens[n].key_size);
+}
+
+static void usage(const char *progname, size_t size, int warmup, int n)
+{
+	fprintf(stderr, "Usage: %s [-h]\n", progname);
+	fprintf(stderr, "Usage: %s -a ALGO [-d] [--format FMT] [--hist] [-k BITS] [--list] [-n LOOP]", progname);
+	fprintf(stderr, " [--output FILE] [-r] [-s SIZE] [-v [-v]] [-w SEC]\n");
+	fprintf(stderr, "Usage: %s --keygen TYPE [--format FMT] [-k BITS] [-n LOOP]", progname);
+	fprintf(stderr, " [--output FILE] [-v [-v]] [-w SEC]\n");
+	fprintf(stderr, "Generic crypto performance testing tool for OP-TEE, using the crypt TA\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "Options:\n");
+	fprintf(stderr, "  -a ALGO          Algorithm, by TEE_ALG_* name with or without the\n");
+	fprintf(stderr, "                   prefix, e.g. AES_CBC_NOPAD (see --list)\n");
+	fprintf(stderr, "  -d               Decrypt or verify instead of encrypt or sign\n");
+	fprintf(stderr, "  --format FMT     Result format: text, json (one object per line) or csv [text]\n");
+	fprintf(stderr, "  -h|--help        Print this help and exit\n");
+	fprintf(stderr, "  --hist           Print the full latency histogram\n");
+	fprintf(stderr, "  -k BITS          Key size in bits [algorithm default]\n");
+	fprintf(stderr, "  --keygen TYPE    Measure key pair generation instead, e.g. RSA or\n");
+	fprintf(stderr, "                   P-256 (see --list), and print the latency\n");
+	fprintf(stderr, "                   distribution [-n: %u]\n", CRYPTO_KEYGEN_COUNT);
+	fprintf(stderr, "  --list           List the algorithms and exit\n");
+	fprintf(stderr, "  -n LOOP          Outer test loop iterations [%u, asymmetric: %u]\n",
+		n, CRYPTO_ASYM_COUNT);
+	fprintf(stderr, "  --output FILE    Write json/csv results to FILE instead of stdout\n");
+	fprintf(stderr, "  -r|--random      Get input data from /dev/urandom (default: all-zeros)\n");
+	fprintf(stderr, "  -s SIZE          Test buffer size in bytes, K/M suffixes allowed [%zu]\n", size);
+	fprintf(stderr, "                   (ignored by asymmetric algorithms, whose input is\n");
+	fprintf(stderr, "                   sized after the algorithm and key)\n");
+	fprintf(stderr, "  -s START:END[:xF]  Size sweep: test START, START*F, ... up to END\n");
+	fprintf(stderr, "                   bytes (F defaults to 2), print one row per size and\n");
+	fprintf(stderr, "                   the fixed per-invoke cost\n");
+	fprintf(stderr, "  -v               Be verbose (use twice for greater effect)\n");
+	fprintf(stderr, "  -w|--warmup SEC  Warm-up time in seconds: execute a busy loop before\n");
+	fprintf(stderr, "                   the test to mitigate the effects of cpufreq etc. [%u]\n", warmup);
+}
+
+#define NEXT_ARG(i) \
+	do { \
+		if (++i == argc) { \
+			fprintf(stderr, "%s: %s: missing argument\n", \
+				argv[0], argv[i - 1]); \
+			return 1; \
+		} \
+	} while (0);
+
+int crypto_perf_runner_cmd_parser(int argc, char *argv[])
+{
+	int i;
+	/* Command line params */
+	size_t size = 1024;	/* Buffer size (-s) */
+	unsigned int n = CRYPTO_DEF_COUNT;/* Number of measurements (-n)*/
+	int verbosity = CRYPTO_DEF_VERBOSITY;	/* Verbosity (-v) */
+	const struct perf_alg *alg = NULL;	/* Algorithm (-a) */
+	uint32_t key_size = 0;	/* Key size in bits (-k) */
+	int decrypt = 0;	/* Decrypt or verify (-d) */
+	/* Get input data from /dev/urandom (-r) */
+	int random_in = CRYPTO_USE_ZEROS;
+	/* Start with a 2-second busy loop (-w) */
+	int warmup = CRYPTO_DEF_WARMUP;
+	int n_set = 0;
+	const struct perf_keygen *kg = NULL;	/* Key type (--keygen) */
+
+	/* Parse command line */
+	for (i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-h") || !strcmp(argv[i], "--help")) {
+			usage(argv[0], size, warmup, n);
+			return 0;
+		}
+		if (!strcmp(argv[i], "--list")) {
+			list_algs();
+			return 0;
+		}
+	}
+	for (i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-a")) {
+			NEXT_ARG(i);
+			alg = find_alg(argv[i]);
+			if (!alg) {
+				fprintf(stderr, "%s: unknown algorithm: %s (see --list)\n",
+					argv[0], argv[i]);
+				return 1;
+			}
+		} else if (!strcmp(argv[i], "-d")) {
+			decrypt = 1;
+		} else if (!strcmp(argv[i], "--format")) {
+			NEXT_ARG(i);
+			if (perf_output_set_format(argv[i])) {
+				fprintf(stderr, "%s: invalid format\n",
+					argv[0]);
+				usage(argv[0], size, warmup, n);
+				return 1;
+			}
+		} else if (!strcmp(argv[i], "--hist")) {
+			dump_hist = 1;
+		} else if (!strcmp(argv[i], "-k")) {
+			NEXT_ARG(i);
+			key_size = atoi(argv[i]);
+			if (!key_size) {
+				fprintf(stderr, "%s: invalid key size\n",
+					argv[0]);
+				usage(argv[0], size, warmup, n);
+				return 1;
+			}
+		} else if (!strcmp(argv[i], "--keygen")) {
+			NEXT_ARG(i);
+			kg = find_keygen(argv[i]);
+			if (!kg) {
+				fprintf(stderr, "%s: unknown key type: %s (see --list)\n",
+					argv[0], argv[i]);
+				return 1;
+			}
+		} else if (!strcmp(argv[i], "-n")) {
+			NEXT_ARG(i);
+			n = atoi(argv[i]);
+			n_set = 1;
+		} else if (!strcmp(argv[i], "--output")) {
+			NEXT_ARG(i);
+			if (perf_output_set_file(argv[i]))
+				return 1;
+		} else if (!strcmp(argv[i], "--random") ||
+			   !strcmp(argv[i], "-r")) {
+			random_in = CRYPTO_USE_RANDOM;
+		} else if (!strcmp(argv[i], "-s")) {
+			NEXT_ARG(i);
+			if (strchr(argv[i], ':')) {
+				if (parse_size_sweep(argv[i], &sweep)) {
+					fprintf(stderr, "%s: invalid size sweep\n",
+						argv[0]);
+					usage(argv[0], size, warmup, n);
+					return 1;
+				}
+				size = size_sweep_get(&sweep,
+					size_sweep_count(&sweep) - 1);
+			} else if (parse_size(argv[i], &size)) {
+				fprintf(stderr, "%s: invalid size\n", argv[0]);
+				usage(argv[0], size, warmup, n);
+				return 1;
+			}
+		} else if (!strcmp(argv[i], "-v")) {
+			verbosity++;
+		} else if (!strcmp(argv[i], "--warmup") ||
+			   !strcmp(argv[i], "-w")) {
+			NEXT_ARG(i);
+			warmup = atoi(argv[i]);
+		} else {
+			fprintf(stderr, "%s: invalid argument: %s\n",
+				argv[0], argv[i]);
+			usage(argv[0], size, warmup, n);
+			return 1;
+		}
+	}
+
+	if (kg) {
+		if (alg || decrypt || sweep.factor) {
+			fprintf(stderr, "%s: --keygen excludes -a, -d and size sweeps\n\n",
+				argv[0]);
+			usage(argv[0], size, warmup, n);
+			return 1;
+		}
+		if (!key_size)
+			key_size = kg->key_size;
+		if (check_keygen(kg, key_size)) {
+			fprintf(stderr, "\n");
+			usage(argv[0], size, warmup, n);
+			return 1;
+		}
+		run_keygen(kg, key_size, n_set ? n : CRYPTO_KEYGEN_COUNT,
+			   warmup, verbosity);
+		return 0;
+	}
+
+	if (!alg) {
+		fprintf(stderr, "%s: no algorithm (-a)\n\n", argv[0]);
+		usage(argv[0], size, warmup, n);
+		return 1;
+	}
+
+	if (!key_size)
+		key_size = alg->key_size;
+
+	/* Public key operations take milliseconds */
+	if (is_asym(alg) && !n_set)
+		n = CRYPTO_ASYM_COUNT;
+
+	if (check_params(alg, decrypt, key_size, size)) {
+		fprintf(stderr, "\n");
+		usage(argv[0], size, warmup, n);
+		return 1;
+	}
+
+	run_test(alg, decrypt, key_size, size, n, random_in, warmup,
+		 verbosity);
+
+	return 0;
+}
@@ -0,0 +1,244 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Copyright (c) 2026, Linaro Limited
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/utsname.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "perf_output.h"
+
+static enum perf_format format = PERF_FORMAT_TEXT;
+static FILE *out_file;
+static const char *case_id;
+
+/* Keys of the last CSV header line, to re-emit it when the layout changes */
+static char csv_header[PERF_RECORD_MAX_FIELDS * 32];
+
+int perf_output_set_format(const char *name)
+{
+	if (!strcmp(name, "text"))
+		format = PERF_FORMAT_TEXT;
+	else if (!strcmp(name, "json"))
+		format = PERF_FORMAT_JSON;
+	else if (!strcmp(name, "csv"))
+		format = PERF_FORMAT_CSV;
+	else
+		return -1;
+	return 0;
+}
+
+int perf_output_set_file(const char *path)
+{
+	FILE *f = fopen(path, "w");
+
+	if (!f) {
+		perror(path);
+		return -1;
+	}
+	if (out_file)
+		fclose(out_file);
+	out_file = f;
+	csv_header[0] = '\0';
+	return 0;
+}
+
+bool perf_output_text(void)
+{
+	return format == PERF_FORMAT_TEXT;
+}
+
+/* Test case identifier added to the records, NULL to clear */
+void perf_output_set_case(const char *id)
+{
+	case_id = id;
+}
+
+static struct perf_field *add_field(struct perf_record *r, const char *key,
+				    bool quoted)
+{
+	struct perf_field *f = NULL;
+
+	if (r->count >= PERF_RECORD_MAX_FIELDS) {
+		fprintf(stderr, "perf record: too many fields, %s dropped\n",
+			key);
+		return NULL;
+	}
+	f = r->f + r->count++;
+	f->key = key;
+	f->quoted = quoted;
+	f->val[0] = '\0';
+	return f;
+}
+
+void perf_record_init(struct perf_record *r, const char *test)
+{
+	r->count = 0;
+	if (case_id)
+		perf_record_str(r, "case", case_id);
+	perf_record_str(r, "test", test);
+}
+
+void perf_record_str(struct perf_record *r, const char *key, const char *val)
+{
+	struct perf_field *f = add_field(r, key, true);
+
+	if (f)
+		snprintf(f->val, sizeof(f->val), "%s", val);
+}
+
+void perf_record_uint(struct perf_record *r, const char *key,
+		      unsigned long long val)
+{
+	struct perf_field *f = add_field(r, key, false);
+
+	if (f)
+		snprintf(f->val, sizeof(f->val), "%llu", val);
+}
+
+void perf_record_int(struct perf_record *r, const char *key, long long val)
+{
+	struct perf_field *f = add_field(r, key, false);
+
+	if (f)
+		snprintf(f->val, sizeof(f->val), "%lld", val);
+}
+
+void perf_record_double(struct perf_record *r, const char *key, double val)
+{
+	struct perf_field *f = add_field(r, key, false);
+
+	if (!f)
+		return;
+	/* JSON has no representation for NaN/Inf */
+	if (isfinite(val))
+		snprintf(f->val, sizeof(f->val), "%.9g", val);
+	else if (format == PERF_FORMAT_JSON)
+		snprintf(f->val, sizeof(f->val), "null");
+}
+
+void perf_record_bool(struct perf_record *r, const char *key, bool val)
+{
+	struct perf_field *f = add_field(r, key, false);
+
+	if (!f)
+		return;
+	if (format == PERF_FORMAT_JSON)
+		snprintf(f->val, sizeof(f->val), "%s", val ? "true" : "false");
+	else
+		snprintf(f->val, sizeof(f->val), "%d", val);
+}
+
+static void add_env(struct perf_record *r)
+{
+	static struct utsname uts;
+	static long ncpus;
+	static bool inited;
+	struct tm tm = { };
+	char ts[32] = { };
+	time_t now = time(NULL);
+
+	if (!inited) {
+		if (uname(&uts))
+			memset(&uts, 0, sizeof(uts));
+		ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+		inited = true;
+	}
+
+	if (gmtime_r(&now, &tm))
+		strftime(ts, sizeof(ts), "%Y-%m-%dT%H:%M:%SZ", &tm);
+	perf_record_str(r, "timestamp", ts);
+	perf_record_str(r, "host", uts.nodename);
+	perf_record_str(r, "kernel", uts.release);
+	perf_record_str(r, "machine", uts.machine);
+	perf_record_int(r, "ncpus", ncpus);
+}
+
+static void print_json_string(FILE *f, const char *s)
+{
+	fputc('"', f);
+	for (; *s; s++) {
+		if (*s == '"' || *s == '\\')
+			fprintf(f, "\\%c", *s);
+		else if ((unsigned char)*s < 0x20)
+			fprintf(f, "\\u%04x", (unsigned char)*s);
+		else
+			fputc(*s, f);
+	}
+	fputc('"', f);
+}
+
+static void emit_json(FILE *f, struct perf_record *r)
+{
+	unsigned int i = 0;
+
+	fputc('{', f);
+	for (i = 0; i < r->count; i++) {
+		if (i)
+			fputc(',', f);
+		print_json_string(f, r->f[i].key);
+		fputc(':', f);
+		if (r->f[i].quoted)
+			print_json_string(f, r->f[i].val);
+		else
+			fputs(r->f[i].val, f);
+	}
+	fputs("}\n", f);
+}
+
+static void print_csv_value(FILE *f, const char *s)
+{
+	if (!strpbrk(s, ",\"\n")) {
+		fputs(s, f);
+		return;
+	}
+	fputc('"', f);
+	for (; *s; s++) {
+		if (*s == '"')
+			fputc('"', f);
+		fputc(*s, f);
+	}
+	fputc('"', f);
+}
+
+static void emit_csv(FILE *f, struct perf_record *r)
+{
+	char hdr[sizeof(csv_header)] = { };
+	size_t len = 0;
+	unsigned int i = 0;
+
+	for (i = 0; i < r->count && len < sizeof(hdr); i++)
+		len += snprintf(hdr + len, sizeof(hdr) - len, "%s%s",
+				i ? "," : "", r->f[i].key);
+	if (strcmp(hdr, csv_header)) {
+		strcpy(csv_header, hdr);
+		fprintf(f, "%s\n", hdr);
+	}
+
+	for (i = 0; i < r->count; i++) {
+		if (i)
+			fputc(',', f);
+		print_csv_value(f, r->f[i].val);
+	}
+	fputc('\n', f);
+}
+
+void perf_record_emit(struct perf_record *r)
+{
+	FILE *f = out_file ? out_file : stdout;
+
+	if (format == PERF_FORMAT_TEXT)
+		return;
+
+	add_env(r);
+	if (format == PERF_FORMAT_JSON)
+		emit_json(f, r);
+	else
+		emit_csv(f, r);
+	fflush(f);
+}
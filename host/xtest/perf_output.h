@@ -0,0 +1,56 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*
+ * Copyright (c) 2026, Linaro Limited
+ */
+
+#ifndef XTEST_PERF_OUTPUT_H
+#define XTEST_PERF_OUTPUT_H
+
+#include <stdbool.h>
+
+/*
+ * Performance result emitter
+ *
+ * Each result is a flat record of key/value pairs. In text format (the
+ * default) callers print their usual human readable output and records are
+ * not emitted. In JSON format each record is printed as one JSON object per
+ * line. In CSV format a header line is printed whenever the set of keys
+ * differs from the previous record. Environment metadata (timestamp, host,
+ * kernel, machine, CPU count) is appended to every record.
+ */
+
+enum perf_format {
+	PERF_FORMAT_TEXT = 0,
+	PERF_FORMAT_JSON,
+	PERF_FORMAT_CSV,
+};
+
+#define PERF_RECORD_MAX_FIELDS	48
+#define PERF_RECORD_VAL_LEN	128
+
+struct perf_field {
+	const char *key;
+	char val[PERF_RECORD_VAL_LEN];
+	bool quoted;
+};
+
+struct perf_record {
+	unsigned int count;
+	struct perf_field f[PERF_RECORD_MAX_FIELDS];
+};
+
+int perf_output_set_format(const char *name);
+int perf_output_set_file(const char *path);
+bool perf_output_text(void);
+void perf_output_set_case(const char *id);
+
+void perf_record_init(struct perf_record *r, const char *test);
+void perf_record_str(struct perf_record *r, const char *key, const char *val);
+void perf_record_uint(struct perf_record *r, const char *key,
+		      unsigned long long val);
+void perf_record_int(struct perf_record *r, const char *key, long long val);
+void perf_record_double(struct perf_record *r, const char *key, double val);
+void perf_record_bool(struct perf_record *r, const char *key, bool val);
+void perf_record_emit(struct perf_record *r);
+
+#endif /* XTEST_PERF_OUTPUT_H */
@@ -1473,3 +1473,293 @@ out:
 }
 ADBG_CASE_DEFINE(regression, 1020, xtest_tee_test_1020,
 		"Test lockdep algorithm");
+
+static TEEC_Result aes_path_invoke(TEEC_Session *session, uint32_t cmd,
+				   uint32_t path, const void *in, void *out,
+				   size_t size, uint32_t *used)
+{
+	TEEC_Operation op = TEEC_OPERATION_INITIALIZER;
+	TEEC_Result res;
+	uint32_t ret_orig;
+
+	op.params[0].tmpref.buffer = (void *)in;
+	op.params[0].tmpref.size = size;
+	op.params[1].tmpref.buffer = out;
+	op.params[1].tmpref.size = size;
+	op.params[2].value.a = path;
+	op.params[2].value.b = UINT32_MAX;
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_TEMP_INPUT,
+					 TEEC_MEMREF_TEMP_OUTPUT,
+					 TEEC_VALUE_INOUT, TEEC_NONE);
+
+	res = TEEC_InvokeCommand(session, cmd, &op, &ret_orig);
+	*used = op.params[2].value.b;
+	return res;
+}
+
+static const uint32_t aes_paths[] = {
+	TA_CRYPT_AES_PATH_REFERENCE, TA_CRYPT_AES_PATH_MULTIBLOCK,
+	TA_CRYPT_AES_PATH_BITSLICED, TA_CRYPT_AES_PATH_AUTO,
+};
+
+/* Encrypt and decrypt @nblocks blocks of @in with all paths */
+static void aes_paths_check(ADBG_Case_t *c, TEEC_Session *session,
+			    const uint8_t *in, size_t nblocks)
+{
+	size_t size = nblocks * 16;
+	uint8_t *ref = calloc(3, size);
+	uint8_t *out = ref + size;
+	uint8_t *dec = out + size;
+	uint32_t exp_path = 0;
+	uint32_t used = 0;
+	size_t n = 0;
+
+	if (!ADBG_EXPECT_NOT_NULL(c, ref))
+		return;
+
+	if (!ADBG_EXPECT_TEEC_SUCCESS(c,
+		aes_path_invoke(session, TA_CRYPT_CMD_AES256ECB_ENC,
+				TA_CRYPT_AES_PATH_REFERENCE, in, ref, size,
+				&used)))
+		goto out;
+
+	for (n = 0; n < ARRAY_SIZE(aes_paths); n++) {
+		exp_path = aes_paths[n];
+		if (exp_path == TA_CRYPT_AES_PATH_AUTO)
+			exp_path = nblocks >= 4 ? TA_CRYPT_AES_PATH_MULTIBLOCK :
+						  TA_CRYPT_AES_PATH_REFERENCE;
+
+		memset(out, 0, size);
+		if (!ADBG_EXPECT_TEEC_SUCCESS(c,
+			aes_path_invoke(session, TA_CRYPT_CMD_AES256ECB_ENC,
+					aes_paths[n], in, out, size, &used)))
+			goto out;
+		ADBG_EXPECT(c, exp_path, used);
+		if (!ADBG_EXPECT_BUFFER(c, ref, size, out, size))
+			Do_ADBG_Log("%zu blocks, path %" PRIu32, nblocks,
+				    aes_paths[n]);
+
+		memset(dec, 0, size);
+		if (!ADBG_EXPECT_TEEC_SUCCESS(c,
+			aes_path_invoke(session, TA_CRYPT_CMD_AES256ECB_DEC,
+					aes_paths[n], ref, dec, size, &used)))
+			goto out;
+		ADBG_EXPECT(c, exp_path, used);
+		if (!ADBG_EXPECT_BUFFER(c, in, size, dec, size))
+			Do_ADBG_Log("%zu blocks, path %" PRIu32, nblocks,
+				    aes_paths[n]);
+	}
+out:
+	free(ref);
+}
+
+static void xtest_tee_test_1021(ADBG_Case_t *c)
+{
+	static const uint8_t kat_in[] = {
+		0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+		0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+		0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17,
+		0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f
+	};
+	static const uint8_t kat_out[] = {
+		0x5A, 0x6E, 0x04, 0x57, 0x08, 0xFB, 0x71, 0x96,
+		0xF0, 0x2E, 0x55, 0x3D, 0x02, 0xC3, 0xA6, 0x92,
+		0xE9, 0xC3, 0xEF, 0x8A, 0xB2, 0x34, 0x53, 0xE6,
+		0xF0, 0x74, 0x9C, 0xD6, 0x36, 0xE7, 0xA8, 0x8E
+	};
+	/* Partial and full groups of 4 blocks */
+	static const size_t nblocks[] = { 1, 3, 4, 5, 8, 37 };
+	TEEC_Session session = { 0 };
+	uint8_t in[37 * 16] = { };
+	uint8_t out[sizeof(kat_out)] = { };
+	uint32_t ret_orig = 0;
+	uint32_t used = 0;
+	size_t n = 0;
+
+	for (n = 0; n < sizeof(in); n++)
+		in[n] = n * 7 + 3;
+
+	if (!ADBG_EXPECT_TEEC_SUCCESS(c, xtest_teec_open_session(
+					      &session, &crypt_user_ta_uuid,
+					      NULL, &ret_orig)))
+		return;
+
+	Do_ADBG_BeginSubCase(c, "Known answer, all paths");
+	for (n = 0; n < ARRAY_SIZE(aes_paths); n++) {
+		if (!ADBG_EXPECT_TEEC_SUCCESS(c,
+			aes_path_invoke(&session, TA_CRYPT_CMD_AES256ECB_ENC,
+					aes_paths[n], kat_in, out,
+					sizeof(kat_in), &used)))
+			break;
+		ADBG_EXPECT_BUFFER(c, kat_out, sizeof(kat_out), out,
+				   sizeof(out));
+		if (!ADBG_EXPECT_TEEC_SUCCESS(c,
+			aes_path_invoke(&session, TA_CRYPT_CMD_AES256ECB_DEC,
+					aes_paths[n], kat_out, out,
+					sizeof(kat_out), &used)))
+			break;
+		ADBG_EXPECT_BUFFER(c, kat_in, sizeof(kat_in), out,
+				   sizeof(out));
+	}
+	Do_ADBG_EndSubCase(c, "Known answer, all paths");
+
+	Do_ADBG_BeginSubCase(c, "Paths agree with the reference");
+	for (n = 0; n < ARRAY_SIZE(nblocks); n++)
+		aes_paths_check(c, &session, in, nblocks[n]);
+	Do_ADBG_EndSubCase(c, "Paths agree with the reference");
+
+	Do_ADBG_BeginSubCase(c, "Unknown path");
+	ADBG_EXPECT_TEEC_RESULT(c, TEEC_ERROR_BAD_PARAMETERS,
+		aes_path_invoke(&session, TA_CRYPT_CMD_AES256ECB_ENC,
+				TA_CRYPT_AES_PATH_BITSLICED + 1, in, out,
+				sizeof(out), &used));
+	Do_ADBG_EndSubCase(c, "Unknown path");
+
+	TEEC_CloseSession(&session);
+}
+ADBG_CASE_DEFINE(regression, 1021, xtest_tee_test_1021,
+		"Test AES-256 ECB implementation paths of the crypt TA");
+
+static TEEC_Result sha_invoke(TEEC_Session *session, uint32_t cmd,
+			      const void *in, size_t in_size, void *out,
+			      size_t out_size)
+{
+	TEEC_Operation op = TEEC_OPERATION_INITIALIZER;
+	uint32_t ret_orig;
+
+	op.params[0].tmpref.buffer = (void *)in;
+	op.params[0].tmpref.size = in_size;
+	op.params[1].tmpref.buffer = out;
+	op.params[1].tmpref.size = out_size;
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_TEMP_INPUT,
+					 TEEC_MEMREF_TEMP_OUTPUT,
+					 TEEC_NONE, TEEC_NONE);
+
+	return TEEC_InvokeCommand(session, cmd, &op, &ret_orig);
+}
+
+static void xtest_tee_test_1022(ADBG_Case_t *c)
+{
+	static const uint8_t abc[] = { 'a', 'b', 'c' };
+	/* FIPS 180-2 two-block message for SHA-384 and SHA-512 */
+	static const char msg112[] =
+		"abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmn"
+		"hijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu";
+	static const uint8_t sha384_abc[] = {
+		0xcb, 0x00, 0x75, 0x3f, 0x45, 0xa3, 0x5e, 0x8b,
+		0xb5, 0xa0, 0x3d, 0x69, 0x9a, 0xc6, 0x50, 0x07,
+		0x27, 0x2c, 0x32, 0xab, 0x0e, 0xde, 0xd1, 0x63,
+		0x1a, 0x8b, 0x60, 0x5a, 0x43, 0xff, 0x5b, 0xed,
+		0x80, 0x86, 0x07, 0x2b, 0xa1, 0xe7, 0xcc, 0x23,
+		0x58, 0xba, 0xec, 0xa1, 0x34, 0xc8, 0x25, 0xa7,
+	};
+	static const uint8_t sha512_abc[] = {
+		0xdd, 0xaf, 0x35, 0xa1, 0x93, 0x61, 0x7a, 0xba,
+		0xcc, 0x41, 0x73, 0x49, 0xae, 0x20, 0x41, 0x31,
+		0x12, 0xe6, 0xfa, 0x4e, 0x89, 0xa9, 0x7e, 0xa2,
+		0x0a, 0x9e, 0xee, 0xe6, 0x4b, 0x55, 0xd3, 0x9a,
+		0x21, 0x92, 0x99, 0x2a, 0x27, 0x4f, 0xc1, 0xa8,
+		0x36, 0xba, 0x3c, 0x23, 0xa3, 0xfe, 0xeb, 0xbd,
+		0x45, 0x4d, 0x44, 0x23, 0x64, 0x3c, 0xe8, 0x0e,
+		0x2a, 0x9a, 0xc9, 0x4f, 0xa5, 0x4c, 0xa4, 0x9f,
+	};
+	static const uint8_t sha384_msg112[] = {
+		0x09, 0x33, 0x0c, 0x33, 0xf7, 0x11, 0x47, 0xe8,
+		0x3d, 0x19, 0x2f, 0xc7, 0x82, 0xcd, 0x1b, 0x47,
+		0x53, 0x11, 0x1b, 0x17, 0x3b, 0x3b, 0x05, 0xd2,
+		0x2f, 0xa0, 0x80, 0x86, 0xe3, 0xb0, 0xf7, 0x12,
+		0xfc, 0xc7, 0xc7, 0x1a, 0x55, 0x7e, 0x2d, 0xb9,
+		0x66, 0xc3, 0xe9, 0xfa, 0x91, 0x74, 0x60, 0x39,
+	};
+	static const uint8_t sha512_msg112[] = {
+		0x8e, 0x95, 0x9b, 0x75, 0xda, 0xe3, 0x13, 0xda,
+		0x8c, 0xf4, 0xf7, 0x28, 0x14, 0xfc, 0x14, 0x3f,
+		0x8f, 0x77, 0x79, 0xc6, 0xeb, 0x9f, 0x7f, 0xa1,
+		0x72, 0x99, 0xae, 0xad, 0xb6, 0x88, 0x90, 0x18,
+		0x50, 0x1d, 0x28, 0x9e, 0x49, 0x00, 0xf7, 0xe4,
+		0x33, 0x1b, 0x99, 0xde, 0xc4, 0xb5, 0x43, 0x3a,
+		0xc7, 0xd3, 0x29, 0xee, 0xb6, 0xdd, 0x26, 0x54,
+		0x5e, 0x96, 0xe5, 0x5b, 0x87, 0x4b, 0xe9, 0x09,
+	};
+	/* Around the padding and block boundaries */
+	static const size_t lens[] = {
+		0, 1, 55, 56, 63, 64, 65, 119, 1000, 4097
+	};
+	TEEC_Operation op = TEEC_OPERATION_INITIALIZER;
+	TEEC_Session session = { 0 };
+	uint8_t in[4097] = { };
+	uint8_t ref[32] = { };
+	uint8_t out[64] = { };
+	uint32_t ret_orig = 0;
+	size_t n = 0;
+
+	for (n = 0; n < sizeof(in); n++)
+		in[n] = n * 31 + 7;
+
+	if (!ADBG_EXPECT_TEEC_SUCCESS(c, xtest_teec_open_session(
+					      &session, &crypt_user_ta_uuid,
+					      NULL, &ret_orig)))
+		return;
+
+	Do_ADBG_BeginSubCase(c, "SHA-384 and SHA-512 known answers");
+	if (ADBG_EXPECT_TEEC_SUCCESS(c,
+		sha_invoke(&session, TA_CRYPT_CMD_SHA384, abc, sizeof(abc),
+			   out, sizeof(sha384_abc))))
+		ADBG_EXPECT_BUFFER(c, sha384_abc, sizeof(sha384_abc), out,
+				   sizeof(sha384_abc));
+	if (ADBG_EXPECT_TEEC_SUCCESS(c,
+		sha_invoke(&session, TA_CRYPT_CMD_SHA384, msg112,
+			   sizeof(msg112) - 1, out, sizeof(sha384_msg112))))
+		ADBG_EXPECT_BUFFER(c, sha384_msg112, sizeof(sha384_msg112),
+				   out, sizeof(sha384_msg112));
+	if (ADBG_EXPECT_TEEC_SUCCESS(c,
+		sha_invoke(&session, TA_CRYPT_CMD_SHA512, abc, sizeof(abc),
+			   out, sizeof(sha512_abc))))
+		ADBG_EXPECT_BUFFER(c, sha512_abc, sizeof(sha512_abc), out,
+				   sizeof(sha512_abc));
+	if (ADBG_EXPECT_TEEC_SUCCESS(c,
+		sha_invoke(&session, TA_CRYPT_CMD_SHA512, msg112,
+			   sizeof(msg112) - 1, out, sizeof(sha512_msg112))))
+		ADBG_EXPECT_BUFFER(c, sha512_msg112, sizeof(sha512_msg112),
+				   out, sizeof(sha512_msg112));
+	ADBG_EXPECT_TEEC_RESULT(c, TEEC_ERROR_BAD_PARAMETERS,
+		sha_invoke(&session, TA_CRYPT_CMD_SHA512, abc, sizeof(abc),
+			   out, sizeof(sha384_abc)));
+	Do_ADBG_EndSubCase(c, "SHA-384 and SHA-512 known answers");
+
+	Do_ADBG_BeginSubCase(c, "Optimised SHA-256 matches the reference");
+	op.params[0].tmpref.buffer = in;
+	op.params[0].tmpref.size = 3;
+	op.params[1].tmpref.buffer = out;
+	op.params[1].tmpref.size = sizeof(out);
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_TEMP_INPUT,
+					 TEEC_MEMREF_TEMP_OUTPUT,
+					 TEEC_VALUE_OUTPUT, TEEC_NONE);
+	if (ADBG_EXPECT_TEEC_SUCCESS(c,
+		TEEC_InvokeCommand(&session, TA_CRYPT_CMD_SHA256_FAST, &op,
+				   &ret_orig))) {
+		Do_ADBG_Log("SHA-256 implementation: %s",
+			    op.params[2].value.a == TA_CRYPT_SHA256_IMPL_CE ?
+			    "ARMv8 Crypto Extension" : "16-word window");
+		ADBG_EXPECT_COMPARE_UNSIGNED(c, op.params[2].value.a, <=,
+					     TA_CRYPT_SHA256_IMPL_CE);
+	}
+
+	for (n = 0; n < ARRAY_SIZE(lens); n++) {
+		if (!ADBG_EXPECT_TEEC_SUCCESS(c,
+			sha_invoke(&session, TA_CRYPT_CMD_SHA256, in, lens[n],
+				   ref, sizeof(ref))))
+			break;
+		if (!ADBG_EXPECT_TEEC_SUCCESS(c,
+			sha_invoke(&session, TA_CRYPT_CMD_SHA256_FAST, in,
+				   lens[n], out, sizeof(ref))))
+			break;
+		if (!ADBG_EXPECT_BUFFER(c, ref, sizeof(ref), out, sizeof(ref)))
+			Do_ADBG_Log("%zu bytes", lens[n]);
+	}
+	Do_ADBG_EndSubCase(c, "Optimised SHA-256 matches the reference");
+
+	TEEC_CloseSession(&session);
+}
+ADBG_CASE_DEFINE(regression, 1022, xtest_tee_test_1022,
+		"Test software SHA-256, SHA-384 and SHA-512 of the crypt TA");
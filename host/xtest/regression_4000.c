@@ -154,53 +154,6 @@ int ck_ec_params_attr_from_tee_algo(CK_ATTRIBUTE *attrs, size_t count,
 }
 #endif /*CFG_SECURE_KEY_SERVICES*/
 
-static TEEC_Result ta_crypt_cmd_reset_operation(ADBG_Case_t *c, TEEC_Session *s,
-						TEE_OperationHandle oph)
-{
-	TEEC_Result res;
-	TEEC_Operation op = TEEC_OPERATION_INITIALIZER;
-	uint32_t ret_orig;
-
-	assert((uintptr_t)oph <= UINT32_MAX);
-	op.params[0].value.a = (uint32_t)(uintptr_t)oph;
-	op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT, TEEC_NONE, TEEC_NONE,
-					 TEEC_NONE);
-	res = TEEC_InvokeCommand(s, TA_CRYPT_CMD_RESET_OPERATION, &op,
-				 &ret_orig);
-	if (res != TEEC_SUCCESS) {
-		(void)ADBG_EXPECT_TEEC_ERROR_ORIGIN(c, TEEC_ORIGIN_TRUSTED_APP,
-						    ret_orig);
-	}
-	return res;
-}
-
-static TEEC_Result ta_crypt_cmd_copy_operation(ADBG_Case_t *c,
-					       TEEC_Session *s,
-					       TEE_OperationHandle dst_oph,
-					       TEE_OperationHandle src_oph)
-{
-	TEEC_Result res;
-	TEEC_Operation op = TEEC_OPERATION_INITIALIZER;
-	uint32_t ret_orig;
-
-	assert((uintptr_t)dst_oph <= UINT32_MAX);
-	op.params[0].value.a = (uint32_t)(uintptr_t)dst_oph;
-
-	assert((uintptr_t)src_oph <= UINT32_MAX);
-	op.params[0].value.b = (uint32_t)(uintptr_t)src_oph;
-	op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT, TEEC_NONE, TEEC_NONE,
-					 TEEC_NONE);
-
-	res = TEEC_InvokeCommand(s, TA_CRYPT_CMD_COPY_OPERATION, &op,
-				 &ret_orig);
-
-	if (res != TEEC_SUCCESS) {
-		(void)ADBG_EXPECT_TEEC_ERROR_ORIGIN(c, TEEC_ORIGIN_TRUSTED_APP,
-						    ret_orig);
-	}
-	return res;
-}
-
 static TEEC_Result ta_crypt_cmd_digest_update(ADBG_Case_t *c, TEEC_Session *s,
 					      TEE_OperationHandle oph,
 					      const void *chunk,
@@ -266,137 +219,6 @@ static TEEC_Result ta_crypt_cmd_digest_do_final(ADBG_Case_t *c, TEEC_Session *s,
 	return res;
 }
 
-static TEE_Result ta_crypt_cmd_set_operation_key2(ADBG_Case_t *c,
-						  TEEC_Session *s,
-						  TEE_OperationHandle oph,
-						  TEE_ObjectHandle key1,
-						  TEE_ObjectHandle key2)
-{
-	TEEC_Result res;
-	TEEC_Operation op = TEEC_OPERATION_INITIALIZER;
-	uint32_t ret_orig;
-
-	assert((uintptr_t)oph <= UINT32_MAX);
-	op.params[0].value.a = (uint32_t)(uintptr_t)oph;
-
-	assert((uintptr_t)key1 <= UINT32_MAX);
-	op.params[0].value.b = (uint32_t)(uintptr_t)key1;
-
-	assert((uintptr_t)key2 <= UINT32_MAX);
-	op.params[1].value.a = (uint32_t)(uintptr_t)key2;
-	op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT, TEEC_VALUE_INPUT,
-					 TEEC_NONE, TEEC_NONE);
-
-	res = TEEC_InvokeCommand(s, TA_CRYPT_CMD_SET_OPERATION_KEY2, &op,
-				 &ret_orig);
-
-	if (res != TEEC_SUCCESS) {
-		(void)ADBG_EXPECT_TEEC_ERROR_ORIGIN(c, TEEC_ORIGIN_TRUSTED_APP,
-			    ret_orig);
-	}
-
-	return res;
-}
-
-static TEEC_Result ta_crypt_cmd_mac_init(ADBG_Case_t *c, TEEC_Session *s,
-					 TEE_OperationHandle oph,
-					 const void *iv, size_t iv_len)
-{
-	TEEC_Result res;
-	TEEC_Operation op = TEEC_OPERATION_INITIALIZER;
-	uint32_t ret_orig;
-
-	assert((uintptr_t)oph <= UINT32_MAX);
-	op.params[0].value.a = (uint32_t)(uintptr_t)oph;
-
-	if (iv != NULL) {
-		op.params[1].tmpref.buffer = (void *)iv;
-		op.params[1].tmpref.size = iv_len;
-		op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT,
-						 TEEC_MEMREF_TEMP_INPUT,
-						 TEEC_NONE, TEEC_NONE);
-	} else {
-		op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT, TEEC_NONE,
-						 TEEC_NONE, TEEC_NONE);
-	}
-
-	res = TEEC_InvokeCommand(s, TA_CRYPT_CMD_MAC_INIT, &op, &ret_orig);
-
-	if (res != TEEC_SUCCESS) {
-		(void)ADBG_EXPECT_TEEC_ERROR_ORIGIN(c, TEEC_ORIGIN_TRUSTED_APP,
-						    ret_orig);
-	}
-
-	return res;
-}
-
-static TEEC_Result ta_crypt_cmd_mac_update(ADBG_Case_t *c, TEEC_Session *s,
-					   TEE_OperationHandle oph,
-					   const void *chunk, size_t chunk_size)
-{
-	TEEC_Result res;
-	TEEC_Operation op = TEEC_OPERATION_INITIALIZER;
-	uint32_t ret_orig;
-
-	assert((uintptr_t)oph <= UINT32_MAX);
-	op.params[0].value.a = (uint32_t)(uintptr_t)oph;
-
-	op.params[1].tmpref.buffer = (void *)chunk;
-	op.params[1].tmpref.size = chunk_size;
-
-	op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT,
-					 TEEC_MEMREF_TEMP_INPUT, TEEC_NONE,
-					 TEEC_NONE);
-
-	res = TEEC_InvokeCommand(s, TA_CRYPT_CMD_MAC_UPDATE, &op, &ret_orig);
-
-	if (res != TEEC_SUCCESS) {
-		(void)ADBG_EXPECT_TEEC_ERROR_ORIGIN(c, TEEC_ORIGIN_TRUSTED_APP,
-						    ret_orig);
-	}
-
-	return res;
-}
-
-static TEEC_Result ta_crypt_cmd_mac_final_compute(ADBG_Case_t *c,
-						  TEEC_Session *s,
-						  TEE_OperationHandle oph,
-						  const void *chunk,
-						  size_t chunk_len,
-						  void *hash,
-						  size_t *hash_len)
-{
-	TEEC_Result res;
-	TEEC_Operation op = TEEC_OPERATION_INITIALIZER;
-	uint32_t ret_orig;
-
-	assert((uintptr_t)oph <= UINT32_MAX);
-	op.params[0].value.a = (uint32_t)(uintptr_t)oph;
-
-	op.params[1].tmpref.buffer = (void *)chunk;
-	op.params[1].tmpref.size = chunk_len;
-
-	op.params[2].tmpref.buffer = (void *)hash;
-	op.params[2].tmpref.size = *hash_len;
-
-	op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT,
-					 TEEC_MEMREF_TEMP_INPUT,
-					 TEEC_MEMREF_TEMP_OUTPUT, TEEC_NONE);
-
-	res = TEEC_InvokeCommand(s, TA_CRYPT_CMD_MAC_FINAL_COMPUTE, &op,
-				 &ret_orig);
-
-	if (res != TEEC_SUCCESS) {
-		(void)ADBG_EXPECT_TEEC_ERROR_ORIGIN(c, TEEC_ORIGIN_TRUSTED_APP,
-						    ret_orig);
-	}
-
-	if (res == TEEC_SUCCESS)
-		*hash_len = op.params[2].tmpref.size;
-
-	return res;
-}
-
 static TEEC_Result ta_crypt_cmd_cipher_init(ADBG_Case_t *c, TEEC_Session *s,
 					    TEE_OperationHandle oph,
 					    const void *iv, size_t iv_len)
@@ -430,41 +252,6 @@ static TEEC_Result ta_crypt_cmd_cipher_init(ADBG_Case_t *c, TEEC_Session *s,
 	return res;
 }
 
-static TEEC_Result ta_crypt_cmd_cipher_update(ADBG_Case_t *c, TEEC_Session *s,
-					      TEE_OperationHandle oph,
-					      const void *src, size_t src_len,
-					      void *dst, size_t *dst_len)
-{
-	TEEC_Result res;
-	TEEC_Operation op = TEEC_OPERATION_INITIALIZER;
-	uint32_t ret_orig;
-
-	assert((uintptr_t)oph <= UINT32_MAX);
-	op.params[0].value.a = (uint32_t)(uintptr_t)oph;
-
-	op.params[1].tmpref.buffer = (void *)src;
-	op.params[1].tmpref.size = src_len;
-
-	op.params[2].tmpref.buffer = dst;
-	op.params[2].tmpref.size = *dst_len;
-
-	op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT,
-					 TEEC_MEMREF_TEMP_INPUT,
-					 TEEC_MEMREF_TEMP_OUTPUT, TEEC_NONE);
-
-	res = TEEC_InvokeCommand(s, TA_CRYPT_CMD_CIPHER_UPDATE, &op, &ret_orig);
-
-	if (res != TEEC_SUCCESS) {
-		(void)ADBG_EXPECT_TEEC_ERROR_ORIGIN(c, TEEC_ORIGIN_TRUSTED_APP,
-						    ret_orig);
-	}
-
-	if (res == TEEC_SUCCESS)
-		*dst_len = op.params[2].tmpref.size;
-
-	return res;
-}
-
 static TEEC_Result ta_crypt_cmd_cipher_do_final(ADBG_Case_t *c,
 						TEEC_Session *s,
 						TEE_OperationHandle oph,
@@ -938,6 +725,354 @@ static TEEC_Result ta_crypt_cmd_generate_key(ADBG_Case_t *c,
 	return res;
 }
 
+/*
+ * Client side of TA_CRYPT_CMD_BATCH. Steps and the data of their memrefs
+ * are collected by the batch_*() helpers below, which follow the
+ * ta_crypt_cmd_*() ones but take handles as TA_CRYPT_BATCH_REF() to the
+ * step which returned them. batch_run() serialises the batch, invokes
+ * the TA once and copies the results back.
+ */
+struct crypt_batch {
+	struct ta_crypt_batch_step *steps;
+	size_t num_steps;
+	uint8_t *data;
+	size_t data_len;
+	size_t num_done;
+	bool oom;
+};
+
+#define BATCH_DATA_ALIGN	8
+
+static bool batch_is_memref(uint32_t param_types, size_t param)
+{
+	switch (TEEC_PARAM_TYPE_GET(param_types, param)) {
+	case TEEC_MEMREF_TEMP_INPUT:
+	case TEEC_MEMREF_TEMP_OUTPUT:
+	case TEEC_MEMREF_TEMP_INOUT:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static void batch_free(struct crypt_batch *b)
+{
+	free(b->steps);
+	free(b->data);
+	memset(b, 0, sizeof(*b));
+}
+
+static size_t batch_add(struct crypt_batch *b, uint32_t cmd,
+			uint32_t param_types)
+{
+	struct ta_crypt_batch_step *st = NULL;
+
+	st = realloc(b->steps, (b->num_steps + 1) * sizeof(*st));
+	if (!st) {
+		b->oom = true;
+		return 0;
+	}
+	b->steps = st;
+	st += b->num_steps;
+	memset(st, 0, sizeof(*st));
+	st->cmd = cmd;
+	st->param_types = param_types;
+	return b->num_steps++;
+}
+
+static void batch_value(struct crypt_batch *b, size_t step, size_t param,
+			uint32_t a, uint32_t bv)
+{
+	if (b->oom)
+		return;
+	b->steps[step].p[param][0] = a;
+	b->steps[step].p[param][1] = bv;
+}
+
+static void batch_ref(struct crypt_batch *b, size_t step, size_t param,
+		      size_t field, uint32_t ref)
+{
+	if (b->oom)
+		return;
+	b->steps[step].p[param][field] = ref;
+	b->steps[step].refs |= TA_CRYPT_BATCH_REF_BIT(param, field);
+}
+
+/* Adds @len bytes of memref data, copied from @buf unless it is NULL */
+static void batch_memref(struct crypt_batch *b, size_t step, size_t param,
+			 const void *buf, size_t len)
+{
+	size_t offs = ROUNDUP(b->data_len, BATCH_DATA_ALIGN);
+	uint8_t *data = NULL;
+
+	if (b->oom)
+		return;
+	if (offs + len > b->data_len) {
+		data = realloc(b->data, offs + len);
+		if (!data) {
+			b->oom = true;
+			return;
+		}
+		memset(data + b->data_len, 0, offs + len - b->data_len);
+		b->data = data;
+		b->data_len = offs + len;
+	}
+	if (buf && len)
+		memcpy(b->data + offs, buf, len);
+	b->steps[step].p[param][0] = offs;
+	b->steps[step].p[param][1] = len;
+}
+
+/* Output of a memref after a successful batch_run() */
+static void *batch_out(struct crypt_batch *b, size_t step, size_t param,
+		       size_t *len)
+{
+	*len = b->steps[step].p[param][1];
+	return b->data + b->steps[step].p[param][0];
+}
+
+static TEEC_Result batch_run(ADBG_Case_t *c, TEEC_Session *s,
+			     struct crypt_batch *b)
+{
+	TEEC_Operation op = TEEC_OPERATION_INITIALIZER;
+	struct ta_crypt_batch_hdr *hdr = NULL;
+	struct ta_crypt_batch_step *steps = NULL;
+	size_t steps_len = b->num_steps * sizeof(*steps);
+	size_t data_offs = sizeof(*hdr) + steps_len;
+	TEEC_Result res = TEEC_SUCCESS;
+	uint32_t ret_orig = 0;
+	uint8_t *buf = NULL;
+	size_t n = 0;
+	size_t m = 0;
+
+	if (b->oom)
+		return TEEC_ERROR_OUT_OF_MEMORY;
+	buf = calloc(1, data_offs + b->data_len);
+	if (!buf)
+		return TEEC_ERROR_OUT_OF_MEMORY;
+
+	hdr = (struct ta_crypt_batch_hdr *)(void *)buf;
+	steps = (struct ta_crypt_batch_step *)(void *)(hdr + 1);
+	hdr->num_steps = b->num_steps;
+	memcpy(steps, b->steps, steps_len);
+	if (b->data_len)
+		memcpy(buf + data_offs, b->data, b->data_len);
+	/* Memref offsets are relative to the whole buffer in the TA */
+	for (n = 0; n < b->num_steps; n++) {
+		steps[n].res = TEEC_ERROR_GENERIC;
+		for (m = 0; m < 4; m++)
+			if (batch_is_memref(steps[n].param_types, m))
+				steps[n].p[m][0] += data_offs;
+	}
+
+	op.params[0].tmpref.buffer = buf;
+	op.params[0].tmpref.size = data_offs + b->data_len;
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_TEMP_INOUT, TEEC_NONE,
+					 TEEC_NONE, TEEC_NONE);
+
+	res = TEEC_InvokeCommand(s, TA_CRYPT_CMD_BATCH, &op, &ret_orig);
+	if (res != TEEC_SUCCESS) {
+		(void)ADBG_EXPECT_TEEC_ERROR_ORIGIN(c, TEEC_ORIGIN_TRUSTED_APP,
+						    ret_orig);
+		goto out;
+	}
+
+	b->num_done = hdr->num_done;
+	for (n = 0; n < b->num_steps; n++)
+		for (m = 0; m < 4; m++)
+			if (batch_is_memref(steps[n].param_types, m))
+				steps[n].p[m][0] -= data_offs;
+	memcpy(b->steps, steps, steps_len);
+	if (b->data_len)
+		memcpy(b->data, buf + data_offs, b->data_len);
+out:
+	free(buf);
+	return res;
+}
+
+static bool batch_step_freed(struct crypt_batch *b, size_t step,
+			     uint32_t free_cmd, uint32_t h)
+{
+	size_t n = 0;
+
+	for (n = step + 1; n < b->num_done; n++)
+		if (b->steps[n].cmd == free_cmd &&
+		    b->steps[n].res == TEEC_SUCCESS &&
+		    b->steps[n].p[0][0] == h)
+			return true;
+	return false;
+}
+
+/*
+ * Frees the operations and objects allocated by the steps which were run
+ * and not freed by a later step, as left by a batch which stopped early.
+ */
+static void batch_free_handles(ADBG_Case_t *c, TEEC_Session *s,
+			       struct crypt_batch *b)
+{
+	struct ta_crypt_batch_step *st = NULL;
+	size_t n = 0;
+
+	for (n = 0; n < b->num_done; n++) {
+		st = b->steps + n;
+		if (st->res != TEEC_SUCCESS)
+			continue;
+		if (st->cmd == TA_CRYPT_CMD_ALLOCATE_OPERATION &&
+		    !batch_step_freed(b, n, TA_CRYPT_CMD_FREE_OPERATION,
+				      st->p[0][0]))
+			(void)ta_crypt_cmd_free_operation(c, s,
+				(TEE_OperationHandle)(uintptr_t)st->p[0][0]);
+		if (st->cmd == TA_CRYPT_CMD_ALLOCATE_TRANSIENT_OBJECT &&
+		    !batch_step_freed(b, n, TA_CRYPT_CMD_FREE_TRANSIENT_OBJECT,
+				      st->p[1][0]))
+			(void)ta_crypt_cmd_free_transient_object(c, s,
+				(TEE_ObjectHandle)(uintptr_t)st->p[1][0]);
+	}
+}
+
+/*
+ * Runs the batch and checks that every step succeeded. If one failed,
+ * what the earlier steps allocated is freed.
+ */
+static bool batch_run_check(ADBG_Case_t *c, TEEC_Session *s,
+			    struct crypt_batch *b)
+{
+	size_t n = 0;
+
+	if (!ADBG_EXPECT_TEEC_SUCCESS(c, batch_run(c, s, b)))
+		return false;
+
+	for (n = 0; n < b->num_done; n++) {
+		if (!ADBG_EXPECT_TEEC_SUCCESS(c, b->steps[n].res)) {
+			Do_ADBG_Log("Batch step %zu, command %" PRIu32,
+				    n, b->steps[n].cmd);
+			batch_free_handles(c, s, b);
+			return false;
+		}
+	}
+	return ADBG_EXPECT_COMPARE_UNSIGNED(c, b->num_done, ==, b->num_steps);
+}
+
+/* The step returns the operation as TA_CRYPT_BATCH_REF(step, 0, 0) */
+static size_t batch_allocate_operation(struct crypt_batch *b, uint32_t algo,
+				       uint32_t mode, uint32_t max_key_size)
+{
+	size_t st = batch_add(b, TA_CRYPT_CMD_ALLOCATE_OPERATION,
+			      TEEC_PARAM_TYPES(TEEC_VALUE_INOUT,
+					       TEEC_VALUE_INPUT, TEEC_NONE,
+					       TEEC_NONE));
+
+	batch_value(b, st, 0, 0, algo);
+	batch_value(b, st, 1, mode, max_key_size);
+	return st;
+}
+
+/* The step returns the object as TA_CRYPT_BATCH_REF(step, 1, 0) */
+static size_t batch_allocate_transient_object(struct crypt_batch *b,
+					      TEE_ObjectType obj_type,
+					      uint32_t max_obj_size)
+{
+	size_t st = batch_add(b, TA_CRYPT_CMD_ALLOCATE_TRANSIENT_OBJECT,
+			      TEEC_PARAM_TYPES(TEEC_VALUE_INPUT,
+					       TEEC_VALUE_OUTPUT, TEEC_NONE,
+					       TEEC_NONE));
+
+	batch_value(b, st, 0, obj_type, max_obj_size);
+	return st;
+}
+
+static void batch_populate_transient_object(struct crypt_batch *b,
+					    uint32_t obj,
+					    const TEE_Attribute *attrs,
+					    uint32_t attr_count)
+{
+	size_t st = batch_add(b, TA_CRYPT_CMD_POPULATE_TRANSIENT_OBJECT,
+			      TEEC_PARAM_TYPES(TEEC_VALUE_INPUT,
+					       TEEC_MEMREF_TEMP_INPUT,
+					       TEEC_NONE, TEEC_NONE));
+	uint8_t *buf = NULL;
+	size_t blen = 0;
+
+	if (pack_attrs(attrs, attr_count, &buf, &blen)) {
+		b->oom = true;
+		return;
+	}
+	batch_ref(b, st, 0, 0, obj);
+	batch_memref(b, st, 1, buf, blen);
+	free(buf);
+}
+
+/*
+ * Commands taking handles in params[0].value: FREE_OPERATION,
+ * RESET_OPERATION and FREE_TRANSIENT_OBJECT with @h1 only,
+ * COPY_OPERATION and SET_OPERATION_KEY with @h1 and @h2.
+ */
+static void batch_handles(struct crypt_batch *b, uint32_t cmd, uint32_t h1,
+			  uint32_t h2, bool has_h2)
+{
+	size_t st = batch_add(b, cmd, TEEC_PARAM_TYPES(TEEC_VALUE_INPUT,
+						       TEEC_NONE, TEEC_NONE,
+						       TEEC_NONE));
+
+	batch_ref(b, st, 0, 0, h1);
+	if (has_h2)
+		batch_ref(b, st, 0, 1, h2);
+}
+
+static void batch_set_operation_key2(struct crypt_batch *b, uint32_t oph,
+				     uint32_t key1, uint32_t key2)
+{
+	size_t st = batch_add(b, TA_CRYPT_CMD_SET_OPERATION_KEY2,
+			      TEEC_PARAM_TYPES(TEEC_VALUE_INPUT,
+					       TEEC_VALUE_INPUT, TEEC_NONE,
+					       TEEC_NONE));
+
+	batch_ref(b, st, 0, 0, oph);
+	batch_ref(b, st, 0, 1, key1);
+	batch_ref(b, st, 1, 0, key2);
+}
+
+/*
+ * Commands taking an operation and an input buffer: DIGEST_UPDATE,
+ * MAC_UPDATE, and MAC_INIT or CIPHER_INIT where @in may be NULL.
+ */
+static void batch_in(struct crypt_batch *b, uint32_t cmd, uint32_t oph,
+		     const void *in, size_t in_len)
+{
+	size_t st = 0;
+
+	if (!in && (cmd == TA_CRYPT_CMD_MAC_INIT ||
+		    cmd == TA_CRYPT_CMD_CIPHER_INIT)) {
+		batch_handles(b, cmd, oph, 0, false);
+		return;
+	}
+
+	st = batch_add(b, cmd, TEEC_PARAM_TYPES(TEEC_VALUE_INPUT,
+						TEEC_MEMREF_TEMP_INPUT,
+						TEEC_NONE, TEEC_NONE));
+	batch_ref(b, st, 0, 0, oph);
+	batch_memref(b, st, 1, in, in_len);
+}
+
+/*
+ * Commands taking an operation, an input and an output buffer:
+ * DIGEST_DO_FINAL, MAC_FINAL_COMPUTE, CIPHER_UPDATE and CIPHER_DO_FINAL.
+ * The output is batch_out(b, step, 2).
+ */
+static size_t batch_in_out(struct crypt_batch *b, uint32_t cmd, uint32_t oph,
+			   const void *in, size_t in_len, size_t out_len)
+{
+	size_t st = batch_add(b, cmd, TEEC_PARAM_TYPES(TEEC_VALUE_INPUT,
+						       TEEC_MEMREF_TEMP_INPUT,
+						       TEEC_MEMREF_TEMP_OUTPUT,
+						       TEEC_NONE));
+
+	batch_ref(b, st, 0, 0, oph);
+	batch_memref(b, st, 1, in, in_len);
+	batch_memref(b, st, 2, NULL, out_len);
+	return st;
+}
+
 static const uint8_t hash_data_md5_in1[] = {
 	'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j', 'k', 'l', 'm'
 };
@@ -1057,87 +1192,57 @@ static void xtest_tee_test_4001(ADBG_Case_t *c)
 
 
 	for (n = 0; n < ARRAY_SIZE(hash_cases); n++) {
-		TEE_OperationHandle op1;
-		TEE_OperationHandle op2;
-		uint8_t out[64];
+		struct crypt_batch b = { };
+		uint32_t op1;
+		uint32_t op2;
+		size_t final[3];
+		void *out;
 		size_t out_size;
+		size_t m;
 
 		Do_ADBG_BeginSubCase(c, "Hash case %d algo 0x%x",
 				     (int)n, (unsigned int)hash_cases[n].algo);
 
-		if (!ADBG_EXPECT_TEEC_SUCCESS(c,
-			ta_crypt_cmd_allocate_operation(c, &session, &op1,
-							hash_cases[n].algo,
-							TEE_MODE_DIGEST, 0)))
-			goto out;
-
-		if (!ADBG_EXPECT_TEEC_SUCCESS(c,
-			ta_crypt_cmd_allocate_operation(c, &session, &op2,
-							hash_cases[n].algo,
-							TEE_MODE_DIGEST, 0)))
-			goto out;
-
-		if (!ADBG_EXPECT_TEEC_SUCCESS(c,
-			ta_crypt_cmd_digest_update(c, &session, op1,
-						   hash_cases[n].in,
-						   hash_cases[n].in_incr)))
-			goto out;
-
-		if (!ADBG_EXPECT_TEEC_SUCCESS(c,
-			ta_crypt_cmd_copy_operation(c, &session, op2, op1)))
-			goto out;
-
-		out_size = sizeof(out);
-		memset(out, 0, sizeof(out));
-		if (!ADBG_EXPECT_TEEC_SUCCESS(c,
-			ta_crypt_cmd_digest_do_final(c, &session, op2,
+		/* The whole case runs in a single invoke of the TA */
+		op1 = TA_CRYPT_BATCH_REF(batch_allocate_operation(&b,
+						hash_cases[n].algo,
+						TEE_MODE_DIGEST, 0), 0, 0);
+		op2 = TA_CRYPT_BATCH_REF(batch_allocate_operation(&b,
+						hash_cases[n].algo,
+						TEE_MODE_DIGEST, 0), 0, 0);
+		batch_in(&b, TA_CRYPT_CMD_DIGEST_UPDATE, op1, hash_cases[n].in,
+			 hash_cases[n].in_incr);
+		batch_handles(&b, TA_CRYPT_CMD_COPY_OPERATION, op2, op1, true);
+		final[0] = batch_in_out(&b, TA_CRYPT_CMD_DIGEST_DO_FINAL, op2,
 				hash_cases[n].in + hash_cases[n].in_incr,
-				hash_cases[n].in_len - hash_cases[n].in_incr,
-				out, &out_size)))
-			goto out;
-
-		(void)ADBG_EXPECT_BUFFER(c, hash_cases[n].out,
-					 hash_cases[n].out_len, out, out_size);
-
-		if (!ADBG_EXPECT_TEEC_SUCCESS(c,
-			ta_crypt_cmd_reset_operation(c, &session, op1)))
-			goto out;
-
-		out_size = sizeof(out);
-		memset(out, 0, sizeof(out));
-		if (!ADBG_EXPECT_TEEC_SUCCESS(c,
-			ta_crypt_cmd_digest_do_final(c, &session, op1,
-						     hash_cases[n].in,
-						     hash_cases[n].in_len, out,
-						     &out_size)))
-			goto out;
-
-		(void)ADBG_EXPECT_BUFFER(c, hash_cases[n].out,
-					 hash_cases[n].out_len, out, out_size);
-
+				hash_cases[n].in_len - hash_cases[n].in_incr,
+				64);
+		batch_handles(&b, TA_CRYPT_CMD_RESET_OPERATION, op1, 0, false);
+		final[1] = batch_in_out(&b, TA_CRYPT_CMD_DIGEST_DO_FINAL, op1,
+					hash_cases[n].in, hash_cases[n].in_len,
+					64);
 		/*
 		 * Invoke TEE_DigestDoFinal() a second time to check that state
 		 * was properly reset
 		 */
-		out_size = sizeof(out);
-		memset(out, 0, sizeof(out));
-		if (!ADBG_EXPECT_TEEC_SUCCESS(c,
-			ta_crypt_cmd_digest_do_final(c, &session, op1,
-						     hash_cases[n].in,
-						     hash_cases[n].in_len, out,
-						     &out_size)))
-			goto out;
-
-		(void)ADBG_EXPECT_BUFFER(c, hash_cases[n].out,
-					 hash_cases[n].out_len, out, out_size);
-
-		if (!ADBG_EXPECT_TEEC_SUCCESS(c,
-			ta_crypt_cmd_free_operation(c, &session, op1)))
+		final[2] = batch_in_out(&b, TA_CRYPT_CMD_DIGEST_DO_FINAL, op1,
+					hash_cases[n].in, hash_cases[n].in_len,
+					64);
+		batch_handles(&b, TA_CRYPT_CMD_FREE_OPERATION, op1, 0, false);
+		batch_handles(&b, TA_CRYPT_CMD_FREE_OPERATION, op2, 0, false);
+
+		if (!batch_run_check(c, &session, &b)) {
+			batch_free(&b);
 			goto out;
+		}
 
-		if (!ADBG_EXPECT_TEEC_SUCCESS(c,
-			ta_crypt_cmd_free_operation(c, &session, op2)))
-			goto out;
+		for (m = 0; m < ARRAY_SIZE(final); m++) {
+			out = batch_out(&b, final[m], 2, &out_size);
+			(void)ADBG_EXPECT_BUFFER(c, hash_cases[n].out,
+						 hash_cases[n].out_len, out,
+						 out_size);
+		}
+		batch_free(&b);
 
 		Do_ADBG_EndSubCase(c, NULL);
 	}
@@ -1704,13 +1809,15 @@ static const struct xtest_mac_case mac_cases[] = {
 static void xtest_tee_test_4002(ADBG_Case_t *c)
 {
 	TEEC_Session session = { 0 };
-	TEE_OperationHandle op1;
-	TEE_OperationHandle op2;
-	TEE_ObjectHandle key_handle;
-	uint8_t out[64];
+	uint32_t op1;
+	uint32_t op2;
+	uint32_t key_handle;
+	size_t final[2];
+	void *out;
 	size_t out_size;
 	uint32_t ret_orig;
 	size_t n;
+	size_t m;
 
 	if (!ADBG_EXPECT_TEEC_SUCCESS(c,
 		xtest_teec_open_session(&session, &crypt_user_ta_uuid, NULL,
@@ -1718,6 +1825,7 @@ static void xtest_tee_test_4002(ADBG_Case_t *c)
 		return;
 
 	for (n = 0; n < ARRAY_SIZE(mac_cases); n++) {
+		struct crypt_batch b = { };
 		TEE_Attribute key_attr;
 		size_t key_size;
 		size_t offs;
@@ -1735,93 +1843,59 @@ static void xtest_tee_test_4002(ADBG_Case_t *c)
 			/* Exclude parity in bit size of key */
 			key_size -= key_size / 8;
 
-		if (!ADBG_EXPECT_TEEC_SUCCESS(c,
-			ta_crypt_cmd_allocate_operation(c, &session, &op1,
-				mac_cases[n].algo, TEE_MODE_MAC, key_size)))
-			goto out;
-
-		if (!ADBG_EXPECT_TEEC_SUCCESS(c,
-			ta_crypt_cmd_allocate_operation(c, &session, &op2,
-				mac_cases[n].algo, TEE_MODE_MAC, key_size)))
-			goto out;
-
-		if (!ADBG_EXPECT_TEEC_SUCCESS(c,
-			ta_crypt_cmd_allocate_transient_object(c, &session,
-				mac_cases[n].key_type, key_size, &key_handle)))
-			goto out;
-
-		if (!ADBG_EXPECT_TEEC_SUCCESS(c,
-			ta_crypt_cmd_populate_transient_object(c, &session,
-				key_handle, &key_attr, 1)))
-			goto out;
-
-		if (!ADBG_EXPECT_TEEC_SUCCESS(c,
-			ta_crypt_cmd_set_operation_key(c, &session, op1,
-				key_handle)))
-			goto out;
-
-		if (!ADBG_EXPECT_TEEC_SUCCESS(c,
-			ta_crypt_cmd_free_transient_object(c, &session,
-				key_handle)))
-			goto out;
-
-		if (!ADBG_EXPECT_TEEC_SUCCESS(c,
-			ta_crypt_cmd_mac_init(c, &session, op1, NULL, 0)))
-			goto out;
+		/* The whole case runs in a single invoke of the TA */
+		op1 = TA_CRYPT_BATCH_REF(batch_allocate_operation(&b,
+				mac_cases[n].algo, TEE_MODE_MAC, key_size),
+				0, 0);
+		op2 = TA_CRYPT_BATCH_REF(batch_allocate_operation(&b,
+				mac_cases[n].algo, TEE_MODE_MAC, key_size),
+				0, 0);
+		key_handle = TA_CRYPT_BATCH_REF(
+			batch_allocate_transient_object(&b,
+				mac_cases[n].key_type, key_size), 1, 0);
+		batch_populate_transient_object(&b, key_handle, &key_attr, 1);
+		batch_handles(&b, TA_CRYPT_CMD_SET_OPERATION_KEY, op1,
+			      key_handle, true);
+		batch_handles(&b, TA_CRYPT_CMD_FREE_TRANSIENT_OBJECT,
+			      key_handle, 0, false);
+		batch_in(&b, TA_CRYPT_CMD_MAC_INIT, op1, NULL, 0);
 
 		offs = 0;
 		if (mac_cases[n].in != NULL) {
 			while (offs + mac_cases[n].in_incr <
 					mac_cases[n].in_len) {
-				if (!ADBG_EXPECT_TEEC_SUCCESS(c,
-					ta_crypt_cmd_mac_update(c, &session,
-						op1, mac_cases[n].in + offs,
-						mac_cases[n].in_incr)))
-					goto out;
+				batch_in(&b, TA_CRYPT_CMD_MAC_UPDATE, op1,
+					 mac_cases[n].in + offs,
+					 mac_cases[n].in_incr);
 				offs += mac_cases[n].in_incr;
 				if (!mac_cases[n].multiple_incr)
 					break;
 			}
 		}
 
-		if (!ADBG_EXPECT_TEEC_SUCCESS(c,
-			ta_crypt_cmd_copy_operation(c, &session, op2, op1)))
-			goto out;
-
-		out_size = sizeof(out);
-		memset(out, 0, sizeof(out));
-		if (!ADBG_EXPECT_TEEC_SUCCESS(c,
-			ta_crypt_cmd_mac_final_compute(c, &session, op2,
-				mac_cases[n].in + offs,
-				mac_cases [n].in_len - offs,
-				out, &out_size)))
-			goto out;
-
-		(void)ADBG_EXPECT_BUFFER(c, mac_cases[n].out,
-					 mac_cases[n].out_len, out, out_size);
-
-		if (!ADBG_EXPECT_TEEC_SUCCESS(c,
-			ta_crypt_cmd_mac_init(c, &session, op1, NULL, 0)))
-			goto out;
-
-		out_size = sizeof(out);
-		memset(out, 0, sizeof(out));
-		if (!ADBG_EXPECT_TEEC_SUCCESS(c,
-			ta_crypt_cmd_mac_final_compute(c, &session, op1,
-				mac_cases[n].in, mac_cases[n].in_len, out,
-				&out_size)))
-			goto out;
-
-		(void)ADBG_EXPECT_BUFFER(c, mac_cases[n].out,
-					 mac_cases[n].out_len, out, out_size);
-
-		if (!ADBG_EXPECT_TEEC_SUCCESS(c,
-			ta_crypt_cmd_free_operation(c, &session, op1)))
+		batch_handles(&b, TA_CRYPT_CMD_COPY_OPERATION, op2, op1, true);
+		final[0] = batch_in_out(&b, TA_CRYPT_CMD_MAC_FINAL_COMPUTE, op2,
+					mac_cases[n].in + offs,
+					mac_cases[n].in_len - offs, 64);
+		batch_in(&b, TA_CRYPT_CMD_MAC_INIT, op1, NULL, 0);
+		final[1] = batch_in_out(&b, TA_CRYPT_CMD_MAC_FINAL_COMPUTE, op1,
+					mac_cases[n].in, mac_cases[n].in_len,
+					64);
+		batch_handles(&b, TA_CRYPT_CMD_FREE_OPERATION, op1, 0, false);
+		batch_handles(&b, TA_CRYPT_CMD_FREE_OPERATION, op2, 0, false);
+
+		if (!batch_run_check(c, &session, &b)) {
+			batch_free(&b);
 			goto out;
+		}
 
-		if (!ADBG_EXPECT_TEEC_SUCCESS(c,
-			ta_crypt_cmd_free_operation(c, &session, op2)))
-			goto out;
+		for (m = 0; m < ARRAY_SIZE(final); m++) {
+			out = batch_out(&b, final[m], 2, &out_size);
+			(void)ADBG_EXPECT_BUFFER(c, mac_cases[n].out,
+						 mac_cases[n].out_len, out,
+						 out_size);
+		}
+		batch_free(&b);
 
 		Do_ADBG_EndSubCase(c, NULL);
 	}
@@ -2796,11 +2870,14 @@ static const struct xtest_ciph_case ciph_cases[] = {
 static void xtest_tee_test_4003(ADBG_Case_t *c)
 {
 	TEEC_Session session = { 0 };
-	TEE_OperationHandle op;
-	TEE_ObjectHandle key1_handle = TEE_HANDLE_NULL;
-	TEE_ObjectHandle key2_handle = TEE_HANDLE_NULL;
+	uint32_t op;
+	uint32_t key1_handle;
+	uint32_t key2_handle;
 	uint8_t out[2048];
-	size_t out_size;
+	size_t update;
+	size_t final;
+	void *part;
+	size_t part_size;
 	size_t out_offs;
 	uint32_t ret_orig;
 	size_t n;
@@ -2811,6 +2888,7 @@ static void xtest_tee_test_4003(ADBG_Case_t *c)
 		return;
 
 	for (n = 0; n < ARRAY_SIZE(ciph_cases); n++) {
+		struct crypt_batch b = { };
 		TEE_Attribute key_attr;
 		size_t key_size;
 		size_t op_key_size;
@@ -2834,100 +2912,71 @@ static void xtest_tee_test_4003(ADBG_Case_t *c)
 		if (ciph_cases[n].key2 != NULL)
 			op_key_size *= 2;
 
-		if (!ADBG_EXPECT_TEEC_SUCCESS(c,
-			ta_crypt_cmd_allocate_operation(c, &session, &op,
+		/* The whole case runs in a single invoke of the TA */
+		op = TA_CRYPT_BATCH_REF(batch_allocate_operation(&b,
 				ciph_cases[n].algo, ciph_cases[n].mode,
-				op_key_size)))
-			goto out;
-
-		if (!ADBG_EXPECT_TEEC_SUCCESS(c,
-			ta_crypt_cmd_allocate_transient_object(c, &session,
-				ciph_cases[n].key_type, key_size,
-				&key1_handle)))
-			goto out;
-
-		if (!ADBG_EXPECT_TEEC_SUCCESS(c,
-			ta_crypt_cmd_populate_transient_object(c, &session,
-				key1_handle, &key_attr, 1)))
-			goto out;
+				op_key_size), 0, 0);
+		key1_handle = TA_CRYPT_BATCH_REF(
+			batch_allocate_transient_object(&b,
+				ciph_cases[n].key_type, key_size), 1, 0);
+		batch_populate_transient_object(&b, key1_handle, &key_attr, 1);
 
 		if (ciph_cases[n].key2 != NULL) {
 			key_attr.content.ref.buffer =
 				(void *)ciph_cases[n].key2;
 			key_attr.content.ref.length = ciph_cases[n].key2_len;
 
-			if (!ADBG_EXPECT_TEEC_SUCCESS(c,
-				ta_crypt_cmd_allocate_transient_object(c,
-					&session, ciph_cases[n].key_type,
-					key_attr.content.ref.length * 8,
-					&key2_handle)))
-				goto out;
-
-			if (!ADBG_EXPECT_TEEC_SUCCESS(c,
-				ta_crypt_cmd_populate_transient_object(c,
-					&session, key2_handle, &key_attr, 1)))
-				goto out;
-
-			if (!ADBG_EXPECT_TEEC_SUCCESS(c,
-				ta_crypt_cmd_set_operation_key2(c, &session, op,
-					key1_handle, key2_handle)))
-				goto out;
+			key2_handle = TA_CRYPT_BATCH_REF(
+				batch_allocate_transient_object(&b,
+					ciph_cases[n].key_type,
+					key_attr.content.ref.length * 8),
+				1, 0);
+			batch_populate_transient_object(&b, key2_handle,
+							&key_attr, 1);
+			batch_set_operation_key2(&b, op, key1_handle,
+						 key2_handle);
+			batch_handles(&b, TA_CRYPT_CMD_FREE_TRANSIENT_OBJECT,
+				      key2_handle, 0, false);
 		} else {
-			if (!ADBG_EXPECT_TEEC_SUCCESS(c,
-				ta_crypt_cmd_set_operation_key(c, &session, op,
-					key1_handle)))
-				goto out;
+			batch_handles(&b, TA_CRYPT_CMD_SET_OPERATION_KEY, op,
+				      key1_handle, true);
 		}
+		batch_handles(&b, TA_CRYPT_CMD_FREE_TRANSIENT_OBJECT,
+			      key1_handle, 0, false);
+
+		batch_in(&b, TA_CRYPT_CMD_CIPHER_INIT, op, ciph_cases[n].iv,
+			 ciph_cases[n].iv_len);
+		update = batch_in_out(&b, TA_CRYPT_CMD_CIPHER_UPDATE, op,
+				      ciph_cases[n].in, ciph_cases[n].in_incr,
+				      sizeof(out));
+		final = batch_in_out(&b, TA_CRYPT_CMD_CIPHER_DO_FINAL, op,
+				ciph_cases[n].in + ciph_cases[n].in_incr,
+				ciph_cases[n].in_len - ciph_cases[n].in_incr,
+				sizeof(out));
+		batch_handles(&b, TA_CRYPT_CMD_FREE_OPERATION, op, 0, false);
 
-		if (!ADBG_EXPECT_TEEC_SUCCESS(c,
-			ta_crypt_cmd_free_transient_object(c, &session,
-				key1_handle)))
-			goto out;
-		key1_handle = TEE_HANDLE_NULL;
-
-		if (!ADBG_EXPECT_TEEC_SUCCESS(c,
-			ta_crypt_cmd_free_transient_object(c, &session,
-				key2_handle)))
-			goto out;
-		key2_handle = TEE_HANDLE_NULL;
-
-		if (!ADBG_EXPECT_TEEC_SUCCESS(c,
-			ta_crypt_cmd_cipher_init(c, &session, op,
-				ciph_cases[n].iv, ciph_cases[n].iv_len)))
-			goto out;
-
-		out_offs = 0;
-		out_size = sizeof(out);
-		memset(out, 0, sizeof(out));
-		if (!ADBG_EXPECT_TEEC_SUCCESS(c,
-			ta_crypt_cmd_cipher_update(c, &session, op,
-				ciph_cases[n].in, ciph_cases[n].in_incr, out,
-				&out_size)))
+		if (!batch_run_check(c, &session, &b)) {
+			batch_free(&b);
 			goto out;
+		}
 
+		part = batch_out(&b, update, 2, &part_size);
 		if (ciph_cases[n].algo == TEE_ALG_AES_CTR)
-			ADBG_EXPECT_COMPARE_UNSIGNED(c, out_size, ==,
+			ADBG_EXPECT_COMPARE_UNSIGNED(c, part_size, ==,
 				ciph_cases[n].in_incr);
-
-		out_offs += out_size;
-		out_size = sizeof(out) - out_offs;
-
-		if (!ADBG_EXPECT_TEEC_SUCCESS(c,
-			ta_crypt_cmd_cipher_do_final(c, &session, op,
-				ciph_cases[n].in + ciph_cases[n].in_incr,
-				ciph_cases[n].in_len - ciph_cases[n].in_incr,
-				out + out_offs,
-				&out_size)))
-			goto out;
-
-		out_offs += out_size;
-
-		(void)ADBG_EXPECT_BUFFER(c, ciph_cases[n].out,
-					 ciph_cases[n].out_len, out, out_offs);
-
-		if (!ADBG_EXPECT_TEEC_SUCCESS(c,
-			ta_crypt_cmd_free_operation(c, &session, op)))
-			goto out;
+		memcpy(out, part, part_size);
+		out_offs = part_size;
+
+		part = batch_out(&b, final, 2, &part_size);
+		if (ADBG_EXPECT_COMPARE_UNSIGNED(c, part_size, <=,
+						 sizeof(out) - out_offs)) {
+			memcpy(out + out_offs, part, part_size);
+			out_offs += part_size;
+			(void)ADBG_EXPECT_BUFFER(c, ciph_cases[n].out,
+						 ciph_cases[n].out_len, out,
+						 out_offs);
+		}
+		batch_free(&b);
 
 		Do_ADBG_EndSubCase(c, NULL);
 	}
@@ -7317,3 +7366,235 @@ static void xtest_tee_test_4012(ADBG_Case_t *c)
 ADBG_CASE_DEFINE(regression, 4012, xtest_tee_test_4012,
 		"Test seeding RNG entropy");
 #endif /*CFG_SYSTEM_PTA*/
+
+static TEEC_Result ta_crypt_cmd_operation_pool(ADBG_Case_t *c, TEEC_Session *s,
+					       uint32_t mode)
+{
+	TEEC_Result res;
+	TEEC_Operation op = TEEC_OPERATION_INITIALIZER;
+	uint32_t ret_orig = 0;
+
+	op.params[0].value.a = mode;
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT, TEEC_NONE,
+					 TEEC_NONE, TEEC_NONE);
+
+	res = TEEC_InvokeCommand(s, TA_CRYPT_CMD_OPERATION_POOL, &op,
+				 &ret_orig);
+
+	if (res != TEEC_SUCCESS) {
+		(void)ADBG_EXPECT_TEEC_ERROR_ORIGIN(c, TEEC_ORIGIN_TRUSTED_APP,
+						    ret_orig);
+	}
+
+	return res;
+}
+
+static bool check_operation_pool(ADBG_Case_t *c, TEEC_Session *s,
+				 uint32_t hits, uint32_t misses,
+				 uint32_t count)
+{
+	TEEC_Operation op = TEEC_OPERATION_INITIALIZER;
+	uint32_t ret_orig = 0;
+
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_OUTPUT, TEEC_VALUE_OUTPUT,
+					 TEEC_NONE, TEEC_NONE);
+	if (!ADBG_EXPECT_TEEC_SUCCESS(c, TEEC_InvokeCommand(s,
+			TA_CRYPT_CMD_OPERATION_POOL_STATS, &op, &ret_orig)))
+		return false;
+
+	return ADBG_EXPECT_COMPARE_UNSIGNED(c, op.params[0].value.a, ==,
+					    hits) &&
+	       ADBG_EXPECT_COMPARE_UNSIGNED(c, op.params[0].value.b, ==,
+					    misses) &&
+	       ADBG_EXPECT_COMPARE_UNSIGNED(c, op.params[1].value.a, ==,
+					    count);
+}
+
+static TEEC_Result ta_crypt_cmd_get_operation_info(ADBG_Case_t *c,
+						   TEEC_Session *s,
+						   TEE_OperationHandle oph,
+						   TEE_OperationInfo *info)
+{
+	TEEC_Result res;
+	TEEC_Operation op = TEEC_OPERATION_INITIALIZER;
+	uint32_t ret_orig = 0;
+
+	op.params[0].value.a = (uint32_t)(uintptr_t)oph;
+	op.params[1].tmpref.buffer = info;
+	op.params[1].tmpref.size = sizeof(*info);
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT,
+					 TEEC_MEMREF_TEMP_OUTPUT, TEEC_NONE,
+					 TEEC_NONE);
+
+	res = TEEC_InvokeCommand(s, TA_CRYPT_CMD_GET_OPERATION_INFO, &op,
+				 &ret_orig);
+
+	if (res != TEEC_SUCCESS) {
+		(void)ADBG_EXPECT_TEEC_ERROR_ORIGIN(c, TEEC_ORIGIN_TRUSTED_APP,
+						    ret_orig);
+	}
+
+	return res;
+}
+
+/*
+ * AES-128 ECB on a pooled operation: the operation must come back without
+ * key nor state from the previous use.
+ */
+static bool pooled_aes_ecb(ADBG_Case_t *c, TEEC_Session *s, bool pooled)
+{
+	TEE_OperationHandle op = TEE_HANDLE_NULL;
+	TEE_ObjectHandle key = TEE_HANDLE_NULL;
+	TEE_OperationInfo info = { };
+	TEE_Attribute key_attr = { };
+	uint8_t out[sizeof(ciph_data_in1)] = { };
+	size_t out_size = sizeof(out);
+	bool ret = false;
+
+	if (!ADBG_EXPECT_TEEC_SUCCESS(c,
+		ta_crypt_cmd_allocate_operation(c, s, &op,
+			TEE_ALG_AES_ECB_NOPAD, TEE_MODE_ENCRYPT, 128)))
+		return false;
+
+	if (!ADBG_EXPECT_TEEC_SUCCESS(c,
+		ta_crypt_cmd_get_operation_info(c, s, op, &info)))
+		goto out;
+	if (pooled && !ADBG_EXPECT_COMPARE_UNSIGNED(c, info.handleState &
+			(TEE_HANDLE_FLAG_KEY_SET | TEE_HANDLE_FLAG_INITIALIZED),
+			==, 0))
+		goto out;
+
+	key_attr.attributeID = TEE_ATTR_SECRET_VALUE;
+	key_attr.content.ref.buffer = (void *)ciph_data_aes_key1;
+	key_attr.content.ref.length = sizeof(ciph_data_aes_key1);
+
+	if (!ADBG_EXPECT_TEEC_SUCCESS(c,
+		ta_crypt_cmd_allocate_transient_object(c, s, TEE_TYPE_AES, 128,
+						       &key)))
+		goto out;
+	if (!ADBG_EXPECT_TEEC_SUCCESS(c,
+		ta_crypt_cmd_populate_transient_object(c, s, key, &key_attr,
+						       1)))
+		goto out;
+	if (!ADBG_EXPECT_TEEC_SUCCESS(c,
+		ta_crypt_cmd_set_operation_key(c, s, op, key)))
+		goto out;
+	if (!ADBG_EXPECT_TEEC_SUCCESS(c,
+		ta_crypt_cmd_cipher_init(c, s, op, NULL, 0)))
+		goto out;
+	if (!ADBG_EXPECT_TEEC_SUCCESS(c,
+		ta_crypt_cmd_cipher_do_final(c, s, op, ciph_data_in1,
+					     sizeof(ciph_data_in1), out,
+					     &out_size)))
+		goto out;
+	ret = ADBG_EXPECT_BUFFER(c, ciph_data_aes_ecb_nopad_out1,
+				 sizeof(ciph_data_aes_ecb_nopad_out1), out,
+				 out_size);
+out:
+	if (key != TEE_HANDLE_NULL)
+		ADBG_EXPECT_TEEC_SUCCESS(c,
+			ta_crypt_cmd_free_transient_object(c, s, key));
+	/* Freed while initialized: the pool has to reset it */
+	ADBG_EXPECT_TEEC_SUCCESS(c, ta_crypt_cmd_free_operation(c, s, op));
+	return ret;
+}
+
+static void xtest_tee_test_4013(ADBG_Case_t *c)
+{
+	TEEC_Session session = { };
+	TEE_OperationHandle op = TEE_HANDLE_NULL;
+	TEE_OperationHandle prev = TEE_HANDLE_NULL;
+	uint8_t out[TEE_SHA256_HASH_SIZE] = { };
+	size_t out_size = 0;
+	uint32_t ret_orig = 0;
+	size_t n = 0;
+
+	if (!ADBG_EXPECT_TEEC_SUCCESS(c,
+		xtest_teec_open_session(&session, &crypt_user_ta_uuid, NULL,
+					&ret_orig)))
+		return;
+
+	if (!ADBG_EXPECT_TEEC_SUCCESS(c,
+		ta_crypt_cmd_operation_pool(c, &session,
+					    TA_CRYPT_OP_POOL_ENABLE)))
+		goto out;
+	if (!check_operation_pool(c, &session, 0, 0, 0))
+		goto out;
+
+	Do_ADBG_BeginSubCase(c, "Digest operations");
+	for (n = 0; n < 3; n++) {
+		if (!ADBG_EXPECT_TEEC_SUCCESS(c,
+			ta_crypt_cmd_allocate_operation(c, &session, &op,
+				TEE_ALG_SHA256, TEE_MODE_DIGEST, 0)))
+			goto out;
+		if (n && !ADBG_EXPECT_POINTER(c, prev, op))
+			goto out;
+		/* Leave a partial digest behind for the next round */
+		out_size = sizeof(out);
+		if (!ADBG_EXPECT_TEEC_SUCCESS(c,
+			ta_crypt_cmd_digest_do_final(c, &session, op,
+				hash_data_sha256_in1,
+				sizeof(hash_data_sha256_in1), out,
+				&out_size)) ||
+		    !ADBG_EXPECT_BUFFER(c, hash_data_sha256_out1,
+					sizeof(hash_data_sha256_out1), out,
+					out_size) ||
+		    !ADBG_EXPECT_TEEC_SUCCESS(c,
+			ta_crypt_cmd_digest_update(c, &session, op,
+				hash_data_sha256_in2,
+				sizeof(hash_data_sha256_in2))))
+			goto out;
+		if (!ADBG_EXPECT_TEEC_SUCCESS(c,
+			ta_crypt_cmd_free_operation(c, &session, op)))
+			goto out;
+		prev = op;
+	}
+	if (!check_operation_pool(c, &session, 2, 1, 1))
+		goto out;
+	Do_ADBG_EndSubCase(c, "Digest operations");
+
+	Do_ADBG_BeginSubCase(c, "Cipher operations");
+	if (!pooled_aes_ecb(c, &session, false) ||
+	    !pooled_aes_ecb(c, &session, true))
+		goto out;
+	if (!check_operation_pool(c, &session, 3, 2, 2))
+		goto out;
+	Do_ADBG_EndSubCase(c, "Cipher operations");
+
+	Do_ADBG_BeginSubCase(c, "Keyed by max key size");
+	if (!ADBG_EXPECT_TEEC_SUCCESS(c,
+		ta_crypt_cmd_allocate_operation(c, &session, &op,
+			TEE_ALG_AES_ECB_NOPAD, TEE_MODE_ENCRYPT, 256)))
+		goto out;
+	if (!ADBG_EXPECT_TEEC_SUCCESS(c,
+		ta_crypt_cmd_free_operation(c, &session, op)))
+		goto out;
+	if (!check_operation_pool(c, &session, 3, 3, 3))
+		goto out;
+	Do_ADBG_EndSubCase(c, "Keyed by max key size");
+
+	Do_ADBG_BeginSubCase(c, "Disable");
+	if (!ADBG_EXPECT_TEEC_RESULT(c, TEEC_ERROR_BAD_PARAMETERS,
+		ta_crypt_cmd_operation_pool(c, &session, 2)))
+		goto out;
+	if (!ADBG_EXPECT_TEEC_SUCCESS(c,
+		ta_crypt_cmd_operation_pool(c, &session,
+					    TA_CRYPT_OP_POOL_DISABLE)))
+		goto out;
+	if (!check_operation_pool(c, &session, 3, 3, 0))
+		goto out;
+	/* Disabled, freed operations aren't pooled anymore */
+	if (!ADBG_EXPECT_TEEC_SUCCESS(c,
+		ta_crypt_cmd_allocate_operation(c, &session, &op,
+			TEE_ALG_SHA256, TEE_MODE_DIGEST, 0)))
+		goto out;
+	if (!ADBG_EXPECT_TEEC_SUCCESS(c,
+		ta_crypt_cmd_free_operation(c, &session, op)))
+		goto out;
+	check_operation_pool(c, &session, 3, 3, 0);
+	Do_ADBG_EndSubCase(c, "Disable");
+out:
+	TEEC_CloseSession(&session);
+}
+ADBG_CASE_DEFINE(regression, 4013, xtest_tee_test_4013,
+		"Test crypt TA operation pool");
@@ -605,6 +605,32 @@ static TEEC_Result cmd_div(ADBG_Case_t *c, TEEC_Session *s, uint32_t hop1,
 	return res;
 }
 
+static TEEC_Result cmd_program(ADBG_Case_t *c, TEEC_Session *s,
+			       const uint32_t *prog, size_t prog_words,
+			       const uint32_t *regs, size_t num_regs,
+			       int32_t *flag)
+{
+	TEEC_Result res;
+	TEEC_Operation op = TEEC_OPERATION_INITIALIZER;
+	uint32_t ret_orig;
+
+	op.params[0].tmpref.buffer = (void *)prog;
+	op.params[0].tmpref.size = prog_words * sizeof(uint32_t);
+	op.params[1].tmpref.buffer = (void *)regs;
+	op.params[1].tmpref.size = num_regs * sizeof(uint32_t);
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_TEMP_INPUT,
+					 TEEC_MEMREF_TEMP_INPUT,
+					 TEEC_VALUE_OUTPUT, TEEC_NONE);
+	res = TEEC_InvokeCommand(s, TA_CRYPT_CMD_ARITH_PROGRAM, &op,
+				 &ret_orig);
+	ADBG_EXPECT_TEEC_ERROR_ORIGIN(c, TEEC_ORIGIN_TRUSTED_APP, ret_orig);
+
+	if (!res && flag)
+		*flag = op.params[2].value.a;
+
+	return res;
+}
+
 static void test_4101(ADBG_Case_t *c)
 {
 	TEEC_Session session = { 0 };
@@ -2499,3 +2525,304 @@ static void test_4114(ADBG_Case_t *c)
 }
 ADBG_CASE_DEFINE(regression, 4114, test_4114,
 		"Test TEE Internal API Arithmetical API - GCD");
+
+#define INSN(op, d, a, b, cc) \
+	TA_CRYPT_ARITH_INSN(TA_CRYPT_ARITH_OP_##op, (d), (a), (b), (cc))
+
+static bool new_vars(ADBG_Case_t *c, TEEC_Session *s, uint32_t *h,
+		     size_t count)
+{
+	size_t n;
+
+	for (n = 0; n < count; n++)
+		h[n] = TA_CRYPT_ARITH_INVALID_HANDLE;
+	for (n = 0; n < count; n++)
+		if (!ADBG_EXPECT_TEEC_SUCCESS(c, cmd_new_var(c, s, 2048,
+							     h + n)))
+			return false;
+	return true;
+}
+
+static void free_vars(ADBG_Case_t *c, TEEC_Session *s, uint32_t *h,
+		      size_t count)
+{
+	size_t n;
+
+	for (n = 0; n < count; n++)
+		ADBG_EXPECT_TEEC_SUCCESS(c, cmd_free_handle(c, s, h[n]));
+}
+
+/* The 4110 vectors, in one invocation */
+static bool test_4115_mod(ADBG_Case_t *c, TEEC_Session *s,
+			  const char *str_op1, const char *str_op2,
+			  const char *str_n, const char *str_add_res,
+			  const char *str_mul_res)
+{
+	static const uint32_t prog[] = {
+		INSN(ADDMOD, 3, 0, 1, 2),	/* r3 = (r0 + r1) mod r2 */
+		INSN(MULMOD, 4, 0, 1, 2),	/* r4 = (r0 * r1) mod r2 */
+		INSN(SUBMOD, 5, 3, 1, 2),	/* r5 = (r3 - r1) mod r2 */
+		INSN(CMP, 0, 5, 0, 0),		/* flag = cmp(r5, r0) */
+	};
+	uint32_t h[8];
+	int32_t flag = -1;
+	bool res = false;
+
+	if (!new_vars(c, s, h, ARRAY_SIZE(h)))
+		goto out;
+	if (!ADBG_EXPECT_TEEC_SUCCESS(c,
+			convert_from_string(c, s, str_op1, h[0])) ||
+	    !ADBG_EXPECT_TEEC_SUCCESS(c,
+			convert_from_string(c, s, str_op2, h[1])) ||
+	    !ADBG_EXPECT_TEEC_SUCCESS(c,
+			convert_from_string(c, s, str_n, h[2])) ||
+	    !ADBG_EXPECT_TEEC_SUCCESS(c,
+			convert_from_string(c, s, str_add_res, h[6])) ||
+	    !ADBG_EXPECT_TEEC_SUCCESS(c,
+			convert_from_string(c, s, str_mul_res, h[7])))
+		goto out;
+
+	if (!ADBG_EXPECT_TEEC_SUCCESS(c, cmd_program(c, s, prog,
+			ARRAY_SIZE(prog), h, ARRAY_SIZE(h), &flag)))
+		goto out;
+	if (!ADBG_EXPECT_COMPARE_SIGNED(c, flag, ==, 0))
+		goto out;
+	if (!ADBG_EXPECT_TEEC_SUCCESS(c, compare_handle(c, s, h[3], h[6], 0)))
+		goto out;
+	if (!ADBG_EXPECT_TEEC_SUCCESS(c, compare_handle(c, s, h[4], h[7], 0)))
+		goto out;
+
+	res = true;
+out:
+	free_vars(c, s, h, ARRAY_SIZE(h));
+	return res;
+}
+
+/* The 4111 vectors, in one invocation */
+static bool test_4115_invmod(ADBG_Case_t *c, TEEC_Session *s,
+			     const char *str_op, const char *str_n,
+			     const char *str_res)
+{
+	static const uint32_t prog[] = {
+		INSN(INVMOD, 2, 0, 1, 0),	/* r2 = r0^-1 mod r1 */
+		INSN(MULMOD, 3, 2, 0, 1),	/* r3 = (r2 * r0) mod r1 */
+		INSN(CMP_S32, 0, 3, 0, 1),	/* flag = cmp(r3, 1) */
+	};
+	uint32_t h[5];
+	int32_t flag = -1;
+	bool res = false;
+
+	if (!new_vars(c, s, h, ARRAY_SIZE(h)))
+		goto out;
+	if (!ADBG_EXPECT_TEEC_SUCCESS(c,
+			convert_from_string(c, s, str_op, h[0])) ||
+	    !ADBG_EXPECT_TEEC_SUCCESS(c,
+			convert_from_string(c, s, str_n, h[1])) ||
+	    !ADBG_EXPECT_TEEC_SUCCESS(c,
+			convert_from_string(c, s, str_res, h[4])))
+		goto out;
+
+	if (!ADBG_EXPECT_TEEC_SUCCESS(c, cmd_program(c, s, prog,
+			ARRAY_SIZE(prog), h, ARRAY_SIZE(h), &flag)))
+		goto out;
+	if (!ADBG_EXPECT_COMPARE_SIGNED(c, flag, ==, 0))
+		goto out;
+	if (!ADBG_EXPECT_TEEC_SUCCESS(c, compare_handle(c, s, h[2], h[4], 0)))
+		goto out;
+
+	res = true;
+out:
+	free_vars(c, s, h, ARRAY_SIZE(h));
+	return res;
+}
+
+/*
+ * Fermat test 3^(p - 1) mod p == 1 for the Mersenne prime p = 2^127 - 1,
+ * by left-to-right square-and-multiply with a select per exponent bit
+ */
+#define TEST_4115_EXP_BITS	127
+
+static bool test_4115_modexp(ADBG_Case_t *c, TEEC_Session *s)
+{
+	static const uint32_t check[] = {
+		INSN(CMP_S32, 0, 3, 0, 1),	/* flag = cmp(acc, 1) */
+	};
+	static const uint32_t bad[] = {
+		INSN(COPY, 5, 0, 0, 0),		/* r5 doesn't exist */
+	};
+	uint32_t prog[TEST_4115_EXP_BITS * 4 * 2 + ARRAY_SIZE(check)] = { };
+	uint32_t h[5];		/* base, exponent, modulus, acc, tmp */
+	int32_t flag = -1;
+	bool res = false;
+	size_t n = 0;
+	int bit;
+
+	for (bit = TEST_4115_EXP_BITS - 1; bit >= 0; bit--) {
+		uint32_t insn[] = {
+			INSN(SQRMOD, 3, 3, 2, 0),	/* acc = acc^2 mod p */
+			INSN(MULMOD, 4, 3, 0, 2),	/* tmp = acc * 3 mod p */
+			INSN(GET_BIT, 0, 1, 0, bit),
+			/* acc = bit ? tmp : acc */
+			INSN(SELECT, 3, 4, 3, TA_CRYPT_ARITH_COND_GT),
+		};
+
+		memcpy(prog + n, insn, sizeof(insn));
+		n += ARRAY_SIZE(insn);
+	}
+	memcpy(prog + n, check, sizeof(check));
+	n += ARRAY_SIZE(check);
+
+	if (!new_vars(c, s, h, ARRAY_SIZE(h)))
+		goto out;
+	if (!ADBG_EXPECT_TEEC_SUCCESS(c, cmd_from_s32(c, s, h[0], 3)) ||
+	    !ADBG_EXPECT_TEEC_SUCCESS(c, convert_from_string(c, s,
+			"7FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFE", h[1])) ||
+	    !ADBG_EXPECT_TEEC_SUCCESS(c, convert_from_string(c, s,
+			"7FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF", h[2])) ||
+	    !ADBG_EXPECT_TEEC_SUCCESS(c, cmd_from_s32(c, s, h[3], 1)))
+		goto out;
+
+	if (!ADBG_EXPECT_TEEC_SUCCESS(c, cmd_program(c, s, prog, n, h,
+						     ARRAY_SIZE(h), &flag)))
+		goto out;
+	if (!ADBG_EXPECT_COMPARE_SIGNED(c, flag, ==, 0))
+		goto out;
+
+	/* Register index out of range: rejected before anything runs */
+	if (!ADBG_EXPECT_TEEC_RESULT(c, TEEC_ERROR_BAD_PARAMETERS,
+			cmd_program(c, s, bad, ARRAY_SIZE(bad), h,
+				    ARRAY_SIZE(h), NULL)))
+		goto out;
+
+	res = true;
+out:
+	free_vars(c, s, h, ARRAY_SIZE(h));
+	return res;
+}
+
+static void test_4115(ADBG_Case_t *c)
+{
+	TEEC_Session session = { 0 };
+	uint32_t ret_orig;
+	size_t n;
+
+	if (!ADBG_EXPECT_TEEC_SUCCESS(c,
+			xtest_teec_open_session(&session, &crypt_user_ta_uuid,
+						NULL, &ret_orig)))
+		return;
+
+	for (n = 0; n < ARRAY_SIZE(test_4110_data); n++) {
+		if (!ADBG_EXPECT_TRUE(c, test_4115_mod(c, &session,
+				test_4110_data[n].op1, test_4110_data[n].op2,
+				test_4110_data[n].n,
+				test_4110_data[n].addres,
+				test_4110_data[n].mulres))) {
+			Do_ADBG_Log("n %zu", n);
+			goto out;
+		}
+	}
+
+	for (n = 0; n < ARRAY_SIZE(test_4111_data); n++) {
+		if (!ADBG_EXPECT_TRUE(c, test_4115_invmod(c, &session,
+				test_4111_data[n].op, test_4111_data[n].n,
+				test_4111_data[n].res))) {
+			Do_ADBG_Log("n %zu", n);
+			goto out;
+		}
+	}
+
+	ADBG_EXPECT_TRUE(c, test_4115_modexp(c, &session));
+out:
+	TEEC_CloseSession(&session);
+}
+ADBG_CASE_DEFINE(regression, 4115, test_4115,
+		"Test TEE Internal API Arithmetical API - Bytecode program");
+
+/*
+ * Grows the handle database past its initial size, frees everything so
+ * that the upper half is released, then grows it again: the handles of
+ * the first round must not resolve to the slots allocated again.
+ */
+#define TEST_4116_REGROW_VARS	8
+
+static bool test_4116_regrow(ADBG_Case_t *c, TEEC_Session *s)
+{
+	uint32_t old[TEST_4116_REGROW_VARS];
+	uint32_t h[TEST_4116_REGROW_VARS];
+	bool res = false;
+	size_t n;
+
+	if (!new_vars(c, s, old, ARRAY_SIZE(old))) {
+		free_vars(c, s, old, ARRAY_SIZE(old));
+		return false;
+	}
+	/* Last first, so the upper half is free when the shrink is tried */
+	for (n = ARRAY_SIZE(old); n > 0; n--)
+		if (!ADBG_EXPECT_TEEC_SUCCESS(c,
+				cmd_free_handle(c, s, old[n - 1])))
+			return false;
+
+	if (!new_vars(c, s, h, ARRAY_SIZE(h)))
+		goto out;
+	for (n = 0; n < ARRAY_SIZE(old); n++) {
+		if (!ADBG_EXPECT_TEEC_RESULT(c, TEEC_ERROR_BAD_PARAMETERS,
+					     cmd_from_s32(c, s, old[n], 1))) {
+			Do_ADBG_Log("n %zu", n);
+			goto out;
+		}
+	}
+	res = true;
+out:
+	free_vars(c, s, h, ARRAY_SIZE(h));
+	return res;
+}
+
+static void test_4116(ADBG_Case_t *c)
+{
+	TEEC_Session session = { 0 };
+	TEEC_Operation op = TEEC_OPERATION_INITIALIZER;
+	uint32_t h1 = TA_CRYPT_ARITH_INVALID_HANDLE;
+	uint32_t h2 = TA_CRYPT_ARITH_INVALID_HANDLE;
+	uint32_t ret_orig;
+
+	if (!ADBG_EXPECT_TEEC_SUCCESS(c,
+			xtest_teec_open_session(&session, &crypt_user_ta_uuid,
+						NULL, &ret_orig)))
+		return;
+
+	Do_ADBG_BeginSubCase(c, "Stale handles");
+	if (!ADBG_EXPECT_TEEC_SUCCESS(c, cmd_new_var(c, &session, 64, &h1)))
+		goto out;
+	if (!ADBG_EXPECT_TEEC_SUCCESS(c, cmd_free_handle(c, &session, h1)))
+		goto out;
+	if (!ADBG_EXPECT_TEEC_RESULT(c, TEEC_ERROR_BAD_PARAMETERS,
+				     cmd_from_s32(c, &session, h1, 1)))
+		goto out;
+	/* The slot is reused but the old handle must stay invalid */
+	if (!ADBG_EXPECT_TEEC_SUCCESS(c, cmd_new_var(c, &session, 64, &h2)))
+		goto out;
+	ADBG_EXPECT_COMPARE_UNSIGNED(c, h1, !=, h2);
+	ADBG_EXPECT_TEEC_RESULT(c, TEEC_ERROR_BAD_PARAMETERS,
+				cmd_from_s32(c, &session, h1, 1));
+	ADBG_EXPECT_TEEC_SUCCESS(c, cmd_from_s32(c, &session, h2, 1));
+	ADBG_EXPECT_TEEC_SUCCESS(c, cmd_free_handle(c, &session, h2));
+	Do_ADBG_EndSubCase(c, "Stale handles");
+
+	Do_ADBG_BeginSubCase(c, "Stale handles after shrink and regrow");
+	if (!ADBG_EXPECT_TRUE(c, test_4116_regrow(c, &session)))
+		goto out;
+	Do_ADBG_EndSubCase(c, "Stale handles after shrink and regrow");
+
+	Do_ADBG_BeginSubCase(c, "Allocate, reuse and free handles");
+	op.params[0].value.a = 500;
+	op.params[0].value.b = 3;
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT, TEEC_VALUE_OUTPUT,
+					 TEEC_VALUE_OUTPUT, TEEC_NONE);
+	ADBG_EXPECT_TEEC_SUCCESS(c, TEEC_InvokeCommand(&session,
+			TA_CRYPT_CMD_ARITH_HANDLE_BENCH, &op, &ret_orig));
+	Do_ADBG_EndSubCase(c, "Allocate, reuse and free handles");
+out:
+	TEEC_CloseSession(&session);
+}
+ADBG_CASE_DEFINE(regression, 4116, test_4116,
+		"Test TEE Internal API Arithmetical API - Handles");
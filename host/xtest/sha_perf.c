@@ -26,8 +26,12 @@
  */
 
 #include <adbg.h>
+#include <errno.h>
 #include <fcntl.h>
+#include <inttypes.h>
 #include <math.h>
+#include <pthread.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -40,6 +44,7 @@
 #include <unistd.h>
 
 #include "crypto_common.h"
+#include "xtest_helpers.h"
 
 /*
  * TEE client stuff
@@ -53,76 +58,57 @@ static TEEC_SharedMemory in_shm = {
 static TEEC_SharedMemory out_shm = {
 	.flags = TEEC_MEM_OUTPUT
 };
+static TEEC_SharedMemory desc_shm = {
+	.flags = TEEC_MEM_INPUT
+};
+static TEEC_SharedMemory tree_shm = {
+	.flags = TEEC_MEM_INPUT | TEEC_MEM_OUTPUT
+};
 
-static void errx(const char *msg, TEEC_Result res, uint32_t *orig)
-{
-	fprintf(stderr, "%s: 0x%08x", msg, res);
-	if (orig)
-		fprintf(stderr, " (orig=%d)", (int)*orig);
-	fprintf(stderr, "\n");
-	exit (1);
-}
+/* Print the full latency histogram (--hist) */
+static int dump_hist;
+static struct lat_hist hist;
 
-static void check_res(TEEC_Result res, const char *errmsg, uint32_t *orig)
-{
-	if (res != TEEC_SUCCESS)
-		errx(errmsg, res, orig);
-}
+/* Secure-side time returned by the TA */
+static struct ta_time ta_time;
 
-static void open_ta(void)
-{
-	TEEC_Result res;
-	TEEC_UUID uuid = TA_SHA_PERF_UUID;
-	uint32_t err_origin;
+/* Buffer size sweep (-s START:END:xFACTOR), sweep.factor == 0 when unused */
+static struct size_sweep sweep;
 
-	res = TEEC_InitializeContext(NULL, &ctx);
-	check_res(res,"TEEC_InitializeContext", NULL);
+/* Skip the invocation baseline measurement (--no-baseline) */
+static int no_baseline;
 
-	res = TEEC_OpenSession(&ctx, &sess, &uuid, TEEC_LOGIN_PUBLIC, NULL,
-			       NULL, &err_origin);
-	check_res(res,"TEEC_OpenSession", &err_origin);
-}
+/* Bytes per TEE_DigestUpdate() call (--unit N), 0: one TEE_DigestDoFinal() */
+static size_t unit;
+
+/* File hashed across invocations into one digest (--stream FILE) */
+static const char *stream_file;
+
+/* Re-initialize the operation before each message (--reinit) */
+static int reinit;
 
 /*
- * Statistics
- *
- * We want to compute min, max, mean and standard deviation of processing time
+ * Messages hashed per invocation (--batch N, 0 when unused), their size
+ * ranging from msg_min to msg_max bytes (--msg-size S or MIN:MAX)
  */
+static unsigned int batch;
+static size_t msg_min = 64;
+static size_t msg_max = 64;
 
-struct statistics {
-	int n;
-	double m;
-	double M2;
-	double min;
-	double max;
-	int initialized;
-};
+#define MERKLE_DEF_COUNT	10
 
-/* Take new sample into account (Knuth/Welford algorithm) */
-static void update_stats(struct statistics *s, uint64_t t)
-{
-	double x = (double)t;
-	double delta = x - s->m;
-
-	s->n++;
-	s->m += delta/s->n;
-	s->M2 += delta*(x - s->m);
-	if (!s->initialized) {
-		s->min = s->max = x;
-		s->initialized = 1;
-	} else {
-		if (s->min > x)
-			s->min = x;
-		if (s->max < x)
-			s->max = x;
-	}
-}
+/* Merkle tree leaf size (--merkle LEAF, 0 when unused) and threads (-t N) */
+static size_t merkle_leaf;
+static unsigned int num_threads = 1;
+
+/* Run parameters, common to all the result records of a test */
+static struct perf_record params;
+
+static const TEEC_UUID ta_uuid = TA_SHA_PERF_UUID;
 
-static double stddev(struct statistics *s)
+static void open_session(TEEC_Session *s)
 {
-	if (s->n < 2)
-		return NAN;
-	return sqrt(s->M2/s->n);
+	crypto_open_session(&ctx, s, &ta_uuid);
 }
 
 static const char *algo_str(uint32_t algo)
@@ -138,6 +124,20 @@ static const char *algo_str(uint32_t algo)
 		return "SHA384";
 	case TA_SHA_SHA512:
 		return "SHA512";
+	case TA_SHA_HMAC_SHA1:
+		return "HMAC-SHA1";
+	case TA_SHA_HMAC_SHA256:
+		return "HMAC-SHA256";
+	case TA_SHA_HMAC_SHA512:
+		return "HMAC-SHA512";
+	case TA_SHA_SHA3_224:
+		return "SHA3-224";
+	case TA_SHA_SHA3_256:
+		return "SHA3-256";
+	case TA_SHA_SHA3_384:
+		return "SHA3-384";
+	case TA_SHA_SHA3_512:
+		return "SHA3-512";
 	default:
 		return "???";
 	}
@@ -147,14 +147,21 @@ static int hash_size(uint32_t algo)
 {
 	switch (algo) {
 	case TA_SHA_SHA1:
+	case TA_SHA_HMAC_SHA1:
 		return 20;
 	case TA_SHA_SHA224:
+	case TA_SHA_SHA3_224:
 		return 28;
 	case TA_SHA_SHA256:
+	case TA_SHA_HMAC_SHA256:
+	case TA_SHA_SHA3_256:
 		return 32;
 	case TA_SHA_SHA384:
+	case TA_SHA_SHA3_384:
 		return 48;
 	case TA_SHA_SHA512:
+	case TA_SHA_HMAC_SHA512:
+	case TA_SHA_SHA3_512:
 		return 64;
 	default:
 		return 0;
@@ -172,65 +179,49 @@ static void alloc_shm(size_t sz, uint32_t algo, int offset)
 	in_shm.buffer = NULL;
 	in_shm.size = sz + offset;
 	res = TEEC_AllocateSharedMemory(&ctx, &in_shm);
-	check_res(res, "TEEC_AllocateSharedMemory", NULL);
+	crypto_check_res(res, "TEEC_AllocateSharedMemory", NULL);
 
 	out_shm.buffer = NULL;
-	out_shm.size = hash_size(algo);
+	out_shm.size = hash_size(algo) * (batch ? batch : 1);
 	res = TEEC_AllocateSharedMemory(&ctx, &out_shm);
-	check_res(res, "TEEC_AllocateSharedMemory", NULL);
+	crypto_check_res(res, "TEEC_AllocateSharedMemory", NULL);
 }
 
 static void free_shm(void)
 {
 	TEEC_ReleaseSharedMemory(&in_shm);
 	TEEC_ReleaseSharedMemory(&out_shm);
+	if (batch)
+		TEEC_ReleaseSharedMemory(&desc_shm);
 }
 
-static ssize_t read_random(void *in, size_t rsize)
-{
-	static int rnd;
-	ssize_t s;
-
-	if (!rnd) {
-		rnd = open("/dev/urandom", O_RDONLY);
-		if (rnd < 0) {
-			perror("open");
-			return 1;
-		}
-	}
-	s = read(rnd, in, rsize);
-	if (s < 0) {
-		perror("read");
-		return 1;
-	}
-	if ((size_t)s != rsize) {
-		printf("read: requested %zu bytes, got %zd\n",
-		       rsize, s);
-	}
-	return 0;
-}
-
-static long get_current_time(struct timespec *ts)
+/*
+ * Allocate the batch message table and lay the messages out one after the
+ * other from @offset, their lengths spread uniformly over msg_min..msg_max.
+ * Return the total size of the messages.
+ */
+static size_t alloc_batch_table(int offset)
 {
-	if (clock_gettime(CLOCK_MONOTONIC, ts) < 0) {
-		perror("clock_gettime");
-		exit(1);
-	}
-	return 0;
-}
+	struct ta_sha_perf_msg *m = NULL;
+	unsigned int seed = 1;
+	TEEC_Result res;
+	size_t off = 0;
+	unsigned int i;
 
-static uint64_t timespec_diff_ns(struct timespec *start, struct timespec *end)
-{
-	uint64_t ns = 0;
+	desc_shm.buffer = NULL;
+	desc_shm.size = batch * sizeof(*m);
+	res = TEEC_AllocateSharedMemory(&ctx, &desc_shm);
+	crypto_check_res(res, "TEEC_AllocateSharedMemory", NULL);
 
-	if (end->tv_nsec < start->tv_nsec) {
-		ns += 1000000000 * (end->tv_sec - start->tv_sec - 1);
-		ns += 1000000000 - start->tv_nsec + end->tv_nsec;
-	} else {
-		ns += 1000000000 * (end->tv_sec - start->tv_sec);
-		ns += end->tv_nsec - start->tv_nsec;
+	m = desc_shm.buffer;
+	for (i = 0; i < batch; i++) {
+		m[i].offset = offset + off;
+		m[i].len = msg_min;
+		if (msg_max > msg_min)
+			m[i].len += rand_r(&seed) % (msg_max - msg_min + 1);
+		off += m[i].len;
 	}
-	return ns;
+	return off;
 }
 
 static uint64_t run_test_once(void *in, size_t size,  int random_in, TEEC_Operation *op)
@@ -238,20 +229,23 @@ static uint64_t run_test_once(void *in, size_t size,  int random_in, TEEC_Operat
 	struct timespec t0, t1;
 	TEEC_Result res;
 	uint32_t ret_origin;
+	uint32_t cmd = batch ? TA_SHA_PERF_CMD_PROCESS_BATCH :
+			       TA_SHA_PERF_CMD_PROCESS;
 
 	if (random_in == CRYPTO_USE_RANDOM)
 		read_random(in, size);
+	if (TEEC_PARAM_TYPE_GET(op->paramTypes, 3) == TEEC_VALUE_INOUT)
+		op->params[3].value.a = unit;
 
 	get_current_time(&t0);
-	res = TEEC_InvokeCommand(&sess, TA_SHA_PERF_CMD_PROCESS, op,
-				 &ret_origin);
-	check_res(res, "TEEC_InvokeCommand", &ret_origin);
+	res = TEEC_InvokeCommand(&sess, cmd, op, &ret_origin);
+	crypto_check_res(res, "TEEC_InvokeCommand", &ret_origin);
 	get_current_time(&t1);
 
 	return timespec_diff_ns(&t0, &t1);
 }
 
-static void prepare_op(int algo)
+static void prepare_op(TEEC_Session *s, int algo)
 {
 	TEEC_Result res;
 	uint32_t ret_origin;
@@ -261,32 +255,523 @@ static void prepare_op(int algo)
 	op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT, TEEC_NONE,
 					 TEEC_NONE, TEEC_NONE);
 	op.params[0].value.a = algo;
-	res = TEEC_InvokeCommand(&sess, TA_SHA_PERF_CMD_PREPARE_OP, &op,
+	if (reinit)
+		op.params[0].value.b = TA_SHA_PERF_FLAG_REINIT;
+	res = TEEC_InvokeCommand(s, TA_SHA_PERF_CMD_PREPARE_OP, &op,
 				 &ret_origin);
-	check_res(res, "TEEC_InvokeCommand", &ret_origin);
+	if (res == TEEC_ERROR_NOT_SUPPORTED) {
+		fprintf(stderr, "%s is not supported by this TEE\n",
+			algo_str(algo));
+		exit(1);
+	}
+	crypto_check_res(res, "TEEC_InvokeCommand", &ret_origin);
+}
+
+/* Run @n timed invocations on @size bytes of the input buffer */
+static void measure(TEEC_Operation *op, size_t size, unsigned int n,
+		    int random_in, int offset, struct statistics *stats,
+		    struct lat_hist *h, int verbosity)
+{
+	unsigned int n0 = n;
+	uint64_t t;
+
+	memset(stats, 0, sizeof(*stats));
+	lat_hist_init(h);
+	ta_time_reset(&ta_time);
+	op->params[0].memref.size = size + offset;
+
+	while (n-- > 0) {
+		t = run_test_once((uint8_t *)in_shm.buffer + offset, size, random_in, op);
+		update_stats(stats, t);
+		lat_hist_record(h, t);
+		ta_time_update(&ta_time, &op->params[3].value);
+		if (n0 >= 10 && n % (n0 / 10) == 0)
+			vverbose("#");
+	}
+	vverbose("\n");
+}
+
+static void run_sweep(TEEC_Operation *op, unsigned int n, int random_in,
+		      int offset, int verbosity)
+{
+	unsigned int count = size_sweep_count(&sweep);
+	struct sweep_row *rows = NULL;
+	struct statistics stats;
+	unsigned int i = 0;
+	size_t sz = 0;
+
+	rows = calloc(count, sizeof(*rows));
+	if (!rows)
+		crypto_errx("calloc", TEEC_ERROR_OUT_OF_MEMORY, NULL);
+
+	for (i = 0; i < count; i++) {
+		sz = size_sweep_get(&sweep, i);
+		verbose("size=%zu bytes\n", sz);
+		measure(op, sz, n, random_in, offset, &stats, &hist,
+			verbosity);
+		sweep_record(rows + i, sz, sz, &stats, &hist, &ta_time);
+		if (dump_hist && perf_output_text()) {
+			printf("size=%zu bytes:\n", sz);
+			lat_hist_dump(&hist);
+		}
+	}
+	sweep_print(rows, count, &params);
+	free(rows);
+}
+
+static void record_params(int algo, unsigned int n, unsigned int l,
+			  int random_in, int offset, int warmup)
+{
+	perf_record_init(&params, "sha_perf");
+	perf_record_str(&params, "algo", algo_str(algo));
+	perf_record_uint(&params, "loops", n);
+	perf_record_uint(&params, "inner_loops", l);
+	perf_record_str(&params, "input_data",
+			random_in == CRYPTO_USE_RANDOM ? "random" : "zeros");
+	perf_record_bool(&params, "unaligned", offset);
+	perf_record_int(&params, "warmup_s", warmup);
+	perf_record_uint(&params, "unit", unit);
+	perf_record_bool(&params, "reinit", reinit);
+	perf_record_uint(&params, "batch", batch);
+	if (batch) {
+		perf_record_uint(&params, "msg_size_min", msg_min);
+		perf_record_uint(&params, "msg_size_max", msg_max);
+	}
+}
+
+/* Number of TEE_DigestUpdate() calls hashing @size bytes in @unit chunks */
+static size_t update_count(size_t size)
+{
+	if (!unit || !size)
+		return 0;
+	return (size - 1) / unit;
+}
+
+/* Read up to @size bytes, less only at the end of the file */
+static size_t read_chunk(int fd, uint8_t *buf, size_t size)
+{
+	size_t done = 0;
+	ssize_t r;
+
+	while (done < size) {
+		r = read(fd, buf + done, size - done);
+		if (r < 0) {
+			if (errno == EINTR)
+				continue;
+			perror(stream_file);
+			exit(1);
+		}
+		if (!r)
+			break;
+		done += r;
+	}
+	return done;
 }
 
-static void do_warmup(int warmup)
+/* MiB/s for 64-bit byte counts, streams may not fit in a size_t */
+static double stream_rate(uint64_t bytes, uint64_t ns)
 {
-	struct timespec t0, t;
+	return (double)bytes / (1024 * 1024) * 1000000000 / ns;
+}
+
+/*
+ * Stream mode: hash stream_file in @size-byte chunks, one UPDATE invocation
+ * per chunk into the same digest operation, then get the digest with FINAL.
+ * Reading the file is not part of the invocation times.
+ */
+static void run_stream(int algo, size_t size, int offset, int verbosity)
+{
+	struct statistics stats;
+	struct timespec start, end, t0, t1;
+	struct perf_record r;
+	TEEC_Operation op;
+	TEEC_Result res;
+	uint32_t ret_origin;
+	uint64_t invoke_ns = 0;
+	uint64_t read_ns = 0;
+	uint64_t total = 0;
+	uint8_t *digest;
+	size_t len;
+	int fd;
 	int i;
 
-	get_current_time(&t0);
-	do {
-		for (i = 0; i < 100000; i++)
-			;
-		get_current_time(&t);
-	} while (timespec_diff_ns(&t0, &t) < (uint64_t)warmup * 1000000000);
+	fd = open(stream_file, O_RDONLY);
+	if (fd < 0) {
+		perror(stream_file);
+		exit(1);
+	}
+
+	memset(&stats, 0, sizeof(stats));
+	lat_hist_init(&hist);
+	ta_time_reset(&ta_time);
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_PARTIAL_INPUT,
+					 TEEC_VALUE_INPUT, TEEC_VALUE_OUTPUT,
+					 TEEC_NONE);
+	op.params[0].memref.parent = &in_shm;
+	op.params[0].memref.offset = offset;
+	op.params[1].value.a = unit;
+
+	get_current_time(&start);
+	while (true) {
+		get_current_time(&t0);
+		len = read_chunk(fd, (uint8_t *)in_shm.buffer + offset, size);
+		get_current_time(&t1);
+		read_ns += timespec_diff_ns(&t0, &t1);
+		if (!len)
+			break;
+
+		op.params[0].memref.size = len;
+		get_current_time(&t0);
+		res = TEEC_InvokeCommand(&sess, TA_SHA_PERF_CMD_UPDATE, &op,
+					 &ret_origin);
+		crypto_check_res(res, "TEEC_InvokeCommand", &ret_origin);
+		get_current_time(&t1);
+
+		update_stats(&stats, timespec_diff_ns(&t0, &t1));
+		lat_hist_record(&hist, timespec_diff_ns(&t0, &t1));
+		ta_time_update(&ta_time, &op.params[2].value);
+		invoke_ns += timespec_diff_ns(&t0, &t1);
+		total += len;
+		if (stats.n % 1000 == 0)
+			vverbose("#");
+	}
+	vverbose("\n");
+
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_WHOLE, TEEC_NONE,
+					 TEEC_NONE, TEEC_NONE);
+	op.params[0].memref.parent = &out_shm;
+	res = TEEC_InvokeCommand(&sess, TA_SHA_PERF_CMD_FINAL, &op,
+				 &ret_origin);
+	crypto_check_res(res, "TEEC_InvokeCommand", &ret_origin);
+	get_current_time(&end);
+	close(fd);
+
+	if (!stats.n) {
+		fprintf(stderr, "%s: empty file\n", stream_file);
+		return;
+	}
+
+	digest = out_shm.buffer;
+	if (!perf_output_text()) {
+		struct lat_summary sum;
+		char hex[2 * 64 + 1] = { };
+
+		for (i = 0; i < hash_size(algo); i++)
+			snprintf(hex + 2 * i, 3, "%02x", digest[i]);
+		r = params;
+		lat_hist_summary(&hist, &sum);
+		perf_record_uint(&r, "size", size);
+		perf_record_uint(&r, "stream_bytes", total);
+		perf_record_stats(&r, size, &stats, &sum);
+		perf_record_ta_time(&r, &ta_time, &stats);
+		perf_record_double(&r, "stream_mib_per_s",
+				   stream_rate(total, invoke_ns));
+		perf_record_double(&r, "e2e_mib_per_s",
+				   stream_rate(total,
+					       timespec_diff_ns(&start, &end)));
+		perf_record_double(&r, "read_us", (double)read_ns / 1000);
+		perf_record_str(&r, "digest", hex);
+		perf_record_emit(&r);
+		return;
+	}
+
+	printf("%s: %" PRIu64 " bytes in %d invocations of up to %zu bytes\n",
+	       stream_file, total, stats.n, size);
+	printf("invoke: min=%gus max=%gus mean=%gus stddev=%gus, %gMiB/s (end-to-end %gMiB/s, file read %gs)\n",
+	       stats.min / 1000, stats.max / 1000, stats.m / 1000,
+	       stddev(&stats) / 1000, stream_rate(total, invoke_ns),
+	       stream_rate(total, timespec_diff_ns(&start, &end)),
+	       (double)read_ns / 1000000000);
+	lat_hist_print_percentiles(&hist);
+	print_ta_time(&ta_time, &stats);
+	if (unit && ta_time.stats.n)
+		printf("%zu-byte updates: %gus secure time per TEE_DigestUpdate()\n",
+		       unit, ta_time.stats.m / 1000 / ((size + unit - 1) / unit));
+	printf("%s: ", algo_str(algo));
+	for (i = 0; i < hash_size(algo); i++)
+		printf("%02x", digest[i]);
+	printf("\n");
+	if (dump_hist)
+		lat_hist_dump(&hist);
+}
+
+static void emit_result(size_t size, struct statistics *stats)
+{
+	struct perf_record r = params;
+	struct lat_summary sum;
+
+	lat_hist_summary(&hist, &sum);
+	perf_record_uint(&r, "size", size);
+	perf_record_stats(&r, size, stats, &sum);
+	perf_record_ta_time(&r, &ta_time, stats);
+	if (batch) {
+		perf_record_double(&r, "digests_per_s",
+				   batch * 1000000000.0 / stats->m);
+		perf_record_double(&r, "us_per_digest",
+				   stats->m / batch / 1000);
+	}
+	perf_record_emit(&r);
+}
+
+/*
+ * Merkle tree mode (--merkle LEAF): the input buffer is split in LEAF-byte
+ * leaves hashed by 1..num_threads threads, one TA session each. The interior
+ * nodes are then computed level by level, a node being the hash of the
+ * concatenation of its two children (an odd last node is promoted as is),
+ * the threads sharing each level and meeting on a barrier between levels.
+ * The nodes are stored level after level in tree_shm.
+ */
+struct merkle_args {
+	int algo;
+	size_t size;
+	size_t leaves;
+	unsigned int nthr;
+	size_t root_off;
+	pthread_barrier_t barrier;
+};
+
+struct merkle_ctx {
+	pthread_t thr;
+	unsigned int id;
+	struct merkle_args *args;
+	TEEC_Session sess;
+	struct timespec start;
+	struct timespec leaves_done;
+	struct timespec end;
+};
+
+/* Hash @len bytes at @in_off of @in into the node at @out_off of tree_shm */
+static void merkle_hash(TEEC_Session *s, TEEC_SharedMemory *in, size_t in_off,
+			size_t len, size_t out_off, size_t dsz)
+{
+	TEEC_Result res;
+	uint32_t ret_origin;
+	TEEC_Operation op;
+
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_PARTIAL_INPUT,
+					 TEEC_MEMREF_PARTIAL_OUTPUT,
+					 TEEC_VALUE_INPUT, TEEC_NONE);
+	op.params[0].memref.parent = in;
+	op.params[0].memref.offset = in_off;
+	op.params[0].memref.size = len;
+	op.params[1].memref.parent = &tree_shm;
+	op.params[1].memref.offset = out_off;
+	op.params[1].memref.size = dsz;
+	op.params[2].value.a = 1;
+	res = TEEC_InvokeCommand(s, TA_SHA_PERF_CMD_PROCESS, &op, &ret_origin);
+	crypto_check_res(res, "TEEC_InvokeCommand", &ret_origin);
 }
 
-static const char *yesno(int v)
+static void *merkle_thread(void *arg)
 {
-	return (v ? "yes" : "no");
+	struct merkle_ctx *t = arg;
+	struct merkle_args *a = t->args;
+	uint8_t *tree = tree_shm.buffer;
+	size_t dsz = hash_size(a->algo);
+	size_t count = a->leaves;
+	size_t level_off = 0;
+	size_t parents;
+	size_t next;
+	size_t len;
+	size_t i;
+
+	open_session(&t->sess);
+	prepare_op(&t->sess, a->algo);
+
+	xtest_barrier_wait(&a->barrier);
+	get_current_time(&t->start);
+	for (i = count * t->id / a->nthr; i < count * (t->id + 1) / a->nthr;
+	     i++) {
+		len = a->size - i * merkle_leaf;
+		if (len > merkle_leaf)
+			len = merkle_leaf;
+		merkle_hash(&t->sess, &in_shm, i * merkle_leaf, len, i * dsz,
+			    dsz);
+	}
+	get_current_time(&t->leaves_done);
+
+	while (count > 1) {
+		xtest_barrier_wait(&a->barrier);
+		next = level_off + count * dsz;
+		parents = (count + 1) / 2;
+		for (i = parents * t->id / a->nthr;
+		     i < parents * (t->id + 1) / a->nthr; i++) {
+			if (2 * i + 1 < count)
+				merkle_hash(&t->sess, &tree_shm,
+					    level_off + 2 * i * dsz, 2 * dsz,
+					    next + i * dsz, dsz);
+			else
+				memcpy(tree + next + i * dsz,
+				       tree + level_off + 2 * i * dsz, dsz);
+		}
+		level_off = next;
+		count = parents;
+	}
+	get_current_time(&t->end);
+
+	if (!t->id)
+		a->root_off = level_off;
+	TEEC_CloseSession(&t->sess);
+	return NULL;
 }
 
-static double mb_per_sec(size_t size, double usec)
+/*
+ * Build the tree once with @nthr threads, return the leaf hashing and total
+ * tree times in @leaf_ns and @tree_ns
+ */
+static void merkle_build(struct merkle_args *a, unsigned int nthr,
+			 uint64_t *leaf_ns, uint64_t *tree_ns)
 {
-	return (1000000000/usec)*((double)size/(1024*1024));
+	struct merkle_ctx *t;
+	struct timespec *first;
+	struct timespec *leaves_done;
+	struct timespec *last;
+	unsigned int i;
+	int e;
+
+	t = calloc(nthr, sizeof(*t));
+	if (!t)
+		crypto_errx("calloc", TEEC_ERROR_OUT_OF_MEMORY, NULL);
+
+	a->nthr = nthr;
+	xtest_barrier_init(&a->barrier, nthr);
+	for (i = 0; i < nthr; i++) {
+		t[i].id = i;
+		t[i].args = a;
+		e = pthread_create(&t[i].thr, NULL, merkle_thread, t + i);
+		if (e) {
+			fprintf(stderr, "pthread_create: %s\n", strerror(e));
+			exit(1);
+		}
+	}
+	for (i = 0; i < nthr; i++) {
+		e = pthread_join(t[i].thr, NULL);
+		if (e) {
+			fprintf(stderr, "pthread_join: %s\n", strerror(e));
+			exit(1);
+		}
+	}
+	xtest_barrier_destroy(&a->barrier);
+
+	first = &t[0].start;
+	leaves_done = &t[0].leaves_done;
+	last = &t[0].end;
+	for (i = 1; i < nthr; i++) {
+		if (timespec_to_ns(&t[i].start) < timespec_to_ns(first))
+			first = &t[i].start;
+		if (timespec_to_ns(&t[i].leaves_done) >
+		    timespec_to_ns(leaves_done))
+			leaves_done = &t[i].leaves_done;
+		if (timespec_to_ns(&t[i].end) > timespec_to_ns(last))
+			last = &t[i].end;
+	}
+	*leaf_ns = timespec_diff_ns(first, leaves_done);
+	*tree_ns = timespec_diff_ns(first, last);
+	free(t);
+}
+
+/* Number of nodes of the tree, promoted odd nodes included */
+static size_t merkle_nodes(size_t leaves)
+{
+	size_t nodes = leaves;
+
+	while (leaves > 1) {
+		leaves = (leaves + 1) / 2;
+		nodes += leaves;
+	}
+	return nodes;
+}
+
+static void run_merkle(int algo, size_t size, unsigned int n, int verbosity)
+{
+	struct merkle_args a = {
+		.algo = algo,
+		.size = size,
+		.leaves = (size + merkle_leaf - 1) / merkle_leaf,
+	};
+	struct statistics leaf_st;
+	struct statistics tree_st;
+	struct perf_record r;
+	size_t dsz = hash_size(algo);
+	uint8_t *root = NULL;
+	uint64_t leaf_ns = 0;
+	uint64_t tree_ns = 0;
+	double base = 0;
+	double leaves_per_s = 0;
+	unsigned int nthr;
+	unsigned int i;
+	TEEC_Result res;
+
+	tree_shm.buffer = NULL;
+	tree_shm.size = merkle_nodes(a.leaves) * dsz;
+	res = TEEC_AllocateSharedMemory(&ctx, &tree_shm);
+	crypto_check_res(res, "TEEC_AllocateSharedMemory", NULL);
+	root = calloc(1, dsz);
+	if (!root)
+		crypto_errx("calloc", TEEC_ERROR_OUT_OF_MEMORY, NULL);
+
+	if (perf_output_text()) {
+		printf("Merkle tree: %zu leaves of %zu bytes, %s, %u builds per thread count\n",
+		       a.leaves, merkle_leaf, algo_str(algo), n);
+		printf("threads  leaves/s  leaf(MiB/s)  tree(ms)  reduce(ms)  speedup  efficiency\n");
+	}
+	for (nthr = 1; nthr <= num_threads; nthr++) {
+		memset(&leaf_st, 0, sizeof(leaf_st));
+		memset(&tree_st, 0, sizeof(tree_st));
+		for (i = 0; i < n; i++) {
+			merkle_build(&a, nthr, &leaf_ns, &tree_ns);
+			update_stats(&leaf_st, leaf_ns);
+			update_stats(&tree_st, tree_ns);
+
+			/* Any thread count must give the same tree */
+			if (nthr == 1 && !i)
+				memcpy(root, (uint8_t *)tree_shm.buffer +
+				       a.root_off, dsz);
+			else if (memcmp(root, (uint8_t *)tree_shm.buffer +
+					a.root_off, dsz))
+				crypto_errx("Merkle root mismatch",
+					    TEEC_ERROR_GENERIC, NULL);
+		}
+		if (nthr == 1)
+			base = tree_st.m;
+		leaves_per_s = a.leaves * 1000000000.0 / leaf_st.m;
+
+		if (!perf_output_text()) {
+			r = params;
+			perf_record_uint(&r, "size", size);
+			perf_record_uint(&r, "merkle_leaf", merkle_leaf);
+			perf_record_uint(&r, "leaves", a.leaves);
+			perf_record_uint(&r, "threads", nthr);
+			perf_record_double(&r, "leaves_per_s", leaves_per_s);
+			perf_record_double(&r, "leaf_mib_per_s",
+					   mb_per_sec(size, leaf_st.m));
+			perf_record_double(&r, "tree_ms", tree_st.m / 1000000);
+			perf_record_double(&r, "reduce_ms",
+					   (tree_st.m - leaf_st.m) / 1000000);
+			perf_record_double(&r, "speedup", base / tree_st.m);
+			perf_record_double(&r, "efficiency",
+					   base / (tree_st.m * nthr));
+			perf_record_emit(&r);
+			continue;
+		}
+		printf("%7u  %8g  %11g  %8g  %10g  %7.2f  %9.1f%%\n", nthr,
+		       leaves_per_s, mb_per_sec(size, leaf_st.m),
+		       tree_st.m / 1000000, (tree_st.m - leaf_st.m) / 1000000,
+		       base / tree_st.m, 100 * base / (tree_st.m * nthr));
+		verbose("  tree time stddev=%gms\n", stddev(&tree_st) / 1000000);
+	}
+	if (perf_output_text()) {
+		printf("root: ");
+		for (i = 0; i < dsz; i++)
+			printf("%02x", root[i]);
+		printf("\n");
+	}
+
+	free(root);
+	TEEC_ReleaseSharedMemory(&tree_shm);
 }
 
 /* Hash test: buffer of size byte. Run test n times.
@@ -305,10 +790,8 @@ extern void sha_perf_run_test(int algo, size_t size, unsigned int n,
 				unsigned int l, int random_in, int offset,
 				int warmup, int verbosity)
 {
-	uint64_t t;
 	struct statistics stats;
 	TEEC_Operation op;
-	int n0 = n;
 	struct timespec ts;
 	double sd;
 
@@ -320,18 +803,44 @@ extern void sha_perf_run_test(int algo, size_t size, unsigned int n,
 	vverbose("Clock resolution is %lu ns\n", ts.tv_sec*1000000000 +
 		ts.tv_nsec);
 
-	open_ta();
-	prepare_op(algo);
+	record_params(algo, n, l, random_in, offset, warmup);
+
+	crypto_open_ta(&ctx, &sess, &ta_uuid);
+	prepare_op(&sess, algo);
 
+	if (batch)
+		size = alloc_batch_table(offset);
 	alloc_shm(size, algo, offset);
 
+	if (stream_file) {
+		verbose("Streaming %s: %s, chunk=%zu bytes, unit=%zu\n",
+			stream_file, algo_str(algo), size, unit);
+		if (warmup)
+			do_warmup(warmup);
+		run_stream(algo, size, offset, verbosity);
+		goto out;
+	}
+
+	if (merkle_leaf) {
+		if (random_in == CRYPTO_USE_RANDOM)
+			read_random(in_shm.buffer, size);
+		else
+			memset(in_shm.buffer, 0, size);
+		verbose("Merkle tree: %s, size=%zu bytes, leaf=%zu bytes, threads=1..%u, builds=%u\n",
+			algo_str(algo), size, merkle_leaf, num_threads, n);
+		if (warmup)
+			do_warmup(warmup);
+		run_merkle(algo, size, n, verbosity);
+		goto out;
+	}
+
 	if (random_in == CRYPTO_USE_ZEROS)
 		memset((uint8_t *)in_shm.buffer + offset, 0, size);
 
 	memset(&op, 0, sizeof(op));
 	op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_PARTIAL_INPUT,
 					 TEEC_MEMREF_PARTIAL_OUTPUT,
-					 TEEC_VALUE_INPUT, TEEC_NONE);
+					 TEEC_VALUE_INPUT, TEEC_VALUE_OUTPUT);
 	op.params[0].memref.parent = &in_shm;
 	op.params[0].memref.offset = 0;
 	op.params[0].memref.size = size + offset;
@@ -340,32 +849,83 @@ extern void sha_perf_run_test(int algo, size_t size, unsigned int n,
 	op.params[1].memref.size = hash_size(algo);
 	op.params[2].value.a = l;
 	op.params[2].value.b = offset;
+	if (batch) {
+		op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_PARTIAL_INPUT,
+						 TEEC_MEMREF_PARTIAL_OUTPUT,
+						 TEEC_MEMREF_PARTIAL_INPUT,
+						 TEEC_VALUE_OUTPUT);
+		op.params[1].memref.size = out_shm.size;
+		op.params[2].memref.parent = &desc_shm;
+		op.params[2].memref.offset = 0;
+		op.params[2].memref.size = desc_shm.size;
+	}
+	/* value[3] as inout passes the update size to the TA */
+	if (unit)
+		op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_PARTIAL_INPUT,
+						 TEEC_MEMREF_PARTIAL_OUTPUT,
+						 TEEC_VALUE_INPUT,
+						 TEEC_VALUE_INOUT);
 
-	verbose("Starting test: %s, size=%zu bytes, ",
-		algo_str(algo), size);
+	verbose("Starting test: %s, ", algo_str(algo));
+	if (sweep.factor)
+		verbose("size=%zu..%zu bytes (x%u), ", sweep.start, sweep.end,
+			sweep.factor);
+	else
+		verbose("size=%zu bytes, ", size);
 	verbose("random=%s, ", yesno(random_in == CRYPTO_USE_RANDOM));
 	verbose("unaligned=%s, ", yesno(offset));
+	if (unit)
+		verbose("unit=%zu, ", unit);
+	if (batch)
+		verbose("batch=%u, msg-size=%zu..%zu, ", batch, msg_min,
+			msg_max);
+	verbose("reinit=%s, ", yesno(reinit));
 	verbose("inner loops=%u, loops=%u, warm-up=%u s\n", l, n, warmup);
 
 	if (warmup)
 		do_warmup(warmup);
 
-	memset(&stats, 0, sizeof(stats));
-	while (n-- > 0) {
-		t = run_test_once((uint8_t *)in_shm.buffer + offset, size, random_in, &op);
-		update_stats(&stats, t);
-		if (n % (n0 / 10) == 0)
-			vverbose("#");
+	invoke_baseline.valid = 0;
+	if (!no_baseline) {
+		TEEC_Result res;
+
+		res = measure_invoke_baseline(&sess, TA_SHA_PERF_CMD_NULL,
+					      TA_SHA_PERF_CMD_VALUE, n);
+		crypto_check_res(res, "invocation baseline", NULL);
+	}
+
+	if (sweep.factor) {
+		run_sweep(&op, n, random_in, offset, verbosity);
+		goto out;
+	}
+
+	measure(&op, size, n, random_in, offset, &stats, &hist, verbosity);
+	if (!perf_output_text()) {
+		emit_result(size, &stats);
+		goto out;
 	}
-	vverbose("\n");
 	sd = stddev(&stats);
 	printf("min=%gus max=%gus mean=%gus stddev=%gus (cv %g%%) (%gMiB/s)\n",
 	       stats.min / 1000, stats.max / 1000, stats.m / 1000,
 	       sd / 1000, 100 * sd / stats.m, mb_per_sec(size, stats.m));
+	lat_hist_print_percentiles(&hist);
+	if (batch)
+		printf("batch of %u messages of %zu..%zu bytes: %g digests/s, %gus per digest\n",
+		       batch, msg_min, msg_max, batch * 1000000000.0 / stats.m,
+		       stats.m / batch / 1000);
+	print_invoke_baseline(size, &stats);
+	print_ta_time(&ta_time, &stats);
+	if (update_count(size) && ta_time.stats.n)
+		printf("%zu TEE_DigestUpdate() of %zu bytes + final per digest: %gus secure time per call\n",
+		       update_count(size), unit,
+		       ta_time.stats.m / 1000 / l / (update_count(size) + 1));
 	verbose("2-sigma interval: %g..%gus (%g..%gMiB/s)\n",
 		(stats.m - 2 * sd) / 1000, (stats.m + 2 * sd) / 1000,
 		mb_per_sec(size, stats.m + 2 * sd),
 		mb_per_sec(size, stats.m - 2 * sd));
+	if (dump_hist)
+		lat_hist_dump(&hist);
+out:
 	free_shm();
 }
 
@@ -374,23 +934,73 @@ static void usage(const char *progname,
 				int algo, size_t size, int warmup, int l, int n)
 {
 	fprintf(stderr, "Usage: %s [-h]\n", progname);
-	fprintf(stderr, "Usage: %s [-a ALGO] [-l LOOP] [-n LOOP] [-r] [-s SIZE]", progname);
+	fprintf(stderr, "Usage: %s [-a ALGO]", progname);
+	fprintf(stderr, " [--batch N [--msg-size S|MIN:MAX]] [--format FMT]");
+	fprintf(stderr, " [--hist] [-l LOOP] [-n LOOP] [--no-baseline]");
+	fprintf(stderr, " [--merkle LEAF [-t N]] [--output FILE] [-r]");
+	fprintf(stderr, " [--reinit] [-s SIZE] [--stream FILE] [--unit N]");
 	fprintf(stderr, " [-v [-v]] [-w SEC]\n");
 	fprintf(stderr, "SHA performance testing tool for OP-TEE\n");
 	fprintf(stderr, "\n");
 	fprintf(stderr, "Options:\n");
-	fprintf(stderr, "  -a ALGO          Algorithm (SHA1, SHA224, SHA256, SHA384, SHA512) [%s]\n", algo_str(algo));
+	fprintf(stderr, "  -a ALGO          Algorithm (SHA1, SHA224, SHA256, SHA384, SHA512, HMAC-SHA1,\n");
+	fprintf(stderr, "                   HMAC-SHA256, HMAC-SHA512, SHA3-224, SHA3-256, SHA3-384,\n");
+	fprintf(stderr, "                   SHA3-512) [%s]\n", algo_str(algo));
+	fprintf(stderr, "  --batch N        Hash N messages per invocation, packed in the buffer\n");
+	fprintf(stderr, "                   with a table of offsets; reports digests/s\n");
+	fprintf(stderr, "  --format FMT     Result format: text, json (one object per line) or csv [text]\n");
 	fprintf(stderr, "  -h|--help Print this help and exit\n");
+	fprintf(stderr, "  --hist           Print the full latency histogram\n");
 	fprintf(stderr, "  -l LOOP          Inner loop iterations (TA calls TEE_DigestDoFinal() <x> times) [%u]\n", l);
+	fprintf(stderr, "  --merkle LEAF    Build a Merkle tree over the SIZE-byte buffer with\n");
+	fprintf(stderr, "                   LEAF-byte leaves using 1..N threads (-t N), one session\n");
+	fprintf(stderr, "                   each; -n sets the builds per thread count [%u]\n", MERKLE_DEF_COUNT);
+	fprintf(stderr, "  --msg-size S|MIN:MAX  Size of the --batch messages in bytes, fixed or\n");
+	fprintf(stderr, "                   spread uniformly over MIN..MAX [64]\n");
 	fprintf(stderr, "  -n LOOP          Outer test loop iterations [%u]\n", n);
+	fprintf(stderr, "  --no-baseline    Do not measure the invocation baseline (null and value-only\n");
+	fprintf(stderr, "                   commands) nor report crypto-only time\n");
+	fprintf(stderr, "  --output FILE    Write json/csv results to FILE instead of stdout\n");
+	fprintf(stderr, "  --reinit         Re-initialize the operation before each message\n");
+	fprintf(stderr, "                   (TEE_ResetOperation(), and for HMAC set the key again)\n");
 	fprintf(stderr, "  -r|--random      Get input data from /dev/urandom (default:  all-zeros)\n");
-	fprintf(stderr, "  -s SIZE          Test buffer size in bytes [%zu]\n", size);
+	fprintf(stderr, "  -s SIZE          Test buffer size in bytes, K/M suffixes allowed [%zu]\n", size);
+	fprintf(stderr, "  -s START:END[:xF]  Size sweep: test START, START*F, ... up to END\n");
+	fprintf(stderr, "                   bytes (F defaults to 2) with a single session, print\n");
+	fprintf(stderr, "                   one row per size and the fixed per-invoke cost\n");
+	fprintf(stderr, "  --stream FILE    Hash FILE in SIZE-byte chunks, one invocation per chunk\n");
+	fprintf(stderr, "                   into a single digest operation, and print the digest\n");
+	fprintf(stderr, "  -t|--threads N   Merkle tree: test 1..N threads [1]\n");
 	fprintf(stderr, "  -u|--unalign     Use unaligned buffer (odd address)\n");
+	fprintf(stderr, "  --unit N         Hash with TEE_DigestUpdate() calls of N bytes and a\n");
+	fprintf(stderr, "                   final on the last chunk (0: single final) [0]\n");
 	fprintf(stderr, "  -v               Be verbose (use twice for greater effect)\n");
 	fprintf(stderr, "  -w|--warmup SEC  Warm-up time in seconds: execute a busy loop before\n");
 	fprintf(stderr, "                   the test to mitigate the effects of cpufreq etc. [%u]\n", warmup);
 }
 
+/* --msg-size S or MIN:MAX */
+static int parse_msg_size(const char *arg)
+{
+	char buf[32] = { };
+	char *sep = NULL;
+
+	if (strlen(arg) >= sizeof(buf))
+		return -1;
+	strcpy(buf, arg);
+	sep = strchr(buf, ':');
+	if (sep)
+		*sep = '\0';
+	if (parse_size(buf, &msg_min))
+		return -1;
+	msg_max = msg_min;
+	if (sep && parse_size(sep + 1, &msg_max))
+		return -1;
+	if (msg_max < msg_min || msg_max > UINT32_MAX)
+		return -1;
+	return 0;
+}
+
 #define NEXT_ARG(i) \
 	do { \
 		if (++i == argc) { \
@@ -416,6 +1026,8 @@ extern int sha_perf_runner_cmd_parser(int argc, char *argv[])
 	/* Start with a 2-second busy loop (-w) */
 	int warmup = CRYPTO_DEF_WARMUP;
 	int offset = 0; /* Buffer offset wrt. alloc'ed address (-u) */
+	int msg_size_set = 0;
+	int n_set = 0;
 
 	/* Parse command line */
 	for (i = 1; i < argc; i++) {
@@ -428,6 +1040,16 @@ extern int sha_perf_runner_cmd_parser(int argc, char *argv[])
 		if (!strcmp(argv[i], "-l")) {
 			NEXT_ARG(i);
 			l = atoi(argv[i]);
+		} else if (!strcmp(argv[i], "--format")) {
+			NEXT_ARG(i);
+			if (perf_output_set_format(argv[i])) {
+				fprintf(stderr, "%s: invalid format\n",
+					argv[0]);
+				usage(argv[0], algo, size, warmup, l, n);
+				return 1;
+			}
+		} else if (!strcmp(argv[i], "--hist")) {
+			dump_hist = 1;
 		} else if (!strcmp(argv[i], "-a")) {
 			NEXT_ARG(i);
 			if (!strcasecmp(argv[i], "SHA1"))
@@ -440,6 +1062,20 @@ extern int sha_perf_runner_cmd_parser(int argc, char *argv[])
 				algo = TA_SHA_SHA384;
 			else if (!strcasecmp(argv[i], "SHA512"))
 				algo = TA_SHA_SHA512;
+			else if (!strcasecmp(argv[i], "HMAC-SHA1"))
+				algo = TA_SHA_HMAC_SHA1;
+			else if (!strcasecmp(argv[i], "HMAC-SHA256"))
+				algo = TA_SHA_HMAC_SHA256;
+			else if (!strcasecmp(argv[i], "HMAC-SHA512"))
+				algo = TA_SHA_HMAC_SHA512;
+			else if (!strcasecmp(argv[i], "SHA3-224"))
+				algo = TA_SHA_SHA3_224;
+			else if (!strcasecmp(argv[i], "SHA3-256"))
+				algo = TA_SHA_SHA3_256;
+			else if (!strcasecmp(argv[i], "SHA3-384"))
+				algo = TA_SHA_SHA3_384;
+			else if (!strcasecmp(argv[i], "SHA3-512"))
+				algo = TA_SHA_SHA3_512;
 			else {
 				fprintf(stderr, "%s, invalid algorithm\n",
 					argv[0]);
@@ -449,12 +1085,81 @@ extern int sha_perf_runner_cmd_parser(int argc, char *argv[])
 		} else if (!strcmp(argv[i], "-n")) {
 			NEXT_ARG(i);
 			n = atoi(argv[i]);
+			n_set = 1;
+		} else if (!strcmp(argv[i], "--merkle")) {
+			NEXT_ARG(i);
+			if (parse_size(argv[i], &merkle_leaf) || !merkle_leaf ||
+			    merkle_leaf > UINT32_MAX) {
+				fprintf(stderr, "%s: invalid leaf size\n",
+					argv[0]);
+				usage(argv[0], algo, size, warmup, l, n);
+				return 1;
+			}
+		} else if (!strcmp(argv[i], "--threads") ||
+			   !strcmp(argv[i], "-t")) {
+			NEXT_ARG(i);
+			num_threads = atoi(argv[i]);
+			if (!num_threads) {
+				fprintf(stderr, "%s: invalid thread count\n",
+					argv[0]);
+				usage(argv[0], algo, size, warmup, l, n);
+				return 1;
+			}
+		} else if (!strcmp(argv[i], "--no-baseline")) {
+			no_baseline = 1;
+		} else if (!strcmp(argv[i], "--output")) {
+			NEXT_ARG(i);
+			if (perf_output_set_file(argv[i]))
+				return 1;
+		} else if (!strcmp(argv[i], "--batch")) {
+			NEXT_ARG(i);
+			batch = atoi(argv[i]);
+			if (!batch) {
+				fprintf(stderr, "%s: invalid batch size\n",
+					argv[0]);
+				usage(argv[0], algo, size, warmup, l, n);
+				return 1;
+			}
+		} else if (!strcmp(argv[i], "--msg-size")) {
+			NEXT_ARG(i);
+			if (parse_msg_size(argv[i])) {
+				fprintf(stderr, "%s: invalid message size\n",
+					argv[0]);
+				usage(argv[0], algo, size, warmup, l, n);
+				return 1;
+			}
+			msg_size_set = 1;
+		} else if (!strcmp(argv[i], "--reinit")) {
+			reinit = 1;
 		} else if (!strcmp(argv[i], "--random") ||
 			   !strcmp(argv[i], "-r")) {
 			random_in = CRYPTO_USE_RANDOM;
 		} else if (!strcmp(argv[i], "-s")) {
 			NEXT_ARG(i);
-			size = atoi(argv[i]);
+			if (strchr(argv[i], ':')) {
+				if (parse_size_sweep(argv[i], &sweep)) {
+					fprintf(stderr, "%s: invalid size sweep\n",
+						argv[0]);
+					usage(argv[0], algo, size, warmup, l, n);
+					return 1;
+				}
+				size = size_sweep_get(&sweep,
+					size_sweep_count(&sweep) - 1);
+			} else if (parse_size(argv[i], &size)) {
+				fprintf(stderr, "%s: invalid size\n", argv[0]);
+				usage(argv[0], algo, size, warmup, l, n);
+				return 1;
+			}
+		} else if (!strcmp(argv[i], "--stream")) {
+			NEXT_ARG(i);
+			stream_file = argv[i];
+		} else if (!strcmp(argv[i], "--unit")) {
+			NEXT_ARG(i);
+			if (parse_size(argv[i], &unit) || unit > UINT32_MAX) {
+				fprintf(stderr, "%s: invalid unit\n", argv[0]);
+				usage(argv[0], algo, size, warmup, l, n);
+				return 1;
+			}
 		} else if (!strcmp(argv[i], "--unalign") ||
 			   !strcmp(argv[i], "-u")) {
 			offset = 1;
@@ -472,6 +1177,47 @@ extern int sha_perf_runner_cmd_parser(int argc, char *argv[])
 		}
 	}
 
+	if (merkle_leaf && (stream_file || batch || unit || sweep.factor ||
+			    offset)) {
+		fprintf(stderr, "--merkle is not supported with --stream, --batch, --unit, -u or a size sweep\n\n");
+		usage(argv[0], algo, size, warmup, l, n);
+		return 1;
+	}
+
+	if (num_threads > 1 && !merkle_leaf) {
+		fprintf(stderr, "--threads needs --merkle\n\n");
+		usage(argv[0], algo, size, warmup, l, n);
+		return 1;
+	}
+
+	/* A tree build is much longer than a single invocation */
+	if (merkle_leaf && !n_set)
+		n = MERKLE_DEF_COUNT;
+
+	if (msg_size_set && !batch) {
+		fprintf(stderr, "--msg-size needs --batch\n\n");
+		usage(argv[0], algo, size, warmup, l, n);
+		return 1;
+	}
+
+	if (batch && (stream_file || unit || sweep.factor)) {
+		fprintf(stderr, "--batch is not supported with --stream, --unit or a size sweep\n\n");
+		usage(argv[0], algo, size, warmup, l, n);
+		return 1;
+	}
+
+	if (batch && (uint64_t)msg_max * batch > UINT32_MAX) {
+		fprintf(stderr, "--batch: total buffer size is too large\n\n");
+		usage(argv[0], algo, size, warmup, l, n);
+		return 1;
+	}
+
+	if (stream_file && sweep.factor) {
+		fprintf(stderr, "--stream is not supported with a size sweep\n\n");
+		usage(argv[0], algo, size, warmup, l, n);
+		return 1;
+	}
+
 	sha_perf_run_test(algo, size, n, l, random_in, offset, warmup, verbosity);
 
 	return 0;
@@ -33,6 +33,7 @@
 /* include here shandalone tests */
 #include "crypto_common.h"
 #include "install_ta.h"
+#include "perf_output.h"
 #include "stats.h"
 
 
@@ -69,10 +70,15 @@ void usage(char *program)
 	printf("\t                   To run several suites, use multiple names\n");
 	printf("\t                   separated by a '+')\n");
 	printf("\t                   Default value: '%s'\n", gsuitename);
+	printf("\t-f <format>        Benchmark result format: text, json or csv.\n");
+	printf("\t                   Default: text\n");
+	printf("\t-o <file>          Write json/csv benchmark results to <file>\n");
+	printf("\t                   instead of stdout\n");
 	printf("\t-h                 Show usage\n");
 	printf("applets:\n");
 	printf("\t--sha-perf [opts]  SHA performance testing tool (-h for usage)\n");
 	printf("\t--aes-perf [opts]  AES performance testing tool (-h for usage)\n");
+	printf("\t--crypto-perf [opts] Generic crypto performance testing tool (-h for usage)\n");
 #ifdef CFG_SECSTOR_TA_MGMT_PTA
 	printf("\t--install-ta [directory or list of TAs]\n");
 	printf("\t                   Install TAs\n");
@@ -119,6 +125,8 @@ int main(int argc, char *argv[])
 		return sha_perf_runner_cmd_parser(argc-1, &argv[1]);
 	else if (argc > 1 && !strcmp(argv[1], "--aes-perf"))
 		return aes_perf_runner_cmd_parser(argc-1, &argv[1]);
+	else if (argc > 1 && !strcmp(argv[1], "--crypto-perf"))
+		return crypto_perf_runner_cmd_parser(argc - 1, &argv[1]);
 #ifdef CFG_SECSTOR_TA_MGMT_PTA
 	else if (argc > 1 && !strcmp(argv[1], "--install-ta"))
 		return install_ta_runner_cmd_parser(argc - 1, argv + 1);
@@ -130,14 +138,24 @@ int main(int argc, char *argv[])
 	else if (argc > 1 && !strcmp(argv[1], "--stats"))
 		return stats_runner_cmd_parser(argc - 1, &argv[1]);
 
-	while ((opt = getopt(argc, argv, "d:l:t:h")) != -1)
+	while ((opt = getopt(argc, argv, "d:f:l:o:t:h")) != -1)
 		switch (opt) {
 		case 'd':
 			_device = optarg;
 			break;
+		case 'f':
+			if (perf_output_set_format(optarg)) {
+				usage(argv[0]);
+				return -1;
+			}
+			break;
 		case 'l':
 			p = optarg;
 			break;
+		case 'o':
+			if (perf_output_set_file(optarg))
+				return -1;
+			break;
 		case 't':
 			test_suite = optarg;
 			break;
@@ -28,6 +28,8 @@
 #ifndef TA_AES_PERF_H
 #define TA_AES_PERF_H
 
+#include <stdint.h>
+
 #define TA_AES_PERF_UUID { 0xe626662e, 0xc0e2, 0x485c, \
 	{ 0xb8, 0xc8, 0x09, 0xfb, 0xce, 0x6e, 0xdf, 0x3d } }
 
@@ -35,9 +37,66 @@
  * Commands implemented by the TA
  */
 
+/*
+ * PREPARE_KEY
+ * [in] value[0].a: decrypt if non-zero, value[0].b: key size in bits
+ * [in] value[1].a: mode of operation (TA_AES_*)
+ * [in] value[2] (optional): .a: AAD length in bytes for the AE modes (up to
+ * TA_AES_PERF_MAX_AAD), .b: TA_AES_PERF_FLAG_* flags
+ */
 #define TA_AES_PERF_CMD_PREPARE_KEY	0
+/*
+ * PROCESS and PROCESS_SDP accept an optional value[3] output. When present,
+ * value[3].a returns the time spent in the processing loop in microseconds
+ * and value[3].b the resolution of that measurement in microseconds.
+ */
 #define TA_AES_PERF_CMD_PROCESS		1
 #define TA_AES_PERF_CMD_PROCESS_SDP	2
+/*
+ * Process several segments of the in/out buffers in one invocation
+ * [in/out] memref[0]: input buffer
+ * [in/out] memref[1]: output buffer (may be the same as the input buffer)
+ * [in]     memref[2]: array of struct ta_aes_perf_batch_desc
+ * [in]     value[3].a: inner loops, the whole table is processed a times
+ */
+#define TA_AES_PERF_CMD_PROCESS_BATCH	3
+/*
+ * Invocation baseline: NULL takes no parameter and does nothing, VALUE
+ * copies value[0] (in) to value[1] (out). Used to measure the cost of the
+ * TA invocation path alone.
+ */
+#define TA_AES_PERF_CMD_NULL		4
+#define TA_AES_PERF_CMD_VALUE		5
+/*
+ * Key agility
+ * PREPARE_KEY_POOL: [in] value[0].a: number of keys (1..TA_AES_PERF_MAX_KEYS)
+ * derived from the PREPARE_KEY key, for the current mode and key size.
+ * REKEY: [in] value[0].a: count, [out] value[1].a: elapsed time in
+ * microseconds, value[1].b: its resolution. Switches the operation to the
+ * next key of the pool (TEE_ResetOperation(), TEE_SetOperationKey() and
+ * TEE_CipherInit()/TEE_AEInit()) count times.
+ * PROCESS also rekeys every value[3].a bytes when value[3] is passed as
+ * inout instead of output.
+ */
+#define TA_AES_PERF_CMD_PREPARE_KEY_POOL	6
+#define TA_AES_PERF_CMD_REKEY			7
+/*
+ * Compute the tags needed to decrypt the content of memref[0] in per-message
+ * AE mode, one per message of value[1].a bytes (0: the whole buffer).
+ * PROCESS fails with TEE_ERROR_BAD_STATE when decrypting without them.
+ */
+#define TA_AES_PERF_CMD_PREPARE_TAGS		8
+
+#define TA_AES_PERF_MAX_KEYS	64
+#define TA_AES_PERF_MAX_AAD	256
+
+/*
+ * Process each unit of the buffer as a complete message: GCM is
+ * re-initialized with the AAD for every unit and finalized, computing the
+ * tag on encryption and checking it on decryption. CCM, CTS and CMAC are
+ * always processed this way.
+ */
+#define TA_AES_PERF_FLAG_AE_PER_MESSAGE	(1 << 0)
 
 /*
  * Supported AES modes of operation
@@ -48,6 +107,9 @@
 #define TA_AES_CTR	2
 #define TA_AES_XTS	3
 #define TA_AES_GCM	4
+#define TA_AES_CCM	5
+#define TA_AES_CTS	6
+#define TA_AES_CMAC	7
 
 /*
  * AES key sizes
@@ -56,4 +118,21 @@
 #define AES_192	192
 #define AES_256	256
 
+/*
+ * Segment descriptor for TA_AES_PERF_CMD_PROCESS_BATCH. The segment at
+ * [offset, offset + len) of the input buffer is processed into the same
+ * range of the output buffer. When TA_AES_PERF_BATCH_IV is set the operation
+ * is re-initialized with @iv first, so that each segment is an independent
+ * message; otherwise it continues the stream of the previous segment.
+ */
+#define TA_AES_PERF_BATCH_IV	(1 << 0)
+
+struct ta_aes_perf_batch_desc {
+	uint32_t offset;
+	uint32_t len;
+	uint32_t flags;
+	uint32_t reserved;
+	uint8_t iv[16];
+};
+
 #endif /* TA_AES_PERF_H */
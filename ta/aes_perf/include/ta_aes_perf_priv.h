@@ -32,6 +32,11 @@
 
 TEE_Result cmd_prepare_key(uint32_t param_types, TEE_Param params[4]);
 TEE_Result cmd_process(uint32_t param_types, TEE_Param params[4], bool sdp);
+TEE_Result cmd_process_batch(uint32_t param_types, TEE_Param params[4]);
+TEE_Result cmd_value(uint32_t param_types, TEE_Param params[4]);
+TEE_Result cmd_prepare_key_pool(uint32_t param_types, TEE_Param params[4]);
+TEE_Result cmd_rekey(uint32_t param_types, TEE_Param params[4]);
+TEE_Result cmd_prepare_tags(uint32_t param_types, TEE_Param params[4]);
 void cmd_clean_res(void);
 
 #endif /* TA_EAS_PERF_PRIV_H */
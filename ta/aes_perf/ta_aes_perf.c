@@ -42,6 +42,9 @@
 	} while(0)
 
 #define TAG_LEN	128
+#define GCM_NONCE_LEN	12
+/* 4 bytes left for the CCM length field: messages up to 4 GiB */
+#define CCM_NONCE_LEN	11
 
 static uint8_t iv[] = { 0xA0, 0xA1, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7,
 			0xA8, 0xA9, 0xAA, 0xAB, 0xAC, 0xAD, 0xAE, 0xAF };
@@ -49,6 +52,47 @@ static int use_iv;
 
 static TEE_OperationHandle crypto_op = NULL;
 static uint32_t algo;
+static uint32_t key_bits;
+
+/* Per-message processing, see TA_AES_PERF_FLAG_AE_PER_MESSAGE */
+static bool per_message;
+static uint8_t aad[TA_AES_PERF_MAX_AAD];
+static uint32_t aad_len;
+
+/*
+ * Per-message AE decryption checks the tags computed by PREPARE_TAGS with
+ * tag_op, an encryption operation using the same key as crypto_op.
+ */
+static TEE_OperationHandle tag_op;
+static uint8_t *tags;
+static uint32_t tags_count;
+
+static uint8_t aes_key[] = { 0x00, 0x01, 0x02, 0x03,
+			     0x04, 0x05, 0x06, 0x07,
+			     0x08, 0x09, 0x0A, 0x0B,
+			     0x0C, 0x0D, 0x0E, 0x0F,
+			     0x10, 0x11, 0x12, 0x13,
+			     0x14, 0x15, 0x16, 0x17,
+			     0x18, 0x19, 0x1A, 0x1B,
+			     0x1C, 0x1D, 0x1E, 0x1F };
+static uint8_t aes_key2[] = { 0x20, 0x21, 0x22, 0x23,
+			      0x24, 0x25, 0x26, 0x27,
+			      0x28, 0x29, 0x2A, 0x2B,
+			      0x2C, 0x2D, 0x2E, 0x2F,
+			      0x30, 0x31, 0x32, 0x33,
+			      0x34, 0x35, 0x36, 0x37,
+			      0x38, 0x39, 0x3A, 0x3B,
+			      0x3C, 0x3D, 0x3E, 0x3F };
+
+/*
+ * Key pool for the key agility tests: the operation key is replaced by the
+ * next key of the pool at each rekey.
+ */
+static TEE_ObjectHandle key_pool[TA_AES_PERF_MAX_KEYS];
+static TEE_ObjectHandle key2_pool[TA_AES_PERF_MAX_KEYS];
+static uint32_t pool_size;
+static uint32_t pool_next;
+static uint32_t bytes_since_rekey;
 
 static bool is_inbuf_a_secure_memref(TEE_Param *param)
 {
@@ -101,14 +145,129 @@ static __maybe_unused TEE_Result flush_memref_buffer(TEE_Param *param __unused)
 }
 #endif /* CFG_CACHE_API */
 
+/* Elapsed secure time in microseconds, 1 ms resolution */
+static uint32_t elapsed_us(TEE_Time *t0, TEE_Time *t1)
+{
+	return (t1->seconds - t0->seconds) * 1000000 +
+	       (t1->millis - t0->millis) * 1000;
+}
+
+static TEE_Result reinit_op(const uint8_t *ivp);
+
+/* Switch the operation to the next key of the pool and restart it */
+static TEE_Result rekey(void)
+{
+	TEE_Result res;
+	uint32_t k = pool_next;
+
+	pool_next = (pool_next + 1) % pool_size;
+
+	TEE_ResetOperation(crypto_op);
+	if (algo == TEE_ALG_AES_XTS)
+		res = TEE_SetOperationKey2(crypto_op, key_pool[k],
+					   key2_pool[k]);
+	else
+		res = TEE_SetOperationKey(crypto_op, key_pool[k]);
+	CHECK(res, "TEE_SetOperationKey", return res;);
+
+	if (tag_op) {
+		TEE_ResetOperation(tag_op);
+		res = TEE_SetOperationKey(tag_op, key_pool[k]);
+		CHECK(res, "TEE_SetOperationKey", return res;);
+	}
+
+	return reinit_op(iv);
+}
+
+/* Rekey first if @rekey_bytes have been processed since the last rekey */
+static TEE_Result account_rekey(uint32_t rekey_bytes, uint32_t len)
+{
+	TEE_Result res;
+
+	if (!rekey_bytes)
+		return TEE_SUCCESS;
+
+	if (bytes_since_rekey >= rekey_bytes) {
+		res = rekey();
+		if (res != TEE_SUCCESS)
+			return res;
+		bytes_since_rekey = 0;
+	}
+	bytes_since_rekey += len;
+	return TEE_SUCCESS;
+}
+
+/* Start a GCM or CCM message of @len bytes and feed it the AAD */
+static TEE_Result ae_init_message(TEE_OperationHandle op, const uint8_t *ivp,
+				  uint32_t len)
+{
+	TEE_Result res;
+	uint32_t nonce_len = GCM_NONCE_LEN;
+
+	if (algo == TEE_ALG_AES_CCM)
+		nonce_len = CCM_NONCE_LEN;
+
+	res = TEE_AEInit(op, ivp, nonce_len, TAG_LEN, aad_len, len);
+	if (res != TEE_SUCCESS)
+		return res;
+	if (aad_len)
+		TEE_AEUpdateAAD(op, aad, aad_len);
+	return TEE_SUCCESS;
+}
+
+/* Process message @idx of the buffer from init to final */
+static TEE_Result process_message(const uint8_t *ivp, const void *in,
+				  uint32_t len, void *out, uint32_t outsz,
+				  uint32_t idx)
+{
+	TEE_Result res;
+	uint8_t tag[TAG_LEN / 8];
+	uint32_t tag_len = sizeof(tag);
+
+	switch (algo) {
+	case TEE_ALG_AES_GCM:
+	case TEE_ALG_AES_CCM:
+		res = ae_init_message(crypto_op, ivp, len);
+		CHECK(res, "TEE_AEInit", return res;);
+		if (tag_op) {
+			if (idx >= tags_count)
+				return TEE_ERROR_BAD_STATE;
+			return TEE_AEDecryptFinal(crypto_op, in, len, out,
+						  &outsz, tags + idx * sizeof(tag),
+						  sizeof(tag));
+		}
+		return TEE_AEEncryptFinal(crypto_op, in, len, out, &outsz,
+					  tag, &tag_len);
+	case TEE_ALG_AES_CTS:
+		TEE_CipherInit(crypto_op, ivp, sizeof(iv));
+		return TEE_CipherDoFinal(crypto_op, in, len, out, &outsz);
+	case TEE_ALG_AES_CMAC:
+		/* Nothing is written to the output buffer */
+		TEE_MACInit(crypto_op, NULL, 0);
+		return TEE_MACComputeFinal(crypto_op, in, len, tag, &tag_len);
+	default:
+		return TEE_ERROR_BAD_STATE;
+	}
+}
+
+static TEE_Result process_unit(const void *in, uint32_t len, void *out,
+			       uint32_t *outsz, uint32_t idx)
+{
+	if (per_message)
+		return process_message(iv, in, len, out, *outsz, idx);
+	if (algo == TEE_ALG_AES_GCM)
+		return TEE_AEUpdate(crypto_op, in, len, out, outsz);
+	return TEE_CipherUpdate(crypto_op, in, len, out, outsz);
+}
+
 TEE_Result cmd_process(uint32_t param_types,
 		       TEE_Param params[TEE_NUM_PARAMS],
 		       bool use_sdp)
 {
 	TEE_Result res;
 	int n;
-	int unit;
-	void *in, *out;
+	uint32_t unit;
+	uint8_t *in, *out;
 	uint32_t insz;
 	uint32_t outsz;
 	uint32_t exp_param_types = TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INOUT,
@@ -117,11 +276,28 @@ TEE_Result cmd_process(uint32_t param_types,
 						   TEE_PARAM_TYPE_NONE);
 	bool secure_in;
 	bool secure_out = false;
-	TEE_Result (*do_update)(TEE_OperationHandle, const void *, uint32_t,
-				void *, uint32_t *);
+	bool timed = false;
+	uint32_t rekey_bytes = 0;
+	TEE_Time t0, t1;
 
-	if (param_types != exp_param_types)
+	/*
+	 * Optional value[3] output: time spent in the processing loop.
+	 * As inout, value[3].a also sets the rekey interval in bytes.
+	 */
+	if (param_types == (exp_param_types |
+			    TEE_PARAM_TYPES(0, 0, 0,
+					    TEE_PARAM_TYPE_VALUE_OUTPUT))) {
+		timed = true;
+	} else if (param_types == (exp_param_types |
+				   TEE_PARAM_TYPES(0, 0, 0,
+						TEE_PARAM_TYPE_VALUE_INOUT))) {
+		timed = true;
+		rekey_bytes = params[3].value.a;
+		if (rekey_bytes && !pool_size)
+			return TEE_ERROR_BAD_STATE;
+	} else if (param_types != exp_param_types) {
 		return TEE_ERROR_BAD_PARAMETERS;
+	}
 
 	if (use_sdp) {
 		/*
@@ -159,25 +335,29 @@ TEE_Result cmd_process(uint32_t param_types,
 	if (!unit)
 		unit = insz;
 
-	if (algo == TEE_ALG_AES_GCM)
-		do_update = TEE_AEUpdate;
-	else
-		do_update = TEE_CipherUpdate;
+	if (timed)
+		TEE_GetSystemTime(&t0);
 
 	while (n--) {
-		uint32_t i;
-		for (i = 0; i < insz / unit; i++) {
-			res = do_update(crypto_op, in, unit, out, &outsz);
-			CHECK(res, "TEE_CipherUpdate/TEE_AEUpdate", return res;);
-			in  = (void *)((uintptr_t)in + unit);
-			out = (void *)((uintptr_t)out + unit);
-		}
-		if (insz % unit) {
-			res = do_update(crypto_op, in, insz % unit, out, &outsz);
-			CHECK(res, "TEE_CipherUpdate/TEE_AEUpdate", return res;);
+		uint32_t off;
+		uint32_t len;
+
+		for (off = 0; off < insz; off += len) {
+			len = insz - off < unit ? insz - off : unit;
+			res = account_rekey(rekey_bytes, len);
+			CHECK(res, "rekey", return res;);
+			res = process_unit(in + off, len, out + off, &outsz,
+					   off / unit);
+			CHECK(res, "process_unit", return res;);
 		}
 	}
 
+	if (timed) {
+		TEE_GetSystemTime(&t1);
+		params[3].value.a = elapsed_us(&t0, &t1);
+		params[3].value.b = 1000;
+	}
+
 	if (secure_out) {
 		/* intentionally flush output data from cache for SDP buffers */
 		res = flush_memref_buffer(&params[1]);
@@ -187,6 +367,98 @@ TEE_Result cmd_process(uint32_t param_types,
 	return TEE_SUCCESS;
 }
 
+static TEE_Result reinit_op(const uint8_t *ivp)
+{
+	size_t ivlen = use_iv ? sizeof(iv) : 0;
+
+	if (!use_iv)
+		ivp = NULL;
+
+	switch (algo) {
+	case TEE_ALG_AES_GCM:
+		/* Per-message GCM is initialized for each message */
+		if (per_message)
+			return TEE_SUCCESS;
+		return TEE_AEInit(crypto_op, ivp, ivlen, TAG_LEN, 0, 0);
+	case TEE_ALG_AES_CCM:
+		/* CCM needs the payload length, it is initialized per message */
+		return TEE_SUCCESS;
+	case TEE_ALG_AES_CMAC:
+		TEE_MACInit(crypto_op, NULL, 0);
+		return TEE_SUCCESS;
+	default:
+		TEE_CipherInit(crypto_op, ivp, ivlen);
+		return TEE_SUCCESS;
+	}
+}
+
+TEE_Result cmd_process_batch(uint32_t param_types,
+			     TEE_Param params[TEE_NUM_PARAMS])
+{
+	TEE_Result res;
+	const struct ta_aes_perf_batch_desc *table;
+	struct ta_aes_perf_batch_desc d;
+	const uint8_t *ivp;
+	uint8_t *in, *out;
+	uint32_t insz, outsz, sz;
+	size_t count, i;
+	int n;
+	uint32_t exp_param_types = TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INOUT,
+						   TEE_PARAM_TYPE_MEMREF_INOUT,
+						   TEE_PARAM_TYPE_MEMREF_INPUT,
+						   TEE_PARAM_TYPE_VALUE_INPUT);
+
+	if (param_types != exp_param_types)
+		return TEE_ERROR_BAD_PARAMETERS;
+	/* Tags are prepared for the messages of PROCESS only */
+	if (tag_op)
+		return TEE_ERROR_NOT_SUPPORTED;
+
+	in = params[0].memref.buffer;
+	insz = params[0].memref.size;
+	out = params[1].memref.buffer;
+	outsz = params[1].memref.size;
+	table = params[2].memref.buffer;
+	count = params[2].memref.size / sizeof(*table);
+	n = params[3].value.a;
+
+	if (!count || params[2].memref.size % sizeof(*table))
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	while (n--) {
+		for (i = 0; i < count; i++) {
+			/* Shared memory: copy before checking */
+			memcpy(&d, table + i, sizeof(d));
+			if (d.offset > insz || d.len > insz - d.offset ||
+			    d.offset > outsz || d.len > outsz - d.offset)
+				return TEE_ERROR_BAD_PARAMETERS;
+
+			ivp = iv;
+			if (d.flags & TA_AES_PERF_BATCH_IV)
+				ivp = d.iv;
+
+			sz = outsz - d.offset;
+			if (per_message) {
+				res = process_message(ivp, in + d.offset, d.len,
+						      out + d.offset, sz, i);
+				CHECK(res, "process_message", return res;);
+				continue;
+			}
+
+			if (d.flags & TA_AES_PERF_BATCH_IV) {
+				res = reinit_op(ivp);
+				CHECK(res, "reinit_op", return res;);
+			}
+
+			res = process_unit(in + d.offset, d.len,
+					   out + d.offset, &sz, i);
+			CHECK(res, "process_unit", return res;);
+		}
+	}
+
+	return TEE_SUCCESS;
+}
+
 TEE_Result cmd_prepare_key(uint32_t param_types, TEE_Param params[4])
 {
 	TEE_Result res;
@@ -196,35 +468,29 @@ TEE_Result cmd_prepare_key(uint32_t param_types, TEE_Param params[4])
 	uint32_t mode;
 	uint32_t op_keysize;
 	uint32_t keysize;
-	const uint8_t *ivp;
-	size_t ivlen;
-	static uint8_t aes_key[] = { 0x00, 0x01, 0x02, 0x03,
-				     0x04, 0x05, 0x06, 0x07,
-				     0x08, 0x09, 0x0A, 0x0B,
-				     0x0C, 0x0D, 0x0E, 0x0F,
-				     0x10, 0x11, 0x12, 0x13,
-				     0x14, 0x15, 0x16, 0x17,
-				     0x18, 0x19, 0x1A, 0x1B,
-				     0x1C, 0x1D, 0x1E, 0x1F };
-	static uint8_t aes_key2[] = { 0x20, 0x21, 0x22, 0x23,
-				      0x24, 0x25, 0x26, 0x27,
-				      0x28, 0x29, 0x2A, 0x2B,
-				      0x2C, 0x2D, 0x2E, 0x2F,
-				      0x30, 0x31, 0x32, 0x33,
-				      0x34, 0x35, 0x36, 0x37,
-				      0x38, 0x39, 0x3A, 0x3B,
-				      0x3C, 0x3D, 0x3E, 0x3F };
-
+	uint32_t flags = 0;
 	uint32_t exp_param_types = TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
 						   TEE_PARAM_TYPE_VALUE_INPUT,
 						   TEE_PARAM_TYPE_NONE,
 						   TEE_PARAM_TYPE_NONE);
-	if (param_types != exp_param_types)
+
+	aad_len = 0;
+	if (param_types == (exp_param_types |
+			    TEE_PARAM_TYPES(0, 0, TEE_PARAM_TYPE_VALUE_INPUT,
+					    0))) {
+		if (params[2].value.a > TA_AES_PERF_MAX_AAD)
+			return TEE_ERROR_BAD_PARAMETERS;
+		aad_len = params[2].value.a;
+		flags = params[2].value.b;
+	} else if (param_types != exp_param_types) {
 		return TEE_ERROR_BAD_PARAMETERS;
+	}
 
 	mode = params[0].value.a ? TEE_MODE_DECRYPT : TEE_MODE_ENCRYPT;
 	keysize = params[0].value.b;
+	key_bits = keysize;
 	op_keysize = keysize;
+	per_message = false;
 
 	switch (params[1].value.a) {
 	case TA_AES_ECB:
@@ -247,6 +513,25 @@ TEE_Result cmd_prepare_key(uint32_t param_types, TEE_Param params[4])
 	case TA_AES_GCM:
 		algo = TEE_ALG_AES_GCM;
 		use_iv = 1;
+		per_message = flags & TA_AES_PERF_FLAG_AE_PER_MESSAGE;
+		break;
+	case TA_AES_CCM:
+		algo = TEE_ALG_AES_CCM;
+		use_iv = 1;
+		per_message = true;
+		break;
+	case TA_AES_CTS:
+		algo = TEE_ALG_AES_CTS;
+		use_iv = 1;
+		per_message = true;
+		break;
+	case TA_AES_CMAC:
+		if (mode == TEE_MODE_DECRYPT)
+			return TEE_ERROR_BAD_PARAMETERS;
+		algo = TEE_ALG_AES_CMAC;
+		mode = TEE_MODE_MAC;
+		use_iv = 0;
+		per_message = true;
 		break;
 	default:
 		return TEE_ERROR_BAD_PARAMETERS;
@@ -286,26 +571,223 @@ TEE_Result cmd_prepare_key(uint32_t param_types, TEE_Param params[4])
 		CHECK(res, "TEE_SetOperationKey", return res;);
 	}
 
+	if (per_message && mode == TEE_MODE_DECRYPT &&
+	    (algo == TEE_ALG_AES_GCM || algo == TEE_ALG_AES_CCM)) {
+		res = TEE_AllocateOperation(&tag_op, algo, TEE_MODE_ENCRYPT,
+					    op_keysize);
+		CHECK(res, "TEE_AllocateOperation", return res;);
+
+		res = TEE_SetOperationKey(tag_op, hkey);
+		CHECK(res, "TEE_SetOperationKey", return res;);
+	}
+
 	TEE_FreeTransientObject(hkey);
 
-	if (use_iv) {
-		ivp = iv;
-		ivlen = sizeof(iv);
-	} else {
-		ivp = NULL;
-		ivlen = 0;
+	return reinit_op(iv);
+}
+
+TEE_Result cmd_value(uint32_t param_types, TEE_Param params[4])
+{
+	uint32_t exp_param_types = TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
+						   TEE_PARAM_TYPE_VALUE_OUTPUT,
+						   TEE_PARAM_TYPE_NONE,
+						   TEE_PARAM_TYPE_NONE);
+
+	if (param_types != exp_param_types)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	params[1].value.a = params[0].value.a;
+	params[1].value.b = params[0].value.b;
+	return TEE_SUCCESS;
+}
+
+static void free_key_pool(void)
+{
+	uint32_t i;
+
+	for (i = 0; i < pool_size; i++) {
+		TEE_FreeTransientObject(key_pool[i]);
+		TEE_FreeTransientObject(key2_pool[i]);
+		key_pool[i] = TEE_HANDLE_NULL;
+		key2_pool[i] = TEE_HANDLE_NULL;
 	}
+	pool_size = 0;
+	pool_next = 0;
+	bytes_since_rekey = 0;
+}
 
-	if (algo == TEE_ALG_AES_GCM) {
-		return TEE_AEInit(crypto_op, ivp, ivlen, TAG_LEN, 0, 0);
-	} else {
-		TEE_CipherInit(crypto_op, ivp, ivlen);
-		return TEE_SUCCESS;
+static TEE_Result alloc_pool_key(uint8_t *ref, uint32_t idx,
+				 TEE_ObjectHandle *key)
+{
+	TEE_Result res;
+	TEE_Attribute attr;
+	uint8_t buf[32];
+
+	/* Derive a distinct key per pool entry */
+	memcpy(buf, ref, sizeof(buf));
+	buf[0] ^= idx;
+	buf[1] ^= idx >> 8;
+
+	res = TEE_AllocateTransientObject(TEE_TYPE_AES, key_bits, key);
+	CHECK(res, "TEE_AllocateTransientObject", return res;);
+
+	TEE_InitRefAttribute(&attr, TEE_ATTR_SECRET_VALUE, buf, key_bits / 8);
+	res = TEE_PopulateTransientObject(*key, &attr, 1);
+	CHECK(res, "TEE_PopulateTransientObject", return res;);
+
+	return TEE_SUCCESS;
+}
+
+TEE_Result cmd_prepare_key_pool(uint32_t param_types, TEE_Param params[4])
+{
+	TEE_Result res;
+	uint32_t n;
+	uint32_t i;
+	uint32_t exp_param_types = TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
+						   TEE_PARAM_TYPE_NONE,
+						   TEE_PARAM_TYPE_NONE,
+						   TEE_PARAM_TYPE_NONE);
+
+	if (param_types != exp_param_types)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	n = params[0].value.a;
+	if (!n || n > TA_AES_PERF_MAX_KEYS)
+		return TEE_ERROR_BAD_PARAMETERS;
+	if (!crypto_op)
+		return TEE_ERROR_BAD_STATE;
+
+	free_key_pool();
+	for (i = 0; i < n; i++) {
+		pool_size = i + 1;
+		res = alloc_pool_key(aes_key, i, key_pool + i);
+		if (res != TEE_SUCCESS)
+			goto err;
+		if (algo == TEE_ALG_AES_XTS) {
+			res = alloc_pool_key(aes_key2, i, key2_pool + i);
+			if (res != TEE_SUCCESS)
+				goto err;
+		}
+	}
+	return TEE_SUCCESS;
+err:
+	free_key_pool();
+	return res;
+}
+
+TEE_Result cmd_rekey(uint32_t param_types, TEE_Param params[4])
+{
+	TEE_Result res;
+	TEE_Time t0, t1;
+	uint32_t n;
+	uint32_t exp_param_types = TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
+						   TEE_PARAM_TYPE_VALUE_OUTPUT,
+						   TEE_PARAM_TYPE_NONE,
+						   TEE_PARAM_TYPE_NONE);
+
+	if (param_types != exp_param_types)
+		return TEE_ERROR_BAD_PARAMETERS;
+	if (!pool_size)
+		return TEE_ERROR_BAD_STATE;
+
+	n = params[0].value.a;
+	TEE_GetSystemTime(&t0);
+	while (n--) {
+		res = rekey();
+		if (res != TEE_SUCCESS)
+			return res;
 	}
+	TEE_GetSystemTime(&t1);
+	bytes_since_rekey = 0;
+
+	params[1].value.a = elapsed_us(&t0, &t1);
+	params[1].value.b = 1000;
+	return TEE_SUCCESS;
+}
+
+TEE_Result cmd_prepare_tags(uint32_t param_types, TEE_Param params[4])
+{
+	TEE_Result res = TEE_SUCCESS;
+	const uint8_t *in;
+	uint8_t *pt, *ct;
+	uint8_t tag[TAG_LEN / 8];
+	uint32_t tag_len;
+	uint32_t insz, unit, off, len, sz, count, i;
+	uint32_t exp_param_types = TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT,
+						   TEE_PARAM_TYPE_VALUE_INPUT,
+						   TEE_PARAM_TYPE_NONE,
+						   TEE_PARAM_TYPE_NONE);
+
+	if (param_types != exp_param_types)
+		return TEE_ERROR_BAD_PARAMETERS;
+	if (!tag_op)
+		return TEE_ERROR_BAD_STATE;
+
+	in = params[0].memref.buffer;
+	insz = params[0].memref.size;
+	unit = params[1].value.a;
+	if (!insz)
+		return TEE_ERROR_BAD_PARAMETERS;
+	if (!unit || unit > insz)
+		unit = insz;
+	count = insz / unit + !!(insz % unit);
+
+	if (count != tags_count) {
+		TEE_Free(tags);
+		tags_count = 0;
+		tags = TEE_Malloc(count * sizeof(tag), TEE_MALLOC_FILL_ZERO);
+		if (!tags)
+			return TEE_ERROR_OUT_OF_MEMORY;
+		tags_count = count;
+	}
+
+	pt = TEE_Malloc(unit, 0);
+	ct = TEE_Malloc(unit, 0);
+	if (!pt || !ct) {
+		res = TEE_ERROR_OUT_OF_MEMORY;
+		goto out;
+	}
+
+	/*
+	 * GCM and CCM encrypt in CTR mode: encrypting the input gives the
+	 * plaintext it is the ciphertext of, and encrypting that plaintext
+	 * gives the input back along with its tag.
+	 */
+	for (i = 0, off = 0; i < count; i++, off += len) {
+		len = insz - off < unit ? insz - off : unit;
+
+		res = ae_init_message(tag_op, iv, len);
+		CHECK(res, "TEE_AEInit", goto out;);
+		sz = len;
+		tag_len = sizeof(tag);
+		res = TEE_AEEncryptFinal(tag_op, in + off, len, pt, &sz, tag,
+					 &tag_len);
+		CHECK(res, "TEE_AEEncryptFinal", goto out;);
+
+		res = ae_init_message(tag_op, iv, len);
+		CHECK(res, "TEE_AEInit", goto out;);
+		sz = len;
+		tag_len = sizeof(tag);
+		res = TEE_AEEncryptFinal(tag_op, pt, len, ct, &sz,
+					 tags + i * sizeof(tag), &tag_len);
+		CHECK(res, "TEE_AEEncryptFinal", goto out;);
+	}
+out:
+	TEE_Free(pt);
+	TEE_Free(ct);
+	return res;
 }
 
 void cmd_clean_res(void)
 {
+	free_key_pool();
 	if (crypto_op)
 		TEE_FreeOperation(crypto_op);
+	crypto_op = TEE_HANDLE_NULL;
+	if (tag_op)
+		TEE_FreeOperation(tag_op);
+	tag_op = TEE_HANDLE_NULL;
+	TEE_Free(tags);
+	tags = NULL;
+	tags_count = 0;
 }
@@ -85,6 +85,20 @@ TEE_Result TA_InvokeCommandEntryPoint(void *pSessionContext,
 		EMSG("Invalid SDP commands: TA was built without SDP support");
 		return TEE_ERROR_NOT_SUPPORTED;
 #endif
+	case TA_AES_PERF_CMD_PROCESS_BATCH:
+		return cmd_process_batch(nParamTypes, pParams);
+
+	case TA_AES_PERF_CMD_NULL:
+		return TEE_SUCCESS;
+	case TA_AES_PERF_CMD_VALUE:
+		return cmd_value(nParamTypes, pParams);
+
+	case TA_AES_PERF_CMD_PREPARE_KEY_POOL:
+		return cmd_prepare_key_pool(nParamTypes, pParams);
+	case TA_AES_PERF_CMD_REKEY:
+		return cmd_rekey(nParamTypes, pParams);
+	case TA_AES_PERF_CMD_PREPARE_TAGS:
+		return cmd_prepare_tags(nParamTypes, pParams);
 
 	default:
 		return TEE_ERROR_BAD_PARAMETERS;
@@ -27,6 +27,9 @@
 
 /* #define FULL_UNROLL */
 
+#include <stdbool.h>
+#include <string.h>
+
 #include "aes_impl.h"
 
 typedef unsigned long u32;
@@ -1252,3 +1255,655 @@ void rijndaelDecrypt(const u32 *rk, int nrounds, const u8 ciphertext[16],
 	    (Td4[(t0) & 0xff] & 0x000000ff) ^ rk[3];
 	PUTU32(plaintext + 12, s3);
 }
+
+/*
+ * Multi-block T-table path: AES_MB_BLOCKS independent blocks go through
+ * each round together so that their table lookups can overlap. Four
+ * states of four words still fit in the general purpose registers.
+ */
+
+#define TE_ROUND(t, s, rk) do { \
+		(t)[0] = Te0[(s)[0] >> 24] ^ Te1[((s)[1] >> 16) & 0xff] ^ \
+			 Te2[((s)[2] >> 8) & 0xff] ^ Te3[(s)[3] & 0xff] ^ \
+			 (rk)[0]; \
+		(t)[1] = Te0[(s)[1] >> 24] ^ Te1[((s)[2] >> 16) & 0xff] ^ \
+			 Te2[((s)[3] >> 8) & 0xff] ^ Te3[(s)[0] & 0xff] ^ \
+			 (rk)[1]; \
+		(t)[2] = Te0[(s)[2] >> 24] ^ Te1[((s)[3] >> 16) & 0xff] ^ \
+			 Te2[((s)[0] >> 8) & 0xff] ^ Te3[(s)[1] & 0xff] ^ \
+			 (rk)[2]; \
+		(t)[3] = Te0[(s)[3] >> 24] ^ Te1[((s)[0] >> 16) & 0xff] ^ \
+			 Te2[((s)[1] >> 8) & 0xff] ^ Te3[(s)[2] & 0xff] ^ \
+			 (rk)[3]; \
+	} while (0)
+
+/* Explicitly unrolled so that the states stay in registers */
+#define TE_ROUND4(t, s, rk) do { \
+		TE_ROUND((t)[0], (s)[0], rk); \
+		TE_ROUND((t)[1], (s)[1], rk); \
+		TE_ROUND((t)[2], (s)[2], rk); \
+		TE_ROUND((t)[3], (s)[3], rk); \
+	} while (0)
+
+#define TE_LAST(a, b, c, d, rk) \
+	((Te4[(a) >> 24] & 0xff000000) ^ \
+	 (Te4[((b) >> 16) & 0xff] & 0x00ff0000) ^ \
+	 (Te4[((c) >> 8) & 0xff] & 0x0000ff00) ^ \
+	 (Te4[(d) & 0xff] & 0x000000ff) ^ (rk))
+
+#define TD_ROUND(t, s, rk) do { \
+		(t)[0] = Td0[(s)[0] >> 24] ^ Td1[((s)[3] >> 16) & 0xff] ^ \
+			 Td2[((s)[2] >> 8) & 0xff] ^ Td3[(s)[1] & 0xff] ^ \
+			 (rk)[0]; \
+		(t)[1] = Td0[(s)[1] >> 24] ^ Td1[((s)[0] >> 16) & 0xff] ^ \
+			 Td2[((s)[3] >> 8) & 0xff] ^ Td3[(s)[2] & 0xff] ^ \
+			 (rk)[1]; \
+		(t)[2] = Td0[(s)[2] >> 24] ^ Td1[((s)[1] >> 16) & 0xff] ^ \
+			 Td2[((s)[0] >> 8) & 0xff] ^ Td3[(s)[3] & 0xff] ^ \
+			 (rk)[2]; \
+		(t)[3] = Td0[(s)[3] >> 24] ^ Td1[((s)[2] >> 16) & 0xff] ^ \
+			 Td2[((s)[1] >> 8) & 0xff] ^ Td3[(s)[0] & 0xff] ^ \
+			 (rk)[3]; \
+	} while (0)
+
+#define TD_ROUND4(t, s, rk) do { \
+		TD_ROUND((t)[0], (s)[0], rk); \
+		TD_ROUND((t)[1], (s)[1], rk); \
+		TD_ROUND((t)[2], (s)[2], rk); \
+		TD_ROUND((t)[3], (s)[3], rk); \
+	} while (0)
+
+#define TD_LAST(a, b, c, d, rk) \
+	((Td4[(a) >> 24] & 0xff000000) ^ \
+	 (Td4[((b) >> 16) & 0xff] & 0x00ff0000) ^ \
+	 (Td4[((c) >> 8) & 0xff] & 0x0000ff00) ^ \
+	 (Td4[(d) & 0xff] & 0x000000ff) ^ (rk))
+
+static void encrypt_interleaved(const u32 *rk, int nrounds, const u8 *in,
+				u8 *out)
+{
+	u32 s[AES_MB_BLOCKS][4];
+	u32 t[AES_MB_BLOCKS][4];
+	int b, r;
+
+	for (b = 0; b < AES_MB_BLOCKS; b++) {
+		s[b][0] = GETU32(in + 16 * b) ^ rk[0];
+		s[b][1] = GETU32(in + 16 * b + 4) ^ rk[1];
+		s[b][2] = GETU32(in + 16 * b + 8) ^ rk[2];
+		s[b][3] = GETU32(in + 16 * b + 12) ^ rk[3];
+	}
+
+	for (r = 1; r < nrounds; r += 2) {
+		TE_ROUND4(t, s, rk + 4 * r);
+		if (r + 1 == nrounds)
+			break;
+		TE_ROUND4(s, t, rk + 4 * (r + 1));
+	}
+
+	/* nrounds is even: the last full round left its output in t[] */
+	rk += nrounds << 2;
+	for (b = 0; b < AES_MB_BLOCKS; b++) {
+		u32 *st = t[b];
+		u32 v;
+
+		v = TE_LAST(st[0], st[1], st[2], st[3], rk[0]);
+		PUTU32(out + 16 * b, v);
+		v = TE_LAST(st[1], st[2], st[3], st[0], rk[1]);
+		PUTU32(out + 16 * b + 4, v);
+		v = TE_LAST(st[2], st[3], st[0], st[1], rk[2]);
+		PUTU32(out + 16 * b + 8, v);
+		v = TE_LAST(st[3], st[0], st[1], st[2], rk[3]);
+		PUTU32(out + 16 * b + 12, v);
+	}
+}
+
+static void decrypt_interleaved(const u32 *rk, int nrounds, const u8 *in,
+				u8 *out)
+{
+	u32 s[AES_MB_BLOCKS][4];
+	u32 t[AES_MB_BLOCKS][4];
+	int b, r;
+
+	for (b = 0; b < AES_MB_BLOCKS; b++) {
+		s[b][0] = GETU32(in + 16 * b) ^ rk[0];
+		s[b][1] = GETU32(in + 16 * b + 4) ^ rk[1];
+		s[b][2] = GETU32(in + 16 * b + 8) ^ rk[2];
+		s[b][3] = GETU32(in + 16 * b + 12) ^ rk[3];
+	}
+
+	for (r = 1; r < nrounds; r += 2) {
+		TD_ROUND4(t, s, rk + 4 * r);
+		if (r + 1 == nrounds)
+			break;
+		TD_ROUND4(s, t, rk + 4 * (r + 1));
+	}
+
+	rk += nrounds << 2;
+	for (b = 0; b < AES_MB_BLOCKS; b++) {
+		u32 *st = t[b];
+		u32 v;
+
+		v = TD_LAST(st[0], st[3], st[2], st[1], rk[0]);
+		PUTU32(out + 16 * b, v);
+		v = TD_LAST(st[1], st[0], st[3], st[2], rk[1]);
+		PUTU32(out + 16 * b + 4, v);
+		v = TD_LAST(st[2], st[1], st[0], st[3], rk[2]);
+		PUTU32(out + 16 * b + 8, v);
+		v = TD_LAST(st[3], st[2], st[1], st[0], rk[3]);
+		PUTU32(out + 16 * b + 12, v);
+	}
+}
+
+/*
+ * Same as rijndaelEncrypt() on @nblocks consecutive blocks, with the key
+ * schedule from rijndaelSetupEncrypt().
+ */
+void rijndaelEncryptBlocks(const u32 *rk, int nrounds, const u8 *plaintext,
+			   u8 *ciphertext, size_t nblocks)
+{
+	for (; nblocks >= AES_MB_BLOCKS; nblocks -= AES_MB_BLOCKS) {
+		encrypt_interleaved(rk, nrounds, plaintext, ciphertext);
+		plaintext += 16 * AES_MB_BLOCKS;
+		ciphertext += 16 * AES_MB_BLOCKS;
+	}
+	for (; nblocks; nblocks--) {
+		rijndaelEncrypt(rk, nrounds, plaintext, ciphertext);
+		plaintext += 16;
+		ciphertext += 16;
+	}
+}
+
+/*
+ * Same as rijndaelDecrypt() on @nblocks consecutive blocks, with the key
+ * schedule from rijndaelSetupDecrypt().
+ */
+void rijndaelDecryptBlocks(const u32 *rk, int nrounds, const u8 *ciphertext,
+			   u8 *plaintext, size_t nblocks)
+{
+	for (; nblocks >= AES_MB_BLOCKS; nblocks -= AES_MB_BLOCKS) {
+		decrypt_interleaved(rk, nrounds, ciphertext, plaintext);
+		ciphertext += 16 * AES_MB_BLOCKS;
+		plaintext += 16 * AES_MB_BLOCKS;
+	}
+	for (; nblocks; nblocks--) {
+		rijndaelDecrypt(rk, nrounds, ciphertext, plaintext);
+		ciphertext += 16;
+		plaintext += 16;
+	}
+}
+
+/*
+ * Constant-time bitsliced path, AES_BS_BLOCKS blocks at a time. Plane
+ * q[i] holds bit i of every byte: bit 16 * blk + 4 * col + row is the
+ * state byte at (row, col) of block blk. No memory access or branch
+ * depends on the key or the data, the key expansion included.
+ */
+#define LANES(x)	((uint64_t)(x) * 0x0001000100010001ULL)
+#define NIBBLES(x)	((uint64_t)(x) * 0x1111111111111111ULL)
+
+/* Transpose of the 8x8 bit matrix whose rows are the bytes of @x */
+static uint64_t transpose8x8(uint64_t x)
+{
+	uint64_t t;
+
+	t = (x ^ (x >> 7)) & 0x00aa00aa00aa00aaULL;
+	x ^= t ^ (t << 7);
+	t = (x ^ (x >> 14)) & 0x0000cccc0000ccccULL;
+	x ^= t ^ (t << 14);
+	t = (x ^ (x >> 28)) & 0x00000000f0f0f0f0ULL;
+	x ^= t ^ (t << 28);
+	return x;
+}
+
+static void bs_load(uint64_t q[8], const u8 *in)
+{
+	uint64_t x;
+	int i, j;
+
+	for (i = 0; i < 8; i++)
+		q[i] = 0;
+	for (j = 0; j < 8; j++) {
+		x = 0;
+		for (i = 0; i < 8; i++)
+			x |= (uint64_t)in[8 * j + i] << (8 * i);
+		x = transpose8x8(x);
+		for (i = 0; i < 8; i++)
+			q[i] |= ((x >> (8 * i)) & 0xff) << (8 * j);
+	}
+}
+
+static void bs_store(u8 *out, const uint64_t q[8])
+{
+	uint64_t x;
+	int i, j;
+
+	for (j = 0; j < 8; j++) {
+		x = 0;
+		for (i = 0; i < 8; i++)
+			x |= ((q[i] >> (8 * j)) & 0xff) << (8 * i);
+		x = transpose8x8(x);
+		for (i = 0; i < 8; i++)
+			out[8 * j + i] = (u8)(x >> (8 * i));
+	}
+}
+
+/* Boyar-Peralta S-box circuit: 32 AND, 83 XOR/XNOR */
+static void bs_sbox(uint64_t q[8])
+{
+	uint64_t x0, x1, x2, x3, x4, x5, x6, x7;
+	uint64_t y1, y2, y3, y4, y5, y6, y7, y8, y9;
+	uint64_t y10, y11, y12, y13, y14, y15, y16, y17, y18, y19;
+	uint64_t y20, y21;
+	uint64_t z0, z1, z2, z3, z4, z5, z6, z7, z8, z9;
+	uint64_t z10, z11, z12, z13, z14, z15, z16, z17;
+	uint64_t t0, t1, t2, t3, t4, t5, t6, t7, t8, t9;
+	uint64_t t10, t11, t12, t13, t14, t15, t16, t17, t18, t19;
+	uint64_t t20, t21, t22, t23, t24, t25, t26, t27, t28, t29;
+	uint64_t t30, t31, t32, t33, t34, t35, t36, t37, t38, t39;
+	uint64_t t40, t41, t42, t43, t44, t45, t46, t47, t48, t49;
+	uint64_t t50, t51, t52, t53, t54, t55, t56, t57, t58, t59;
+	uint64_t t60, t61, t62, t63, t64, t65, t66, t67;
+	uint64_t s0, s1, s2, s3, s4, s5, s6, s7;
+
+	x0 = q[7];
+	x1 = q[6];
+	x2 = q[5];
+	x3 = q[4];
+	x4 = q[3];
+	x5 = q[2];
+	x6 = q[1];
+	x7 = q[0];
+
+	/* Top linear transformation */
+	y14 = x3 ^ x5;
+	y13 = x0 ^ x6;
+	y9 = x0 ^ x3;
+	y8 = x0 ^ x5;
+	t0 = x1 ^ x2;
+	y1 = t0 ^ x7;
+	y4 = y1 ^ x3;
+	y12 = y13 ^ y14;
+	y2 = y1 ^ x0;
+	y5 = y1 ^ x6;
+	y3 = y5 ^ y8;
+	t1 = x4 ^ y12;
+	y15 = t1 ^ x5;
+	y20 = t1 ^ x1;
+	y6 = y15 ^ x7;
+	y10 = y15 ^ t0;
+	y11 = y20 ^ y9;
+	y7 = x7 ^ y11;
+	y17 = y10 ^ y11;
+	y19 = y10 ^ y8;
+	y16 = t0 ^ y11;
+	y21 = y13 ^ y16;
+	y18 = x0 ^ y16;
+
+	/* Non-linear section: inversion in GF(2^8) */
+	t2 = y12 & y15;
+	t3 = y3 & y6;
+	t4 = t3 ^ t2;
+	t5 = y4 & x7;
+	t6 = t5 ^ t2;
+	t7 = y13 & y16;
+	t8 = y5 & y1;
+	t9 = t8 ^ t7;
+	t10 = y2 & y7;
+	t11 = t10 ^ t7;
+	t12 = y9 & y11;
+	t13 = y14 & y17;
+	t14 = t13 ^ t12;
+	t15 = y8 & y10;
+	t16 = t15 ^ t12;
+	t17 = t4 ^ t14;
+	t18 = t6 ^ t16;
+	t19 = t9 ^ t14;
+	t20 = t11 ^ t16;
+	t21 = t17 ^ y20;
+	t22 = t18 ^ y19;
+	t23 = t19 ^ y21;
+	t24 = t20 ^ y18;
+
+	t25 = t21 ^ t22;
+	t26 = t21 & t23;
+	t27 = t24 ^ t26;
+	t28 = t25 & t27;
+	t29 = t28 ^ t22;
+	t30 = t23 ^ t24;
+	t31 = t22 ^ t26;
+	t32 = t31 & t30;
+	t33 = t32 ^ t24;
+	t34 = t23 ^ t33;
+	t35 = t27 ^ t33;
+	t36 = t24 & t35;
+	t37 = t36 ^ t34;
+	t38 = t27 ^ t36;
+	t39 = t29 & t38;
+	t40 = t25 ^ t39;
+
+	t41 = t40 ^ t37;
+	t42 = t29 ^ t33;
+	t43 = t29 ^ t40;
+	t44 = t33 ^ t37;
+	t45 = t42 ^ t41;
+	z0 = t44 & y15;
+	z1 = t37 & y6;
+	z2 = t33 & x7;
+	z3 = t43 & y16;
+	z4 = t40 & y1;
+	z5 = t29 & y7;
+	z6 = t42 & y11;
+	z7 = t45 & y17;
+	z8 = t41 & y10;
+	z9 = t44 & y12;
+	z10 = t37 & y3;
+	z11 = t33 & y4;
+	z12 = t43 & y13;
+	z13 = t40 & y5;
+	z14 = t29 & y2;
+	z15 = t42 & y9;
+	z16 = t45 & y14;
+	z17 = t41 & y8;
+
+	/* Bottom linear transformation */
+	t46 = z15 ^ z16;
+	t47 = z10 ^ z11;
+	t48 = z5 ^ z13;
+	t49 = z9 ^ z10;
+	t50 = z2 ^ z12;
+	t51 = z2 ^ z5;
+	t52 = z7 ^ z8;
+	t53 = z0 ^ z3;
+	t54 = z6 ^ z7;
+	t55 = z16 ^ z17;
+	t56 = z12 ^ t48;
+	t57 = t50 ^ t53;
+	t58 = z4 ^ t46;
+	t59 = z3 ^ t54;
+	t60 = t46 ^ t57;
+	t61 = z14 ^ t57;
+	t62 = t52 ^ t58;
+	t63 = t49 ^ t58;
+	t64 = z4 ^ t59;
+	t65 = t61 ^ t62;
+	t66 = z1 ^ t63;
+	s0 = t59 ^ t63;
+	s6 = t56 ^ ~t62;
+	s7 = t48 ^ ~t60;
+	t67 = t64 ^ t65;
+	s3 = t53 ^ t66;
+	s4 = t51 ^ t66;
+	s5 = t47 ^ t65;
+	s1 = t64 ^ ~s3;
+	s2 = t55 ^ ~t67;
+
+	q[7] = s0;
+	q[6] = s1;
+	q[5] = s2;
+	q[4] = s3;
+	q[3] = s4;
+	q[2] = s5;
+	q[1] = s6;
+	q[0] = s7;
+}
+
+/* Inverse of the S-box affine transform, constant 0x05 included */
+static void bs_inv_affine(uint64_t q[8])
+{
+	uint64_t x[8];
+	int i;
+
+	for (i = 0; i < 8; i++)
+		x[i] = q[i];
+	for (i = 0; i < 8; i++)
+		q[i] = x[(i + 2) & 7] ^ x[(i + 5) & 7] ^ x[(i + 7) & 7];
+	q[0] = ~q[0];
+	q[2] = ~q[2];
+}
+
+/*
+ * The S-box is S(x) = A(I(x)) with I() the inversion and A() affine, so
+ * I(y) = A^-1(S(y)) and S^-1(x) = I(A^-1(x)) = A^-1(S(A^-1(x))).
+ */
+static void bs_inv_sbox(uint64_t q[8])
+{
+	bs_inv_affine(q);
+	bs_sbox(q);
+	bs_inv_affine(q);
+}
+
+/* Row r rotates left by r columns, that is by 4 * r bits in each lane */
+static void bs_shift_rows(uint64_t q[8])
+{
+	uint64_t x;
+	int i;
+
+	for (i = 0; i < 8; i++) {
+		x = q[i];
+		q[i] = (x & NIBBLES(0x1)) |
+		       ((x >> 4) & LANES(0x0222)) | ((x << 12) & LANES(0x2000)) |
+		       ((x >> 8) & LANES(0x0044)) | ((x << 8) & LANES(0x4400)) |
+		       ((x >> 12) & LANES(0x0008)) | ((x << 4) & LANES(0x8880));
+	}
+}
+
+static void bs_inv_shift_rows(uint64_t q[8])
+{
+	uint64_t x;
+	int i;
+
+	for (i = 0; i < 8; i++) {
+		x = q[i];
+		q[i] = (x & NIBBLES(0x1)) |
+		       ((x << 4) & LANES(0x2220)) | ((x >> 12) & LANES(0x0002)) |
+		       ((x >> 8) & LANES(0x0044)) | ((x << 8) & LANES(0x4400)) |
+		       ((x << 12) & LANES(0x8000)) | ((x >> 4) & LANES(0x0888));
+	}
+}
+
+/* Row r of each column receives row r + 1 (one nibble per column) */
+static uint64_t rot_rows1(uint64_t x)
+{
+	return ((x >> 1) & NIBBLES(0x7)) | ((x << 3) & NIBBLES(0x8));
+}
+
+static uint64_t rot_rows2(uint64_t x)
+{
+	return ((x >> 2) & NIBBLES(0x3)) | ((x << 2) & NIBBLES(0xc));
+}
+
+/* Multiplication by x in GF(2^8), modulo x^8 + x^4 + x^3 + x + 1 */
+static void bs_xtime(uint64_t q[8])
+{
+	uint64_t hi = q[7];
+
+	q[7] = q[6];
+	q[6] = q[5];
+	q[5] = q[4];
+	q[4] = q[3] ^ hi;
+	q[3] = q[2] ^ hi;
+	q[2] = q[1];
+	q[1] = q[0] ^ hi;
+	q[0] = hi;
+}
+
+/* a'[r] = 2 * (a[r] ^ a[r + 1]) ^ a[r + 1] ^ a[r + 2] ^ a[r + 3] */
+static void bs_mix_columns(uint64_t q[8])
+{
+	uint64_t u[8];
+	uint64_t r1, r2;
+	int i;
+
+	for (i = 0; i < 8; i++) {
+		r1 = rot_rows1(q[i]);
+		r2 = rot_rows2(q[i]);
+		u[i] = q[i] ^ r1;
+		q[i] = r1 ^ r2 ^ rot_rows1(r2);
+	}
+	bs_xtime(u);
+	for (i = 0; i < 8; i++)
+		q[i] ^= u[i];
+}
+
+/*
+ * InvMixColumns is MixColumns after a[r] ^= 4 * (a[r] ^ a[r + 2]), see
+ * "The Design of Rijndael", section 4.1.3.
+ */
+static void bs_inv_mix_columns(uint64_t q[8])
+{
+	uint64_t u[8];
+	int i;
+
+	for (i = 0; i < 8; i++)
+		u[i] = q[i] ^ rot_rows2(q[i]);
+	bs_xtime(u);
+	bs_xtime(u);
+	for (i = 0; i < 8; i++)
+		q[i] ^= u[i];
+	bs_mix_columns(q);
+}
+
+static void bs_add_round_key(uint64_t q[8], const uint64_t *rk)
+{
+	int i;
+
+	for (i = 0; i < 8; i++)
+		q[i] ^= rk[i];
+}
+
+static u32 bs_sub_word(u32 w)
+{
+	uint64_t q[8];
+	u32 r = 0;
+	int i, j;
+
+	for (i = 0; i < 8; i++) {
+		q[i] = 0;
+		for (j = 0; j < 4; j++)
+			q[i] |= (uint64_t)((w >> (8 * j + i)) & 1) << j;
+	}
+	bs_sbox(q);
+	for (i = 0; i < 8; i++)
+		for (j = 0; j < 4; j++)
+			r |= (u32)((q[i] >> j) & 1) << (8 * j + i);
+	return r;
+}
+
+/**
+ * Expand the cipher key into the bitsliced key schedule, used for both
+ * encryption and decryption.
+ *
+ * @return the number of rounds for the given cipher key size.
+ */
+int rijndaelSetupBitsliced(struct rijndael_bs_key *bk, const u8 *key,
+			   int keybits)
+{
+	u32 w[4 * (AES_BS_MAX_ROUNDS + 1)];
+	u8 buf[16 * AES_BS_BLOCKS];
+	int nk = keybits / 32;
+	int nw, i, j;
+	u32 temp;
+
+	if (keybits != 128 && keybits != 192 && keybits != 256)
+		return 0;
+	bk->nrounds = NROUNDS(keybits);
+	nw = 4 * (bk->nrounds + 1);
+
+	for (i = 0; i < nk; i++)
+		w[i] = GETU32(key + 4 * i);
+	for (; i < nw; i++) {
+		temp = w[i - 1];
+		if (i % nk == 0)
+			temp = bs_sub_word(((temp << 8) | (temp >> 24)) &
+					   0xffffffff) ^ rcon[i / nk - 1];
+		else if (nk > 6 && i % nk == 4)
+			temp = bs_sub_word(temp);
+		w[i] = w[i - nk] ^ temp;
+	}
+
+	/* Each round key is replicated in the lanes of all the blocks */
+	for (i = 0; i <= bk->nrounds; i++) {
+		for (j = 0; j < 16 * AES_BS_BLOCKS; j += 4)
+			PUTU32(buf + j, w[4 * i + (j & 15) / 4]);
+		bs_load(bk->rk[i], buf);
+	}
+	return bk->nrounds;
+}
+
+static void bs_encrypt(const struct rijndael_bs_key *bk, uint64_t q[8])
+{
+	int r;
+
+	bs_add_round_key(q, bk->rk[0]);
+	for (r = 1; r < bk->nrounds; r++) {
+		bs_sbox(q);
+		bs_shift_rows(q);
+		bs_mix_columns(q);
+		bs_add_round_key(q, bk->rk[r]);
+	}
+	bs_sbox(q);
+	bs_shift_rows(q);
+	bs_add_round_key(q, bk->rk[bk->nrounds]);
+}
+
+static void bs_decrypt(const struct rijndael_bs_key *bk, uint64_t q[8])
+{
+	int r;
+
+	bs_add_round_key(q, bk->rk[bk->nrounds]);
+	for (r = bk->nrounds - 1; r > 0; r--) {
+		bs_inv_shift_rows(q);
+		bs_inv_sbox(q);
+		bs_add_round_key(q, bk->rk[r]);
+		bs_inv_mix_columns(q);
+	}
+	bs_inv_shift_rows(q);
+	bs_inv_sbox(q);
+	bs_add_round_key(q, bk->rk[0]);
+}
+
+static void bs_blocks(const struct rijndael_bs_key *bk, const u8 *in, u8 *out,
+		      size_t nblocks, bool decrypt)
+{
+	u8 buf[16 * AES_BS_BLOCKS];
+	uint64_t q[8];
+	size_t n;
+
+	while (nblocks) {
+		n = nblocks < AES_BS_BLOCKS ? nblocks : AES_BS_BLOCKS;
+		if (n < AES_BS_BLOCKS) {
+			memset(buf, 0, sizeof(buf));
+			memcpy(buf, in, 16 * n);
+			bs_load(q, buf);
+		} else {
+			bs_load(q, in);
+		}
+		if (decrypt)
+			bs_decrypt(bk, q);
+		else
+			bs_encrypt(bk, q);
+		if (n < AES_BS_BLOCKS) {
+			bs_store(buf, q);
+			memcpy(out, buf, 16 * n);
+		} else {
+			bs_store(out, q);
+		}
+		in += 16 * n;
+		out += 16 * n;
+		nblocks -= n;
+	}
+}
+
+void rijndaelEncryptBitsliced(const struct rijndael_bs_key *bk,
+			      const u8 *plaintext, u8 *ciphertext,
+			      size_t nblocks)
+{
+	bs_blocks(bk, plaintext, ciphertext, nblocks, false);
+}
+
+void rijndaelDecryptBitsliced(const struct rijndael_bs_key *bk,
+			      const u8 *ciphertext, u8 *plaintext,
+			      size_t nblocks)
+{
+	bs_blocks(bk, ciphertext, plaintext, nblocks, true);
+}
@@ -25,6 +25,9 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <stdbool.h>
+#include <ta_crypt.h>
+
 #include "aes_taf.h"
 #include "aes_impl.h"
 
@@ -39,21 +42,35 @@ const unsigned char key[KEYLENGTH(AES_256)] = {
 /* Encryption/decryption buffer */
 unsigned long rk[RKLENGTH(AES_256)];
 
-TEE_Result ta_entry_aes256ecb_encrypt(uint32_t param_types, TEE_Param params[4])
+/* Bitsliced key schedule, the same for encryption and decryption */
+static struct rijndael_bs_key bs_key;
+
+static TEE_Result aes256ecb(uint32_t param_types, TEE_Param params[4],
+			    bool decrypt)
 {
+	const uint32_t exp_pt = TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT,
+						TEE_PARAM_TYPE_MEMREF_OUTPUT,
+						TEE_PARAM_TYPE_NONE,
+						TEE_PARAM_TYPE_NONE);
+	const uint32_t exp_pt_path =
+		TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT,
+				TEE_PARAM_TYPE_MEMREF_OUTPUT,
+				TEE_PARAM_TYPE_VALUE_INOUT,
+				TEE_PARAM_TYPE_NONE);
+	uint32_t path = TA_CRYPT_AES_PATH_AUTO;
+	const unsigned char *in = NULL;
+	unsigned char *out = NULL;
 	size_t n_input_blocks;
 	size_t i;
 
 /*
  * It is expected that memRef[0] is input buffer and memRef[1] is
- * output buffer.
+ * output buffer, value[2] optionally selects the implementation.
  */
-	if (param_types !=
-	    TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT,
-			    TEE_PARAM_TYPE_MEMREF_OUTPUT, TEE_PARAM_TYPE_NONE,
-			    TEE_PARAM_TYPE_NONE)) {
+	if (param_types == exp_pt_path)
+		path = params[2].value.a;
+	else if (param_types != exp_pt)
 		return TEE_ERROR_BAD_PARAMETERS;
-	}
 
 /* Check that input buffer is whole mult. of block size, in bits */
 	if ((params[0].memref.size << 8) % AES_BLOCK_SIZE != 0)
@@ -63,60 +80,70 @@ TEE_Result ta_entry_aes256ecb_encrypt(uint32_t param_types, TEE_Param params[4])
 	if ((params[1].memref.size << 8) % AES_BLOCK_SIZE != 0)
 		return TEE_ERROR_BAD_PARAMETERS;
 
-/* Set up for encryption */
-	(void)rijndaelSetupEncrypt(rk, key, AES_256);
-
 	n_input_blocks = params[0].memref.size / (AES_BLOCK_SIZE / 8);
-
-	for (i = 0; i < n_input_blocks; i++) {
-		const unsigned char *ciphertext = params[0].memref.buffer;
-		unsigned char *plaintext = params[1].memref.buffer;
-
-		rijndaelEncrypt(rk, NROUNDS(AES_256),
-				&ciphertext[i * (AES_BLOCK_SIZE / 8)],
-				&plaintext[i * (AES_BLOCK_SIZE / 8)]);
+	in = params[0].memref.buffer;
+	out = params[1].memref.buffer;
+
+	if (path == TA_CRYPT_AES_PATH_AUTO) {
+		if (n_input_blocks >= AES_MB_BLOCKS)
+			path = TA_CRYPT_AES_PATH_MULTIBLOCK;
+		else
+			path = TA_CRYPT_AES_PATH_REFERENCE;
 	}
 
-	return TEE_SUCCESS;
-}
-
-TEE_Result ta_entry_aes256ecb_decrypt(uint32_t param_types, TEE_Param params[4])
-{
-	size_t n_input_blocks;
-	size_t i;
-
-/*
- * It is expected that memRef[0] is input buffer and memRef[1] is
- * output buffer.
- */
-	if (param_types !=
-	    TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT,
-			    TEE_PARAM_TYPE_MEMREF_OUTPUT, TEE_PARAM_TYPE_NONE,
-			    TEE_PARAM_TYPE_NONE)) {
+	switch (path) {
+	case TA_CRYPT_AES_PATH_REFERENCE:
+		if (decrypt)
+			(void)rijndaelSetupDecrypt(rk, key, AES_256);
+		else
+			(void)rijndaelSetupEncrypt(rk, key, AES_256);
+		for (i = 0; i < n_input_blocks; i++) {
+			if (decrypt)
+				rijndaelDecrypt(rk, NROUNDS(AES_256),
+						&in[i * (AES_BLOCK_SIZE / 8)],
+						&out[i * (AES_BLOCK_SIZE / 8)]);
+			else
+				rijndaelEncrypt(rk, NROUNDS(AES_256),
+						&in[i * (AES_BLOCK_SIZE / 8)],
+						&out[i * (AES_BLOCK_SIZE / 8)]);
+		}
+		break;
+	case TA_CRYPT_AES_PATH_MULTIBLOCK:
+		if (decrypt) {
+			(void)rijndaelSetupDecrypt(rk, key, AES_256);
+			rijndaelDecryptBlocks(rk, NROUNDS(AES_256), in, out,
+					      n_input_blocks);
+		} else {
+			(void)rijndaelSetupEncrypt(rk, key, AES_256);
+			rijndaelEncryptBlocks(rk, NROUNDS(AES_256), in, out,
+					      n_input_blocks);
+		}
+		break;
+	case TA_CRYPT_AES_PATH_BITSLICED:
+		(void)rijndaelSetupBitsliced(&bs_key, key, AES_256);
+		if (decrypt)
+			rijndaelDecryptBitsliced(&bs_key, in, out,
+						 n_input_blocks);
+		else
+			rijndaelEncryptBitsliced(&bs_key, in, out,
+						 n_input_blocks);
+		break;
+	default:
 		return TEE_ERROR_BAD_PARAMETERS;
 	}
 
-/* Check that input buffer is whole mult. of block size, in bits */
-	if ((params[0].memref.size << 8) % AES_BLOCK_SIZE != 0)
-		return TEE_ERROR_BAD_PARAMETERS;
-
-/* Check that output buffer is whole mult. of block size, in bits */
-	if ((params[1].memref.size << 8) % AES_BLOCK_SIZE != 0)
-		return TEE_ERROR_BAD_PARAMETERS;
-
-/* Set up for decryption */
-	(void)rijndaelSetupDecrypt(rk, key, AES_256);
-
-	n_input_blocks = params[0].memref.size / (AES_BLOCK_SIZE / 8);
+	if (param_types == exp_pt_path)
+		params[2].value.b = path;
 
-	for (i = 0; i < n_input_blocks; i++) {
-		const unsigned char *ciphertext = params[0].memref.buffer;
-		unsigned char *plaintext = params[1].memref.buffer;
+	return TEE_SUCCESS;
+}
 
-		rijndaelDecrypt(rk, NROUNDS(AES_256),
-				&ciphertext[i * (AES_BLOCK_SIZE / 8)],
-				&plaintext[i * (AES_BLOCK_SIZE / 8)]);
-	}
+TEE_Result ta_entry_aes256ecb_encrypt(uint32_t param_types, TEE_Param params[4])
+{
+	return aes256ecb(param_types, params, false);
+}
 
-	return TEE_SUCCESS;
+TEE_Result ta_entry_aes256ecb_decrypt(uint32_t param_types, TEE_Param params[4])
+{
+	return aes256ecb(param_types, params, true);
 }
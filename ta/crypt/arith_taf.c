@@ -562,3 +562,270 @@ TEE_Result ta_entry_arith_compute_fmm(uint32_t param_types,
 
 	return TEE_SUCCESS;
 }
+
+struct arith_insn {
+	uint32_t op;
+	uint32_t d;
+	uint32_t a;
+	uint32_t b;
+	uint32_t c;
+};
+
+static void decode_insn(const uint32_t *w, struct arith_insn *insn)
+{
+	insn->op = w[0] & 0xff;
+	insn->d = (w[0] >> 8) & 0xff;
+	insn->a = (w[0] >> 16) & 0xff;
+	insn->b = w[0] >> 24;
+	insn->c = w[1];
+}
+
+static bool check_insn(const struct arith_insn *insn, size_t num_regs)
+{
+	if (insn->d >= num_regs || insn->a >= num_regs ||
+	    insn->b >= num_regs)
+		return false;
+
+	switch (insn->op) {
+	case TA_CRYPT_ARITH_OP_ADDMOD:
+	case TA_CRYPT_ARITH_OP_SUBMOD:
+	case TA_CRYPT_ARITH_OP_MULMOD:
+		return insn->c < num_regs;
+	case TA_CRYPT_ARITH_OP_ADD:
+	case TA_CRYPT_ARITH_OP_SUB:
+	case TA_CRYPT_ARITH_OP_MUL:
+	case TA_CRYPT_ARITH_OP_SQR:
+	case TA_CRYPT_ARITH_OP_MOD:
+	case TA_CRYPT_ARITH_OP_SQRMOD:
+	case TA_CRYPT_ARITH_OP_INVMOD:
+	case TA_CRYPT_ARITH_OP_COPY:
+	case TA_CRYPT_ARITH_OP_CMP:
+	case TA_CRYPT_ARITH_OP_CMP_S32:
+	case TA_CRYPT_ARITH_OP_GET_BIT:
+	case TA_CRYPT_ARITH_OP_SELECT:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static bool cond_match(int32_t flag, uint32_t cond)
+{
+	if (flag < 0)
+		return cond & TA_CRYPT_ARITH_COND_LT;
+	if (flag > 0)
+		return cond & TA_CRYPT_ARITH_COND_GT;
+	return cond & TA_CRYPT_ARITH_COND_EQ;
+}
+
+/* @zero is used to copy a register with TEE_BigIntAdd() */
+static void exec_insn(const struct arith_insn *insn, TEE_BigInt **regs,
+		      const TEE_BigInt *zero, int32_t *flag)
+{
+	TEE_BigInt *d = regs[insn->d];
+	TEE_BigInt *a = regs[insn->a];
+	TEE_BigInt *b = regs[insn->b];
+
+	switch (insn->op) {
+	case TA_CRYPT_ARITH_OP_ADD:
+		TEE_BigIntAdd(d, a, b);
+		break;
+	case TA_CRYPT_ARITH_OP_SUB:
+		TEE_BigIntSub(d, a, b);
+		break;
+	case TA_CRYPT_ARITH_OP_MUL:
+		TEE_BigIntMul(d, a, b);
+		break;
+	case TA_CRYPT_ARITH_OP_SQR:
+		TEE_BigIntSquare(d, a);
+		break;
+	case TA_CRYPT_ARITH_OP_MOD:
+		TEE_BigIntMod(d, a, b);
+		break;
+	case TA_CRYPT_ARITH_OP_ADDMOD:
+		TEE_BigIntAddMod(d, a, b, regs[insn->c]);
+		break;
+	case TA_CRYPT_ARITH_OP_SUBMOD:
+		TEE_BigIntSubMod(d, a, b, regs[insn->c]);
+		break;
+	case TA_CRYPT_ARITH_OP_MULMOD:
+		TEE_BigIntMulMod(d, a, b, regs[insn->c]);
+		break;
+	case TA_CRYPT_ARITH_OP_SQRMOD:
+		TEE_BigIntSquareMod(d, a, b);
+		break;
+	case TA_CRYPT_ARITH_OP_INVMOD:
+		TEE_BigIntInvMod(d, a, b);
+		break;
+	case TA_CRYPT_ARITH_OP_COPY:
+		if (d != a)
+			TEE_BigIntAdd(d, a, zero);
+		break;
+	case TA_CRYPT_ARITH_OP_CMP:
+		*flag = TEE_BigIntCmp(a, b);
+		break;
+	case TA_CRYPT_ARITH_OP_CMP_S32:
+		*flag = TEE_BigIntCmpS32(a, insn->c);
+		break;
+	case TA_CRYPT_ARITH_OP_GET_BIT:
+		*flag = TEE_BigIntGetBit(a, insn->c);
+		break;
+	case TA_CRYPT_ARITH_OP_SELECT:
+		if (!cond_match(*flag, insn->c))
+			a = b;
+		if (d != a)
+			TEE_BigIntAdd(d, a, zero);
+		break;
+	default:
+		/* Rejected by check_insn() */
+		TEE_Panic(insn->op);
+	}
+}
+
+TEE_Result ta_entry_arith_program(uint32_t param_types,
+				  TEE_Param params[TEE_NUM_PARAMS])
+{
+	CHECK_PT(MEMREF_INPUT, MEMREF_INPUT, VALUE_OUTPUT, NONE);
+
+	size_t num_words = params[0].memref.size / sizeof(uint32_t);
+	size_t num_regs = params[1].memref.size / sizeof(uint32_t);
+	TEE_BigInt zero[TEE_BigIntSizeInU32(32)] = { };
+	TEE_Result res = TEE_ERROR_BAD_PARAMETERS;
+	struct arith_insn insn = { };
+	TEE_BigInt **regs = NULL;
+	uint32_t *prog = NULL;
+	uint32_t h = 0;
+	int32_t flag = 0;
+	size_t n = 0;
+
+	if (params[0].memref.size % (2 * sizeof(uint32_t)) ||
+	    params[1].memref.size % sizeof(uint32_t) || !num_regs ||
+	    num_regs > 256)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	/* Private copies, shared memory may change under our feet */
+	prog = TEE_Malloc(params[0].memref.size, TEE_MALLOC_FILL_ZERO);
+	regs = TEE_Malloc(num_regs * sizeof(*regs), TEE_MALLOC_FILL_ZERO);
+	if ((num_words && !prog) || !regs) {
+		res = TEE_ERROR_OUT_OF_MEMORY;
+		goto out;
+	}
+	TEE_MemMove(prog, params[0].memref.buffer, params[0].memref.size);
+
+	for (n = 0; n < num_regs; n++) {
+		TEE_MemMove(&h, (uint32_t *)params[1].memref.buffer + n,
+			    sizeof(h));
+		regs[n] = lookup_handle(HT_BIGINT, h);
+		if (!regs[n])
+			goto out;
+	}
+
+	for (n = 0; n < num_words; n += 2) {
+		decode_insn(prog + n, &insn);
+		if (!check_insn(&insn, num_regs)) {
+			EMSG("Invalid instruction %zu", n / 2);
+			goto out;
+		}
+	}
+
+	TEE_BigIntInit(zero, TEE_BigIntSizeInU32(32));
+	for (n = 0; n < num_words; n += 2) {
+		decode_insn(prog + n, &insn);
+		exec_insn(&insn, regs, zero, &flag);
+	}
+
+	params[2].value.a = flag;
+	res = TEE_SUCCESS;
+out:
+	TEE_Free(prog);
+	TEE_Free(regs);
+	return res;
+}
+
+static uint32_t elapsed_ms(TEE_Time *t0)
+{
+	TEE_Time t1 = { };
+
+	TEE_GetSystemTime(&t1);
+	return (t1.seconds - t0->seconds) * 1000 + t1.millis - t0->millis;
+}
+
+/* One round of TA_CRYPT_CMD_ARITH_HANDLE_BENCH, times are accumulated */
+static TEE_Result handle_bench_round(struct handle_db *db, int *h,
+				     size_t count,
+				     TEE_Param params[TEE_NUM_PARAMS])
+{
+	static uint8_t obj;
+	TEE_Time t0 = { };
+	int stale = 0;
+	size_t n = 0;
+
+	TEE_GetSystemTime(&t0);
+	for (n = 0; n < count; n++) {
+		h[n] = handle_get(db, &obj);
+		if (h[n] < 0)
+			return TEE_ERROR_OUT_OF_MEMORY;
+	}
+	params[1].value.a += elapsed_ms(&t0);
+
+	TEE_GetSystemTime(&t0);
+	for (n = 0; n < count; n++)
+		if (handle_lookup(db, h[n]) != &obj)
+			return TEE_ERROR_GENERIC;
+	params[1].value.b += elapsed_ms(&t0);
+
+	TEE_GetSystemTime(&t0);
+	for (n = 0; n < count; n += 2)
+		if (!handle_put(db, h[n]))
+			return TEE_ERROR_GENERIC;
+	for (n = 0; n < count; n += 2) {
+		stale = h[n];
+		h[n] = handle_get(db, &obj);
+		if (h[n] < 0)
+			return TEE_ERROR_OUT_OF_MEMORY;
+	}
+	params[2].value.a += elapsed_ms(&t0);
+
+	/* Every freed slot has been reused, with a new generation */
+	if (handle_lookup(db, stale)) {
+		EMSG("Stale handle %#x resolved", stale);
+		return TEE_ERROR_GENERIC;
+	}
+
+	TEE_GetSystemTime(&t0);
+	for (n = 0; n < count; n++)
+		if (!handle_put(db, h[n]))
+			return TEE_ERROR_GENERIC;
+	params[2].value.b += elapsed_ms(&t0);
+
+	return TEE_SUCCESS;
+}
+
+TEE_Result ta_entry_arith_handle_bench(uint32_t param_types,
+				       TEE_Param params[TEE_NUM_PARAMS])
+{
+	CHECK_PT(VALUE_INPUT, VALUE_OUTPUT, VALUE_OUTPUT, NONE);
+
+	struct handle_db db = HANDLE_DB_INITIALIZER;
+	size_t count = params[0].value.a;
+	uint32_t rounds = params[0].value.b;
+	TEE_Result res = TEE_SUCCESS;
+	int *h = NULL;
+
+	if (!count || count > BIT(HANDLE_INDEX_BITS))
+		return TEE_ERROR_BAD_PARAMETERS;
+	h = TEE_Malloc(count * sizeof(*h), 0);
+	if (!h)
+		return TEE_ERROR_OUT_OF_MEMORY;
+
+	params[1].value.a = 0;
+	params[1].value.b = 0;
+	params[2].value.a = 0;
+	params[2].value.b = 0;
+	while (rounds-- && !res)
+		res = handle_bench_round(&db, h, count, params);
+
+	TEE_Free(h);
+	handle_db_destroy(&db);
+	return res;
+}
@@ -25,6 +25,8 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <stdbool.h>
+#include <ta_crypt.h>
 #include <tee_internal_api.h>
 #include "cryp_taf.h"
 
@@ -39,6 +41,98 @@ extern const void *ta_head;
 #define VAL2HANDLE(v) (void *)(uintptr_t)(v == TEE_HANDLE_NULL ? v : v + (uintptr_t)&ta_head)
 #define HANDLE2VAL(h) (uint32_t)(h == TEE_HANDLE_NULL ? (uintptr_t)h : (uintptr_t)((uintptr_t)h - (uintptr_t)&ta_head))
 
+/*
+ * Opt-in pool of freed operations, handed out again by
+ * ta_entry_allocate_operation() for the same algorithm, mode and
+ * maximum key size. The TA is not single instance so the pool is private
+ * to the session. Pooled operations are reset and have no key, as if just
+ * allocated.
+ */
+#define OP_POOL_SIZE	8
+
+struct op_pool_entry {
+	TEE_OperationHandle op;
+	uint32_t algo;
+	uint32_t mode;
+	uint32_t max_key_size;
+};
+
+static struct {
+	bool enabled;
+	size_t count;
+	uint32_t hits;
+	uint32_t misses;
+	struct op_pool_entry e[OP_POOL_SIZE];
+} op_pool;
+
+static TEE_OperationHandle op_pool_get(uint32_t algo, uint32_t mode,
+				       uint32_t max_key_size)
+{
+	TEE_OperationHandle op = TEE_HANDLE_NULL;
+	size_t n = 0;
+
+	if (!op_pool.enabled)
+		return TEE_HANDLE_NULL;
+
+	for (n = 0; n < op_pool.count; n++) {
+		if (op_pool.e[n].algo == algo && op_pool.e[n].mode == mode &&
+		    op_pool.e[n].max_key_size == max_key_size) {
+			op = op_pool.e[n].op;
+			op_pool.count--;
+			op_pool.e[n] = op_pool.e[op_pool.count];
+			op_pool.hits++;
+			return op;
+		}
+	}
+	op_pool.misses++;
+	return TEE_HANDLE_NULL;
+}
+
+/* Returns true if @op was pooled instead of being freed */
+static bool op_pool_put(TEE_OperationHandle op)
+{
+	TEE_OperationInfo info = { };
+
+	if (!op_pool.enabled || op_pool.count == OP_POOL_SIZE ||
+	    op == TEE_HANDLE_NULL)
+		return false;
+
+	TEE_GetOperationInfo(op, &info);
+	switch (info.operationClass) {
+	case TEE_OPERATION_DIGEST:
+		TEE_ResetOperation(op);
+		break;
+	case TEE_OPERATION_CIPHER:
+	case TEE_OPERATION_MAC:
+	case TEE_OPERATION_AE:
+		if (!(info.handleState & TEE_HANDLE_FLAG_KEY_SET))
+			break;
+		TEE_ResetOperation(op);
+		if (info.handleState & TEE_HANDLE_FLAG_EXPECT_TWO_KEYS)
+			TEE_SetOperationKey2(op, TEE_HANDLE_NULL,
+					     TEE_HANDLE_NULL);
+		else
+			TEE_SetOperationKey(op, TEE_HANDLE_NULL);
+		break;
+	default:
+		/* Asymmetric and key derivation operations aren't pooled */
+		return false;
+	}
+
+	op_pool.e[op_pool.count].op = op;
+	op_pool.e[op_pool.count].algo = info.algorithm;
+	op_pool.e[op_pool.count].mode = info.mode;
+	op_pool.e[op_pool.count].max_key_size = info.maxKeySize;
+	op_pool.count++;
+	return true;
+}
+
+static void op_pool_flush(void)
+{
+	while (op_pool.count)
+		TEE_FreeOperation(op_pool.e[--op_pool.count].op);
+}
+
 TEE_Result ta_entry_allocate_operation(uint32_t param_type, TEE_Param params[4])
 {
 	TEE_Result res;
@@ -49,6 +143,13 @@ TEE_Result ta_entry_allocate_operation(uint32_t param_type, TEE_Param params[4])
 			   TEE_PARAM_TYPE_VALUE_INPUT, TEE_PARAM_TYPE_NONE,
 			   TEE_PARAM_TYPE_NONE));
 
+	op = op_pool_get(params[0].value.b, params[1].value.a,
+			 params[1].value.b);
+	if (op != TEE_HANDLE_NULL) {
+		params[0].value.a = HANDLE2VAL(op);
+		return TEE_SUCCESS;
+	}
+
 	res = TEE_AllocateOperation(&op,
 				    params[0].value.b, params[1].value.a,
 				    params[1].value.b);
@@ -64,7 +165,44 @@ TEE_Result ta_entry_free_operation(uint32_t param_type, TEE_Param params[4])
 			  (TEE_PARAM_TYPE_VALUE_INPUT, TEE_PARAM_TYPE_NONE,
 			   TEE_PARAM_TYPE_NONE, TEE_PARAM_TYPE_NONE));
 
-	TEE_FreeOperation(op);
+	if (!op_pool_put(op))
+		TEE_FreeOperation(op);
+	return TEE_SUCCESS;
+}
+
+TEE_Result ta_entry_operation_pool(uint32_t param_type, TEE_Param params[4])
+{
+	ASSERT_PARAM_TYPE(TEE_PARAM_TYPES
+			  (TEE_PARAM_TYPE_VALUE_INPUT, TEE_PARAM_TYPE_NONE,
+			   TEE_PARAM_TYPE_NONE, TEE_PARAM_TYPE_NONE));
+
+	switch (params[0].value.a) {
+	case TA_CRYPT_OP_POOL_DISABLE:
+		op_pool_flush();
+		op_pool.enabled = false;
+		return TEE_SUCCESS;
+	case TA_CRYPT_OP_POOL_ENABLE:
+		op_pool.enabled = true;
+		op_pool.hits = 0;
+		op_pool.misses = 0;
+		return TEE_SUCCESS;
+	default:
+		return TEE_ERROR_BAD_PARAMETERS;
+	}
+}
+
+TEE_Result ta_entry_operation_pool_stats(uint32_t param_type,
+					 TEE_Param params[4])
+{
+	ASSERT_PARAM_TYPE(TEE_PARAM_TYPES
+			  (TEE_PARAM_TYPE_VALUE_OUTPUT,
+			   TEE_PARAM_TYPE_VALUE_OUTPUT, TEE_PARAM_TYPE_NONE,
+			   TEE_PARAM_TYPE_NONE));
+
+	params[0].value.a = op_pool.hits;
+	params[0].value.b = op_pool.misses;
+	params[1].value.a = op_pool.count;
+	params[1].value.b = OP_POOL_SIZE;
 	return TEE_SUCCESS;
 }
 
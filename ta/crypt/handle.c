@@ -14,66 +14,175 @@
  */
 #define HANDLE_DB_INITIAL_MAX_PTRS	4
 
+#define HANDLE_MAX_PTRS		(1U << HANDLE_INDEX_BITS)
+#define HANDLE_INDEX_MASK	(HANDLE_MAX_PTRS - 1)
+#define HANDLE_GEN_MASK		((1U << HANDLE_GEN_BITS) - 1)
+#define HANDLE_NONE		UINT32_MAX
+
 void handle_db_destroy(struct handle_db *db)
 {
+	size_t n;
+
 	if (db) {
-		TEE_Free(db->ptrs);
-		db->ptrs = NULL;
+		/*
+		 * Handles still in use are current, so start past every
+		 * generation: no handle from before resolves once regrown
+		 */
+		for (n = 0; n < db->max_ptrs; n++)
+			if (db->ents[n].gen >= db->regrow_gen)
+				db->regrow_gen = (db->ents[n].gen + 1) &
+						 HANDLE_GEN_MASK;
+		TEE_Free(db->ents);
+		db->ents = NULL;
 		db->max_ptrs = 0;
+		db->num_used = 0;
+		db->free_head = HANDLE_NONE;
+		db->shrink_delay = 0;
 	}
 }
 
-int handle_get(struct handle_db *db, void *ptr)
+/* Push the free slots [first, last) so that the lowest index pops first */
+static void push_free(struct handle_db *db, size_t first, size_t last)
 {
 	size_t n;
-	void *p;
-	size_t new_max_ptrs;
 
-	if (!db || !ptr)
-		return -1;
-
-	/* Try to find an empty location */
-	for (n = 0; n < db->max_ptrs; n++) {
-		if (!db->ptrs[n]) {
-			db->ptrs[n] = ptr;
-			return n;
-		}
+	for (n = last; n > first; n--) {
+		if (db->ents[n - 1].ptr)
+			continue;
+		db->ents[n - 1].next_free = db->free_head;
+		db->free_head = n - 1;
 	}
+}
+
+static int grow(struct handle_db *db)
+{
+	size_t new_max_ptrs;
+	size_t n;
+	void *p;
 
-	/* No location available, grow the ptrs array */
 	if (db->max_ptrs)
 		new_max_ptrs = db->max_ptrs * 2;
 	else
 		new_max_ptrs = HANDLE_DB_INITIAL_MAX_PTRS;
-	p = TEE_Realloc(db->ptrs, new_max_ptrs * sizeof(void *));
+	if (new_max_ptrs > HANDLE_MAX_PTRS)
+		return -1;
+
+	p = TEE_Realloc(db->ents, new_max_ptrs * sizeof(*db->ents));
 	if (!p)
 		return -1;
-	db->ptrs = p;
-	TEE_MemFill(db->ptrs + db->max_ptrs, 0,
-		    (new_max_ptrs - db->max_ptrs) * sizeof(void *));
+	db->ents = p;
+	TEE_MemFill(db->ents + db->max_ptrs, 0,
+		    (new_max_ptrs - db->max_ptrs) * sizeof(*db->ents));
+	for (n = db->max_ptrs; n < new_max_ptrs; n++)
+		db->ents[n].gen = db->regrow_gen;
+	push_free(db, db->max_ptrs, new_max_ptrs);
+	db->max_ptrs = new_max_ptrs;
+	db->shrink_delay = 0;
+	return 0;
+}
+
+/*
+ * Handles can't be renumbered, so only a free upper half of the array can
+ * be released. That is checked once at most a quarter of the slots is
+ * used. After a failed check the next one waits for a quarter of the slots
+ * worth of frees, which keeps the cost of the scans constant per free.
+ * The released slots take their generations with them, so grow() starts
+ * slots at regrow_gen, past every generation released so far: stale
+ * handles to them don't resolve again once they're back.
+ */
+static void shrink(struct handle_db *db)
+{
+	size_t new_max_ptrs = db->max_ptrs / 2;
+	size_t n;
+	void *p;
+
+	if (db->max_ptrs <= HANDLE_DB_INITIAL_MAX_PTRS ||
+	    db->num_used > db->max_ptrs / 4)
+		return;
+	if (db->shrink_delay) {
+		db->shrink_delay--;
+		return;
+	}
+
+	for (n = new_max_ptrs; n < db->max_ptrs; n++) {
+		if (db->ents[n].ptr) {
+			db->shrink_delay = db->max_ptrs / 4;
+			return;
+		}
+	}
+
+	for (n = new_max_ptrs; n < db->max_ptrs; n++)
+		if (db->ents[n].gen > db->regrow_gen)
+			db->regrow_gen = db->ents[n].gen;
+
+	/* Rebuild the free list without the released slots */
+	db->free_head = HANDLE_NONE;
+	push_free(db, 0, new_max_ptrs);
+	p = TEE_Realloc(db->ents, new_max_ptrs * sizeof(*db->ents));
+	if (p)
+		db->ents = p;
 	db->max_ptrs = new_max_ptrs;
+}
+
+int handle_get(struct handle_db *db, void *ptr)
+{
+	struct handle_entry *e;
+	uint32_t n;
+
+	if (!db || !ptr)
+		return -1;
+
+	if (db->free_head == HANDLE_NONE && grow(db))
+		return -1;
+
+	n = db->free_head;
+	e = db->ents + n;
+	db->free_head = e->next_free;
+	e->ptr = ptr;
+	db->num_used++;
 
-	/* Since n stopped at db->max_ptrs there is an empty location there */
-	db->ptrs[n] = ptr;
-	return n;
+	return (int)((e->gen << HANDLE_INDEX_BITS) | n);
+}
+
+static struct handle_entry *find_entry(struct handle_db *db, int handle)
+{
+	uint32_t n = (uint32_t)handle & HANDLE_INDEX_MASK;
+	struct handle_entry *e;
+
+	if (!db || handle < 0 || n >= db->max_ptrs)
+		return NULL;
+
+	e = db->ents + n;
+	if (!e->ptr || e->gen != (uint32_t)handle >> HANDLE_INDEX_BITS)
+		return NULL;
+	return e;
 }
 
 void *handle_put(struct handle_db *db, int handle)
 {
+	struct handle_entry *e = find_entry(db, handle);
 	void *p;
 
-	if (!db || handle < 0 || (size_t)handle >= db->max_ptrs)
+	if (!e)
 		return NULL;
 
-	p = db->ptrs[handle];
-	db->ptrs[handle] = NULL;
+	p = e->ptr;
+	e->ptr = NULL;
+	e->gen = (e->gen + 1) & HANDLE_GEN_MASK;
+	e->next_free = db->free_head;
+	db->free_head = e - db->ents;
+	db->num_used--;
+
+	shrink(db);
 	return p;
 }
 
 void *handle_lookup(struct handle_db *db, int handle)
 {
-	if (!db || handle < 0 || (size_t)handle >= db->max_ptrs)
+	struct handle_entry *e = find_entry(db, handle);
+
+	if (!e)
 		return NULL;
 
-	return db->ptrs[handle];
+	return e->ptr;
 }
@@ -7,17 +7,37 @@
 
 #include <tee_internal_api.h>
 
+/*
+ * A handle is a slot index in its low HANDLE_INDEX_BITS bits and the
+ * generation of the slot above. The generation is incremented each time
+ * the slot is freed, so a stale handle is detected until the generation
+ * wraps, after 2^HANDLE_GEN_BITS reuses of the same slot. Handles fit in
+ * 28 bits, callers may use the upper bits.
+ */
+#define HANDLE_INDEX_BITS	20
+#define HANDLE_GEN_BITS		8
+
+struct handle_entry {
+	void *ptr;		/* NULL if free */
+	uint32_t gen;
+	uint32_t next_free;	/* Free list link, index or UINT32_MAX */
+};
+
 struct handle_db {
-	void **ptrs;
+	struct handle_entry *ents;
 	size_t max_ptrs;
+	size_t num_used;
+	uint32_t free_head;	/* Index or UINT32_MAX */
+	size_t shrink_delay;	/* Frees before the next shrink attempt */
+	uint32_t regrow_gen;	/* Generation of the slots added by grow() */
 };
 
-#define HANDLE_DB_INITIALIZER	{ NULL, 0 }
+#define HANDLE_DB_INITIALIZER	{ NULL, 0, 0, UINT32_MAX, 0, 0 }
 
 /*
  * Frees all internal data structures of the database, but does not free
  * the db pointer. The database is safe to reuse after it's destroyed, it
- * will just be empty again.
+ * will just be empty again and the handles from before stay invalid.
  */
 void handle_db_destroy(struct handle_db *db);
 
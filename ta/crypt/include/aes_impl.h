@@ -28,6 +28,9 @@
 #ifndef AES_IMPL_H
 #define AES_IMPL_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 int rijndaelSetupEncrypt(unsigned long *rk, const unsigned char *key,
 			 int keybits);
 
@@ -42,6 +45,37 @@ void rijndaelDecrypt(const unsigned long *rk, int nrounds,
 		     const unsigned char ciphertext[16],
 		     unsigned char plaintext[16]);
 
+/* Blocks interleaved by rijndaelEncryptBlocks()/rijndaelDecryptBlocks() */
+#define AES_MB_BLOCKS		4
+
+void rijndaelEncryptBlocks(const unsigned long *rk, int nrounds,
+			   const unsigned char *plaintext,
+			   unsigned char *ciphertext, size_t nblocks);
+
+void rijndaelDecryptBlocks(const unsigned long *rk, int nrounds,
+			   const unsigned char *ciphertext,
+			   unsigned char *plaintext, size_t nblocks);
+
+/* Blocks processed together by the bitsliced implementation */
+#define AES_BS_BLOCKS		4
+#define AES_BS_MAX_ROUNDS	14
+
+struct rijndael_bs_key {
+	uint64_t rk[AES_BS_MAX_ROUNDS + 1][8];
+	int nrounds;
+};
+
+int rijndaelSetupBitsliced(struct rijndael_bs_key *bk,
+			   const unsigned char *key, int keybits);
+
+void rijndaelEncryptBitsliced(const struct rijndael_bs_key *bk,
+			      const unsigned char *plaintext,
+			      unsigned char *ciphertext, size_t nblocks);
+
+void rijndaelDecryptBitsliced(const struct rijndael_bs_key *bk,
+			      const unsigned char *ciphertext,
+			      unsigned char *plaintext, size_t nblocks);
+
 #define AES_BLOCK_SIZE		128
 
 #define AES_128			128
@@ -30,11 +30,14 @@
 
 #include <tee_api.h>
 
-/* params[0] is input buffer and params[1] is output buffer */
+/*
+ * params[0] is input buffer and params[1] is output buffer, optional
+ * params[2] selects the implementation (see TA_CRYPT_AES_PATH_*)
+ */
 TEE_Result ta_entry_aes256ecb_encrypt(uint32_t param_types,
 				      TEE_Param params[4]);
 
-/* params[0] is input buffer and params[1] is output buffer */
+/* Same parameters as ta_entry_aes256ecb_encrypt() */
 TEE_Result ta_entry_aes256ecb_decrypt(uint32_t param_types,
 				      TEE_Param params[4]);
 
@@ -68,5 +68,9 @@ TEE_Result ta_entry_arith_from_fmm(uint32_t param_type,
 				   TEE_Param params[TEE_NUM_PARAMS]);
 TEE_Result ta_entry_arith_compute_fmm(uint32_t param_type,
 				      TEE_Param params[TEE_NUM_PARAMS]);
+TEE_Result ta_entry_arith_program(uint32_t param_type,
+				  TEE_Param params[TEE_NUM_PARAMS]);
+TEE_Result ta_entry_arith_handle_bench(uint32_t param_type,
+				       TEE_Param params[TEE_NUM_PARAMS]);
 
 #endif /*__ARITH_TAF_H*/
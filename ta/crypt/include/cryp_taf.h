@@ -36,6 +36,11 @@ TEE_Result ta_entry_allocate_operation(uint32_t param_type, TEE_Param params[4]
 TEE_Result ta_entry_free_operation(uint32_t param_type, TEE_Param params[4]
 );
 
+TEE_Result ta_entry_operation_pool(uint32_t param_type, TEE_Param params[4]);
+
+TEE_Result ta_entry_operation_pool_stats(uint32_t param_type,
+					 TEE_Param params[4]);
+
 TEE_Result ta_entry_get_operation_info(uint32_t param_type, TEE_Param params[4]
 );
 
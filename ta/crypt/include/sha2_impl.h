@@ -64,9 +64,17 @@
 
 #define SHA224_DIGEST_SIZE (224 / 8)
 #define SHA256_DIGEST_SIZE (256 / 8)
+#define SHA384_DIGEST_SIZE (384 / 8)
+#define SHA512_DIGEST_SIZE (512 / 8)
 
 #define SHA256_BLOCK_SIZE  (512 / 8)
 #define SHA224_BLOCK_SIZE  SHA256_BLOCK_SIZE
+#define SHA512_BLOCK_SIZE  (1024 / 8)
+#define SHA384_BLOCK_SIZE  SHA512_BLOCK_SIZE
+
+/* sha256_fast_impl() return values */
+#define SHA256_IMPL_WINDOW	0	/* Portable C, 16-word schedule */
+#define SHA256_IMPL_CE		1	/* ARMv8 Cryptographic Extension */
 
 struct sha224_ctx {
 	unsigned int tot_len;
@@ -82,6 +90,20 @@ struct sha256_ctx {
 	uint32_t h[8];
 };
 
+struct sha384_ctx {
+	unsigned int tot_len;
+	unsigned int len;
+	unsigned char block[2 * SHA384_BLOCK_SIZE];
+	uint64_t h[8];
+};
+
+struct sha512_ctx {
+	unsigned int tot_len;
+	unsigned int len;
+	unsigned char block[2 * SHA512_BLOCK_SIZE];
+	uint64_t h[8];
+};
+
 void sha224_init(struct sha224_ctx *ctx);
 void sha224_update(struct sha224_ctx *ctx, const unsigned char *message,
 		   unsigned int len);
@@ -98,4 +120,35 @@ void sha256(const unsigned char *message, unsigned int len,
 
 void sha256_transf(struct sha256_ctx *ctx, const unsigned char *message,
 		   unsigned int block_nb);
+
+/*
+ * SHA-256 on the optimised transform: ARMv8 Cryptographic Extension when
+ * built with CFG_CRYPT_SHA2_CE=y, rolling 16-word schedule otherwise.
+ * Contexts come from sha256_init().
+ */
+void sha256_fast_update(struct sha256_ctx *ctx, const unsigned char *message,
+			unsigned int len);
+void sha256_fast_final(struct sha256_ctx *ctx, unsigned char *digest);
+void sha256_fast(const unsigned char *message, unsigned int len,
+		 unsigned char *digest);
+void sha256_transf_fast(struct sha256_ctx *ctx, const unsigned char *message,
+			unsigned int block_nb);
+int sha256_fast_impl(void);
+
+void sha384_init(struct sha384_ctx *ctx);
+void sha384_update(struct sha384_ctx *ctx, const unsigned char *message,
+		   unsigned int len);
+void sha384_final(struct sha384_ctx *ctx, unsigned char *digest);
+void sha384(const unsigned char *message, unsigned int len,
+	    unsigned char *digest);
+
+void sha512_init(struct sha512_ctx *ctx);
+void sha512_update(struct sha512_ctx *ctx, const unsigned char *message,
+		   unsigned int len);
+void sha512_final(struct sha512_ctx *ctx, unsigned char *digest);
+void sha512(const unsigned char *message, unsigned int len,
+	    unsigned char *digest);
+
+void sha512_transf(struct sha512_ctx *ctx, const unsigned char *message,
+		   unsigned int block_nb);
 #endif
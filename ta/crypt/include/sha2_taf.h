@@ -36,4 +36,16 @@ TEE_Result ta_entry_sha224(uint32_t param_types, TEE_Param params[4]);
 /* params[0] is input buffer and params[1] is output buffer */
 TEE_Result ta_entry_sha256(uint32_t param_types, TEE_Param params[4]);
 
+/*
+ * Same as ta_entry_sha256() on the optimised transform, optional
+ * params[2] (value output) returns the implementation in value.a
+ */
+TEE_Result ta_entry_sha256_fast(uint32_t param_types, TEE_Param params[4]);
+
+/* params[0] is input buffer and params[1] is output buffer */
+TEE_Result ta_entry_sha384(uint32_t param_types, TEE_Param params[4]);
+
+/* params[0] is input buffer and params[1] is output buffer */
+TEE_Result ta_entry_sha512(uint32_t param_types, TEE_Param params[4]);
+
 #endif
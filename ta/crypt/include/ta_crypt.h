@@ -28,6 +28,8 @@
 #ifndef TA_CRYPT_H
 #define TA_CRYPT_H
 
+#include <stdint.h>
+
 /* This UUID is generated with the ITU-T UUID generator at
    http://www.itu.int/ITU-T/asn1/uuid.html */
 #define TA_CRYPT_UUID { 0xcb3e5ba0, 0xadf1, 0x11e0, \
@@ -35,9 +37,38 @@
 
 #define TA_CRYPT_CMD_SHA224             1
 #define TA_CRYPT_CMD_SHA256             2
+/*
+ * Software SHA-256 on the optimised transform, SHA-384 and SHA-512
+ * in       params[0].memref = message
+ * out      params[1].memref = digest
+ * SHA256_FAST only, optional:
+ * out      params[2].value.a = TA_CRYPT_SHA256_IMPL_*
+ */
+#define TA_CRYPT_CMD_SHA256_FAST        79
+#define TA_CRYPT_CMD_SHA384             80
+#define TA_CRYPT_CMD_SHA512             81
+#define TA_CRYPT_SHA256_IMPL_WINDOW     0	/* Rolling 16-word schedule */
+#define TA_CRYPT_SHA256_IMPL_CE         1	/* ARMv8 Crypto Extension */
 #define TA_CRYPT_CMD_AES256ECB_ENC      3
 #define TA_CRYPT_CMD_AES256ECB_DEC      4
 
+/*
+ * AES-256 ECB with the fixed test key, software implementation
+ * in       params[0].memref = input, a multiple of 16 bytes
+ * out      params[1].memref = output
+ * Optional:
+ * in/out   params[2].value.a = requested TA_CRYPT_AES_PATH_*
+ * out      params[2].value.b = TA_CRYPT_AES_PATH_* that was used
+ *
+ * TA_CRYPT_AES_PATH_AUTO uses the multi-block path when there are at
+ * least 4 blocks and the reference path otherwise. The bitsliced path
+ * is constant time but only runs when requested.
+ */
+#define TA_CRYPT_AES_PATH_AUTO          0
+#define TA_CRYPT_AES_PATH_REFERENCE     1
+#define TA_CRYPT_AES_PATH_MULTIBLOCK    2
+#define TA_CRYPT_AES_PATH_BITSLICED     3
+
 /*
  * TEE_Result TEE_AllocateOperation(TEE_OperationHandle *operation,
  *              uint32_t algorithm, uint32_t mode, uint32_t maxKeySize);
@@ -54,6 +85,27 @@
  */
 #define TA_CRYPT_CMD_FREE_OPERATION     6
 
+/*
+ * Enables or disables the operation pool of the session. While enabled,
+ * FREE_OPERATION keeps up to a few digest, cipher, MAC and AE operations,
+ * reset and without key, which ALLOCATE_OPERATION hands out again for the
+ * same algorithm, mode and maxKeySize. Enabling clears the counters,
+ * disabling frees the pooled operations.
+ * in       params[0].value.a = TA_CRYPT_OP_POOL_*
+ */
+#define TA_CRYPT_CMD_OPERATION_POOL     82
+#define TA_CRYPT_OP_POOL_DISABLE        0
+#define TA_CRYPT_OP_POOL_ENABLE         1
+
+/*
+ * Operation pool counters
+ * out      params[0].value.a = allocations served from the pool
+ * out      params[0].value.b = allocations not found in the pool
+ * out      params[1].value.a = operations currently pooled
+ * out      params[1].value.b = pool capacity
+ */
+#define TA_CRYPT_CMD_OPERATION_POOL_STATS 83
+
 /*
  * void TEE_GetOperationInfo(TEE_OperationHandle operation,
  *              TEE_OperationInfo* operationInfo);
@@ -611,4 +663,96 @@
  */
 #define TA_CRYPT_CMD_ARITH_COMPUTE_FMM		76
 
+/*
+ * Executes a program of big integer instructions in a single invocation.
+ * Each instruction is two 32-bit words, see TA_CRYPT_ARITH_INSN(), its
+ * operands d, a and b being indexes in the register array. c is a
+ * register index for the modular operations and an immediate otherwise.
+ * There are no branches: CMP, CMP_S32 and GET_BIT set a flag which SELECT
+ * tests.
+ *
+ * in	params[0].memref:	program, array of uint32_t
+ * in	params[1].memref:	registers, array of handles to bignum variables
+ * out	params[2].value.a:	S32 flag after the last instruction
+ */
+#define TA_CRYPT_CMD_ARITH_PROGRAM		77
+
+#define TA_CRYPT_ARITH_INSN(op, d, a, b, c) \
+	((uint32_t)(op) | ((uint32_t)(d) << 8) | ((uint32_t)(a) << 16) | \
+	 ((uint32_t)(b) << 24)), (uint32_t)(c)
+
+#define TA_CRYPT_ARITH_OP_ADD		0	/* d = a + b */
+#define TA_CRYPT_ARITH_OP_SUB		1	/* d = a - b */
+#define TA_CRYPT_ARITH_OP_MUL		2	/* d = a * b */
+#define TA_CRYPT_ARITH_OP_SQR		3	/* d = a * a */
+#define TA_CRYPT_ARITH_OP_MOD		4	/* d = a mod b */
+#define TA_CRYPT_ARITH_OP_ADDMOD	5	/* d = (a + b) mod c */
+#define TA_CRYPT_ARITH_OP_SUBMOD	6	/* d = (a - b) mod c */
+#define TA_CRYPT_ARITH_OP_MULMOD	7	/* d = (a * b) mod c */
+#define TA_CRYPT_ARITH_OP_SQRMOD	8	/* d = (a * a) mod b */
+#define TA_CRYPT_ARITH_OP_INVMOD	9	/* d = a^-1 mod b */
+#define TA_CRYPT_ARITH_OP_COPY		10	/* d = a */
+#define TA_CRYPT_ARITH_OP_CMP		11	/* flag = cmp(a, b) */
+#define TA_CRYPT_ARITH_OP_CMP_S32	12	/* flag = cmp(a, (int32_t)c) */
+#define TA_CRYPT_ARITH_OP_GET_BIT	13	/* flag = bit c of a */
+#define TA_CRYPT_ARITH_OP_SELECT	14	/* d = flag in c ? a : b */
+
+/* Conditions of TA_CRYPT_ARITH_OP_SELECT, may be or'ed */
+#define TA_CRYPT_ARITH_COND_LT		0x1	/* flag < 0 */
+#define TA_CRYPT_ARITH_COND_EQ		0x2	/* flag == 0 */
+#define TA_CRYPT_ARITH_COND_GT		0x4	/* flag > 0 */
+
+/*
+ * Times the handle database of the arith commands on a private database:
+ * allocate handles, look them all up, free and reallocate every other one,
+ * then free them all. Fails if a lookup fails or a stale handle resolves.
+ * Times are the sums over all rounds.
+ *
+ * in	params[0].value.a:	Number of handles
+ * in	params[0].value.b:	Number of rounds
+ * out	params[1].value.a:	Allocation time in ms
+ * out	params[1].value.b:	Lookup time in ms
+ * out	params[2].value.a:	Free and reallocation time in ms
+ * out	params[2].value.b:	Free time in ms
+ */
+#define TA_CRYPT_CMD_ARITH_HANDLE_BENCH		78
+
+/*
+ * Runs a list of crypt TA commands in one invocation. The buffer holds a
+ * struct ta_crypt_batch_hdr, num_steps struct ta_crypt_batch_step and
+ * then the data of the memref parameters of the steps. Steps run in order
+ * until one fails: its result and those of the steps before it are
+ * returned in res, num_done is the number of steps which were run.
+ * Handles allocated by the steps which were run stay allocated when a
+ * later step fails, freeing them is up to the caller.
+ *
+ * For each parameter of a step p[n][0] and p[n][1] are the value a and b,
+ * or the offset from the start of the buffer and the size of a memref,
+ * updated with the output size, also when the step fails with
+ * TEE_ERROR_SHORT_BUFFER. A value field whose bit is set in refs
+ * (TA_CRYPT_BATCH_REF_BIT()) is instead a TA_CRYPT_BATCH_REF() to a field
+ * of an earlier step, as returned by that step: this is how handles are
+ * passed from an allocation to the steps using it.
+ *
+ * in/out   params[0].memref = batch buffer
+ */
+#define TA_CRYPT_CMD_BATCH              84
+
+struct ta_crypt_batch_hdr {
+	uint32_t num_steps;
+	uint32_t num_done;
+};
+
+struct ta_crypt_batch_step {
+	uint32_t cmd;
+	uint32_t param_types;
+	uint32_t refs;
+	uint32_t res;
+	uint32_t p[4][2];
+};
+
+#define TA_CRYPT_BATCH_REF_BIT(param, field)	(1 << ((param) * 2 + (field)))
+#define TA_CRYPT_BATCH_REF(step, param, field) \
+	(((uint32_t)(step) << 3) | ((param) << 1) | (field))
+
 #endif /*TA_CRYPT_H */
@@ -132,6 +132,10 @@ uint32_t sha256_k[64] = {
 	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
 };
 
+typedef void (*sha256_transf_fn)(struct sha256_ctx *ctx,
+				 const unsigned char *message,
+				 unsigned int block_nb);
+
 /* SHA-256 functions */
 void sha256_transf(struct sha256_ctx *ctx, const unsigned char *message,
 		   unsigned int block_nb)
@@ -360,8 +364,9 @@ void sha256_init(struct sha256_ctx *ctx)
 	ctx->tot_len = 0;
 }
 
-void sha256_update(struct sha256_ctx *ctx, const unsigned char *message,
-		   unsigned int len)
+static void sha256_update_with(struct sha256_ctx *ctx,
+			       const unsigned char *message, unsigned int len,
+			       sha256_transf_fn transf)
 {
 	unsigned int block_nb;
 	unsigned int new_len, rem_len, tmp_len;
@@ -384,8 +389,8 @@ void sha256_update(struct sha256_ctx *ctx, const unsigned char *message,
 
 	shifted_message = message + rem_len;
 
-	sha256_transf(ctx, ctx->block, 1);
-	sha256_transf(ctx, shifted_message, block_nb);
+	transf(ctx, ctx->block, 1);
+	transf(ctx, shifted_message, block_nb);
 
 	rem_len = new_len % SHA256_BLOCK_SIZE;
 
@@ -396,7 +401,14 @@ void sha256_update(struct sha256_ctx *ctx, const unsigned char *message,
 	ctx->tot_len += (block_nb + 1) << 6;
 }
 
-void sha256_final(struct sha256_ctx *ctx, unsigned char *digest)
+void sha256_update(struct sha256_ctx *ctx, const unsigned char *message,
+		   unsigned int len)
+{
+	sha256_update_with(ctx, message, len, sha256_transf);
+}
+
+static void sha256_final_with(struct sha256_ctx *ctx, unsigned char *digest,
+			      sha256_transf_fn transf)
 {
 	unsigned int block_nb;
 	unsigned int pm_len;
@@ -419,7 +431,7 @@ void sha256_final(struct sha256_ctx *ctx, unsigned char *digest)
 	ctx->block[ctx->len] = 0x80;
 	UNPACK32(len_b, ctx->block + pm_len - 4);
 
-	sha256_transf(ctx, ctx->block, block_nb);
+	transf(ctx, ctx->block, block_nb);
 
 #ifndef UNROLL_LOOPS
 	for (i = 0; i < 8; i++)
@@ -436,6 +448,11 @@ void sha256_final(struct sha256_ctx *ctx, unsigned char *digest)
 #endif
 }
 
+void sha256_final(struct sha256_ctx *ctx, unsigned char *digest)
+{
+	sha256_final_with(ctx, digest, sha256_transf);
+}
+
 /* SHA-224 functions */
 void sha224(const unsigned char *message, unsigned int len,
 	    unsigned char *digest)
@@ -543,3 +560,434 @@ void sha224_final(struct sha224_ctx *ctx, unsigned char *digest)
 	UNPACK32(ctx->h[6], &digest[24]);
 #endif
 }
+
+/*
+ * SHA-256 with the message schedule kept in a rolling window of 16 words
+ * instead of the 64-word array, all rounds unrolled so that the window
+ * indices and the round constants are known at compile time.
+ */
+#define SHA256_W_LOAD(i)	(w[i])
+#define SHA256_W_NEXT(i)						\
+	(w[(i) & 15] += SHA256_F4(w[((i) - 2) & 15]) +			\
+			w[((i) - 7) & 15] + SHA256_F3(w[((i) - 15) & 15]))
+
+#define SHA256_RND(a, b, c, d, e, f, g, h, i, W)			\
+	do {								\
+		t1 = h + SHA256_F2(e) + CH(e, f, g) + sha256_k[i] + W(i); \
+		t2 = SHA256_F1(a) + MAJ(a, b, c);			\
+		d += t1;						\
+		h = t1 + t2;						\
+	} while (0)
+
+#define SHA256_RND8(i, W)						\
+	do {								\
+		SHA256_RND(a, b, c, d, e, f, g, h, (i) + 0, W);		\
+		SHA256_RND(h, a, b, c, d, e, f, g, (i) + 1, W);		\
+		SHA256_RND(g, h, a, b, c, d, e, f, (i) + 2, W);		\
+		SHA256_RND(f, g, h, a, b, c, d, e, (i) + 3, W);		\
+		SHA256_RND(e, f, g, h, a, b, c, d, (i) + 4, W);		\
+		SHA256_RND(d, e, f, g, h, a, b, c, (i) + 5, W);		\
+		SHA256_RND(c, d, e, f, g, h, a, b, (i) + 6, W);		\
+		SHA256_RND(b, c, d, e, f, g, h, a, (i) + 7, W);		\
+	} while (0)
+
+static void sha256_transf_window(struct sha256_ctx *ctx,
+				 const unsigned char *message,
+				 unsigned int block_nb)
+{
+	uint32_t a, b, c, d, e, f, g, h;
+	uint32_t w[16];
+	uint32_t t1, t2;
+	unsigned int i;
+	int j;
+
+	for (i = 0; i < block_nb; i++, message += SHA256_BLOCK_SIZE) {
+		for (j = 0; j < 16; j++)
+			PACK32(&message[j << 2], &w[j]);
+
+		a = ctx->h[0];
+		b = ctx->h[1];
+		c = ctx->h[2];
+		d = ctx->h[3];
+		e = ctx->h[4];
+		f = ctx->h[5];
+		g = ctx->h[6];
+		h = ctx->h[7];
+
+		SHA256_RND8(0, SHA256_W_LOAD);
+		SHA256_RND8(8, SHA256_W_LOAD);
+		SHA256_RND8(16, SHA256_W_NEXT);
+		SHA256_RND8(24, SHA256_W_NEXT);
+		SHA256_RND8(32, SHA256_W_NEXT);
+		SHA256_RND8(40, SHA256_W_NEXT);
+		SHA256_RND8(48, SHA256_W_NEXT);
+		SHA256_RND8(56, SHA256_W_NEXT);
+
+		ctx->h[0] += a;
+		ctx->h[1] += b;
+		ctx->h[2] += c;
+		ctx->h[3] += d;
+		ctx->h[4] += e;
+		ctx->h[5] += f;
+		ctx->h[6] += g;
+		ctx->h[7] += h;
+	}
+}
+
+#ifdef CFG_CRYPT_SHA2_CE
+#ifndef __aarch64__
+#error CFG_CRYPT_SHA2_CE requires an AArch64 TA
+#endif
+#include <arm_neon.h>
+
+/* ARMv8 Cryptographic Extension: four rounds per SHA256H/SHA256H2 pair */
+static void sha256_transf_ce(struct sha256_ctx *ctx,
+			     const unsigned char *message,
+			     unsigned int block_nb)
+{
+	uint32x4_t abcd = vld1q_u32(ctx->h);
+	uint32x4_t efgh = vld1q_u32(ctx->h + 4);
+	uint32x4_t abcd0, efgh0, tmp, wk;
+	uint32x4_t m[4];
+	unsigned int i;
+	int j;
+
+	for (i = 0; i < block_nb; i++, message += SHA256_BLOCK_SIZE) {
+		for (j = 0; j < 4; j++)
+			m[j] = vreinterpretq_u32_u8(vrev32q_u8(
+					vld1q_u8(message + 16 * j)));
+		abcd0 = abcd;
+		efgh0 = efgh;
+
+		for (j = 0; j < 16; j++) {
+			wk = vaddq_u32(m[j & 3], vld1q_u32(sha256_k + 4 * j));
+			if (j < 12)
+				m[j & 3] = vsha256su1q_u32(
+					vsha256su0q_u32(m[j & 3],
+							m[(j + 1) & 3]),
+					m[(j + 2) & 3], m[(j + 3) & 3]);
+			tmp = abcd;
+			abcd = vsha256hq_u32(abcd, efgh, wk);
+			efgh = vsha256h2q_u32(efgh, tmp, wk);
+		}
+
+		abcd = vaddq_u32(abcd, abcd0);
+		efgh = vaddq_u32(efgh, efgh0);
+	}
+
+	vst1q_u32(ctx->h, abcd);
+	vst1q_u32(ctx->h + 4, efgh);
+}
+#endif /*CFG_CRYPT_SHA2_CE*/
+
+/* Optimised SHA-256: same interface as sha256_transf() */
+void sha256_transf_fast(struct sha256_ctx *ctx, const unsigned char *message,
+			unsigned int block_nb)
+{
+#ifdef CFG_CRYPT_SHA2_CE
+	sha256_transf_ce(ctx, message, block_nb);
+#else
+	sha256_transf_window(ctx, message, block_nb);
+#endif
+}
+
+/* Implementation behind sha256_transf_fast(), a SHA256_IMPL_* value */
+int sha256_fast_impl(void)
+{
+#ifdef CFG_CRYPT_SHA2_CE
+	return SHA256_IMPL_CE;
+#else
+	return SHA256_IMPL_WINDOW;
+#endif
+}
+
+void sha256_fast_update(struct sha256_ctx *ctx, const unsigned char *message,
+			unsigned int len)
+{
+	sha256_update_with(ctx, message, len, sha256_transf_fast);
+}
+
+void sha256_fast_final(struct sha256_ctx *ctx, unsigned char *digest)
+{
+	sha256_final_with(ctx, digest, sha256_transf_fast);
+}
+
+void sha256_fast(const unsigned char *message, unsigned int len,
+		 unsigned char *digest)
+{
+	struct sha256_ctx ctx;
+
+	sha256_init(&ctx);
+	sha256_fast_update(&ctx, message, len);
+	sha256_fast_final(&ctx, digest);
+}
+
+/* SHA-512 and SHA-384 */
+#define SHA512_F1(x) (ROTR(x, 28) ^ ROTR(x, 34) ^ ROTR(x, 39))
+#define SHA512_F2(x) (ROTR(x, 14) ^ ROTR(x, 18) ^ ROTR(x, 41))
+#define SHA512_F3(x) (ROTR(x,  1) ^ ROTR(x,  8) ^ SHFR(x,  7))
+#define SHA512_F4(x) (ROTR(x, 19) ^ ROTR(x, 61) ^ SHFR(x,  6))
+
+#define UNPACK64(x, str)					\
+	{							\
+		UNPACK32((uint32_t)((x) >> 32), (str));		\
+		UNPACK32((uint32_t)(x), (str) + 4);		\
+	}
+
+#define PACK64(str, x)						\
+	{							\
+		uint32_t hi, lo;				\
+								\
+		PACK32((str), &hi);				\
+		PACK32((str) + 4, &lo);				\
+		*(x) = ((uint64_t)hi << 32) | lo;		\
+	}
+
+static const uint64_t sha384_h0[8] = {
+	0xcbbb9d5dc1059ed8ULL, 0x629a292a367cd507ULL,
+	0x9159015a3070dd17ULL, 0x152fecd8f70e5939ULL,
+	0x67332667ffc00b31ULL, 0x8eb44a8768581511ULL,
+	0xdb0c2e0d64f98fa7ULL, 0x47b5481dbefa4fa4ULL,
+};
+
+static const uint64_t sha512_h0[8] = {
+	0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL,
+	0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+	0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL,
+	0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL,
+};
+
+static const uint64_t sha512_k[80] = {
+	0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL,
+	0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL,
+	0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL,
+	0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL,
+	0xd807aa98a3030242ULL, 0x12835b0145706fbeULL,
+	0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+	0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL,
+	0x9bdc06a725c71235ULL, 0xc19bf174cf692694ULL,
+	0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL,
+	0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL,
+	0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL,
+	0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+	0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL,
+	0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL,
+	0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL,
+	0x06ca6351e003826fULL, 0x142929670a0e6e70ULL,
+	0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL,
+	0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+	0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL,
+	0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
+	0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL,
+	0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL,
+	0xd192e819d6ef5218ULL, 0xd69906245565a910ULL,
+	0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+	0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL,
+	0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL,
+	0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL,
+	0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL,
+	0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL,
+	0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+	0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL,
+	0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL,
+	0xca273eceea26619cULL, 0xd186b8c721c0c207ULL,
+	0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL,
+	0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL,
+	0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+	0x28db77f523047d84ULL, 0x32caab7b40c72493ULL,
+	0x3c9ebe0a15c9bebcULL, 0x431d67c49c100d4cULL,
+	0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL,
+	0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL,
+};
+
+#define SHA512_W_LOAD(i)	(w[i])
+#define SHA512_W_NEXT(i)						\
+	(w[(i) & 15] += SHA512_F4(w[((i) - 2) & 15]) +			\
+			w[((i) - 7) & 15] + SHA512_F3(w[((i) - 15) & 15]))
+
+#define SHA512_RND(a, b, c, d, e, f, g, h, i, W)			\
+	do {								\
+		t1 = h + SHA512_F2(e) + CH(e, f, g) + sha512_k[i] + W(i); \
+		t2 = SHA512_F1(a) + MAJ(a, b, c);			\
+		d += t1;						\
+		h = t1 + t2;						\
+	} while (0)
+
+#define SHA512_RND8(i, W)						\
+	do {								\
+		SHA512_RND(a, b, c, d, e, f, g, h, (i) + 0, W);		\
+		SHA512_RND(h, a, b, c, d, e, f, g, (i) + 1, W);		\
+		SHA512_RND(g, h, a, b, c, d, e, f, (i) + 2, W);		\
+		SHA512_RND(f, g, h, a, b, c, d, e, (i) + 3, W);		\
+		SHA512_RND(e, f, g, h, a, b, c, d, (i) + 4, W);		\
+		SHA512_RND(d, e, f, g, h, a, b, c, (i) + 5, W);		\
+		SHA512_RND(c, d, e, f, g, h, a, b, (i) + 6, W);		\
+		SHA512_RND(b, c, d, e, f, g, h, a, (i) + 7, W);		\
+	} while (0)
+
+void sha512_transf(struct sha512_ctx *ctx, const unsigned char *message,
+		   unsigned int block_nb)
+{
+	uint64_t a, b, c, d, e, f, g, h;
+	uint64_t w[16];
+	uint64_t t1, t2;
+	unsigned int i;
+	int j;
+
+	for (i = 0; i < block_nb; i++, message += SHA512_BLOCK_SIZE) {
+		for (j = 0; j < 16; j++)
+			PACK64(&message[j << 3], &w[j]);
+
+		a = ctx->h[0];
+		b = ctx->h[1];
+		c = ctx->h[2];
+		d = ctx->h[3];
+		e = ctx->h[4];
+		f = ctx->h[5];
+		g = ctx->h[6];
+		h = ctx->h[7];
+
+		SHA512_RND8(0, SHA512_W_LOAD);
+		SHA512_RND8(8, SHA512_W_LOAD);
+		SHA512_RND8(16, SHA512_W_NEXT);
+		SHA512_RND8(24, SHA512_W_NEXT);
+		SHA512_RND8(32, SHA512_W_NEXT);
+		SHA512_RND8(40, SHA512_W_NEXT);
+		SHA512_RND8(48, SHA512_W_NEXT);
+		SHA512_RND8(56, SHA512_W_NEXT);
+		SHA512_RND8(64, SHA512_W_NEXT);
+		SHA512_RND8(72, SHA512_W_NEXT);
+
+		ctx->h[0] += a;
+		ctx->h[1] += b;
+		ctx->h[2] += c;
+		ctx->h[3] += d;
+		ctx->h[4] += e;
+		ctx->h[5] += f;
+		ctx->h[6] += g;
+		ctx->h[7] += h;
+	}
+}
+
+void sha512_init(struct sha512_ctx *ctx)
+{
+	int i;
+
+	for (i = 0; i < 8; i++)
+		ctx->h[i] = sha512_h0[i];
+
+	ctx->len = 0;
+	ctx->tot_len = 0;
+}
+
+void sha512_update(struct sha512_ctx *ctx, const unsigned char *message,
+		   unsigned int len)
+{
+	unsigned int block_nb;
+	unsigned int new_len, rem_len, tmp_len;
+	const unsigned char *shifted_message;
+	unsigned long int i;
+
+	tmp_len = SHA512_BLOCK_SIZE - ctx->len;
+	rem_len = len < tmp_len ? len : tmp_len;
+
+	for (i = 0; i < rem_len; i++)
+		ctx->block[ctx->len + i] = message[i];
+
+	if (ctx->len + len < SHA512_BLOCK_SIZE) {
+		ctx->len += len;
+		return;
+	}
+
+	new_len = len - rem_len;
+	block_nb = new_len / SHA512_BLOCK_SIZE;
+
+	shifted_message = message + rem_len;
+
+	sha512_transf(ctx, ctx->block, 1);
+	sha512_transf(ctx, shifted_message, block_nb);
+
+	rem_len = new_len % SHA512_BLOCK_SIZE;
+
+	for (i = 0; i < rem_len; i++)
+		ctx->block[i] = shifted_message[(block_nb << 7) + i];
+
+	ctx->len = rem_len;
+	ctx->tot_len += (block_nb + 1) << 7;
+}
+
+/* Pads and processes the last block(s), @nwords 64-bit words of digest */
+static void sha512_final_words(struct sha512_ctx *ctx, unsigned char *digest,
+			       int nwords)
+{
+	unsigned int block_nb;
+	unsigned int pm_len;
+	uint64_t len_b;
+	unsigned long int i_m;
+	int i;
+
+	block_nb = 1 + ((SHA512_BLOCK_SIZE - 17)
+			< (ctx->len % SHA512_BLOCK_SIZE));
+
+	len_b = ((uint64_t)ctx->tot_len + ctx->len) << 3;
+	pm_len = block_nb << 7;
+
+	for (i_m = 0; i_m < pm_len - ctx->len; i_m++)
+		ctx->block[ctx->len + i_m] = 0;
+
+	ctx->block[ctx->len] = 0x80;
+	/* The upper 64 bits of the 128-bit length are zero */
+	UNPACK64(len_b, ctx->block + pm_len - 8);
+
+	sha512_transf(ctx, ctx->block, block_nb);
+
+	for (i = 0; i < nwords; i++)
+		UNPACK64(ctx->h[i], &digest[i << 3]);
+}
+
+void sha512_final(struct sha512_ctx *ctx, unsigned char *digest)
+{
+	sha512_final_words(ctx, digest, 8);
+}
+
+void sha512(const unsigned char *message, unsigned int len,
+	    unsigned char *digest)
+{
+	struct sha512_ctx ctx;
+
+	sha512_init(&ctx);
+	sha512_update(&ctx, message, len);
+	sha512_final(&ctx, digest);
+}
+
+void sha384_init(struct sha384_ctx *ctx)
+{
+	int i;
+
+	for (i = 0; i < 8; i++)
+		ctx->h[i] = sha384_h0[i];
+
+	ctx->len = 0;
+	ctx->tot_len = 0;
+}
+
+void sha384_update(struct sha384_ctx *ctx, const unsigned char *message,
+		   unsigned int len)
+{
+	sha512_update((struct sha512_ctx *)ctx, message, len);
+}
+
+void sha384_final(struct sha384_ctx *ctx, unsigned char *digest)
+{
+	sha512_final_words((struct sha512_ctx *)ctx, digest, 6);
+}
+
+void sha384(const unsigned char *message, unsigned int len,
+	    unsigned char *digest)
+{
+	struct sha384_ctx ctx;
+
+	sha384_init(&ctx);
+	sha384_update(&ctx, message, len);
+	sha384_final(&ctx, digest);
+}
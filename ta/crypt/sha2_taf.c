@@ -73,3 +73,50 @@ TEE_Result ta_entry_sha256(uint32_t param_types, TEE_Param params[4])
 
 	return TEE_SUCCESS;
 }
+
+static TEE_Result digest(uint32_t param_types, TEE_Param params[4],
+			 size_t digest_size,
+			 void (*fn)(const unsigned char *message,
+				    unsigned int len, unsigned char *digest))
+{
+	if (param_types !=
+	    TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT,
+			    TEE_PARAM_TYPE_MEMREF_OUTPUT, TEE_PARAM_TYPE_NONE,
+			    TEE_PARAM_TYPE_NONE)) {
+		return TEE_ERROR_BAD_PARAMETERS;
+	}
+
+	if (params[1].memref.size < digest_size)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	fn((unsigned char *)params[0].memref.buffer,
+	   (unsigned int)params[0].memref.size,
+	   (unsigned char *)params[1].memref.buffer);
+
+	return TEE_SUCCESS;
+}
+
+TEE_Result ta_entry_sha256_fast(uint32_t param_types, TEE_Param params[4])
+{
+	/* Optional params[2].value.a tells which implementation ran */
+	if (TEE_PARAM_TYPE_GET(param_types, 2) == TEE_PARAM_TYPE_VALUE_OUTPUT) {
+		params[2].value.a = sha256_fast_impl();
+		params[2].value.b = 0;
+		param_types = TEE_PARAM_TYPES(TEE_PARAM_TYPE_GET(param_types, 0),
+					      TEE_PARAM_TYPE_GET(param_types, 1),
+					      TEE_PARAM_TYPE_NONE,
+					      TEE_PARAM_TYPE_GET(param_types, 3));
+	}
+
+	return digest(param_types, params, SHA256_DIGEST_SIZE, sha256_fast);
+}
+
+TEE_Result ta_entry_sha384(uint32_t param_types, TEE_Param params[4])
+{
+	return digest(param_types, params, SHA384_DIGEST_SIZE, sha384);
+}
+
+TEE_Result ta_entry_sha512(uint32_t param_types, TEE_Param params[4])
+{
+	return digest(param_types, params, SHA512_DIGEST_SIZE, sha512);
+}
@@ -3,6 +3,9 @@ srcs-y += aes_impl.c
 srcs-y += aes_taf.c
 srcs-y += cryp_taf.c
 srcs-y += sha2_impl.c
+# SHA-256 on the ARMv8 Cryptographic Extension, AArch64 TAs only
+cppflags-sha2_impl.c-$(CFG_CRYPT_SHA2_CE) += -DCFG_CRYPT_SHA2_CE
+cflags-sha2_impl.c-$(CFG_CRYPT_SHA2_CE) += -march=armv8-a+crypto
 srcs-y += sha2_taf.c
 srcs-$(CFG_SYSTEM_PTA) += seed_rng_taf.c
 srcs-y += ta_entry.c
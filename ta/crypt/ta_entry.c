@@ -37,6 +37,8 @@
 
 static TEE_Result set_global(uint32_t param_types, TEE_Param params[4]);
 static TEE_Result get_global(uint32_t param_types, TEE_Param params[4]);
+static TEE_Result batch(void *session, uint32_t param_types,
+			TEE_Param params[4]);
 static int _globalvalue;
 
 /*
@@ -106,6 +108,13 @@ TEE_Result TA_InvokeCommandEntryPoint(void *pSessionContext,
 		else
 			return ta_entry_sha256(nParamTypes, pParams);
 
+	case TA_CRYPT_CMD_SHA256_FAST:
+		return ta_entry_sha256_fast(nParamTypes, pParams);
+	case TA_CRYPT_CMD_SHA384:
+		return ta_entry_sha384(nParamTypes, pParams);
+	case TA_CRYPT_CMD_SHA512:
+		return ta_entry_sha512(nParamTypes, pParams);
+
 	case TA_CRYPT_CMD_AES256ECB_ENC:
 		return ta_entry_aes256ecb_encrypt(nParamTypes, pParams);
 
@@ -118,6 +127,12 @@ TEE_Result TA_InvokeCommandEntryPoint(void *pSessionContext,
 	case TA_CRYPT_CMD_FREE_OPERATION:
 		return ta_entry_free_operation(nParamTypes, pParams);
 
+	case TA_CRYPT_CMD_OPERATION_POOL:
+		return ta_entry_operation_pool(nParamTypes, pParams);
+
+	case TA_CRYPT_CMD_OPERATION_POOL_STATS:
+		return ta_entry_operation_pool_stats(nParamTypes, pParams);
+
 	case TA_CRYPT_CMD_GET_OPERATION_INFO:
 		return ta_entry_get_operation_info(nParamTypes, pParams);
 
@@ -297,6 +312,12 @@ TEE_Result TA_InvokeCommandEntryPoint(void *pSessionContext,
 		return ta_entry_arith_from_fmm(nParamTypes, pParams);
 	case TA_CRYPT_CMD_ARITH_COMPUTE_FMM:
 		return ta_entry_arith_compute_fmm(nParamTypes, pParams);
+	case TA_CRYPT_CMD_ARITH_PROGRAM:
+		return ta_entry_arith_program(nParamTypes, pParams);
+	case TA_CRYPT_CMD_ARITH_HANDLE_BENCH:
+		return ta_entry_arith_handle_bench(nParamTypes, pParams);
+	case TA_CRYPT_CMD_BATCH:
+		return batch(pSessionContext, nParamTypes, pParams);
 
 	default:
 		return TEE_ERROR_BAD_PARAMETERS;
@@ -338,3 +359,133 @@ static TEE_Result get_global(uint32_t param_types, TEE_Param params[4])
 	params[0].value.a = _globalvalue;
 	return TEE_SUCCESS;
 }
+
+/*
+ * Sets up the parameters of a step of a batch, resolving the references
+ * to earlier steps. Memrefs must be in the data area, after the steps.
+ */
+static TEE_Result batch_params(struct ta_crypt_batch_step *steps, size_t idx,
+			       struct ta_crypt_batch_step *st, uint8_t *buf,
+			       size_t data_offs, size_t size,
+			       TEE_Param params[4])
+{
+	size_t n = 0;
+	size_t f = 0;
+
+	for (n = 0; n < 4; n++) {
+		switch (TEE_PARAM_TYPE_GET(st->param_types, n)) {
+		case TEE_PARAM_TYPE_NONE:
+			break;
+		case TEE_PARAM_TYPE_VALUE_INPUT:
+		case TEE_PARAM_TYPE_VALUE_OUTPUT:
+		case TEE_PARAM_TYPE_VALUE_INOUT:
+			for (f = 0; f < 2; f++) {
+				uint32_t ref = st->p[n][f];
+
+				if (!(st->refs & TA_CRYPT_BATCH_REF_BIT(n, f)))
+					continue;
+				if ((ref >> 3) >= idx)
+					return TEE_ERROR_BAD_PARAMETERS;
+				st->p[n][f] = steps[ref >> 3].p[(ref >> 1) & 3]
+							  [ref & 1];
+			}
+			params[n].value.a = st->p[n][0];
+			params[n].value.b = st->p[n][1];
+			break;
+		case TEE_PARAM_TYPE_MEMREF_INPUT:
+		case TEE_PARAM_TYPE_MEMREF_OUTPUT:
+		case TEE_PARAM_TYPE_MEMREF_INOUT:
+			if (st->p[n][0] < data_offs || st->p[n][0] > size ||
+			    st->p[n][1] > size - st->p[n][0])
+				return TEE_ERROR_BAD_PARAMETERS;
+			params[n].memref.buffer = buf + st->p[n][0];
+			params[n].memref.size = st->p[n][1];
+			break;
+		default:
+			return TEE_ERROR_BAD_PARAMETERS;
+		}
+	}
+	return TEE_SUCCESS;
+}
+
+static void batch_outputs(struct ta_crypt_batch_step *st, TEE_Param params[4])
+{
+	size_t n = 0;
+
+	for (n = 0; n < 4; n++) {
+		switch (TEE_PARAM_TYPE_GET(st->param_types, n)) {
+		case TEE_PARAM_TYPE_VALUE_OUTPUT:
+		case TEE_PARAM_TYPE_VALUE_INOUT:
+			st->p[n][0] = params[n].value.a;
+			st->p[n][1] = params[n].value.b;
+			break;
+		case TEE_PARAM_TYPE_MEMREF_OUTPUT:
+		case TEE_PARAM_TYPE_MEMREF_INOUT:
+			st->p[n][1] = params[n].memref.size;
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+static TEE_Result batch(void *session, uint32_t param_types,
+			TEE_Param params[4])
+{
+	struct ta_crypt_batch_hdr *hdr = NULL;
+	struct ta_crypt_batch_step *steps = NULL;
+	struct ta_crypt_batch_step st = { };
+	TEE_Param sub_params[4] = { };
+	uint8_t *buf = NULL;
+	size_t size = 0;
+	size_t data_offs = 0;
+	uint32_t num_steps = 0;
+	uint32_t n = 0;
+
+	if (param_types != TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INOUT,
+					   TEE_PARAM_TYPE_NONE,
+					   TEE_PARAM_TYPE_NONE,
+					   TEE_PARAM_TYPE_NONE))
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	buf = params[0].memref.buffer;
+	size = params[0].memref.size;
+	if (size < sizeof(*hdr) || ((uintptr_t)buf & (sizeof(uint32_t) - 1)))
+		return TEE_ERROR_BAD_PARAMETERS;
+	hdr = (struct ta_crypt_batch_hdr *)(void *)buf;
+	steps = (struct ta_crypt_batch_step *)(void *)(hdr + 1);
+
+	/* The buffer is shared with the client, only read it once */
+	num_steps = hdr->num_steps;
+	if (num_steps > (size - sizeof(*hdr)) / sizeof(*steps))
+		return TEE_ERROR_BAD_PARAMETERS;
+	data_offs = sizeof(*hdr) + num_steps * sizeof(*steps);
+
+	for (n = 0; n < num_steps; n++) {
+		TEE_MemMove(&st, steps + n, sizeof(st));
+		TEE_MemFill(sub_params, 0, sizeof(sub_params));
+
+		if (st.cmd == TA_CRYPT_CMD_BATCH)
+			st.res = TEE_ERROR_BAD_PARAMETERS;
+		else
+			st.res = batch_params(steps, n, &st, buf, data_offs,
+					      size, sub_params);
+		if (st.res == TEE_SUCCESS) {
+			st.res = TA_InvokeCommandEntryPoint(session, st.cmd,
+							    st.param_types,
+							    sub_params);
+			/* Like an invoke, report the size a short buffer needs */
+			if (st.res == TEE_SUCCESS ||
+			    st.res == TEE_ERROR_SHORT_BUFFER)
+				batch_outputs(&st, sub_params);
+		}
+
+		TEE_MemMove(steps + n, &st, sizeof(st));
+		if (st.res != TEE_SUCCESS) {
+			n++;
+			break;
+		}
+	}
+	hdr->num_done = n;
+	return TEE_SUCCESS;
+}
@@ -28,6 +28,8 @@
 #ifndef TA_SHA_PERF_H
 #define TA_SHA_PERF_H
 
+#include <stdint.h>
+
 #define TA_SHA_PERF_UUID { 0x614789f2, 0x39c0, 0x4ebf, \
 	{ 0xb2, 0x35, 0x92, 0xb3, 0x2a, 0xc1, 0x07, 0xed } }
 
@@ -35,8 +37,47 @@
  * Commands implemented by the TA
  */
 
+/*
+ * PREPARE_OP
+ * [in] value[0].a: algorithm (TA_SHA_*), value[0].b: TA_SHA_PERF_FLAG_*
+ * HMAC operations use a fixed 256-bit key. Returns TEE_ERROR_NOT_SUPPORTED
+ * for algorithms the TEE does not implement.
+ */
 #define TA_SHA_PERF_CMD_PREPARE_OP	0
+/*
+ * PROCESS accepts an optional value[3] output. When present, value[3].a
+ * returns the time spent in the processing loop in microseconds and
+ * value[3].b the resolution of that measurement in microseconds.
+ * As inout, value[3].a also sets the update size: the buffer is then hashed
+ * with TEE_DigestUpdate() calls of that many bytes and a final
+ * TEE_DigestDoFinal() on the last chunk (0: a single TEE_DigestDoFinal()).
+ */
 #define TA_SHA_PERF_CMD_PROCESS		1
+/*
+ * Invocation baseline: NULL takes no parameter and does nothing, VALUE
+ * copies value[0] (in) to value[1] (out). Used to measure the cost of the
+ * TA invocation path alone.
+ */
+#define TA_SHA_PERF_CMD_NULL		2
+#define TA_SHA_PERF_CMD_VALUE		3
+/*
+ * Streaming into the digest operation across invocations
+ * UPDATE: [in] memref[0]: data, [in] value[1].a: update size (0: one
+ * TEE_DigestUpdate() for the whole buffer), [out] value[2]: time spent
+ * hashing as for PROCESS
+ * FINAL: [out] memref[0]: digest of the data of all the UPDATE invocations
+ * since the previous FINAL or PREPARE_OP
+ */
+#define TA_SHA_PERF_CMD_UPDATE		4
+#define TA_SHA_PERF_CMD_FINAL		5
+/*
+ * Hash several messages in one invocation
+ * [in]  memref[0]: messages
+ * [out] memref[1]: digests, one after the other in the order of the table
+ * [in]  memref[2]: array of struct ta_sha_perf_msg
+ * [out] value[3]: time spent hashing as for PROCESS
+ */
+#define TA_SHA_PERF_CMD_PROCESS_BATCH	6
 
 /*
  * Supported algorithms
@@ -47,5 +88,25 @@
 #define TA_SHA_SHA256	2
 #define TA_SHA_SHA384	3
 #define TA_SHA_SHA512	4
+#define TA_SHA_HMAC_SHA1	5
+#define TA_SHA_HMAC_SHA256	6
+#define TA_SHA_HMAC_SHA512	7
+#define TA_SHA_SHA3_224	8
+#define TA_SHA_SHA3_256	9
+#define TA_SHA_SHA3_384	10
+#define TA_SHA_SHA3_512	11
+
+/*
+ * Re-initialize the operation before each message: TEE_ResetOperation(),
+ * and for HMAC TEE_SetOperationKey() again, as when the key changes for
+ * each message.
+ */
+#define TA_SHA_PERF_FLAG_REINIT	(1 << 0)
+
+/* Message at [offset, offset + len) of the PROCESS_BATCH input buffer */
+struct ta_sha_perf_msg {
+	uint32_t offset;
+	uint32_t len;
+};
 
 #endif /* TA_SHA_PERF_H */
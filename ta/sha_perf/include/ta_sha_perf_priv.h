@@ -32,6 +32,10 @@
 
 TEE_Result cmd_prepare_op(uint32_t param_types, TEE_Param params[4]);
 TEE_Result cmd_process(uint32_t param_types, TEE_Param params[4]);
+TEE_Result cmd_value(uint32_t param_types, TEE_Param params[4]);
+TEE_Result cmd_update(uint32_t param_types, TEE_Param params[4]);
+TEE_Result cmd_final(uint32_t param_types, TEE_Param params[4]);
+TEE_Result cmd_process_batch(uint32_t param_types, TEE_Param params[4]);
 void cmd_clean_res(void);
 
 #endif /* TA_SHA_PERF_PRIV_H */
@@ -78,6 +78,18 @@ TEE_Result TA_InvokeCommandEntryPoint(void *pSessionContext,
 	case TA_SHA_PERF_CMD_PROCESS:
 		return cmd_process(nParamTypes, pParams);
 
+	case TA_SHA_PERF_CMD_NULL:
+		return TEE_SUCCESS;
+	case TA_SHA_PERF_CMD_VALUE:
+		return cmd_value(nParamTypes, pParams);
+
+	case TA_SHA_PERF_CMD_UPDATE:
+		return cmd_update(nParamTypes, pParams);
+	case TA_SHA_PERF_CMD_FINAL:
+		return cmd_final(nParamTypes, pParams);
+	case TA_SHA_PERF_CMD_PROCESS_BATCH:
+		return cmd_process_batch(nParamTypes, pParams);
+
 	default:
 		return TEE_ERROR_BAD_PARAMETERS;
 	}
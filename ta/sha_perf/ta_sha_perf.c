@@ -40,23 +40,98 @@
 		}					\
 	} while(0)
 
+#define HMAC_KEY_BITS	256
+
 static TEE_OperationHandle digest_op = NULL;
 
+/* HMAC algorithms: digest_op is a MAC operation keyed with mac_key */
+static bool is_mac;
+static TEE_ObjectHandle mac_key = TEE_HANDLE_NULL;
+static uint32_t op_flags;
+/* Streaming: a message is in progress since the first UPDATE */
+static bool streaming;
+
+static const uint8_t hmac_key[HMAC_KEY_BITS / 8] = {
+	0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+	0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F,
+	0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17,
+	0x18, 0x19, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F,
+};
+
+/* Elapsed secure time in microseconds, 1 ms resolution */
+static uint32_t elapsed_us(TEE_Time *t0, TEE_Time *t1)
+{
+	return (t1->seconds - t0->seconds) * 1000000 +
+	       (t1->millis - t0->millis) * 1000;
+}
+
+/* Start a new message */
+static TEE_Result op_init(void)
+{
+	TEE_Result res;
+
+	if (op_flags & TA_SHA_PERF_FLAG_REINIT) {
+		TEE_ResetOperation(digest_op);
+		if (is_mac) {
+			res = TEE_SetOperationKey(digest_op, mac_key);
+			CHECK(res, "TEE_SetOperationKey", return res;);
+		}
+	}
+	if (is_mac)
+		TEE_MACInit(digest_op, NULL, 0);
+	return TEE_SUCCESS;
+}
+
+static void op_update(const void *chunk, uint32_t len)
+{
+	if (is_mac)
+		TEE_MACUpdate(digest_op, chunk, len);
+	else
+		TEE_DigestUpdate(digest_op, chunk, len);
+}
+
+static TEE_Result op_final(const void *chunk, uint32_t len, void *out,
+			   uint32_t *outsz)
+{
+	if (is_mac)
+		return TEE_MACComputeFinal(digest_op, chunk, len, out, outsz);
+	return TEE_DigestDoFinal(digest_op, chunk, len, out, outsz);
+}
+
 TEE_Result cmd_process(uint32_t param_types, TEE_Param params[4])
 {
 	TEE_Result res;
 	int n;
-	void *in, *out;
+	uint8_t *in;
+	void *out;
 	uint32_t insz;
 	uint32_t outsz;
 	uint32_t offset;
+	uint32_t unit = 0;
+	uint32_t off;
+	bool timed = false;
+	TEE_Time t0, t1;
 	uint32_t exp_param_types = TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT,
 						   TEE_PARAM_TYPE_MEMREF_OUTPUT,
 						   TEE_PARAM_TYPE_VALUE_INPUT,
 						   TEE_PARAM_TYPE_NONE);
 
-	if (param_types != exp_param_types)
+	/*
+	 * Optional value[3] output: time spent in the processing loop.
+	 * As inout, value[3].a also sets the update size.
+	 */
+	if (param_types == (exp_param_types |
+			    TEE_PARAM_TYPES(0, 0, 0,
+					    TEE_PARAM_TYPE_VALUE_OUTPUT))) {
+		timed = true;
+	} else if (param_types == (exp_param_types |
+				   TEE_PARAM_TYPES(0, 0, 0,
+						TEE_PARAM_TYPE_VALUE_INOUT))) {
+		timed = true;
+		unit = params[3].value.a;
+	} else if (param_types != exp_param_types) {
 		return TEE_ERROR_BAD_PARAMETERS;
+	}
 
 	offset = params[2].value.b;
 	in = (uint8_t *)params[0].memref.buffer + offset;
@@ -65,17 +140,107 @@ TEE_Result cmd_process(uint32_t param_types, TEE_Param params[4])
 	outsz = params[1].memref.size;
 	n = params[2].value.a;
 
+	if (!digest_op)
+		return TEE_ERROR_BAD_STATE;
+	streaming = false;
+
+	if (timed)
+		TEE_GetSystemTime(&t0);
+
 	while (n--) {
-		res = TEE_DigestDoFinal(digest_op, in, insz, out, &outsz);
-		CHECK(res, "TEE_DigestDoFinal", return res;);
+		res = op_init();
+		if (res != TEE_SUCCESS)
+			return res;
+		off = 0;
+		/* All the units but the last one go through op_update() */
+		if (unit)
+			for (; insz - off > unit; off += unit)
+				op_update(in + off, unit);
+		res = op_final(in + off, insz - off, out, &outsz);
+		CHECK(res, "TEE_DigestDoFinal/TEE_MACComputeFinal",
+		      return res;);
+	}
+
+	if (timed) {
+		TEE_GetSystemTime(&t1);
+		params[3].value.a = elapsed_us(&t0, &t1);
+		params[3].value.b = 1000;
 	}
 	return TEE_SUCCESS;
 }
 
+TEE_Result cmd_process_batch(uint32_t param_types, TEE_Param params[4])
+{
+	TEE_Result res;
+	TEE_OperationInfo info;
+	const struct ta_sha_perf_msg *table;
+	struct ta_sha_perf_msg m;
+	const uint8_t *in;
+	uint8_t *out;
+	uint32_t insz;
+	uint32_t outsz;
+	uint32_t dsz;
+	uint32_t count;
+	uint32_t i;
+	TEE_Time t0, t1;
+	uint32_t exp_param_types = TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT,
+						   TEE_PARAM_TYPE_MEMREF_OUTPUT,
+						   TEE_PARAM_TYPE_MEMREF_INPUT,
+						   TEE_PARAM_TYPE_VALUE_OUTPUT);
+
+	if (param_types != exp_param_types)
+		return TEE_ERROR_BAD_PARAMETERS;
+	if (!digest_op)
+		return TEE_ERROR_BAD_STATE;
+
+	in = params[0].memref.buffer;
+	insz = params[0].memref.size;
+	out = params[1].memref.buffer;
+	outsz = params[1].memref.size;
+	table = params[2].memref.buffer;
+	count = params[2].memref.size / sizeof(*table);
+	if (!count || params[2].memref.size % sizeof(*table))
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	TEE_GetOperationInfo(digest_op, &info);
+	dsz = info.digestLength;
+	if (!dsz)
+		return TEE_ERROR_BAD_STATE;
+	if (outsz / dsz < count) {
+		params[1].memref.size = count * dsz;
+		return TEE_ERROR_SHORT_BUFFER;
+	}
+	streaming = false;
+
+	TEE_GetSystemTime(&t0);
+	for (i = 0; i < count; i++) {
+		/* Shared memory: copy before checking */
+		memcpy(&m, table + i, sizeof(m));
+		if (m.offset > insz || m.len > insz - m.offset)
+			return TEE_ERROR_BAD_PARAMETERS;
+
+		res = op_init();
+		if (res != TEE_SUCCESS)
+			return res;
+		outsz = dsz;
+		res = op_final(in + m.offset, m.len, out + i * dsz, &outsz);
+		CHECK(res, "TEE_DigestDoFinal/TEE_MACComputeFinal",
+		      return res;);
+	}
+	TEE_GetSystemTime(&t1);
+
+	params[1].memref.size = count * dsz;
+	params[3].value.a = elapsed_us(&t0, &t1);
+	params[3].value.b = 1000;
+	return TEE_SUCCESS;
+}
+
 TEE_Result cmd_prepare_op(uint32_t param_types, TEE_Param params[4])
 {
 	TEE_Result res;
+	TEE_Attribute attr;
 	uint32_t algo;
+	uint32_t key_type = 0;
 
 	uint32_t exp_param_types = TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
 						   TEE_PARAM_TYPE_NONE,
@@ -100,22 +265,165 @@ TEE_Result cmd_prepare_op(uint32_t param_types, TEE_Param params[4])
 	case TA_SHA_SHA512:
 		algo = TEE_ALG_SHA512;
 		break;
+	case TA_SHA_HMAC_SHA1:
+		algo = TEE_ALG_HMAC_SHA1;
+		key_type = TEE_TYPE_HMAC_SHA1;
+		break;
+	case TA_SHA_HMAC_SHA256:
+		algo = TEE_ALG_HMAC_SHA256;
+		key_type = TEE_TYPE_HMAC_SHA256;
+		break;
+	case TA_SHA_HMAC_SHA512:
+		algo = TEE_ALG_HMAC_SHA512;
+		key_type = TEE_TYPE_HMAC_SHA512;
+		break;
+#ifdef TEE_ALG_SHA3_224
+	case TA_SHA_SHA3_224:
+		algo = TEE_ALG_SHA3_224;
+		break;
+	case TA_SHA_SHA3_256:
+		algo = TEE_ALG_SHA3_256;
+		break;
+	case TA_SHA_SHA3_384:
+		algo = TEE_ALG_SHA3_384;
+		break;
+	case TA_SHA_SHA3_512:
+		algo = TEE_ALG_SHA3_512;
+		break;
+#else
+	case TA_SHA_SHA3_224:
+	case TA_SHA_SHA3_256:
+	case TA_SHA_SHA3_384:
+	case TA_SHA_SHA3_512:
+		return TEE_ERROR_NOT_SUPPORTED;
+#endif
 	default:
 		return TEE_ERROR_BAD_PARAMETERS;
 	}
 
-	if (digest_op)
-		TEE_FreeOperation(digest_op);
+	cmd_clean_res();
+	is_mac = key_type;
+	op_flags = params[0].value.b;
 
-	res = TEE_AllocateOperation(&digest_op, algo, TEE_MODE_DIGEST, 0);
+	if (!is_mac) {
+		res = TEE_AllocateOperation(&digest_op, algo, TEE_MODE_DIGEST,
+					    0);
+		CHECK(res, "TEE_AllocateOperation", return res;);
+		return TEE_SUCCESS;
+	}
+
+	res = TEE_AllocateOperation(&digest_op, algo, TEE_MODE_MAC,
+				    HMAC_KEY_BITS);
 	CHECK(res, "TEE_AllocateOperation", return res;);
 
+	res = TEE_AllocateTransientObject(key_type, HMAC_KEY_BITS, &mac_key);
+	CHECK(res, "TEE_AllocateTransientObject", return res;);
+
+	TEE_InitRefAttribute(&attr, TEE_ATTR_SECRET_VALUE, hmac_key,
+			     sizeof(hmac_key));
+	res = TEE_PopulateTransientObject(mac_key, &attr, 1);
+	CHECK(res, "TEE_PopulateTransientObject", return res;);
+
+	res = TEE_SetOperationKey(digest_op, mac_key);
+	CHECK(res, "TEE_SetOperationKey", return res;);
+
+	return TEE_SUCCESS;
+}
+
+
+TEE_Result cmd_value(uint32_t param_types, TEE_Param params[4])
+{
+	uint32_t exp_param_types = TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
+						   TEE_PARAM_TYPE_VALUE_OUTPUT,
+						   TEE_PARAM_TYPE_NONE,
+						   TEE_PARAM_TYPE_NONE);
+
+	if (param_types != exp_param_types)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	params[1].value.a = params[0].value.a;
+	params[1].value.b = params[0].value.b;
+	return TEE_SUCCESS;
+}
+
+TEE_Result cmd_update(uint32_t param_types, TEE_Param params[4])
+{
+	TEE_Result res;
+	const uint8_t *in;
+	uint32_t insz;
+	uint32_t unit;
+	uint32_t off;
+	uint32_t len;
+	TEE_Time t0, t1;
+	uint32_t exp_param_types = TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT,
+						   TEE_PARAM_TYPE_VALUE_INPUT,
+						   TEE_PARAM_TYPE_VALUE_OUTPUT,
+						   TEE_PARAM_TYPE_NONE);
+
+	if (param_types != exp_param_types)
+		return TEE_ERROR_BAD_PARAMETERS;
+	if (!digest_op)
+		return TEE_ERROR_BAD_STATE;
+
+	in = params[0].memref.buffer;
+	insz = params[0].memref.size;
+	unit = params[1].value.a;
+	if (!unit)
+		unit = insz;
+
+	TEE_GetSystemTime(&t0);
+	if (!streaming) {
+		res = op_init();
+		if (res != TEE_SUCCESS)
+			return res;
+		streaming = true;
+	}
+	for (off = 0; off < insz; off += len) {
+		len = insz - off < unit ? insz - off : unit;
+		op_update(in + off, len);
+	}
+	TEE_GetSystemTime(&t1);
+
+	params[2].value.a = elapsed_us(&t0, &t1);
+	params[2].value.b = 1000;
 	return TEE_SUCCESS;
 }
 
+TEE_Result cmd_final(uint32_t param_types, TEE_Param params[4])
+{
+	TEE_Result res;
+	uint32_t outsz;
+	uint32_t exp_param_types = TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_OUTPUT,
+						   TEE_PARAM_TYPE_NONE,
+						   TEE_PARAM_TYPE_NONE,
+						   TEE_PARAM_TYPE_NONE);
+
+	if (param_types != exp_param_types)
+		return TEE_ERROR_BAD_PARAMETERS;
+	if (!digest_op)
+		return TEE_ERROR_BAD_STATE;
+
+	if (!streaming) {
+		res = op_init();
+		if (res != TEE_SUCCESS)
+			return res;
+	}
+	streaming = false;
+
+	outsz = params[0].memref.size;
+	res = op_final(NULL, 0, params[0].memref.buffer, &outsz);
+	CHECK(res, "TEE_DigestDoFinal/TEE_MACComputeFinal", return res;);
+	params[0].memref.size = outsz;
+	return TEE_SUCCESS;
+}
 
 void cmd_clean_res(void)
 {
 	if (digest_op)
-		TEE_FreeOperation(digest_op);	
+		TEE_FreeOperation(digest_op);
+	digest_op = TEE_HANDLE_NULL;
+	TEE_FreeTransientObject(mac_key);
+	mac_key = TEE_HANDLE_NULL;
+	is_mac = false;
+	streaming = false;
 }